@@ -0,0 +1,95 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "../services/elevation/GSIElevationProvider.h"
+
+using services::Coordinate;
+using services::elevation::GSIElevationProvider;
+
+namespace {
+
+// parseTileText は protected なので、ベンチマーク用に公開する
+class BenchGSIElevationProvider : public GSIElevationProvider {
+   public:
+    using GSIElevationProvider::parseTileText;
+};
+
+// GSI の標高タイル (dem5a) と同じ形式: 256 行 x 256 列、欠損は "e"
+const std::string& benchmarkTileText() {
+    static const std::string text = [] {
+        std::mt19937 rng(4);
+        std::uniform_real_distribution<double> elevation(0.0, 800.0);
+        std::uniform_int_distribution<int> missing(0, 99);
+        std::ostringstream ss;
+        for (int y = 0; y < 256; ++y) {
+            for (int x = 0; x < 256; ++x) {
+                if (missing(rng) == 0) {
+                    ss << "e";
+                } else {
+                    ss << std::round(elevation(rng) * 10.0) / 10.0;
+                }
+                if (x < 255) ss << ",";
+            }
+            ss << "\n";
+        }
+        return ss.str();
+    }();
+    return text;
+}
+
+// 約 50m 間隔のランダムウォーク (東京周辺)
+std::vector<Coordinate> benchmarkPath(int vertices) {
+    std::mt19937 rng(5);
+    std::normal_distribution<double> heading(0.0, 0.3);
+    std::vector<Coordinate> path;
+    path.reserve(vertices);
+    Coordinate current{35.68, 139.76};
+    double angle = 0.3;
+    for (int i = 0; i < vertices; ++i) {
+        path.push_back(current);
+        angle += heading(rng);
+        current.lat += 0.00045 * std::sin(angle);
+        current.lon += 0.00055 * std::cos(angle);
+    }
+    return path;
+}
+
+void BM_ParseTileText(benchmark::State& state) {
+    BenchGSIElevationProvider provider;
+    const auto& text = benchmarkTileText();
+    for (auto _ : state) {
+        auto tile = provider.parseTileText(text);
+        benchmark::DoNotOptimize(tile);
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(BM_ParseTileText)->Unit(benchmark::kMillisecond);
+
+void BM_CalculateTileCoord(benchmark::State& state) {
+    auto path = benchmarkPath(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        for (const auto& coord : path) {
+            benchmark::DoNotOptimize(GSIElevationProvider::calculateTileCoord(coord));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CalculateTileCoord)->Arg(1000)->Arg(10000);
+
+void BM_CalculateTileCoordsBatch(benchmark::State& state) {
+    auto path = benchmarkPath(static_cast<int>(state.range(0)));
+    std::vector<GSIElevationProvider::TileCoord> out(path.size());
+    for (auto _ : state) {
+        GSIElevationProvider::calculateTileCoords(path, out);
+        benchmark::DoNotOptimize(out.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CalculateTileCoordsBatch)->Arg(1000)->Arg(10000);
+
+}  // namespace
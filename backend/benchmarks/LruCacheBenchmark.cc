@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../utils/LruCache.h"
+
+using cycling::utils::LruCache;
+
+namespace {
+
+constexpr size_t kCapacity = 1000;
+constexpr int kKeySpace = 2000;
+
+// 標高 L1 と同じ形: "z:x:y" キーとタイル 1 枚分の共有ポインタ
+using TileCache = LruCache<std::string, std::shared_ptr<std::vector<double>>>;
+
+const std::vector<std::string>& benchmarkKeys() {
+    static const std::vector<std::string> keys = [] {
+        std::vector<std::string> result;
+        result.reserve(kKeySpace);
+        for (int i = 0; i < kKeySpace; ++i) {
+            result.push_back("15:" + std::to_string(29000 + i % 64) + ":" +
+                             std::to_string(12900 + i / 64));
+        }
+        return result;
+    }();
+    return keys;
+}
+
+TileCache& sharedCache() {
+    static TileCache cache(kCapacity);
+    static const bool filled = [] {
+        auto tile = std::make_shared<std::vector<double>>(256 * 256, 0.0);
+        const auto& keys = benchmarkKeys();
+        for (size_t i = 0; i < kCapacity; ++i) {
+            cache.put(keys[i], tile);
+        }
+        return true;
+    }();
+    benchmark::DoNotOptimize(filled);
+    return cache;
+}
+
+// 全スレッドで 1 つのキャッシュを共有し、ヒット率およそ 50% で読む
+void BM_LruCacheGet(benchmark::State& state) {
+    auto& cache = sharedCache();
+    const auto& keys = benchmarkKeys();
+    std::mt19937 rng(static_cast<unsigned>(state.thread_index()));
+    std::uniform_int_distribution<int> pick(0, kKeySpace - 1);
+    size_t hits = 0;
+    for (auto _ : state) {
+        auto value = cache.get(keys[pick(rng)]);
+        hits += value.has_value();
+        benchmark::DoNotOptimize(value);
+    }
+    state.counters["hit_rate"] =
+        benchmark::Counter(static_cast<double>(hits), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_LruCacheGet)->ThreadRange(1, 8)->UseRealTime();
+
+// 読み 9 : 書き 1 (ミス時の L2 からの投入を想定)
+void BM_LruCacheGetPut(benchmark::State& state) {
+    auto& cache = sharedCache();
+    const auto& keys = benchmarkKeys();
+    auto tile = std::make_shared<std::vector<double>>(256 * 256, 0.0);
+    std::mt19937 rng(static_cast<unsigned>(state.thread_index()) + 100);
+    std::uniform_int_distribution<int> pick(0, kKeySpace - 1);
+    std::uniform_int_distribution<int> op(0, 9);
+    for (auto _ : state) {
+        const auto& key = keys[pick(rng)];
+        if (op(rng) == 0) {
+            cache.put(key, tile);
+        } else {
+            benchmark::DoNotOptimize(cache.get(key));
+        }
+    }
+}
+BENCHMARK(BM_LruCacheGetPut)->ThreadRange(1, 8)->UseRealTime();
+
+}  // namespace
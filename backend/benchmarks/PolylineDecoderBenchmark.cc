@@ -0,0 +1,126 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../utils/PolylineDecoder.h"
+
+using services::Coordinate;
+using utils::PolylineDecoder;
+
+namespace {
+
+// OSRM の自転車ルートに近い形状: 頂点間隔 10〜60m 程度のランダムウォーク
+const std::string& benchmarkPolyline(int vertices) {
+    static std::map<int, std::string> cache;
+    auto it = cache.find(vertices);
+    if (it != cache.end()) return it->second;
+
+    std::mt19937 rng(3);
+    std::normal_distribution<double> heading(0.0, 0.4);
+    std::uniform_real_distribution<double> stepMeters(10.0, 60.0);
+    std::vector<Coordinate> path;
+    path.reserve(vertices);
+    Coordinate current{35.68, 139.76};
+    double angle = 0.5;
+    for (int i = 0; i < vertices; ++i) {
+        path.push_back(current);
+        angle += heading(rng);
+        double step = stepMeters(rng) / 111000.0;
+        current.lat += step * std::sin(angle);
+        current.lon += step * std::cos(angle) / std::cos(current.lat * M_PI / 180.0);
+    }
+    return cache.emplace(vertices, PolylineDecoder::encode(path)).first->second;
+}
+
+// 比較用: 以前の実装 (1 座標ずつ push_back)
+std::vector<Coordinate> decodePushBack(const std::string& encoded, double precision = 1e5) {
+    std::vector<Coordinate> coordinates;
+    size_t index = 0;
+    size_t len = encoded.length();
+    int lat = 0;
+    int lng = 0;
+    while (index < len) {
+        int b = 0;
+        int shift = 0;
+        int result = 0;
+        do {
+            if (index >= len) break;
+            b = encoded[index++] - 63;
+            result |= (b & 0x1f) << shift;
+            shift += 5;
+        } while (b >= 0x20);
+        lat += ((result & 1) ? ~(result >> 1) : (result >> 1));
+
+        shift = 0;
+        result = 0;
+        do {
+            if (index >= len) break;
+            b = encoded[index++] - 63;
+            result |= (b & 0x1f) << shift;
+            shift += 5;
+        } while (b >= 0x20);
+        lng += ((result & 1) ? ~(result >> 1) : (result >> 1));
+
+        coordinates.push_back({static_cast<double>(lat) / precision,
+                               static_cast<double>(lng) / precision});
+    }
+    return coordinates;
+}
+
+void BM_DecodePushBack(benchmark::State& state) {
+    const auto& encoded = benchmarkPolyline(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        auto coords = decodePushBack(encoded);
+        benchmark::DoNotOptimize(coords.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(encoded.size()));
+}
+BENCHMARK(BM_DecodePushBack)->Arg(1000)->Arg(10000)->Arg(100000);
+
+void BM_Decode(benchmark::State& state) {
+    const auto& encoded = benchmarkPolyline(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        auto coords = PolylineDecoder::decode(encoded);
+        benchmark::DoNotOptimize(coords.data());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(encoded.size()));
+}
+BENCHMARK(BM_Decode)->Arg(1000)->Arg(10000)->Arg(100000);
+
+// バッファを使い回す場合 (確保なし)
+void BM_DecodeIntoReusedBuffer(benchmark::State& state) {
+    const auto& encoded = benchmarkPolyline(static_cast<int>(state.range(0)));
+    std::vector<Coordinate> buffer(PolylineDecoder::countPoints(encoded));
+    for (auto _ : state) {
+        size_t count = PolylineDecoder::decodeInto(encoded, buffer);
+        benchmark::DoNotOptimize(count);
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(encoded.size()));
+}
+BENCHMARK(BM_DecodeIntoReusedBuffer)->Arg(1000)->Arg(10000)->Arg(100000);
+
+void BM_CountPoints(benchmark::State& state) {
+    const auto& encoded = benchmarkPolyline(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(PolylineDecoder::countPoints(encoded));
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(encoded.size()));
+}
+BENCHMARK(BM_CountPoints)->Arg(1000)->Arg(10000)->Arg(100000);
+
+void BM_Encode(benchmark::State& state) {
+    auto coords = PolylineDecoder::decode(benchmarkPolyline(static_cast<int>(state.range(0))));
+    for (auto _ : state) {
+        auto encoded = PolylineDecoder::encode(coords);
+        benchmark::DoNotOptimize(encoded.data());
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Encode)->Arg(1000)->Arg(10000)->Arg(100000);
+
+}  // namespace
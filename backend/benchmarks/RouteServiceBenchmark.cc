@@ -0,0 +1,207 @@
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <memory>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "../services/RouteService.h"
+#include "../services/elevation/GSIElevationProvider.h"
+#include "../services/elevation/IElevationProvider.h"
+#include "../utils/AllocationCounter.h"
+
+using namespace services;
+using services::elevation::GSIElevationProvider;
+using services::elevation::IElevationProvider;
+
+namespace {
+
+// ネットワークを使わない標高プロバイダー (すべてのタイルが L1 に載っている状態を想定)
+class InMemoryElevationProvider : public IElevationProvider {
+   public:
+    void getElevation(const Coordinate& coord, ElevationCallback&& callback) override {
+        callback(getElevationSync(coord));
+    }
+
+    void getElevations(const std::vector<Coordinate>& coords,
+                       ElevationsCallback&& callback) override {
+        std::vector<double> results;
+        results.reserve(coords.size());
+        for (const auto& elevation : getElevationsSync(coords)) {
+            results.push_back(elevation.value_or(0.0));
+        }
+        callback(results);
+    }
+
+    std::optional<double> getElevationSync(const Coordinate& coord) override {
+        auto tc = GSIElevationProvider::calculateTileCoord(coord);
+        return (*tile(tc))[tc.pixel_y * 256 + tc.pixel_x];
+    }
+
+    std::vector<std::optional<double>> getElevationsSync(
+        std::span<const Coordinate> coords) override {
+        return lookup(GSIElevationProvider::calculateTileCoords(coords));
+    }
+
+    std::vector<std::optional<double>> getElevationsSyncE7(
+        std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) override {
+        std::vector<GSIElevationProvider::TileCoord> tileCoords(latsE7.size());
+        GSIElevationProvider::calculateTileCoords(latsE7, lonsE7, tileCoords);
+        return lookup(tileCoords);
+    }
+
+   private:
+    std::vector<std::optional<double>> lookup(
+        const std::vector<GSIElevationProvider::TileCoord>& tileCoords) {
+        std::vector<std::optional<double>> results(tileCoords.size());
+        const std::vector<double>* current = nullptr;
+        for (size_t i = 0; i < tileCoords.size(); ++i) {
+            const auto& tc = tileCoords[i];
+            if (i == 0 || !GSIElevationProvider::sameTile(tc, tileCoords[i - 1])) {
+                current = tile(tc);
+            }
+            results[i] = (*current)[tc.pixel_y * 256 + tc.pixel_x];
+        }
+        return results;
+    }
+
+    // 初回参照時に、タイル位置から決まる起伏を持つタイルを作る
+    const std::vector<double>* tile(const GSIElevationProvider::TileCoord& tc) {
+        int64_t key = (static_cast<int64_t>(tc.x) << 32) | static_cast<uint32_t>(tc.y);
+        auto it = tiles_.find(key);
+        if (it == tiles_.end()) {
+            std::vector<double> data(256 * 256);
+            for (int y = 0; y < 256; ++y) {
+                for (int x = 0; x < 256; ++x) {
+                    data[y * 256 + x] = 100.0 + 50.0 * std::sin((tc.x * 256 + x) * 0.01) +
+                                        50.0 * std::cos((tc.y * 256 + y) * 0.013);
+                }
+            }
+            it = tiles_.emplace(key, std::move(data)).first;
+        }
+        return &it->second;
+    }
+
+    std::unordered_map<int64_t, std::vector<double>> tiles_;
+};
+
+// ENABLE_ALLOCATION_COUNTING でビルドしたときは、1 回あたりのヒープ確保の回数とバイト数も出す
+void reportAllocations(benchmark::State& state, const utils::AllocationCount& before) {
+    if (!utils::AllocationCounter::enabled()) return;
+    auto delta = utils::AllocationCounter::thisThread() - before;
+    state.counters["allocs"] = benchmark::Counter(static_cast<double>(delta.allocations),
+                                                  benchmark::Counter::kAvgIterations);
+    state.counters["alloc_bytes"] = benchmark::Counter(static_cast<double>(delta.bytes),
+                                                       benchmark::Counter::kAvgIterations);
+}
+
+// 交差点の間隔およそ 50m のルート
+std::vector<Coordinate> benchmarkPath(int vertices) {
+    std::mt19937 rng(6);
+    std::normal_distribution<double> heading(0.0, 0.3);
+    std::vector<Coordinate> path;
+    path.reserve(vertices);
+    Coordinate current{35.2, 136.9};
+    double angle = 0.8;
+    for (int i = 0; i < vertices; ++i) {
+        path.push_back(current);
+        angle += heading(rng);
+        current.lat += 0.00045 * std::sin(angle);
+        current.lon += 0.00055 * std::cos(angle);
+    }
+    return path;
+}
+
+// OSRM の route 応答 (steps あり) と同じ入れ子構造。1 ステップあたり交差点 5 個
+osrm::json::Object benchmarkOsrmResult(int intersectionCount) {
+    auto path = benchmarkPath(intersectionCount);
+    osrm::json::Array steps;
+    for (size_t begin = 0; begin < path.size(); begin += 5) {
+        osrm::json::Array intersections;
+        for (size_t i = begin; i < std::min(begin + 5, path.size()); ++i) {
+            osrm::json::Array location;
+            location.values.push_back(osrm::json::Number(path[i].lon));
+            location.values.push_back(osrm::json::Number(path[i].lat));
+            osrm::json::Object intersection;
+            intersection.values["location"] = location;
+            intersections.values.push_back(intersection);
+        }
+        osrm::json::Object step;
+        step.values["intersections"] = intersections;
+        steps.values.push_back(step);
+    }
+
+    osrm::json::Object leg;
+    leg.values["steps"] = steps;
+    osrm::json::Array legs;
+    legs.values.push_back(leg);
+
+    osrm::json::Object route;
+    route.values["distance"] = osrm::json::Number(intersectionCount * 50.0);
+    route.values["duration"] = osrm::json::Number(intersectionCount * 10.0);
+    route.values["geometry"] = osrm::json::String("");
+    route.values["legs"] = legs;
+    osrm::json::Array routes;
+    routes.values.push_back(route);
+
+    osrm::json::Object result;
+    result.values["routes"] = routes;
+    return result;
+}
+
+// 候補の生成と選択のみを測る (evaluator は OSRM を呼ばず、経由地の数から結果を作る)
+void BM_FindBestRouteCandidates(benchmark::State& state) {
+    RouteService service;
+    Coordinate start{35.681236, 139.767125};
+    Coordinate end{35.714074, 139.774109};
+    double targetDistanceKm = static_cast<double>(state.range(0));
+    size_t evaluated = 0;
+    auto evaluator = [&evaluated](const std::vector<Coordinate>& waypoints) {
+        evaluated++;
+        RouteResult result;
+        result.distance_m = 5000.0 + 4000.0 * static_cast<double>(waypoints.size());
+        result.duration_s = result.distance_m / 5.0;
+        result.elevation_gain_m = 20.0 * static_cast<double>(waypoints.size());
+        return std::optional<RouteResult>(std::move(result));
+    };
+    auto allocationsBefore = utils::AllocationCounter::thisThread();
+    for (auto _ : state) {
+        auto best = service.findBestRoute(start, end, {}, targetDistanceKm, 100.0, evaluator);
+        benchmark::DoNotOptimize(best);
+    }
+    reportAllocations(state, allocationsBefore);
+    state.counters["candidates"] =
+        benchmark::Counter(static_cast<double>(evaluated), benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_FindBestRouteCandidates)->Arg(5)->Arg(30)->Arg(100);
+
+// 標高計算を含まない抽出のみ (プロバイダーなし)
+void BM_ProcessRoute(benchmark::State& state) {
+    RouteService service;
+    auto osrmResult = benchmarkOsrmResult(static_cast<int>(state.range(0)));
+    auto allocationsBefore = utils::AllocationCounter::thisThread();
+    for (auto _ : state) {
+        auto result = service.processRoute(osrmResult);
+        benchmark::DoNotOptimize(result);
+    }
+    reportAllocations(state, allocationsBefore);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_ProcessRoute)->Arg(500)->Arg(5000);
+
+void BM_CalculateElevationGain(benchmark::State& state) {
+    RouteService service(std::make_shared<InMemoryElevationProvider>());
+    CompactPath path = benchmarkPath(static_cast<int>(state.range(0)));
+    // タイルの生成を計測から外す
+    service.calculateElevationGain(path);
+    auto allocationsBefore = utils::AllocationCounter::thisThread();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(service.calculateElevationGain(path));
+    }
+    reportAllocations(state, allocationsBefore);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_CalculateElevationGain)->Arg(500)->Arg(5000);
+
+}  // namespace
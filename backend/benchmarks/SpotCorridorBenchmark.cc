@@ -0,0 +1,97 @@
+#include <benchmark/benchmark.h>
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../services/SpotIndex.h"
+
+using namespace services;
+
+namespace {
+
+constexpr int kSpotCount = 100000;
+constexpr int kRouteVertices = 2000;
+
+// 中部地方程度の範囲にスポットを一様に配置する
+const std::vector<Spot>& benchmarkSpots() {
+    static const std::vector<Spot> spots = [] {
+        std::mt19937 rng(1);
+        std::uniform_real_distribution<double> lat(34.5, 36.5);
+        std::uniform_real_distribution<double> lon(136.0, 138.5);
+        std::vector<Spot> result;
+        result.reserve(kSpotCount);
+        for (int i = 0; i < kSpotCount; ++i) {
+            result.push_back({"spot" + std::to_string(i), "cafe", lat(rng), lon(rng), 4.0});
+        }
+        return result;
+    }();
+    return spots;
+}
+
+// 頂点間隔およそ 50m のランダムウォーク (約 100km のルート)
+const std::vector<Coordinate>& benchmarkRoute() {
+    static const std::vector<Coordinate> route = [] {
+        std::mt19937 rng(2);
+        std::normal_distribution<double> heading(0.0, 0.3);
+        std::vector<Coordinate> result;
+        result.reserve(kRouteVertices);
+        Coordinate current{35.2, 136.9};
+        double angle = 0.8;
+        for (int i = 0; i < kRouteVertices; ++i) {
+            result.push_back(current);
+            angle += heading(rng);
+            current.lat += 0.00045 * std::sin(angle);
+            current.lon += 0.00055 * std::cos(angle);
+        }
+        return result;
+    }();
+    return route;
+}
+
+void BM_SpotIndexBuild(benchmark::State& state) {
+    const auto& spots = benchmarkSpots();
+    for (auto _ : state) {
+        SpotIndex index(spots);
+        benchmark::DoNotOptimize(index.size());
+    }
+    state.SetItemsProcessed(state.iterations() * kSpotCount);
+}
+BENCHMARK(BM_SpotIndexBuild)->Unit(benchmark::kMillisecond);
+
+void BM_CorridorQuery(benchmark::State& state) {
+    static const SpotIndex index(benchmarkSpots());
+    const auto& route = benchmarkRoute();
+    double buffer = static_cast<double>(state.range(0));
+    size_t found = 0;
+    for (auto _ : state) {
+        auto hits = index.queryCorridor(route, buffer);
+        found = hits.size();
+        benchmark::DoNotOptimize(hits.data());
+    }
+    state.counters["spots"] = static_cast<double>(found);
+}
+BENCHMARK(BM_CorridorQuery)->Arg(200)->Arg(500)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+// 比較用: 頂点ごとの半径検索 (区間の間のスポットは拾えない)
+void BM_PerVertexRadiusQuery(benchmark::State& state) {
+    static const SpotIndex index(benchmarkSpots());
+    const auto& route = benchmarkRoute();
+    double buffer = static_cast<double>(state.range(0));
+    for (auto _ : state) {
+        std::vector<bool> seen(index.size(), false);
+        size_t found = 0;
+        for (const auto& point : route) {
+            for (size_t id : index.queryRadius(point, buffer)) {
+                if (!seen[id]) {
+                    seen[id] = true;
+                    found++;
+                }
+            }
+        }
+        benchmark::DoNotOptimize(found);
+    }
+}
+BENCHMARK(BM_PerVertexRadiusQuery)->Arg(200)->Arg(500)->Arg(1000)->Unit(benchmark::kMicrosecond);
+
+}  // namespace
@@ -1,5 +1,9 @@
 #include "RouteController.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
 #include <iostream>
 #include <osrm/coordinate.hpp>
 #include <osrm/json_container.hpp>
@@ -8,6 +12,13 @@
 #include <osrm/route_parameters.hpp>
 #include <osrm/status.hpp>
 #include <osrm/table_parameters.hpp>
+#include <trantor/net/EventLoop.h>
+#include <trantor/net/TcpConnection.h>
+
+#include "utils/Deadline.h"
+#include "utils/PolylineDecoder.h"
+#include "utils/PolylineSimplifier.h"
+#include "utils/Trace.h"
 
 namespace api::v1 {
 
@@ -17,6 +28,165 @@ std::shared_ptr<services::ConfigService> Route::configService_;
 std::shared_ptr<services::OSRMClient> Route::osrmClient_;
 std::shared_ptr<services::SpotService> Route::spotService_;
 std::shared_ptr<services::RouteService> Route::routeService_;
+std::shared_ptr<services::SpotSearchJobs> Route::spotSearchJobs_;
+std::shared_ptr<trantor::ConcurrentTaskQueue> Route::computePool_;
+size_t Route::computeWorkers_ = 1;
+std::shared_ptr<cycling::utils::ConcurrencyLimiter> Route::limiter_;
+Route::StreamResponseFactory Route::streamResponseFactory_;
+
+namespace {
+
+Json::Value stopsToJson(const std::vector<services::Spot> &spots) {
+    Json::Value stops(Json::arrayValue);
+    for (const auto &spot : spots) {
+        Json::Value stop;
+        stop["name"] = spot.name;
+        stop["type"] = spot.type;
+        stop["location"]["lat"] = spot.lat;
+        stop["location"]["lon"] = spot.lon;
+        stop["rating"] = spot.rating;
+        stops.append(stop);
+    }
+    return stops;
+}
+
+// Chrome の Trace Event 形式でファイルに書き出し、書き出したパスを返す
+std::optional<std::string> writeChromeTrace(const utils::Trace &trace,
+                                            const std::string &directory) {
+    static std::atomic<uint64_t> sequence{0};
+    auto now = std::chrono::duration_cast<std::chrono::milliseconds>(
+                   std::chrono::system_clock::now().time_since_epoch())
+                   .count();
+    std::string path = directory + "/route-trace-" + std::to_string(now) + "-" +
+                       std::to_string(sequence++) + ".json";
+    std::ofstream out(path, std::ios::trunc);
+    if (!out) {
+        LOG_WARN << "Failed to write trace file: " << path;
+        return std::nullopt;
+    }
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    out << Json::writeString(builder, trace.toChromeTrace());
+    return out ? std::optional<std::string>(path) : std::nullopt;
+}
+
+// 1 回に返すルートの上限 ("alternatives" の値はこの範囲に丸める)
+constexpr int kMaxAlternatives = 5;
+
+// 応答ジオメトリのオプション
+//   zoom: そのズームで 1 ピクセル未満のずれになる頂点を間引く (省略時は間引かない)
+//   precision: ポリラインの精度 (小数点以下 5 桁または 6 桁、既定は 5)
+//   overview: true のとき、ルート全体表示用の粗いジオメトリも返す
+struct GeometryOptions {
+    int zoom = -1;
+    int digits = 5;
+    bool overview = false;
+};
+
+// ルートの summary とジオメトリを out に書く (path は OSRM の geometry をデコードしたもの)
+void writeRoute(Json::Value &out, const services::RouteResult &route,
+                const std::vector<services::Coordinate> &path, const GeometryOptions &options) {
+    out["summary"]["total_distance_m"] = route.distance_m;
+    out["summary"]["estimated_moving_time_s"] = route.duration_s;
+    out["summary"]["total_elevation_gain_m"] = route.elevation_gain_m;
+
+    double precision = options.digits == 6 ? 1e6 : 1e5;
+    if (options.zoom >= 0 && !path.empty()) {
+        double tolerance = utils::PolylineSimplifier::metersPerPixel(std::min(options.zoom, 22),
+                                                                     path.front().lat);
+        out["geometry"] = utils::PolylineDecoder::encode(
+            utils::PolylineSimplifier::simplify(path, tolerance), precision);
+    } else {
+        out["geometry"] = utils::PolylineDecoder::encode(path, precision);
+    }
+    out["geometry_precision"] = options.digits;
+    if (options.overview) {
+        out["overview_geometry"] = utils::PolylineDecoder::encode(
+            utils::PolylineSimplifier::simplify(path,
+                                                utils::PolylineSimplifier::overviewTolerance(path)),
+            precision);
+    }
+}
+
+using PermitPtr = std::shared_ptr<cycling::utils::ConcurrencyLimiter::Permit>;
+
+// 上限に達していれば false。上限が無いときは permit を空のまま true を返す
+bool admit(const std::shared_ptr<cycling::utils::ConcurrencyLimiter> &limiter, PermitPtr &permit) {
+    if (!limiter) return true;
+    auto acquired = limiter->tryAcquire();
+    if (!acquired) return false;
+    permit = std::make_shared<cycling::utils::ConcurrencyLimiter::Permit>(std::move(*acquired));
+    return true;
+}
+
+HttpResponsePtr overloadedResponse() {
+    auto resp = HttpResponse::newHttpResponse();
+    resp->setStatusCode(k503ServiceUnavailable);
+    resp->addHeader("Retry-After", "1");
+    resp->setBody("Server is busy; retry later");
+    return resp;
+}
+
+// X-Request-Timeout-Ms は既定の期限より短くする場合のみ使う
+std::chrono::milliseconds requestBudget(const HttpRequestPtr &req, int defaultMs) {
+    int budgetMs = std::max(defaultMs, 1);
+    const std::string &header = req->getHeader("X-Request-Timeout-Ms");
+    if (!header.empty()) {
+        try {
+            int requested = std::stoi(header);
+            if (requested > 0) budgetMs = std::min(budgetMs, requested);
+        } catch (const std::exception &) {
+            // 不正な値は無視して既定の期限を使う
+        }
+    }
+    return std::chrono::milliseconds(budgetMs);
+}
+
+// クライアントの切断を接続の I/O スレッドで定期的に確かめ、切断していればフラグを立てる。
+// TcpConnection の状態は I/O スレッドでしか更新されないので、計算スレッドはこのフラグだけを読む。
+// 破棄するとタイマーを止める
+class DisconnectWatch {
+   public:
+    // 接続を持たないリクエスト (内部から組み立てたもの) には nullptr を返す
+    static std::shared_ptr<DisconnectWatch> start(const HttpRequestPtr &req) {
+        std::weak_ptr<trantor::TcpConnection> conn = req->getConnectionPtr();
+        auto connPtr = conn.lock();
+        if (!connPtr) return nullptr;
+        auto watch = std::make_shared<DisconnectWatch>(connPtr->getLoop());
+        watch->timer_ = watch->loop_->runEvery(
+            kPollSeconds, [conn, disconnected = watch->disconnected_]() {
+                auto connPtr = conn.lock();
+                if (!connPtr || !connPtr->connected()) {
+                    disconnected->store(true, std::memory_order_relaxed);
+                }
+            });
+        return watch;
+    }
+
+    explicit DisconnectWatch(trantor::EventLoop *loop) : loop_(loop) {}
+    ~DisconnectWatch() { loop_->invalidateTimer(timer_); }
+
+    DisconnectWatch(const DisconnectWatch &) = delete;
+    DisconnectWatch &operator=(const DisconnectWatch &) = delete;
+
+    [[nodiscard]] bool disconnected() const {
+        return disconnected_->load(std::memory_order_relaxed);
+    }
+
+    // 期限の取り消し確認として渡す関数 (どのスレッドから呼んでもよい)
+    static std::function<bool()> cancelCheck(std::shared_ptr<DisconnectWatch> watch) {
+        return [watch = std::move(watch)]() { return watch->disconnected(); };
+    }
+
+   private:
+    static constexpr double kPollSeconds = 0.2;
+
+    trantor::EventLoop *loop_;
+    trantor::TimerId timer_ = 0;
+    std::shared_ptr<std::atomic<bool>> disconnected_ = std::make_shared<std::atomic<bool>>(false);
+};
+
+}  // namespace
 
 void Route::generate(const HttpRequestPtr &req,
                      std::function<void(const HttpResponsePtr &)> &&callback) {
@@ -39,36 +209,120 @@ void Route::generate(const HttpRequestPtr &req,
         return;
     }
 
-    if (!jsonPtr->isMember("start_point") || !jsonPtr->isMember("end_point")) {
-        auto resp = HttpResponse::newHttpResponse();
-        resp->setStatusCode(k400BadRequest);
-        resp->setBody("Missing start_point or end_point");
-        callback(resp);
+    // 上限を超えた分は待たせずに 503 を返す (待たせても期限切れで捨てることになる)
+    PermitPtr permit;
+    if (!admit(limiter_, permit)) {
+        callback(overloadedResponse());
         return;
     }
 
-    services::Coordinate start{(*jsonPtr)["start_point"]["lat"].asDouble(),
-                               (*jsonPtr)["start_point"]["lon"].asDouble()};
-    services::Coordinate end{(*jsonPtr)["end_point"]["lat"].asDouble(),
-                             (*jsonPtr)["end_point"]["lon"].asDouble()};
+    // 期限は受け取った時点から数える (計算プールで待つ時間も含む)。
+    // クライアントが切断した場合も、残りの処理を打ち切る
+    auto deadline =
+        utils::Deadline::after(requestBudget(req, configService_->getRouteDeadlineMs()));
+    if (auto watch = DisconnectWatch::start(req)) {
+        deadline->setCancelCheck(DisconnectWatch::cancelCheck(std::move(watch)));
+    }
+
+    // 処理時間も受け付けた時点から計る
+    auto admittedAt = std::chrono::steady_clock::now();
+    auto run = [jsonPtr, deadline, permit, admittedAt, callback = std::move(callback)]() {
+        ::cycling::utils::ScopedTimer requestTimer(routeService_->metrics().requestSeconds,
+                                                   admittedAt);
+        utils::Deadline::Scope deadlineScope(deadline.get());
+        GenerateOutcome outcome = generateRoute(*jsonPtr, nullptr);
+        if (outcome.status != k200OK) {
+            auto resp = HttpResponse::newHttpResponse();
+            resp->setStatusCode(outcome.status);
+            resp->setBody(outcome.error);
+            callback(resp);
+            return;
+        }
+
+        auto resp = HttpResponse::newHttpJsonResponse(outcome.body);
+        resp->addHeader("Server-Timing", outcome.serverTiming);
+        callback(resp);
+    };
+    // I/O スレッドを塞がないよう計算プールで実行する (切断もその間に検出できる)
+    if (computePool_) {
+        computePool_->runTaskInQueue(std::move(run));
+    } else {
+        run();
+    }
+}
+
+Route::GenerateOutcome Route::generateRoute(const Json::Value &request,
+                                            services::RouteMemo *memo) {
+    auto fail = [](HttpStatusCode status, std::string error) {
+        GenerateOutcome outcome;
+        outcome.status = status;
+        outcome.error = std::move(error);
+        return outcome;
+    };
+
+    auto &metrics = routeService_->metrics();
+    // 段階ごとの区間を記録し、Server-Timing ヘッダーで返す
+    auto trace = std::make_shared<utils::Trace>();
+    utils::Trace::Scope traceScope(trace.get());
+
+    // 期限切れ・取り消しで打ち切ったことを数える
+    auto stopped = [&metrics]() {
+        auto *deadline = utils::Deadline::current();
+        if (deadline && deadline->cancelled()) {
+            metrics.cancelled++;
+        } else {
+            metrics.deadlineExceeded++;
+        }
+    };
+    // 計算プールで待つ間に期限切れ・切断になったものは計算しない
+    if (utils::Deadline::currentExpired()) {
+        stopped();
+        return fail(k504GatewayTimeout, "Route generation deadline exceeded");
+    }
+
+    if (!request.isObject() || !request.isMember("start_point") ||
+        !request.isMember("end_point")) {
+        return fail(k400BadRequest, "Missing start_point or end_point");
+    }
+
+    services::Coordinate start{request["start_point"]["lat"].asDouble(),
+                               request["start_point"]["lon"].asDouble()};
+    services::Coordinate end{request["end_point"]["lat"].asDouble(),
+                             request["end_point"]["lon"].asDouble()};
+
+    const Json::Value &geometryJson = request["geometry_options"];
+    GeometryOptions geometryOptions;
+    geometryOptions.zoom = geometryJson.get("zoom", -1).asInt();
+    geometryOptions.digits = geometryJson.get("precision", 5).asInt();
+    geometryOptions.overview = geometryJson.get("overview", false).asBool();
+    if (geometryOptions.digits != 5 && geometryOptions.digits != 6) {
+        return fail(k400BadRequest, "geometry_options.precision must be 5 or 6");
+    }
 
     LOG_DEBUG << "Request: Start(" << start.lat << ", " << start.lon << ") End(" << end.lat << ", "
               << end.lon << ")";
 
-    std::vector<services::Coordinate> waypoints = services::RouteService::parseWaypoints(*jsonPtr);
+    std::vector<services::Coordinate> waypoints = services::RouteService::parseWaypoints(request);
 
     double targetDistanceKm = 0.0;
-    if (jsonPtr->isMember("preferences") &&
-        (*jsonPtr)["preferences"].isMember("target_distance_km")) {
-        targetDistanceKm = (*jsonPtr)["preferences"]["target_distance_km"].asDouble();
+    if (request.isMember("preferences") && request["preferences"].isMember("target_distance_km")) {
+        targetDistanceKm = request["preferences"]["target_distance_km"].asDouble();
+    }
+
+    // "alternatives": N で、互いに重ならない上位 N 件のルートを返す (迂回候補を探索する場合のみ)
+    int alternatives = 1;
+    if (request.isMember("preferences") && request["preferences"].isMember("alternatives")) {
+        alternatives = std::clamp(request["preferences"]["alternatives"].asInt(), 1,
+                                  kMaxAlternatives);
     }
 
     std::optional<services::RouteResult> bestRoute;
+    std::vector<services::RouteResult> alternativeRoutes;
 
     double targetElevationM = 0.0;
-    if (jsonPtr->isMember("preferences") &&
-        (*jsonPtr)["preferences"].isMember("target_elevation_gain_m")) {
-        targetElevationM = (*jsonPtr)["preferences"]["target_elevation_gain_m"].asDouble();
+    if (request.isMember("preferences") &&
+        request["preferences"].isMember("target_elevation_gain_m")) {
+        targetElevationM = request["preferences"]["target_elevation_gain_m"].asDouble();
     }
 
     if (targetDistanceKm > 0) {
@@ -77,58 +331,279 @@ void Route::generate(const HttpRequestPtr &req,
 
         auto evaluator = [&](const std::vector<services::Coordinate> &candidateWaypoints)
             -> std::optional<services::RouteResult> {
-            osrm::RouteParameters params =
-                services::RouteService::buildRouteParameters(start, end, candidateWaypoints);
-            osrm::json::Object osrmResult;
-            if (osrmClient_->Route(params, osrmResult) == osrm::Status::Ok) {
-                return routeService_->processRoute(osrmResult);
-            }
-            return std::nullopt;
+            utils::TraceSpan span("candidate");
+            span.setDetail(std::to_string(candidateWaypoints.size()) + " waypoints");
+            return computeRoute(start, end, candidateWaypoints, memo);
         };
 
-        bestRoute = routeService_->findBestRoute(start, end, waypoints, targetDistanceKm,
-                                                 targetElevationM, evaluator);
+        if (alternatives > 1) {
+            // 評価済みの候補から選ぶので、OSRM の問い合わせは 1 件のときと変わらない
+            auto routes = routeService_->findBestRoutes(start, end, waypoints, targetDistanceKm,
+                                                        targetElevationM, evaluator,
+                                                        static_cast<size_t>(alternatives));
+            if (!routes.empty()) {
+                bestRoute = std::move(routes.front());
+                alternativeRoutes.assign(std::make_move_iterator(routes.begin() + 1),
+                                         std::make_move_iterator(routes.end()));
+            }
+        } else {
+            bestRoute = routeService_->findBestRoute(start, end, waypoints, targetDistanceKm,
+                                                     targetElevationM, evaluator);
+        }
     } else {
         // Simple route calculation
+        // (目標距離が無いときは比べる候補が無いので、"alternatives" は無視して 1 件だけ返す)
+        bestRoute = computeRoute(start, end, waypoints, memo);
+    }
+
+    if (!bestRoute) {
+        if (utils::Deadline::currentExpired()) {
+            stopped();
+            return fail(k504GatewayTimeout, "Route generation deadline exceeded");
+        }
+        return fail(k400BadRequest, "Route calculation failed");
+    }
+
+    LOG_DEBUG << "Route geometry found. Distance: " << bestRoute->distance_m << "m";
+
+    // OSRM の geometry (full overview) をここで一度だけデコードし、
+    // 応答用のジオメトリとスポット検索の両方に使う
+    auto routePath = std::make_shared<const std::vector<services::Coordinate>>(
+        utils::PolylineDecoder::decode(bestRoute->geometry,
+                                       services::RouteService::kGeometryPrecision));
+
+    Json::Value respJson;
+    writeRoute(respJson, *bestRoute, *routePath, geometryOptions);
+
+    // 2 位以降のルート (スポットは最良のルートについてのみ検索する)
+    if (!alternativeRoutes.empty()) {
+        Json::Value alternativesJson(Json::arrayValue);
+        for (const auto &route : alternativeRoutes) {
+            Json::Value alternative;
+            writeRoute(alternative, route,
+                       utils::PolylineDecoder::decode(route.geometry,
+                                                      services::RouteService::kGeometryPrecision),
+                       geometryOptions);
+            alternativesJson.append(std::move(alternative));
+        }
+        respJson["alternatives"] = std::move(alternativesJson);
+    }
+
+    // Search spots along the route (間引く前の座標列で検索する)
+    double searchRadius = configService_->getSpotSearchRadius();
+
+    // "spots_mode": "deferred" ではルートを先に返し、スポットは spots_token で後から取得させる
+    // (Places の待ち時間をルートの応答時間に含めない)
+    bool deferSpots =
+        spotSearchJobs_ && request.get("spots_mode", "inline").asString() == "deferred";
+    std::optional<std::string> spotsToken;
+    if (deferSpots) {
+        spotsToken = spotSearchJobs_->submit(routePath, searchRadius);
+        if (!spotsToken) {
+            LOG_WARN << "Deferred spot search queue is full; searching inline";
+        }
+    }
+
+    if (spotsToken) {
+        respJson["spots_token"] = *spotsToken;
+        respJson["spots_url"] = "/api/v1/route/spots/" + *spotsToken;
+    } else {
+        std::vector<services::Spot> spots;
+        {
+            ::cycling::utils::ScopedTimer spotTimer(metrics.spotSearchSeconds);
+            utils::TraceSpan span("spots");
+            spots = spotService_->searchSpotsAlongRoute(*routePath, searchRadius);
+        }
+        if (!spots.empty()) {
+            respJson["stops"] = stopsToJson(spots);
+        }
+    }
+
+    // デバッグ用 (TRACE_DEBUG_ENABLED のときのみ): "debug_trace": "json" で区間の木を応答に含め、
+    // "chrome" で Trace Event 形式のファイルを TRACE_OUTPUT_DIR に書き出す
+    std::string debugTrace =
+        configService_->isTraceDebugEnabled() ? request.get("debug_trace", "").asString() : "";
+    if (debugTrace == "json") {
+        respJson["trace"] = trace->toJson();
+    } else if (debugTrace == "chrome") {
+        if (auto path = writeChromeTrace(*trace, configService_->getTraceOutputDir())) {
+            respJson["trace_file"] = *path;
+        }
+    }
+
+    // 期限までに見つかった最良のルートを返す (残りの候補や Places の検索は省略されている)
+    if (utils::Deadline::currentExpired()) {
+        stopped();
+        respJson["deadline_exceeded"] = true;
+    }
+
+    GenerateOutcome outcome;
+    outcome.body = std::move(respJson);
+    outcome.serverTiming = trace->serverTiming();
+    return outcome;
+}
+
+std::optional<services::RouteResult> Route::computeRoute(
+    const services::Coordinate &start, const services::Coordinate &end,
+    const std::vector<services::Coordinate> &waypoints, services::RouteMemo *memo) {
+    auto compute = [&]() -> std::optional<services::RouteResult> {
         osrm::RouteParameters params =
             services::RouteService::buildRouteParameters(start, end, waypoints);
         osrm::json::Object osrmResult;
-        if (osrmClient_->Route(params, osrmResult) == osrm::Status::Ok) {
-            bestRoute = routeService_->processRoute(osrmResult);
+        if (routeWithMetrics(params, osrmResult) == osrm::Status::Ok) {
+            return routeService_->processRoute(osrmResult);
         }
+        return std::nullopt;
+    };
+    if (!memo) {
+        return compute();
     }
+    return memo->getOrCompute(services::RouteMemo::key(start, end, waypoints), compute);
+}
 
-    if (!bestRoute) {
+void Route::generateBatch(const HttpRequestPtr &req,
+                          std::function<void(const HttpResponsePtr &)> &&callback) {
+    auto reject = [&callback](HttpStatusCode status, const std::string &body) {
         auto resp = HttpResponse::newHttpResponse();
-        resp->setStatusCode(k400BadRequest);
-        resp->setBody("Route calculation failed");
+        resp->setStatusCode(status);
+        resp->setBody(body);
         callback(resp);
+    };
+
+    if (!configService_ || !osrmClient_ || !spotService_ || !routeService_) {
+        LOG_ERROR << "RouteController dependencies not initialized";
+        reject(k500InternalServerError, "Internal Server Error: Service dependencies missing");
+        return;
+    }
+    if (!computePool_) {
+        reject(k503ServiceUnavailable, "Batch route generation is not enabled");
         return;
     }
 
-    LOG_DEBUG << "Route geometry found. Distance: " << bestRoute->distance_m << "m";
+    auto jsonPtr = req->getJsonObject();
+    if (!jsonPtr) {
+        reject(k400BadRequest, "Invalid JSON format");
+        return;
+    }
+    const Json::Value &items = (*jsonPtr)["requests"];
+    if (!items.isArray() || items.empty()) {
+        reject(k400BadRequest, "requests must be a non-empty array");
+        return;
+    }
+    auto maxRequests = static_cast<Json::ArrayIndex>(
+        std::max(configService_->getRouteBatchMaxRequests(), 1));
+    if (items.size() > maxRequests) {
+        reject(k400BadRequest,
+               "Too many requests in one batch (max " + std::to_string(maxRequests) + ")");
+        return;
+    }
 
-    Json::Value respJson;
-    respJson["summary"]["total_distance_m"] = bestRoute->distance_m;
-    respJson["summary"]["estimated_moving_time_s"] = bestRoute->duration_s;
-    respJson["summary"]["total_elevation_gain_m"] = bestRoute->elevation_gain_m;
-    respJson["geometry"] = bestRoute->geometry;
+    // 同時に計算する項目 1 件ごとに 1 枠を使い、バッチが終わるまで保持する (単発の
+    // リクエストと同じ数え方)。計算プールの半分までに抑え、残りは単発のリクエストに空けておく
+    std::vector<Json::Value> requests(items.begin(), items.end());
+    size_t parallelism = std::min(std::max<size_t>(computeWorkers_ / 2, 1), requests.size());
+    auto permits = std::make_shared<std::vector<cycling::utils::ConcurrencyLimiter::Permit>>();
+    if (limiter_) {
+        while (permits->size() < parallelism) {
+            auto acquired = limiter_->tryAcquire();
+            if (!acquired) break;
+            permits->push_back(std::move(*acquired));
+        }
+        if (permits->empty()) {
+            callback(overloadedResponse());
+            return;
+        }
+        // 取れた枠の数だけ並列に計算する
+        parallelism = permits->size();
+    }
 
-    // Search spots along the route
-    double searchRadius = configService_->getSpotSearchRadius();
-    auto spots = spotService_->searchSpotsAlongRoute(bestRoute->geometry, searchRadius);
+    auto pool = computePool_;
+    auto watch = DisconnectWatch::start(req);
+    auto budget = std::chrono::milliseconds(std::max(configService_->getRouteDeadlineMs(), 1));
+    auto memoCapacity =
+        static_cast<size_t>(std::max(configService_->getRouteBatchMemoCapacity(), 1));
 
-    for (const auto &spot : spots) {
-        Json::Value stop;
-        stop["name"] = spot.name;
-        stop["type"] = spot.type;
-        stop["location"]["lat"] = spot.lat;
-        stop["location"]["lon"] = spot.lon;
-        stop["rating"] = spot.rating;
-        respJson["stops"].append(stop);
+    NdjsonWriter writer = [requests, pool, parallelism, memoCapacity, budget, watch, permits](
+                              std::function<bool(const std::string &)> send,
+                              std::function<void()> close) {
+        services::RouteBatchRunner::start(
+            requests, parallelism, memoCapacity,
+            [budget, watch](const Json::Value &request, services::RouteMemo &memo) {
+                // 期限は項目ごとに、計算を始めた時点から数える。クライアントが切断したら
+                // 計算中の項目も打ち切る
+                auto deadline = utils::Deadline::after(budget);
+                if (watch) deadline->setCancelCheck(DisconnectWatch::cancelCheck(watch));
+                utils::Deadline::Scope deadlineScope(deadline.get());
+                ::cycling::utils::ScopedTimer itemTimer(routeService_->metrics().batchItemSeconds);
+                GenerateOutcome outcome = generateRoute(request, &memo);
+                services::RouteBatchRunner::Outcome result;
+                result.status = static_cast<int>(outcome.status);
+                result.body = std::move(outcome.body);
+                result.error = std::move(outcome.error);
+                return result;
+            },
+            [pool](std::function<void()> task) { pool->runTaskInQueue(std::move(task)); },
+            std::move(send),
+            // 枠はバッチが終わるまで保持する
+            [close = std::move(close), permits]() { close(); });
+    };
+
+    HttpResponsePtr resp;
+    if (streamResponseFactory_) {
+        resp = streamResponseFactory_(std::move(writer));
+    } else {
+        // 行は項目が終わるたびにしか書かないので、項目の計算中は接続が無通信になる。
+        // アイドル接続の切断 (kickoff) で途中で切られないよう無効にする。バッチの長さは
+        // 項目数の上限 (ROUTE_BATCH_MAX_REQUESTS) と項目ごとの期限で抑えられている
+        resp = HttpResponse::newAsyncStreamResponse(
+            [writer = std::move(writer)](ResponseStreamPtr streamPtr) {
+                std::shared_ptr<ResponseStream> stream(std::move(streamPtr));
+                writer([stream](const std::string &line) { return stream->send(line); },
+                       [stream]() { stream->close(); });
+            },
+            true);
+    }
+    resp->setContentTypeString("application/x-ndjson");
+    callback(resp);
+}
+
+osrm::Status Route::routeWithMetrics(const osrm::RouteParameters &params,
+                                     osrm::json::Object &result) {
+    ::cycling::utils::ScopedTimer timer(routeService_->metrics().osrmRouteSeconds);
+    utils::TraceSpan span("osrm");
+    return osrmClient_->Route(params, result);
+}
+
+void Route::spots(const HttpRequestPtr &req,
+                  std::function<void(const HttpResponsePtr &)> &&callback,
+                  const std::string &token) {
+    services::SpotSearchJobs::Lookup lookup;
+    if (spotSearchJobs_) {
+        lookup = spotSearchJobs_->lookup(token);
+    }
+
+    Json::Value respJson;
+    HttpStatusCode status = k200OK;
+    switch (lookup.status) {
+        case services::SpotSearchJobs::Status::Ready:
+            respJson["status"] = "ready";
+            respJson["stops"] = stopsToJson(lookup.spots);
+            break;
+        case services::SpotSearchJobs::Status::Pending:
+            respJson["status"] = "pending";
+            status = k202Accepted;
+            break;
+        case services::SpotSearchJobs::Status::NotFound:
+            respJson["status"] = "not_found";
+            status = k404NotFound;
+            break;
     }
 
     auto resp = HttpResponse::newHttpJsonResponse(respJson);
+    resp->setStatusCode(status);
+    if (status == k202Accepted) {
+        resp->addHeader("Retry-After", "1");
+    }
     callback(resp);
 }
 
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <drogon/HttpController.h>
+#include <trantor/utils/ConcurrentTaskQueue.h>
 
 #include <functional>
 #include <memory>
@@ -8,8 +9,11 @@
 
 #include "services/ConfigService.h"
 #include "services/OSRMClient.h"
+#include "services/RouteBatch.h"
 #include "services/RouteService.h"
+#include "services/SpotSearchJobs.h"
 #include "services/SpotService.h"
+#include "utils/ConcurrencyLimiter.h"
 
 namespace api::v1 {
 
@@ -18,6 +22,10 @@ class Route : public drogon::HttpController<Route> {
     METHOD_LIST_BEGIN
     // POST /api/v1/route/generate
     ADD_METHOD_TO(Route::generate, "/api/v1/route/generate", drogon::Post);
+    // POST /api/v1/route/generate/batch
+    ADD_METHOD_TO(Route::generateBatch, "/api/v1/route/generate/batch", drogon::Post);
+    // GET /api/v1/route/spots/{token}
+    ADD_METHOD_TO(Route::spots, "/api/v1/route/spots/{1}", drogon::Get);
     METHOD_LIST_END
 
     Route() = default;
@@ -25,10 +33,38 @@ class Route : public drogon::HttpController<Route> {
 
     /**
      * @brief Handle route generation request
+     *
+     * The work runs on the compute pool when one has been injected. 503 with Retry-After when the
+     * concurrency limit is reached; 504 when the deadline (ROUTE_DEADLINE_MS, or a shorter
+     * X-Request-Timeout-Ms header) passes before any route is found. A route found before the
+     * deadline is returned with "deadline_exceeded": true if candidates or spots were skipped.
      */
     void generate(const drogon::HttpRequestPtr &req,
                   std::function<void(const drogon::HttpResponsePtr &)> &&callback);
 
+    /**
+     * @brief Handle many route generation requests in one call
+     *
+     * Body: {"requests": [<generate request>, ...]}; each item may carry an "id" that is echoed
+     * back. Items run on the batch pool and share a memo of candidate routes; the response is
+     * NDJSON with one line per item in completion order, followed by a summary line
+     * (see services::RouteBatchRunner). At most half of the compute workers run items of one
+     * batch, and each running item holds a concurrency slot until the batch ends; 503 when no
+     * compute pool has been injected or no slot is free.
+     */
+    void generateBatch(const drogon::HttpRequestPtr &req,
+                       std::function<void(const drogon::HttpResponsePtr &)> &&callback);
+
+    /**
+     * @brief Return the spots of a route generated with "spots_mode": "deferred"
+     *
+     * 200 with the stops when the search has finished, 202 while it is still running and
+     * 404 for unknown or expired tokens.
+     */
+    void spots(const drogon::HttpRequestPtr &req,
+               std::function<void(const drogon::HttpResponsePtr &)> &&callback,
+               const std::string &token);
+
     // Dependency Injection Setters
     static void setConfigService(std::shared_ptr<services::ConfigService> config) {
         configService_ = config;
@@ -42,12 +78,58 @@ class Route : public drogon::HttpController<Route> {
     static void setRouteService(std::shared_ptr<services::RouteService> service) {
         routeService_ = service;
     }
+    // 未設定の場合、deferred 指定のリクエストもスポットを同期的に検索する
+    static void setSpotSearchJobs(std::shared_ptr<services::SpotSearchJobs> jobs) {
+        spotSearchJobs_ = jobs;
+    }
+    // 未設定の場合、ルート生成は I/O スレッドで同期的に行い、バッチのエンドポイントは 503 を返す
+    static void setComputePool(std::shared_ptr<trantor::ConcurrentTaskQueue> pool,
+                               size_t workers) {
+        computePool_ = pool;
+        computeWorkers_ = workers;
+    }
+    // 未設定の場合、同時に受け付けるルート生成の数は制限しない
+    static void setConcurrencyLimiter(std::shared_ptr<cycling::utils::ConcurrencyLimiter> limiter) {
+        limiter_ = limiter;
+    }
+
+    // NDJSON の本文を書く関数。send が false を返したらクライアントは切断している
+    using NdjsonWriter = std::function<void(std::function<bool(const std::string &)> send,
+                                            std::function<void()> close)>;
+    using StreamResponseFactory = std::function<drogon::HttpResponsePtr(NdjsonWriter writer)>;
+    // テスト用。未設定の場合、drogon の非同期ストリーム応答で書き出す
+    static void setStreamResponseFactory(StreamResponseFactory factory) {
+        streamResponseFactory_ = factory;
+    }
 
    private:
+    struct GenerateOutcome {
+        drogon::HttpStatusCode status = drogon::k200OK;
+        Json::Value body;  // status が 200 のとき
+        std::string error;
+        std::string serverTiming;
+    };
+
+    // 1 件分のルート生成。memo を渡すと候補ルートの OSRM 問い合わせをバッチ内で共有する
+    static GenerateOutcome generateRoute(const Json::Value &request, services::RouteMemo *memo);
+
+    static std::optional<services::RouteResult> computeRoute(
+        const services::Coordinate &start, const services::Coordinate &end,
+        const std::vector<services::Coordinate> &waypoints, services::RouteMemo *memo);
+
+    // OSRM の問い合わせ時間を RouteService::metrics() に記録する
+    static osrm::Status routeWithMetrics(const osrm::RouteParameters &params,
+                                         osrm::json::Object &result);
+
     static std::shared_ptr<services::ConfigService> configService_;
     static std::shared_ptr<services::OSRMClient> osrmClient_;
     static std::shared_ptr<services::SpotService> spotService_;
     static std::shared_ptr<services::RouteService> routeService_;
+    static std::shared_ptr<services::SpotSearchJobs> spotSearchJobs_;
+    static std::shared_ptr<trantor::ConcurrentTaskQueue> computePool_;
+    static size_t computeWorkers_;
+    static std::shared_ptr<cycling::utils::ConcurrencyLimiter> limiter_;
+    static StreamResponseFactory streamResponseFactory_;
 };
 
 }  // namespace api::v1
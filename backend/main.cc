@@ -1,18 +1,163 @@
 #include <drogon/drogon.h>
 
+#include <algorithm>
 #include <iostream>
 #include <memory>
+#include <thread>
 
 #include "controllers/RouteController.h"
 #include "services/ConfigService.h"
+#include "services/MetricsExporter.h"
 #include "services/OSRMClient.h"
 #include "services/RouteService.h"
+#include "services/SpotSearchJobs.h"
 #include "services/SpotService.h"
 #include "services/elevation/ElevationCacheManager.h"
 #include "services/elevation/GSIElevationProvider.h"
 #include "services/elevation/RedisElevationAdapter.h"
 #include "services/elevation/SmartRefreshService.h"
 
+namespace {
+
+void registerMetrics(services::MetricsExporter &metrics,
+                     const std::shared_ptr<services::RouteService> &routeService,
+                     const std::shared_ptr<services::elevation::ElevationCacheManager> &elevation,
+                     const std::shared_ptr<services::elevation::SmartRefreshService> &refresh,
+                     const std::shared_ptr<services::SpotService> &spotService,
+                     const std::shared_ptr<services::SpotSearchJobs> &spotSearchJobs,
+                     const std::shared_ptr<cycling::utils::ConcurrencyLimiter> &limiter) {
+    // Route generation stages
+    auto &route = routeService->metrics();
+    const char *stageHelp = "Time spent in each route generation stage";
+    metrics.addHistogram("pedalmap_route_request_seconds",
+                         "Time to handle POST /api/v1/route/generate, from admission",
+                         route.requestSeconds);
+    metrics.addHistogram("pedalmap_route_batch_item_seconds",
+                         "Time to generate one item of POST /api/v1/route/generate/batch",
+                         route.batchItemSeconds);
+    metrics.addHistogram("pedalmap_route_candidates",
+                         "Detour candidates evaluated per targeted-distance request",
+                         route.candidates);
+    metrics.addHistogram("pedalmap_route_stage_seconds", stageHelp, route.osrmRouteSeconds,
+                         "stage=\"osrm_route\"");
+    metrics.addHistogram("pedalmap_route_stage_seconds", stageHelp, route.processRouteSeconds,
+                         "stage=\"process_route\"");
+    metrics.addHistogram("pedalmap_route_stage_seconds", stageHelp, route.elevationSeconds,
+                         "stage=\"elevation\"");
+    metrics.addHistogram("pedalmap_route_stage_seconds", stageHelp, route.spotSearchSeconds,
+                         "stage=\"spot_search\"");
+
+    // Admission control and deadlines
+    const char *stoppedHelp = "Route generation requests shed or cut short, by reason";
+    metrics.addCounter(
+        "pedalmap_route_stopped_total", stoppedHelp,
+        [routeService]() { return static_cast<double>(routeService->metrics().deadlineExceeded); },
+        "reason=\"deadline\"");
+    metrics.addCounter(
+        "pedalmap_route_stopped_total", stoppedHelp,
+        [routeService]() { return static_cast<double>(routeService->metrics().cancelled); },
+        "reason=\"client_gone\"");
+    metrics.addCounter(
+        "pedalmap_route_stopped_total", stoppedHelp,
+        [limiter]() { return static_cast<double>(limiter->rejected()); }, "reason=\"shed\"");
+    metrics.addGauge(
+        "pedalmap_route_in_flight", "Route generation requests admitted and not yet finished",
+        [limiter]() { return static_cast<double>(limiter->inFlight()); });
+
+    // Elevation cache levels (L1: memory, L2: Redis, GSI: origin)
+    if (elevation) {
+        using Stats = services::elevation::ElevationCacheStats;
+        auto lookups = [&](const char *labels, uint64_t Stats::*field) {
+            metrics.addCounter(
+                "pedalmap_elevation_tile_lookups_total",
+                "Elevation tile lookups by cache level and result",
+                [elevation, field]() { return static_cast<double>(elevation->getStats().*field); },
+                labels);
+        };
+        lookups("level=\"l1\",result=\"hit\"", &Stats::l1Hits);
+        lookups("level=\"l1\",result=\"miss\"", &Stats::l1Misses);
+        lookups("level=\"l2\",result=\"hit\"", &Stats::l2Hits);
+        lookups("level=\"l2\",result=\"miss\"", &Stats::l2Misses);
+        lookups("level=\"gsi\",result=\"fetch\"", &Stats::gsiFetches);
+        lookups("level=\"gsi\",result=\"failure\"", &Stats::gsiFailures);
+        lookups("level=\"gsi\",result=\"coalesced\"", &Stats::coalescedWaits);
+
+        const char *latencyHelp = "Elevation tile lookup latency by cache level";
+        metrics.addHistogram("pedalmap_elevation_tile_seconds", latencyHelp,
+                             elevation->l2Latency(), "level=\"l2\"");
+        metrics.addHistogram("pedalmap_elevation_tile_seconds", latencyHelp,
+                             elevation->gsiLatency(), "level=\"gsi\"");
+    }
+    if (refresh) {
+        metrics.addGauge(
+            "pedalmap_elevation_refresh_queue_depth", "Tiles waiting in the shared refresh queue",
+            [refresh]() { return static_cast<double>(refresh->getStats().queueDepth); });
+        metrics.addGauge(
+            "pedalmap_elevation_refresh_in_flight", "Refresh fetches currently outstanding",
+            [refresh]() { return static_cast<double>(refresh->getStats().inFlight); });
+        metrics.addGauge(
+            "pedalmap_elevation_refresh_pending_retries", "Failed tiles waiting for their backoff",
+            [refresh]() { return static_cast<double>(refresh->getStats().pendingRetries); });
+        metrics.addCounter(
+            "pedalmap_elevation_refreshes_total", "Background tile refreshes by result",
+            [refresh]() { return static_cast<double>(refresh->getStats().refreshedTotal); },
+            "result=\"ok\"");
+        metrics.addCounter(
+            "pedalmap_elevation_refreshes_total", "Background tile refreshes by result",
+            [refresh]() { return static_cast<double>(refresh->getStats().failedTotal); },
+            "result=\"failed\"");
+    }
+
+    // Places cache
+    auto places = spotService->placesCache();
+    if (places) {
+        const char *placesHelp = "Places nearby-search lookups by result";
+        metrics.addCounter(
+            "pedalmap_places_lookups_total", placesHelp,
+            [places]() { return static_cast<double>(places->getStats().l1Hits); },
+            "result=\"l1_hit\"");
+        metrics.addCounter(
+            "pedalmap_places_lookups_total", placesHelp,
+            [places]() { return static_cast<double>(places->getStats().l2Hits); },
+            "result=\"l2_hit\"");
+        metrics.addCounter(
+            "pedalmap_places_lookups_total", placesHelp,
+            [places]() { return static_cast<double>(places->getStats().misses); },
+            "result=\"miss\"");
+    }
+
+    // In-process LRU caches
+    const char *sizeHelp = "Entries held by an in-process LRU cache";
+    const char *capacityHelp = "Capacity of an in-process LRU cache";
+    if (elevation) {
+        metrics.addGauge(
+            "pedalmap_lru_cache_entries", sizeHelp,
+            [elevation]() { return static_cast<double>(elevation->l1Size()); },
+            "cache=\"elevation_l1\"");
+        metrics.addGauge(
+            "pedalmap_lru_cache_capacity", capacityHelp,
+            [elevation]() { return static_cast<double>(elevation->getStats().l1Capacity); },
+            "cache=\"elevation_l1\"");
+    }
+    if (places) {
+        metrics.addGauge(
+            "pedalmap_lru_cache_entries", sizeHelp,
+            [places]() { return static_cast<double>(places->l1Size()); },
+            "cache=\"places_l1\"");
+        metrics.addGauge(
+            "pedalmap_lru_cache_capacity", capacityHelp,
+            [places]() { return static_cast<double>(places->l1Capacity()); },
+            "cache=\"places_l1\"");
+    }
+
+    // Deferred spot searches
+    metrics.addGauge(
+        "pedalmap_spot_search_jobs_pending", "Deferred spot searches queued or running",
+        [spotSearchJobs]() { return static_cast<double>(spotSearchJobs->pendingCount()); });
+}
+
+}  // namespace
+
 int main() {
     std::cout << "Starting Cycling Backend Server..." << std::endl;
 
@@ -38,44 +183,75 @@ int main() {
         });
 
     // OPTIONS Handler
-    drogon::app().registerHandler(
-        "/api/v1/route/generate",
-        [](const drogon::HttpRequestPtr &req,
-           std::function<void(const drogon::HttpResponsePtr &)> &&callback) {
-            auto resp = drogon::HttpResponse::newHttpResponse();
-            resp->setStatusCode(drogon::k200OK);
-            callback(resp);
-        },
-        {drogon::Options});
+    for (const char *path : {"/api/v1/route/generate", "/api/v1/route/generate/batch"}) {
+        drogon::app().registerHandler(
+            path,
+            [](const drogon::HttpRequestPtr &req,
+               std::function<void(const drogon::HttpResponsePtr &)> &&callback) {
+                auto resp = drogon::HttpResponse::newHttpResponse();
+                resp->setStatusCode(drogon::k200OK);
+                callback(resp);
+            },
+            {drogon::Options});
+    }
 
     // 3. Initialize Services (Dependency Injection Wiring)
 
     // OSRM & Spot Services
     auto osrmClient = std::make_shared<services::OSRMClient>(*configService);
     auto spotService = std::make_shared<services::SpotService>(*configService);
+    auto spotSearchJobs = std::make_shared<services::SpotSearchJobs>(
+        spotService, static_cast<size_t>(std::max(configService->getDeferredSpotWorkers(), 1)),
+        static_cast<size_t>(std::max(configService->getDeferredSpotMaxPending(), 1)),
+        std::chrono::seconds(configService->getDeferredSpotTtlSeconds()));
 
     // Elevation Stack
     auto backendProvider = std::make_shared<services::elevation::GSIElevationProvider>();
+    cycling::utils::CircuitBreaker::Options breakerOptions;
+    breakerOptions.failureRateThreshold = configService->getGsiBreakerFailureRate();
+    breakerOptions.slowCallThreshold =
+        std::chrono::milliseconds(configService->getGsiBreakerSlowCallMs());
+    breakerOptions.openDuration = std::chrono::seconds(configService->getGsiBreakerOpenSeconds());
+    backendProvider->setCircuitBreakerOptions(breakerOptions);
 
     // We need to get the Redis client from Drogon.
     // Note: createRedisClient is async/lazy, but getRedisClient returns the pointer.
     auto redisClient = drogon::app().getRedisClient();
+    if (redisClient) {
+        // Places 検索結果を複数インスタンスで共有する
+        spotService->placesCache()->setRedisClient(redisClient);
+    }
 
     std::shared_ptr<services::RouteService> routeService;
+    std::shared_ptr<services::elevation::ElevationCacheManager> elevationManager;
+    std::shared_ptr<services::elevation::SmartRefreshService> refreshService;
 
     if (redisClient) {
         LOG_INFO << "Redis client initialized. Setting up Elevation Cache Layer.";
         auto repository = std::make_shared<services::elevation::RedisElevationAdapter>(redisClient);
 
-        auto refreshService =
+        refreshService =
             std::make_shared<services::elevation::SmartRefreshService>(repository, backendProvider);
         refreshService->setRefreshThreshold(configService->getElevationRefreshThresholdScore());
+        refreshService->setMaxConcurrentFetches(configService->getElevationRefreshConcurrency());
+        refreshService->setRateLimit(configService->getElevationRefreshRatePerSecond(),
+                                     configService->getElevationRefreshConcurrency());
+        refreshService->setStalenessScan(
+            configService->getElevationStalenessScanTopN(),
+            std::chrono::seconds(configService->getElevationStalenessScanIntervalSeconds()));
         refreshService->startWorker();
 
-        auto elevationManager = std::make_shared<services::elevation::ElevationCacheManager>(
+        elevationManager = std::make_shared<services::elevation::ElevationCacheManager>(
             repository, backendProvider, refreshService,
             configService->getElevationLruCacheCapacity());
 
+        // Warm L1 before the listeners start so the first requests after a deploy hit memory
+        elevationManager->warmUp(
+            configService->getElevationL1SnapshotPath(),
+            static_cast<size_t>(std::max(configService->getElevationWarmupTopN(), 0)),
+            static_cast<size_t>(std::max(configService->getElevationWarmupParallelism(), 1)),
+            std::chrono::milliseconds(configService->getElevationWarmupBudgetMs()));
+
         routeService = std::make_shared<services::RouteService>(elevationManager);
     } else {
         LOG_WARN << "Redis client not available. Using direct GSI Elevation Provider.";
@@ -89,9 +265,43 @@ int main() {
     api::v1::Route::setOSRMClient(osrmClient);
     api::v1::Route::setSpotService(spotService);
     api::v1::Route::setRouteService(routeService);
+    api::v1::Route::setSpotSearchJobs(spotSearchJobs);
+
+    // ルート生成の計算プール (ROUTE_WORKERS が 0 以下ならコア数) と、受け付ける数の上限
+    int routeWorkers = configService->getRouteWorkers();
+    if (routeWorkers <= 0) {
+        routeWorkers = static_cast<int>(std::max(std::thread::hardware_concurrency(), 1u));
+    }
+    auto computePool = std::make_shared<trantor::ConcurrentTaskQueue>(
+        static_cast<size_t>(routeWorkers), "RouteComputePool");
+    api::v1::Route::setComputePool(computePool, static_cast<size_t>(routeWorkers));
+    int maxInFlight = configService->getRouteMaxInFlight();
+    auto limiter = std::make_shared<cycling::utils::ConcurrencyLimiter>(
+        static_cast<size_t>(maxInFlight > 0 ? maxInFlight : routeWorkers * 4));
+    api::v1::Route::setConcurrencyLimiter(limiter);
+
+    // 5. Prometheus metrics (GET /metrics)
+    auto metrics = std::make_shared<services::MetricsExporter>();
+    registerMetrics(*metrics, routeService, elevationManager, refreshService, spotService,
+                    spotSearchJobs, limiter);
+    drogon::app().registerHandler(
+        "/metrics",
+        [metrics](const drogon::HttpRequestPtr &req,
+                  std::function<void(const drogon::HttpResponsePtr &)> &&callback) {
+            auto resp = drogon::HttpResponse::newHttpResponse();
+            resp->setContentTypeString(services::MetricsExporter::kContentType);
+            resp->setBody(metrics->render());
+            callback(resp);
+        },
+        {drogon::Get});
 
-    // 5. Run Server
+    // 6. Run Server
     drogon::app().run();
 
+    // 7. Persist hot tiles for the next boot
+    if (elevationManager && !configService->getElevationL1SnapshotPath().empty()) {
+        elevationManager->saveSnapshot(configService->getElevationL1SnapshotPath());
+    }
+
     return 0;
 }
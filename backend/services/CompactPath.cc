@@ -0,0 +1,14 @@
+#include "CompactPath.h"
+
+namespace services {
+
+CompactPath::CompactPath(std::span<const Coordinate> coords) {
+    lats_.resize(coords.size());
+    lons_.resize(coords.size());
+    for (size_t i = 0; i < coords.size(); ++i) {
+        lats_[i] = toFixedE7(coords[i].lat);
+        lons_[i] = toFixedE7(coords[i].lon);
+    }
+}
+
+}  // namespace services
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <vector>
+
+#include "Coordinate.h"
+
+namespace services {
+
+/**
+ * @brief Route path stored as fixed-point (1e-7 degree) int32 coordinates, struct-of-arrays
+ *
+ * Half the size of std::vector<Coordinate> with ~1 cm resolution. The elevation lookup reads the
+ * two int32 lanes directly (IElevationProvider::getElevationsSyncE7); other users read single
+ * points through operator[]. Vectors and brace lists convert implicitly.
+ */
+class CompactPath {
+   public:
+    CompactPath() = default;
+    CompactPath(std::span<const Coordinate> coords);
+    CompactPath(const std::vector<Coordinate>& coords)
+        : CompactPath(std::span<const Coordinate>(coords)) {}
+    CompactPath(std::initializer_list<Coordinate> coords)
+        : CompactPath(std::span<const Coordinate>(coords.begin(), coords.size())) {}
+
+    void reserve(size_t n) {
+        lats_.reserve(n);
+        lons_.reserve(n);
+    }
+    void push_back(const Coordinate& coord) {
+        lats_.push_back(toFixedE7(coord.lat));
+        lons_.push_back(toFixedE7(coord.lon));
+    }
+    void clear() {
+        lats_.clear();
+        lons_.clear();
+    }
+
+    [[nodiscard]] size_t size() const { return lats_.size(); }
+    [[nodiscard]] bool empty() const { return lats_.empty(); }
+    Coordinate operator[](size_t i) const {
+        return {fromFixedE7(lats_[i]), fromFixedE7(lons_[i])};
+    }
+    Coordinate front() const { return (*this)[0]; }
+    Coordinate back() const { return (*this)[size() - 1]; }
+
+    // 1e-7 度単位の座標列
+    [[nodiscard]] std::span<const int32_t> latsE7() const { return lats_; }
+    [[nodiscard]] std::span<const int32_t> lonsE7() const { return lons_; }
+
+   private:
+    std::vector<int32_t> lats_;
+    std::vector<int32_t> lons_;
+};
+
+}  // namespace services
@@ -42,9 +42,22 @@ ConfigService::ConfigService() {
     // Server
     serverPort_ = getEnvInt("SERVER_PORT", 8080);
     allowOrigin_ = getEnvString("ALLOW_ORIGIN", "*");
+    traceDebugEnabled_ = getEnvInt("TRACE_DEBUG_ENABLED", 0) != 0;
+    traceOutputDir_ = getEnvString("TRACE_OUTPUT_DIR", "/tmp");
 
     // Logic
     spotSearchRadius_ = getEnvDouble("SPOT_SEARCH_RADIUS", 500.0);
+    placesEnrichmentEnabled_ = getEnvInt("SPOTS_PLACES_ENRICHMENT", 0) != 0;
+    placesCacheCapacity_ = getEnvInt("PLACES_CACHE_CAPACITY", 5000);
+    placesCacheTtlSeconds_ = getEnvInt("PLACES_CACHE_TTL_SEC", 24 * 60 * 60);
+    deferredSpotWorkers_ = getEnvInt("SPOTS_DEFERRED_WORKERS", 2);
+    deferredSpotMaxPending_ = getEnvInt("SPOTS_DEFERRED_MAX_PENDING", 256);
+    deferredSpotTtlSeconds_ = getEnvInt("SPOTS_DEFERRED_TTL_SEC", 120);
+    routeWorkers_ = getEnvInt("ROUTE_WORKERS", 0);
+    routeMaxInFlight_ = getEnvInt("ROUTE_MAX_IN_FLIGHT", 0);
+    routeDeadlineMs_ = getEnvInt("ROUTE_DEADLINE_MS", 15000);
+    routeBatchMaxRequests_ = getEnvInt("ROUTE_BATCH_MAX_REQUESTS", 1000);
+    routeBatchMemoCapacity_ = getEnvInt("ROUTE_BATCH_MEMO_CAPACITY", 2048);
 
     // Redis & Cache
     redisHost_ = getEnvString("REDIS_HOST", "127.0.0.1");
@@ -53,6 +66,18 @@ ConfigService::ConfigService() {
     elevationCacheTtlDays_ = getEnvInt("ELEVATION_CACHE_TTL_DAYS", 365);
     elevationRefreshThresholdScore_ = getEnvInt("ELEVATION_REFRESH_THRESHOLD_SCORE", 10);
     elevationLruCacheCapacity_ = getEnvInt("ELEVATION_LRU_CACHE_CAPACITY", 1000);
+    elevationRefreshConcurrency_ = getEnvInt("ELEVATION_REFRESH_CONCURRENCY", 4);
+    elevationRefreshRatePerSecond_ = getEnvDouble("ELEVATION_REFRESH_RATE_PER_SEC", 2.0);
+    elevationStalenessScanTopN_ = getEnvInt("ELEVATION_STALENESS_SCAN_TOP_N", 1000);
+    elevationStalenessScanIntervalSeconds_ =
+        getEnvInt("ELEVATION_STALENESS_SCAN_INTERVAL_SEC", 600);
+    elevationL1SnapshotPath_ = getEnvString("ELEVATION_L1_SNAPSHOT_PATH", "");
+    elevationWarmupTopN_ = getEnvInt("ELEVATION_WARMUP_TOP_N", 500);
+    elevationWarmupBudgetMs_ = getEnvInt("ELEVATION_WARMUP_BUDGET_MS", 5000);
+    elevationWarmupParallelism_ = getEnvInt("ELEVATION_WARMUP_PARALLELISM", 4);
+    gsiBreakerFailureRate_ = getEnvDouble("GSI_BREAKER_FAILURE_RATE", 0.5);
+    gsiBreakerSlowCallMs_ = getEnvInt("GSI_BREAKER_SLOW_CALL_MS", 3000);
+    gsiBreakerOpenSeconds_ = getEnvInt("GSI_BREAKER_OPEN_SEC", 30);
 }
 
 std::string ConfigService::getEnvString(const char* key, const std::string& defaultValue) {
@@ -121,7 +146,20 @@ int ConfigService::getApiTimeoutSeconds() const { return apiTimeoutSeconds_; }
 int ConfigService::getApiRetryCount() const { return apiRetryCount_; }
 int ConfigService::getServerPort() const { return serverPort_; }
 std::string ConfigService::getAllowOrigin() const { return allowOrigin_; }
+bool ConfigService::isTraceDebugEnabled() const { return traceDebugEnabled_; }
+std::string ConfigService::getTraceOutputDir() const { return traceOutputDir_; }
 double ConfigService::getSpotSearchRadius() const { return spotSearchRadius_; }
+bool ConfigService::isPlacesEnrichmentEnabled() const { return placesEnrichmentEnabled_; }
+int ConfigService::getPlacesCacheCapacity() const { return placesCacheCapacity_; }
+int ConfigService::getPlacesCacheTtlSeconds() const { return placesCacheTtlSeconds_; }
+int ConfigService::getDeferredSpotWorkers() const { return deferredSpotWorkers_; }
+int ConfigService::getDeferredSpotMaxPending() const { return deferredSpotMaxPending_; }
+int ConfigService::getDeferredSpotTtlSeconds() const { return deferredSpotTtlSeconds_; }
+int ConfigService::getRouteWorkers() const { return routeWorkers_; }
+int ConfigService::getRouteMaxInFlight() const { return routeMaxInFlight_; }
+int ConfigService::getRouteDeadlineMs() const { return routeDeadlineMs_; }
+int ConfigService::getRouteBatchMaxRequests() const { return routeBatchMaxRequests_; }
+int ConfigService::getRouteBatchMemoCapacity() const { return routeBatchMemoCapacity_; }
 std::string ConfigService::getRedisHost() const { return redisHost_; }
 int ConfigService::getRedisPort() const { return redisPort_; }
 std::string ConfigService::getRedisPassword() const { return redisPassword_; }
@@ -130,5 +168,20 @@ int ConfigService::getElevationRefreshThresholdScore() const {
     return elevationRefreshThresholdScore_;
 }
 int ConfigService::getElevationLruCacheCapacity() const { return elevationLruCacheCapacity_; }
+int ConfigService::getElevationRefreshConcurrency() const { return elevationRefreshConcurrency_; }
+double ConfigService::getElevationRefreshRatePerSecond() const {
+    return elevationRefreshRatePerSecond_;
+}
+int ConfigService::getElevationStalenessScanTopN() const { return elevationStalenessScanTopN_; }
+int ConfigService::getElevationStalenessScanIntervalSeconds() const {
+    return elevationStalenessScanIntervalSeconds_;
+}
+std::string ConfigService::getElevationL1SnapshotPath() const { return elevationL1SnapshotPath_; }
+int ConfigService::getElevationWarmupTopN() const { return elevationWarmupTopN_; }
+int ConfigService::getElevationWarmupBudgetMs() const { return elevationWarmupBudgetMs_; }
+int ConfigService::getElevationWarmupParallelism() const { return elevationWarmupParallelism_; }
+double ConfigService::getGsiBreakerFailureRate() const { return gsiBreakerFailureRate_; }
+int ConfigService::getGsiBreakerSlowCallMs() const { return gsiBreakerSlowCallMs_; }
+int ConfigService::getGsiBreakerOpenSeconds() const { return gsiBreakerOpenSeconds_; }
 
 }  // namespace services
@@ -24,9 +24,25 @@ class ConfigService {
     // Server configurations
     [[nodiscard]] virtual int getServerPort() const;
     [[nodiscard]] virtual std::string getAllowOrigin() const;
+    [[nodiscard]] virtual bool isTraceDebugEnabled() const;
+    [[nodiscard]] virtual std::string getTraceOutputDir() const;
 
     // Logic configurations
     [[nodiscard]] virtual double getSpotSearchRadius() const;
+    [[nodiscard]] virtual bool isPlacesEnrichmentEnabled() const;
+    [[nodiscard]] virtual int getPlacesCacheCapacity() const;
+    [[nodiscard]] virtual int getPlacesCacheTtlSeconds() const;
+    [[nodiscard]] virtual int getDeferredSpotWorkers() const;
+    [[nodiscard]] virtual int getDeferredSpotMaxPending() const;
+    [[nodiscard]] virtual int getDeferredSpotTtlSeconds() const;
+    // ルート生成の計算プールのスレッド数 (0 のときは CPU のコア数)
+    [[nodiscard]] virtual int getRouteWorkers() const;
+    // 同時に受け付けるルート生成 (実行中 + 待ち) の上限。0 のときは計算プールのスレッド数の 4 倍
+    [[nodiscard]] virtual int getRouteMaxInFlight() const;
+    // リクエストの期限の既定値 (X-Request-Timeout-Ms ヘッダーはこれより短くする場合のみ有効)
+    [[nodiscard]] virtual int getRouteDeadlineMs() const;
+    [[nodiscard]] virtual int getRouteBatchMaxRequests() const;
+    [[nodiscard]] virtual int getRouteBatchMemoCapacity() const;
 
     // Redis and Cache configurations
     [[nodiscard]] virtual std::string getRedisHost() const;
@@ -35,6 +51,17 @@ class ConfigService {
     [[nodiscard]] virtual int getElevationCacheTtlDays() const;
     [[nodiscard]] virtual int getElevationRefreshThresholdScore() const;
     [[nodiscard]] virtual int getElevationLruCacheCapacity() const;
+    [[nodiscard]] virtual int getElevationRefreshConcurrency() const;
+    [[nodiscard]] virtual double getElevationRefreshRatePerSecond() const;
+    [[nodiscard]] virtual int getElevationStalenessScanTopN() const;
+    [[nodiscard]] virtual int getElevationStalenessScanIntervalSeconds() const;
+    [[nodiscard]] virtual std::string getElevationL1SnapshotPath() const;
+    [[nodiscard]] virtual int getElevationWarmupTopN() const;
+    [[nodiscard]] virtual int getElevationWarmupBudgetMs() const;
+    [[nodiscard]] virtual int getElevationWarmupParallelism() const;
+    [[nodiscard]] virtual double getGsiBreakerFailureRate() const;
+    [[nodiscard]] virtual int getGsiBreakerSlowCallMs() const;
+    [[nodiscard]] virtual int getGsiBreakerOpenSeconds() const;
 
    private:
     std::string findPath(const std::string& filename, const std::string& defaultPath);
@@ -56,13 +83,37 @@ class ConfigService {
     int apiRetryCount_;
     int serverPort_;
     std::string allowOrigin_;
+    bool traceDebugEnabled_;
+    std::string traceOutputDir_;
     double spotSearchRadius_;
+    bool placesEnrichmentEnabled_;
+    int placesCacheCapacity_;
+    int placesCacheTtlSeconds_;
+    int deferredSpotWorkers_;
+    int deferredSpotMaxPending_;
+    int deferredSpotTtlSeconds_;
+    int routeWorkers_;
+    int routeMaxInFlight_;
+    int routeDeadlineMs_;
+    int routeBatchMaxRequests_;
+    int routeBatchMemoCapacity_;
     std::string redisHost_;
     int redisPort_;
     std::string redisPassword_;
     int elevationCacheTtlDays_;
     int elevationRefreshThresholdScore_;
     int elevationLruCacheCapacity_;
+    int elevationRefreshConcurrency_;
+    double elevationRefreshRatePerSecond_;
+    int elevationStalenessScanTopN_;
+    int elevationStalenessScanIntervalSeconds_;
+    std::string elevationL1SnapshotPath_;
+    int elevationWarmupTopN_;
+    int elevationWarmupBudgetMs_;
+    int elevationWarmupParallelism_;
+    double gsiBreakerFailureRate_;
+    int gsiBreakerSlowCallMs_;
+    int gsiBreakerOpenSeconds_;
 };
 
 }  // namespace services
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <cmath>
+#include <cstdint>
+
 namespace services {
 
 struct Coordinate {
@@ -7,4 +10,12 @@ struct Coordinate {
     double lon;
 };
 
+// 固定小数点の座標 (1e-7 度単位の int32, 約 1 cm)。CompactPath と標高の一括取得で使う
+constexpr double kFixedPointScale = 1e7;
+
+inline int32_t toFixedE7(double degrees) {
+    return static_cast<int32_t>(std::lround(degrees * kFixedPointScale));
+}
+inline double fromFixedE7(int32_t value) { return value / kFixedPointScale; }
+
 }  // namespace services
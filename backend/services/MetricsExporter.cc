@@ -0,0 +1,88 @@
+#include "MetricsExporter.h"
+
+#include <cmath>
+#include <cstdio>
+
+namespace services {
+
+namespace {
+
+std::string formatValue(double value) {
+    if (std::isinf(value)) return value > 0 ? "+Inf" : "-Inf";
+    if (std::isnan(value)) return "NaN";
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.15g", value);
+    return buffer;
+}
+
+// `name{labels}` または `name{labels,extra}`
+std::string series(const std::string& name, const std::string& labels,
+                   const std::string& extra = "") {
+    if (labels.empty() && extra.empty()) return name;
+    std::string result = name + "{" + labels;
+    if (!labels.empty() && !extra.empty()) result += ",";
+    return result + extra + "}";
+}
+
+}  // namespace
+
+void MetricsExporter::addCounter(const std::string& name, const std::string& help,
+                                 ValueFn value, const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    family(name, help, "counter").samples.push_back({labels, std::move(value), nullptr});
+}
+
+void MetricsExporter::addGauge(const std::string& name, const std::string& help, ValueFn value,
+                               const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    family(name, help, "gauge").samples.push_back({labels, std::move(value), nullptr});
+}
+
+void MetricsExporter::addHistogram(const std::string& name, const std::string& help,
+                                   const ::cycling::utils::Histogram& histogram,
+                                   const std::string& labels) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    family(name, help, "histogram").samples.push_back({labels, nullptr, &histogram});
+}
+
+std::string MetricsExporter::render() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::string out;
+    for (const auto& family : families_) {
+        out += "# HELP " + family.name + " " + family.help + "\n";
+        out += "# TYPE " + family.name + " " + family.type + "\n";
+        for (const auto& sample : family.samples) {
+            if (!sample.histogram) {
+                out += series(family.name, sample.labels) + " " + formatValue(sample.value()) +
+                       "\n";
+                continue;
+            }
+            auto snapshot = sample.histogram->snapshot();
+            uint64_t cumulative = 0;
+            for (size_t i = 0; i < snapshot.counts.size(); ++i) {
+                cumulative += snapshot.counts[i];
+                std::string le = i < snapshot.upperBounds.size()
+                                     ? formatValue(snapshot.upperBounds[i])
+                                     : "+Inf";
+                out += series(family.name + "_bucket", sample.labels, "le=\"" + le + "\"") + " " +
+                       std::to_string(cumulative) + "\n";
+            }
+            out += series(family.name + "_sum", sample.labels) + " " +
+                   formatValue(snapshot.sum) + "\n";
+            out += series(family.name + "_count", sample.labels) + " " +
+                   std::to_string(snapshot.count) + "\n";
+        }
+    }
+    return out;
+}
+
+MetricsExporter::Family& MetricsExporter::family(const std::string& name, const std::string& help,
+                                                 const char* type) {
+    auto it = index_.find(name);
+    if (it != index_.end()) return families_[it->second];
+    index_[name] = families_.size();
+    families_.push_back({name, help, type, {}});
+    return families_.back();
+}
+
+}  // namespace services
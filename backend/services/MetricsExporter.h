@@ -0,0 +1,58 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../utils/Histogram.h"
+
+namespace services {
+
+/**
+ * @brief Renders registered metrics in the Prometheus text exposition format
+ *
+ * Nothing is recorded here: counters and gauges are read through callbacks at scrape time and
+ * histograms are read from their owners (RouteService, ElevationCacheManager), so the request
+ * path only touches the owners' atomics. Registered histograms must outlive the exporter.
+ * Samples that share a name are rendered as one family and must differ in their labels,
+ * given as `key="value"` pairs without braces.
+ */
+class MetricsExporter {
+   public:
+    using ValueFn = std::function<double()>;
+
+    void addCounter(const std::string& name, const std::string& help, ValueFn value,
+                    const std::string& labels = "");
+    void addGauge(const std::string& name, const std::string& help, ValueFn value,
+                  const std::string& labels = "");
+    void addHistogram(const std::string& name, const std::string& help,
+                      const ::cycling::utils::Histogram& histogram,
+                      const std::string& labels = "");
+
+    [[nodiscard]] std::string render() const;
+
+    static constexpr const char* kContentType = "text/plain; version=0.0.4; charset=utf-8";
+
+   private:
+    struct Sample {
+        std::string labels;
+        ValueFn value;
+        const ::cycling::utils::Histogram* histogram = nullptr;
+    };
+    struct Family {
+        std::string name;
+        std::string help;
+        std::string type;
+        std::vector<Sample> samples;
+    };
+
+    Family& family(const std::string& name, const std::string& help, const char* type);
+
+    mutable std::mutex mutex_;
+    std::vector<Family> families_;  // Registration order
+    std::unordered_map<std::string, size_t> index_;
+};
+
+}  // namespace services
@@ -25,6 +25,10 @@ class OSRMClient {
 
     const osrm::OSRM& getOSRM() const { return *osrm_; }
 
+   protected:
+    // 地図データを読み込まない (リプレイ用の代替実装など、Route を上書きする派生クラス向け)
+    OSRMClient() = default;
+
    private:
     std::unique_ptr<osrm::OSRM> osrm_;
 };
@@ -0,0 +1,200 @@
+#include "PlacesCache.h"
+
+#include <json/json.h>
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <future>
+#include <mutex>
+#include <sstream>
+
+namespace services {
+
+namespace {
+
+constexpr char kKeyPrefix[] = "cycling:places:v1:";
+// Log the hit rate every N lookups
+constexpr uint64_t kStatsLogInterval = 1000;
+// Longest wait for the L2 replies of one lookup before treating the rest as misses
+constexpr auto kRedisWaitTimeout = std::chrono::seconds(1);
+
+}  // namespace
+
+PlacesCache::PlacesCache(size_t capacity, std::chrono::seconds ttl)
+    : l1_(std::max<size_t>(capacity, 1)),
+      ttl_(std::clamp(ttl, std::chrono::seconds(1), kMaxTtl)) {}
+
+void PlacesCache::setRedisClient(drogon::nosql::RedisClientPtr redisClient) {
+    redisClient_ = std::move(redisClient);
+}
+
+std::string PlacesCache::makeKey(const std::string& geohash, double radiusMeters,
+                                 const std::string& typeFilter) {
+    char radius[32];
+    snprintf(radius, sizeof(radius), "%.0f", radiusMeters);
+    return std::string(kKeyPrefix) + geohash + ":" + radius + ":" + typeFilter;
+}
+
+std::optional<std::vector<Spot>> PlacesCache::get(const std::string& key) {
+    return std::move(getMany({key}).front());
+}
+
+std::vector<std::optional<std::vector<Spot>>> PlacesCache::getMany(
+    const std::vector<std::string>& keys) {
+    uint64_t now = nowSeconds();
+    std::vector<std::optional<std::vector<Spot>>> results(keys.size());
+
+    std::vector<size_t> l1Misses;
+    for (size_t i = 0; i < keys.size(); ++i) {
+        auto cached = l1_.get(keys[i]);
+        if (cached && cached->expiresAt > now) {
+            recordLookup(l1Hits_);
+            results[i] = *cached->spots;
+        } else {
+            l1Misses.push_back(i);
+        }
+    }
+
+    std::vector<std::string> payloads;
+    if (redisClient_ && !l1Misses.empty()) {
+        payloads = fetchPayloads(keys, l1Misses);
+    }
+    for (size_t j = 0; j < l1Misses.size(); ++j) {
+        size_t i = l1Misses[j];
+        uint64_t expiresAt = 0;
+        if (j < payloads.size() && !payloads[j].empty()) {
+            if (auto spots = deserialize(payloads[j], now, &expiresAt)) {
+                l1_.put(keys[i],
+                        Entry{std::make_shared<const std::vector<Spot>>(*spots), expiresAt});
+                recordLookup(l2Hits_);
+                results[i] = std::move(spots);
+                continue;
+            }
+        }
+        recordLookup(misses_);
+    }
+    return results;
+}
+
+std::vector<std::string> PlacesCache::fetchPayloads(const std::vector<std::string>& keys,
+                                                    const std::vector<size_t>& indices) {
+    struct BatchState {
+        std::mutex mutex;
+        std::vector<std::string> payloads;
+        size_t remaining;
+        std::promise<void> done;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->payloads.resize(indices.size());
+    state->remaining = indices.size();
+
+    auto finishOne = [](const std::shared_ptr<BatchState>& s, size_t j, std::string payload) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->payloads[j] = std::move(payload);
+        if (--s->remaining == 0) s->done.set_value();
+    };
+
+    // Pipeline the GETs without waiting for each reply, then wait for all of them
+    for (size_t j = 0; j < indices.size(); ++j) {
+        redisClient_->execCommandAsync(
+            [state, finishOne, j](const drogon::nosql::RedisResult& r) {
+                finishOne(state, j,
+                          r.type() == drogon::nosql::RedisResultType::kString ? r.asString()
+                                                                              : std::string());
+            },
+            [state, finishOne, j](const std::exception& e) {
+                LOG_ERROR << "Redis error in PlacesCache::getMany: " << e.what();
+                finishOne(state, j, std::string());
+            },
+            "GET %s", keys[indices[j]].c_str());
+    }
+
+    // Keys that were not answered in time count as misses (late replies are dropped)
+    if (state->done.get_future().wait_for(kRedisWaitTimeout) != std::future_status::ready) {
+        LOG_WARN << "Timeout waiting for PlacesCache::getMany replies";
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->payloads;
+}
+
+void PlacesCache::put(const std::string& key, const std::vector<Spot>& spots) {
+    uint64_t expiresAt = nowSeconds() + static_cast<uint64_t>(ttl_.count());
+    l1_.put(key, Entry{std::make_shared<const std::vector<Spot>>(spots), expiresAt});
+
+    if (redisClient_) {
+        std::string payload = serialize(spots, expiresAt);
+        redisClient_->execCommandAsync(
+            [](const drogon::nosql::RedisResult& r) {
+                if (r.type() == drogon::nosql::RedisResultType::kError) {
+                    LOG_ERROR << "Redis error in PlacesCache::put: " << r.asString();
+                }
+            },
+            [](const std::exception& e) {
+                LOG_ERROR << "Redis exception in PlacesCache::put: " << e.what();
+            },
+            "SETEX %s %lld %s", key.c_str(), static_cast<long long>(ttl_.count()),
+            payload.c_str());
+    }
+}
+
+PlacesCacheStats PlacesCache::getStats() const {
+    return PlacesCacheStats{l1Hits_.load(), l2Hits_.load(), misses_.load()};
+}
+
+std::string PlacesCache::serialize(const std::vector<Spot>& spots, uint64_t expiresAt) {
+    Json::Value root;
+    root["expires_at"] = Json::UInt64(expiresAt);
+    root["spots"] = Json::Value(Json::arrayValue);
+    for (const auto& spot : spots) {
+        Json::Value item;
+        item["name"] = spot.name;
+        item["type"] = spot.type;
+        item["lat"] = spot.lat;
+        item["lon"] = spot.lon;
+        item["rating"] = spot.rating;
+        root["spots"].append(item);
+    }
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "";
+    return Json::writeString(writer, root);
+}
+
+std::optional<std::vector<Spot>> PlacesCache::deserialize(const std::string& payload,
+                                                          uint64_t now, uint64_t* expiresAt) {
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    std::istringstream stream(payload);
+    if (!Json::parseFromStream(reader, stream, &root, &errors) || !root.isObject() ||
+        !root["spots"].isArray() || root["expires_at"].asUInt64() <= now) {
+        return std::nullopt;
+    }
+    if (expiresAt) *expiresAt = root["expires_at"].asUInt64();
+
+    std::vector<Spot> spots;
+    for (const auto& item : root["spots"]) {
+        spots.push_back(Spot{item["name"].asString(), item["type"].asString(),
+                             item["lat"].asDouble(), item["lon"].asDouble(),
+                             item["rating"].asDouble()});
+    }
+    return spots;
+}
+
+uint64_t PlacesCache::nowSeconds() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::seconds>(
+                                     std::chrono::system_clock::now().time_since_epoch())
+                                     .count());
+}
+
+void PlacesCache::recordLookup(std::atomic<uint64_t>& counter) {
+    counter++;
+    auto stats = getStats();
+    uint64_t total = stats.l1Hits + stats.l2Hits + stats.misses;
+    if (total % kStatsLogInterval == 0) {
+        LOG_INFO << "Places cache: " << total << " lookups, hit rate " << stats.hitRate() * 100.0
+                 << "% (L1 " << stats.l1Hits << ", L2 " << stats.l2Hits << ")";
+    }
+}
+
+}  // namespace services
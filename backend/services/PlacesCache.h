@@ -0,0 +1,87 @@
+#pragma once
+
+#include <drogon/nosql/RedisClient.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "../utils/LruCache.h"
+#include "Spot.h"
+
+namespace services {
+
+/**
+ * @brief Places lookup counters
+ */
+struct PlacesCacheStats {
+    uint64_t l1Hits = 0;
+    uint64_t l2Hits = 0;
+    uint64_t misses = 0;
+
+    double hitRate() const {
+        uint64_t total = l1Hits + l2Hits + misses;
+        return total == 0 ? 0.0 : static_cast<double>(l1Hits + l2Hits) / total;
+    }
+};
+
+/**
+ * @brief Cache for Places nearby-search results keyed by geohash cell, radius and type filter
+ *
+ * L1 is an in-process LRU; L2 is Redis when a client is attached. Entries carry their absolute
+ * expiry so an L2 hit never outlives the TTL it was written with. The TTL is capped at 30 days,
+ * the longest Google Places allows location data to be cached.
+ */
+class PlacesCache {
+   public:
+    static constexpr std::chrono::seconds kMaxTtl{30 * 24 * 60 * 60};
+
+    PlacesCache(size_t capacity, std::chrono::seconds ttl);
+
+    // Attach the shared Redis client as the second tier (nullptr disables it)
+    void setRedisClient(drogon::nosql::RedisClientPtr redisClient);
+
+    static std::string makeKey(const std::string& geohash, double radiusMeters,
+                               const std::string& typeFilter);
+
+    std::optional<std::vector<Spot>> get(const std::string& key);
+    // Look up several keys at once (one entry per key). L1 misses are fetched from Redis as
+    // pipelined GETs, so a route's cells cost one round trip instead of one per cell
+    std::vector<std::optional<std::vector<Spot>>> getMany(const std::vector<std::string>& keys);
+    void put(const std::string& key, const std::vector<Spot>& spots);
+
+    [[nodiscard]] PlacesCacheStats getStats() const;
+    [[nodiscard]] size_t l1Size() const { return l1_.size(); }
+    [[nodiscard]] size_t l1Capacity() const { return l1_.capacity(); }
+
+    // Redis payload: {"expires_at": unix seconds, "spots": [...]}
+    static std::string serialize(const std::vector<Spot>& spots, uint64_t expiresAt);
+    static std::optional<std::vector<Spot>> deserialize(const std::string& payload, uint64_t now,
+                                                        uint64_t* expiresAt = nullptr);
+
+   private:
+    struct Entry {
+        std::shared_ptr<const std::vector<Spot>> spots;
+        uint64_t expiresAt;  // unix seconds
+    };
+
+    static uint64_t nowSeconds();
+    // Redis payloads of keys[indices[j]] (empty when absent or not answered in time)
+    std::vector<std::string> fetchPayloads(const std::vector<std::string>& keys,
+                                           const std::vector<size_t>& indices);
+    void recordLookup(std::atomic<uint64_t>& counter);
+
+    ::cycling::utils::LruCache<std::string, Entry> l1_;
+    std::chrono::seconds ttl_;
+    drogon::nosql::RedisClientPtr redisClient_;
+
+    std::atomic<uint64_t> l1Hits_{0};
+    std::atomic<uint64_t> l2Hits_{0};
+    std::atomic<uint64_t> misses_{0};
+};
+
+}  // namespace services
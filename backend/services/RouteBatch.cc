@@ -0,0 +1,219 @@
+#include "RouteBatch.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <exception>
+#include <utility>
+
+#include "../utils/Deadline.h"
+
+namespace services {
+
+namespace {
+
+void appendCoordinate(std::string& key, const Coordinate& c) {
+    char buf[48];
+    int n = std::snprintf(buf, sizeof(buf), "%.6f,%.6f;", c.lat, c.lon);
+    key.append(buf, static_cast<size_t>(n));
+}
+
+}  // namespace
+
+RouteMemo::RouteMemo(size_t capacity) : results_(std::max<size_t>(capacity, 1)) {}
+
+std::string RouteMemo::key(const Coordinate& start, const Coordinate& end,
+                           const std::vector<Coordinate>& waypoints) {
+    std::string key;
+    key.reserve((waypoints.size() + 2) * 24);
+    appendCoordinate(key, start);
+    for (const auto& wp : waypoints) {
+        appendCoordinate(key, wp);
+    }
+    appendCoordinate(key, end);
+    return key;
+}
+
+std::optional<RouteResult> RouteMemo::getOrCompute(const std::string& key,
+                                                   const Compute& compute) {
+    while (true) {
+        std::promise<Computed> promise;
+        std::shared_future<Computed> pending;
+        {
+            // 結果の登録と inFlight_ からの削除は同じロックの中で行うので、ここで両方とも
+            // 見つからなければ、このスレッドが計算する
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (auto cached = results_.get(key)) {
+                hits_++;
+                return *cached;
+            }
+            auto it = inFlight_.find(key);
+            if (it != inFlight_.end()) {
+                pending = it->second;
+            } else {
+                inFlight_.emplace(key, promise.get_future().share());
+            }
+        }
+        if (pending.valid()) {
+            coalesced_++;
+            Computed computed = pending.get();
+            // 計算した側の期限切れで打ち切られた結果は、自分の期限も切れている場合だけ使う
+            if (computed.remembered || utils::Deadline::currentExpired()) {
+                return computed.result;
+            }
+            continue;
+        }
+
+        std::optional<RouteResult> result;
+        try {
+            result = compute();
+        } catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                inFlight_.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        bool remember = !utils::Deadline::currentExpired();
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (remember) results_.put(key, result);
+            inFlight_.erase(key);
+        }
+        promise.set_value({result, remember});
+        return result;
+    }
+}
+
+RouteBatchRunner::RouteBatchRunner(const std::vector<Json::Value>& requests, size_t parallelism,
+                                   size_t memoCapacity, Handler handler, Executor executor,
+                                   Emit emit, Done done)
+    : requestCount_(requests.size()),
+      parallelism_(std::max<size_t>(parallelism, 1)),
+      memo_(memoCapacity),
+      handler_(std::move(handler)),
+      executor_(std::move(executor)),
+      emit_(std::move(emit)),
+      done_(std::move(done)) {
+    // "id" 以外が同じリクエストは 1 回だけ計算する (jsoncpp はキーを整列して書き出すので、
+    // キーの順序が違うだけのリクエストも同じ文字列になる)
+    std::unordered_map<std::string, size_t> itemByRequest;
+    ids_.reserve(requests.size());
+    for (size_t i = 0; i < requests.size(); ++i) {
+        Json::Value request = requests[i];
+        Json::Value id;
+        if (request.isObject() && request.isMember("id")) {
+            id = request["id"];
+            request.removeMember("id");
+        }
+        ids_.push_back(std::move(id));
+
+        auto [it, inserted] = itemByRequest.emplace(toLine(request), items_.size());
+        if (inserted) {
+            items_.push_back({std::move(request), {}});
+        }
+        items_[it->second].indices.push_back(i);
+    }
+}
+
+void RouteBatchRunner::start(const std::vector<Json::Value>& requests, size_t parallelism,
+                             size_t memoCapacity, Handler handler, Executor executor, Emit emit,
+                             Done done) {
+    std::shared_ptr<RouteBatchRunner> runner(
+        new RouteBatchRunner(requests, parallelism, memoCapacity, std::move(handler),
+                             std::move(executor), std::move(emit), std::move(done)));
+    if (runner->items_.empty()) {
+        runner->finish();
+        return;
+    }
+    runner->schedule();
+}
+
+std::string RouteBatchRunner::toLine(const Json::Value& value) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, value);
+}
+
+void RouteBatchRunner::schedule() {
+    std::vector<size_t> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!cancelled_ && running_ < parallelism_ && next_ < items_.size()) {
+            ready.push_back(next_++);
+            running_++;
+        }
+    }
+    auto self = shared_from_this();
+    for (size_t item : ready) {
+        executor_([self, item]() { self->run(item); });
+    }
+}
+
+void RouteBatchRunner::run(size_t item) {
+    bool skip = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        skip = cancelled_;
+    }
+
+    Outcome outcome;
+    try {
+        if (!skip) outcome = handler_(items_[item].request, memo_);
+    } catch (const std::exception& e) {
+        outcome.status = 500;
+        outcome.error = e.what();
+    } catch (...) {
+        outcome.status = 500;
+        outcome.error = "Unknown error";
+    }
+
+    bool finished = false;
+    {
+        // 行の書き出しもこのロックで直列化する
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (size_t index : items_[item].indices) {
+            if (cancelled_) break;
+            Json::Value line;
+            line["index"] = static_cast<Json::UInt64>(index);
+            if (!ids_[index].isNull()) line["id"] = ids_[index];
+            line["status"] = outcome.status;
+            if (outcome.status == 200) {
+                line["result"] = outcome.body;
+                succeeded_++;
+            } else {
+                line["error"] = outcome.error;
+                failed_++;
+            }
+            if (!emit_(toLine(line) + "\n")) {
+                cancelled_ = true;
+            }
+        }
+        running_--;
+        finished = running_ == 0 && (cancelled_ || next_ == items_.size());
+    }
+
+    if (finished) {
+        finish();
+    } else {
+        schedule();
+    }
+}
+
+void RouteBatchRunner::finish() {
+    if (!cancelled_) {
+        Json::Value summary;
+        summary["requests"] = static_cast<Json::UInt64>(requestCount_);
+        summary["unique"] = static_cast<Json::UInt64>(items_.size());
+        summary["succeeded"] = static_cast<Json::UInt64>(succeeded_);
+        summary["failed"] = static_cast<Json::UInt64>(failed_);
+        summary["memo_hits"] = static_cast<Json::UInt64>(memo_.hits());
+        summary["memo_coalesced"] = static_cast<Json::UInt64>(memo_.coalesced());
+        Json::Value line;
+        line["summary"] = summary;
+        emit_(toLine(line) + "\n");
+    }
+    if (done_) done_();
+}
+
+}  // namespace services
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../utils/LruCache.h"
+#include "Coordinate.h"
+#include "RouteService.h"
+
+namespace services {
+
+/**
+ * @brief Memo of candidate route evaluations shared by every item of one batch
+ *
+ * Keyed by the exact coordinates sent to OSRM (start, waypoints, end), so detour candidates
+ * that several batch items have in common are routed once. Concurrent lookups of a key that is
+ * still being computed wait for that computation instead of starting their own.
+ */
+class RouteMemo {
+   public:
+    using Compute = std::function<std::optional<RouteResult>()>;
+
+    explicit RouteMemo(size_t capacity);
+
+    static std::string key(const Coordinate& start, const Coordinate& end,
+                           const std::vector<Coordinate>& waypoints);
+
+    // 失敗 (std::nullopt) も結果として覚える。compute が例外を投げた場合と、計算を終えた時点で
+    // そのスレッドの期限 (utils::Deadline) が切れていた場合は覚えない (途中で打ち切った結果を
+    // 他の項目に使わせない。その計算を待っていた項目は、自分の期限が残っていれば計算し直す)
+    std::optional<RouteResult> getOrCompute(const std::string& key, const Compute& compute);
+
+    [[nodiscard]] uint64_t hits() const { return hits_; }
+    [[nodiscard]] uint64_t coalesced() const { return coalesced_; }
+
+   private:
+    struct Computed {
+        std::optional<RouteResult> result;
+        bool remembered;  // results_ に登録したか
+    };
+
+    cycling::utils::LruCache<std::string, std::optional<RouteResult>> results_;
+    std::mutex mutex_;
+    std::unordered_map<std::string, std::shared_future<Computed>> inFlight_;
+    std::atomic<uint64_t> hits_{0};
+    std::atomic<uint64_t> coalesced_{0};
+};
+
+/**
+ * @brief Runs the items of a batch route request and streams each result as an NDJSON line
+ *
+ * Identical items (ignoring "id") are computed once and reported under every index they
+ * appear at. At most `parallelism` items are handed to the executor at a time; the next one is
+ * scheduled when one completes, so a large batch does not flood a pool shared with other
+ * batches. Lines are emitted in completion order:
+ *
+ *   {"index":0,"id":"a","status":200,"result":{...}}
+ *   {"index":1,"status":400,"error":"Missing start_point or end_point"}
+ *   {"summary":{"requests":2,"unique":2,"succeeded":1,"failed":1,...}}
+ *
+ * When emit() returns false (the client went away) the remaining items are not started, no
+ * summary is written and done() is called once the running items return.
+ */
+class RouteBatchRunner : public std::enable_shared_from_this<RouteBatchRunner> {
+   public:
+    struct Outcome {
+        int status = 200;
+        Json::Value body;   // status が 200 のとき
+        std::string error;  // それ以外のとき
+    };
+
+    using Handler = std::function<Outcome(const Json::Value& request, RouteMemo& memo)>;
+    using Executor = std::function<void(std::function<void()> task)>;
+    using Emit = std::function<bool(const std::string& line)>;
+    using Done = std::function<void()>;
+
+    static void start(const std::vector<Json::Value>& requests, size_t parallelism,
+                      size_t memoCapacity, Handler handler, Executor executor, Emit emit,
+                      Done done);
+
+    // 改行を含まない 1 行の JSON
+    static std::string toLine(const Json::Value& value);
+
+   private:
+    struct Item {
+        Json::Value request;
+        std::vector<size_t> indices;  // 元のリクエスト配列での位置
+    };
+
+    RouteBatchRunner(const std::vector<Json::Value>& requests, size_t parallelism,
+                     size_t memoCapacity, Handler handler, Executor executor, Emit emit, Done done);
+
+    void schedule();
+    void run(size_t item);
+    void finish();
+
+    std::vector<Json::Value> ids_;
+    std::vector<Item> items_;
+    size_t requestCount_;
+    size_t parallelism_;
+    RouteMemo memo_;
+    Handler handler_;
+    Executor executor_;
+    Emit emit_;
+    Done done_;
+
+    std::mutex mutex_;
+    size_t next_ = 0;
+    size_t running_ = 0;
+    size_t succeeded_ = 0;
+    size_t failed_ = 0;
+    bool cancelled_ = false;
+};
+
+}  // namespace services
@@ -1,11 +1,19 @@
 #include "RouteService.h"
 
+#include <algorithm>
+#include <array>
 #include <cmath>
+#include <cstddef>
 #include <iostream>
 #include <limits>
+#include <memory_resource>
 #include <numbers>
 #include <osrm/route_parameters.hpp>
+#include <span>
 
+#include "../utils/Deadline.h"
+#include "../utils/PolylineDecoder.h"
+#include "../utils/Trace.h"
 #include "elevation/IElevationProvider.h"
 
 // Logger
@@ -33,6 +41,54 @@ double calculateDistanceKm(const Coordinate& p1, const Coordinate& p2) {
     return kEarthRadiusKm * c;
 }
 
+// 候補の評価ごとに確保し直さないよう、スレッドごとに容量を使い回す作業領域
+// (評価中に同じスレッドで findBestRoute が入れ子に呼ばれることはない)
+thread_local std::vector<Coordinate> candidateWaypointsScratch;
+
+// 重なりを測るセルの大きさ (度)。緯度方向で約 110 m
+constexpr double kOverlapCellDegrees = 0.001;
+// セルを飛ばさないよう、長い区間はこの間隔 (度) で補間する
+constexpr double kOverlapSampleDegrees = kOverlapCellDegrees / 2.0;
+
+// 経路が通るセル (整列済み、重複なし)
+std::vector<uint64_t> routeCells(std::span<const Coordinate> path) {
+    std::vector<uint64_t> cells;
+    auto add = [&cells](double lat, double lon) {
+        auto row = static_cast<int32_t>(std::floor(lat / kOverlapCellDegrees));
+        auto col = static_cast<int32_t>(std::floor(lon / kOverlapCellDegrees));
+        cells.push_back((static_cast<uint64_t>(static_cast<uint32_t>(row)) << 32) |
+                        static_cast<uint32_t>(col));
+    };
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (i > 0) {
+            double dLat = path[i].lat - path[i - 1].lat;
+            double dLon = path[i].lon - path[i - 1].lon;
+            int steps = static_cast<int>(
+                std::ceil(std::max(std::abs(dLat), std::abs(dLon)) / kOverlapSampleDegrees));
+            for (int s = 1; s < steps; ++s) {
+                double t = static_cast<double>(s) / steps;
+                add(path[i - 1].lat + dLat * t, path[i - 1].lon + dLon * t);
+            }
+        }
+        add(path[i].lat, path[i].lon);
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+    return cells;
+}
+
+double cellOverlap(const std::vector<uint64_t>& route, const std::vector<uint64_t>& other) {
+    if (route.empty()) return 0.0;
+    size_t shared = 0;
+    auto it = other.begin();
+    for (uint64_t cell : route) {
+        it = std::lower_bound(it, other.end(), cell);
+        if (it == other.end()) break;
+        if (*it == cell) shared++;
+    }
+    return static_cast<double>(shared) / static_cast<double>(route.size());
+}
+
 }  // namespace
 
 RouteService::RouteService(std::shared_ptr<elevation::IElevationProvider> elevationProvider)
@@ -181,6 +237,61 @@ std::optional<RouteResult> RouteService::findBestRoute(
     double targetDistanceKm, double targetElevationM, const RouteEvaluator& evaluator) {
     if (targetDistanceKm <= 0) return std::nullopt;
 
+    // 参照 1 つだけを持つラムダなので、std::function への変換でヒープ確保は起きない
+    struct Best {
+        std::optional<RouteResult> route;
+        double cost = std::numeric_limits<double>::max();
+    } best;
+    evaluateCandidates(start, end, fixedWaypoints, targetDistanceKm, targetElevationM, evaluator,
+                       [&best](RouteResult&& result, double cost) {
+                           if (cost < best.cost) {
+                               best.cost = cost;
+                               best.route = std::move(result);
+                           }
+                       });
+    return std::move(best.route);
+}
+
+std::vector<RouteResult> RouteService::findBestRoutes(
+    const Coordinate& start, const Coordinate& end, const std::vector<Coordinate>& fixedWaypoints,
+    double targetDistanceKm, double targetElevationM, const RouteEvaluator& evaluator,
+    size_t maxRoutes, double maxOverlap) {
+    std::vector<RouteResult> selected;
+    if (targetDistanceKm <= 0 || maxRoutes == 0) return selected;
+
+    std::vector<std::pair<double, RouteResult>> ranked;
+    evaluateCandidates(start, end, fixedWaypoints, targetDistanceKm, targetElevationM, evaluator,
+                       [&ranked](RouteResult&& result, double cost) {
+                           ranked.emplace_back(cost, std::move(result));
+                       });
+    // コストが同じなら評価順 (findBestRoute が選ぶものが先頭になる)
+    std::stable_sort(ranked.begin(), ranked.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+
+    std::vector<std::vector<uint64_t>> selectedCells;
+    for (auto& [cost, route] : ranked) {
+        if (selected.size() >= maxRoutes) break;
+        auto cells = routeCells(utils::PolylineDecoder::decode(route.geometry, kGeometryPrecision));
+        bool distinct = std::none_of(
+            selectedCells.begin(), selectedCells.end(),
+            [&](const auto& other) { return cellOverlap(cells, other) > maxOverlap; });
+        if (!distinct) continue;
+        selectedCells.push_back(std::move(cells));
+        selected.push_back(std::move(route));
+    }
+    return selected;
+}
+
+double RouteService::overlapRatio(std::span<const Coordinate> route,
+                                  std::span<const Coordinate> other) {
+    return cellOverlap(routeCells(route), routeCells(other));
+}
+
+void RouteService::evaluateCandidates(const Coordinate& start, const Coordinate& end,
+                                      const std::vector<Coordinate>& fixedWaypoints,
+                                      double targetDistanceKm, double targetElevationM,
+                                      const RouteEvaluator& evaluator,
+                                      const CandidateSink& sink) {
     double straightDist;
     if (fixedWaypoints.empty()) {
         straightDist = calculateDistanceKm(start, end);
@@ -195,26 +306,35 @@ std::optional<RouteResult> RouteService::findBestRoute(
     // MCSS Algorithm: Multi-Candidate Sampling & Selection
 
     // 1. Determine expansion factors based on ratio
-    std::vector<double> expansionFactors;
+    static constexpr std::array kLoopFactors{0.2, 0.3, 0.4, 0.5, 0.6};
+    static constexpr std::array kShortFactors{0.1, 0.2};
+    static constexpr std::array kDetourFactors{0.5, 0.8, 1.0, 1.2, 1.5};
+    std::span<const double> expansionFactors;
     if (straightDist == 0) {  // Loop
-        expansionFactors = {0.2, 0.3, 0.4, 0.5, 0.6};
+        expansionFactors = kLoopFactors;
     } else {
         double ratio = targetDistanceKm / straightDist;
         if (ratio < 1.1) {
-            expansionFactors = {0.1, 0.2};
+            expansionFactors = kShortFactors;
         } else {
-            expansionFactors = {0.5, 0.8, 1.0, 1.2, 1.5};
+            expansionFactors = kDetourFactors;
         }
     }
 
+    // 候補は迂回点 (0〜2 点) だけを持ち、固定経由地との連結は評価の直前に作業領域で行う。
+    // 候補の一覧はスタック上のアリーナに置くので、候補の生成でヒープ確保は起きない
     struct Candidate {
-        std::vector<Coordinate> waypoints;
-        std::string type;
+        std::array<Coordinate, 2> detour;
+        size_t detourCount;
+        const char* type;
     };
-    std::vector<Candidate> candidates;
+    std::array<std::byte, 2048> arenaBuffer;
+    std::pmr::monotonic_buffer_resource arena(arenaBuffer.data(), arenaBuffer.size());
+    std::pmr::vector<Candidate> candidates(&arena);
+    candidates.reserve(1 + expansionFactors.size() * 4);
 
     // Base candidate: Direct path (or just fixed waypoints)
-    candidates.push_back({fixedWaypoints, "Direct"});
+    candidates.push_back({{}, 0, "Direct"});
 
     // Determine segment to insert detour
     Coordinate segmentStart = start;
@@ -251,10 +371,7 @@ std::optional<RouteResult> RouteService::findBestRoute(
             double viaLat = midLat + (side * perpY * currentHeight) / kLatDegToKm;
             double viaLon = midLon + (side * perpX * currentHeight) / kLonDegToKm;
 
-            std::vector<Coordinate> candWps;
-            candWps.push_back({viaLat, viaLon});
-            candWps.insert(candWps.end(), fixedWaypoints.begin(), fixedWaypoints.end());
-            candidates.push_back({candWps, "Single"});
+            candidates.push_back({{Coordinate{viaLat, viaLon}}, 1, "Single"});
         }
 
         // Polygon Detour (2 points)
@@ -270,24 +387,29 @@ std::optional<RouteResult> RouteService::findBestRoute(
                 double p2Lon = segmentStart.lon + 2.0 * (segmentEnd.lon - segmentStart.lon) / 3.0 +
                                (side * perpX * offsetHeight) / kLonDegToKm;
 
-                std::vector<Coordinate> candWps;
-                candWps.push_back({p1Lat, p1Lon});
-                candWps.push_back({p2Lat, p2Lon});
-                candWps.insert(candWps.end(), fixedWaypoints.begin(), fixedWaypoints.end());
-                candidates.push_back({candWps, "Polygon"});
+                candidates.push_back(
+                    {{Coordinate{p1Lat, p1Lon}, Coordinate{p2Lat, p2Lon}}, 2, "Polygon"});
             }
         }
     }
 
-    std::optional<RouteResult> bestRoute = std::nullopt;
-    double minCost = std::numeric_limits<double>::max();
+    metrics_.candidates.observe(static_cast<double>(candidates.size()));
 
     const double kW_Distance = 1.0;
     const double kW_Elevation = 2.0;
 
+    auto& waypoints = candidateWaypointsScratch;
     for (const auto& cand : candidates) {
-        auto result = evaluator(cand.waypoints);
-        if (result) {
+        // 期限切れ・取り消し後は残りの候補を評価しない (呼び出し側はそれまでの結果を使う)
+        if (utils::Deadline::currentExpired()) {
+            LOG_DEBUG << "Deadline reached; skipping the remaining detour candidates";
+            break;
+        }
+        waypoints.assign(cand.detour.begin(), cand.detour.begin() + cand.detourCount);
+        waypoints.insert(waypoints.end(), fixedWaypoints.begin(), fixedWaypoints.end());
+        auto result = evaluator(waypoints);
+        // 期限切れで獲得標高が途中までしか数えられていない候補は、他と比べられないので使わない
+        if (result && !result->truncated) {
             double distDiff = std::abs(result->distance_m / 1000.0 - targetDistanceKm);
             double elevDiff = 0.0;
             if (targetElevationM > 0) {
@@ -296,15 +418,9 @@ std::optional<RouteResult> RouteService::findBestRoute(
 
             // Cost function
             double cost = kW_Distance * distDiff + kW_Elevation * (elevDiff / 100.0);
-
-            if (cost < minCost) {
-                minCost = cost;
-                bestRoute = result;
-            }
+            sink(std::move(*result), cost);
         }
     }
-
-    return bestRoute;
 }
 
 std::vector<Coordinate> RouteService::parseWaypoints(const Json::Value& json) {
@@ -328,6 +444,7 @@ osrm::RouteParameters RouteService::buildRouteParameters(const Coordinate& start
                                                          const Coordinate& end,
                                                          const std::vector<Coordinate>& waypoints) {
     osrm::RouteParameters params;
+    params.coordinates.reserve(waypoints.size() + 2);
     params.coordinates.emplace_back(osrm::util::FloatLongitude{start.lon},
                                     osrm::util::FloatLatitude{start.lat});
     for (const auto& wp : waypoints) {
@@ -337,13 +454,15 @@ osrm::RouteParameters RouteService::buildRouteParameters(const Coordinate& start
     params.coordinates.emplace_back(osrm::util::FloatLongitude{end.lon},
                                     osrm::util::FloatLatitude{end.lat});
 
-    params.geometries = osrm::RouteParameters::GeometriesType::Polyline;
+    params.geometries = osrm::RouteParameters::GeometriesType::Polyline6;
     params.overview = osrm::RouteParameters::OverviewType::Full;
     params.steps = true;
     return params;
 }
 
 std::optional<RouteResult> RouteService::processRoute(const osrm::json::Object& osrmResult) {
+    ::cycling::utils::ScopedTimer timer(metrics_.processRouteSeconds);
+    utils::TraceSpan span("process_route");
     if (!osrmResult.values.contains("routes")) {
         return std::nullopt;
     }
@@ -361,33 +480,44 @@ std::optional<RouteResult> RouteService::processRoute(const osrm::json::Object&
 
     if (route.values.contains("legs")) {
         const auto& legs = route.values.at("legs").get<osrm::json::Array>();
-        for (const auto& legValue : legs.values) {
-            const auto& leg = legValue.get<osrm::json::Object>();
-            if (leg.values.contains("steps")) {
+        auto forEachIntersections = [&legs](auto&& fn) {
+            for (const auto& legValue : legs.values) {
+                const auto& leg = legValue.get<osrm::json::Object>();
+                if (!leg.values.contains("steps")) continue;
                 const auto& steps = leg.values.at("steps").get<osrm::json::Array>();
                 for (const auto& stepValue : steps.values) {
                     const auto& step = stepValue.get<osrm::json::Object>();
                     if (step.values.contains("intersections")) {
-                        const auto& intersections =
-                            step.values.at("intersections").get<osrm::json::Array>();
-                        for (const auto& intersectionValue : intersections.values) {
-                            const auto& intersection = intersectionValue.get<osrm::json::Object>();
-                            if (intersection.values.contains("location")) {
-                                const auto& loc =
-                                    intersection.values.at("location").get<osrm::json::Array>();
-                                res.path.push_back({loc.values[1].get<osrm::json::Number>().value,
-                                                    loc.values[0].get<osrm::json::Number>().value});
-                            }
-                        }
+                        fn(step.values.at("intersections").get<osrm::json::Array>());
                     }
                 }
             }
-        }
+        };
+
+        // 交差点の総数を先に数えて、path を伸ばすたびの再確保をなくす
+        size_t intersectionCount = 0;
+        forEachIntersections([&intersectionCount](const osrm::json::Array& intersections) {
+            intersectionCount += intersections.values.size();
+        });
+        res.path.reserve(intersectionCount);
+
+        forEachIntersections([&res](const osrm::json::Array& intersections) {
+            for (const auto& intersectionValue : intersections.values) {
+                const auto& intersection = intersectionValue.get<osrm::json::Object>();
+                if (intersection.values.contains("location")) {
+                    const auto& loc = intersection.values.at("location").get<osrm::json::Array>();
+                    res.path.push_back({loc.values[1].get<osrm::json::Number>().value,
+                                        loc.values[0].get<osrm::json::Number>().value});
+                }
+            }
+        });
     }
 
     // Calculate elevation gain
     if (elevationProvider_ && !res.path.empty()) {
         res.elevation_gain_m = calculateElevationGain(res.path);
+        // 期限を過ぎると以降のタイルは引かれない (その地点は標高なしとして飛ばされる)
+        res.truncated = utils::Deadline::currentExpired();
         LOG_DEBUG << "Processed path size: " << res.path.size()
                   << ", calculated elevation gain: " << res.elevation_gain_m;
     } else {
@@ -398,17 +528,19 @@ std::optional<RouteResult> RouteService::processRoute(const osrm::json::Object&
     return res;
 }
 
-double RouteService::calculateElevationGain(const std::vector<Coordinate>& path) {
+double RouteService::calculateElevationGain(const CompactPath& path) {
     if (!elevationProvider_ || path.empty()) {
         return 0.0;
     }
+    ::cycling::utils::ScopedTimer timer(metrics_.elevationSeconds);
+    utils::TraceSpan span("elevation");
 
     double totalGain = 0.0;
     std::optional<double> lastElevation = std::nullopt;
 
-    // Sampling could be implemented here for performance
-    for (const auto& coord : path) {
-        auto currentElevation = elevationProvider_->getElevationSync(coord);
+    // 経路全体を固定小数点のレーンのまま渡し、タイル座標の計算とタイル参照をまとめてもらう
+    for (const auto& currentElevation :
+         elevationProvider_->getElevationsSyncE7(path.latsE7(), path.lonsE7())) {
         if (currentElevation) {
             if (lastElevation) {
                 if (*currentElevation > *lastElevation) {
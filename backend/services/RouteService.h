@@ -2,14 +2,19 @@
 
 #include <json/json.h>
 
+#include <atomic>
+#include <cstdint>
 #include <functional>
 #include <memory>
 #include <optional>
+#include <span>
 #include <osrm/osrm.hpp>
 #include <osrm/route_parameters.hpp>
 #include <string>
 #include <vector>
 
+#include "../utils/Histogram.h"
+#include "CompactPath.h"
 #include "Coordinate.h"
 
 namespace services {
@@ -22,12 +27,39 @@ struct RouteResult {
     double distance_m;
     double duration_s;
     double elevation_gain_m;
-    std::string geometry;
-    std::vector<Coordinate> path;
+    std::string geometry;  // OSRM の full overview (精度は RouteService::kGeometryPrecision)
+    CompactPath path;  // 交差点の座標列 (獲得標高の計算用)
+    // 標高の取得中に期限切れ・取り消しになった (elevation_gain_m が過小になりうる)
+    bool truncated = false;
+};
+
+/**
+ * @brief ルート生成の段階ごとの処理時間 (秒) と候補数
+ *
+ * elevation と processRoute (標高計算を含む)、candidates は RouteService 自身が記録し、
+ * それ以外はコントローラーが記録する。
+ */
+struct RouteMetrics {
+    using Histogram = ::cycling::utils::Histogram;
+
+    // 単発のリクエストは受け付けてから応答するまで、バッチの項目は計算を始めてから終わるまで
+    Histogram requestSeconds{Histogram::latencyBuckets()};
+    Histogram batchItemSeconds{Histogram::latencyBuckets()};
+    Histogram candidates{{1, 2, 4, 8, 12, 16, 24, 32}};
+    Histogram osrmRouteSeconds{Histogram::latencyBuckets()};
+    Histogram processRouteSeconds{Histogram::latencyBuckets()};
+    Histogram elevationSeconds{Histogram::latencyBuckets()};
+    Histogram spotSearchSeconds{Histogram::latencyBuckets()};
+    // 期限切れで打ち切ったリクエストと、クライアントの切断で取り消したリクエスト
+    std::atomic<uint64_t> deadlineExceeded{0};
+    std::atomic<uint64_t> cancelled{0};
 };
 
 class RouteService {
    public:
+    // OSRM には polyline6 を要求し、応答の精度はコントローラーで選ぶ
+    static constexpr double kGeometryPrecision = 1e6;
+
     explicit RouteService(
         std::shared_ptr<elevation::IElevationProvider> elevationProvider = nullptr);
     virtual ~RouteService() = default;
@@ -55,6 +87,33 @@ class RouteService {
                                                      double targetElevationM,
                                                      const RouteEvaluator& evaluator);
 
+    // 既に選んだルートとこれ以上重なる候補は、別のルートとして返さない
+    static constexpr double kDefaultMaxOverlap = 0.7;
+
+    /**
+     * @brief findBestRoute と同じ候補を評価し、コストの低い順に最大 maxRoutes 件を返す
+     *
+     * 先に選んだどのルートとも重なり (overlapRatio) が maxOverlap 以下の候補だけを選ぶので、
+     * 迂回の向きや大きさが違うだけで同じ道を通る候補は返さない。
+     * 先頭は findBestRoute の結果と同じ。
+     */
+    virtual std::vector<RouteResult> findBestRoutes(const Coordinate& start, const Coordinate& end,
+                                                    const std::vector<Coordinate>& fixedWaypoints,
+                                                    double targetDistanceKm,
+                                                    double targetElevationM,
+                                                    const RouteEvaluator& evaluator,
+                                                    size_t maxRoutes,
+                                                    double maxOverlap = kDefaultMaxOverlap);
+
+    /**
+     * @brief route のうち other と同じ道を通る部分の割合 (0〜1)
+     *
+     * 両方の経路を約 100 m 四方のセルに落とし、route が通るセルのうち other も通るものの
+     * 割合を返す。
+     */
+    static double overlapRatio(std::span<const Coordinate> route,
+                               std::span<const Coordinate> other);
+
     static osrm::RouteParameters buildRouteParameters(const Coordinate& start,
                                                       const Coordinate& end,
                                                       const std::vector<Coordinate>& waypoints);
@@ -64,10 +123,22 @@ class RouteService {
     /**
      * @brief ルート全体の獲得標高を計算する
      */
-    virtual double calculateElevationGain(const std::vector<Coordinate>& path);
+    virtual double calculateElevationGain(const CompactPath& path);
+
+    RouteMetrics& metrics() { return metrics_; }
 
    private:
+    using CandidateSink = std::function<void(RouteResult&& result, double cost)>;
+
+    // 迂回候補を作って順に評価し、ルートが得られたものをコストとともに sink に渡す
+    // (期限切れ・取り消し後は残りを評価しない)
+    void evaluateCandidates(const Coordinate& start, const Coordinate& end,
+                            const std::vector<Coordinate>& fixedWaypoints,
+                            double targetDistanceKm, double targetElevationM,
+                            const RouteEvaluator& evaluator, const CandidateSink& sink);
+
     std::shared_ptr<elevation::IElevationProvider> elevationProvider_;
+    RouteMetrics metrics_;
 };
 
 }  // namespace services
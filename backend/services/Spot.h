@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+
+namespace services {
+
+struct Spot {
+    std::string name;
+    std::string type;
+    double lat;
+    double lon;
+    double rating;
+};
+
+}  // namespace services
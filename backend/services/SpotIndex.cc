@@ -0,0 +1,217 @@
+#include "SpotIndex.h"
+
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <sstream>
+#include <unordered_map>
+
+namespace services {
+
+namespace {
+
+constexpr double kEarthRadiusMeters = 6371000.0;
+constexpr double kMetersPerDegree = kEarthRadiusMeters * std::numbers::pi / 180.0;
+// Upper bound on grid size; the cell size is doubled until the grid fits
+constexpr size_t kMaxCells = 1 << 22;
+
+/**
+ * Squared distance (in projected units) and segment parameter for n points against segment
+ * (ax, ay) -> (ax + dx, ay + dy). Points are projected on the fly with
+ * x = (lon - lon0) * xScale, y = lat - lat0. No branches, so the loop auto-vectorizes.
+ */
+void pointSegmentDistances(const double* lats, const double* lons, size_t n, double lat0,
+                           double lon0, double xScale, double ax, double ay, double dx, double dy,
+                           double invLenSq, double* distSq, double* t) {
+    for (size_t i = 0; i < n; ++i) {
+        double px = (lons[i] - lon0) * xScale - ax;
+        double py = (lats[i] - lat0) - ay;
+        double u = std::min(std::max((px * dx + py * dy) * invLenSq, 0.0), 1.0);
+        double ex = px - u * dx;
+        double ey = py - u * dy;
+        distSq[i] = ex * ex + ey * ey;
+        t[i] = u;
+    }
+}
+
+}  // namespace
+
+SpotIndex::SpotIndex(std::vector<Spot> spots, double cellSizeDegrees)
+    : cellSize_(std::max(cellSizeDegrees, 1e-6)) {
+    if (spots.empty()) {
+        cellStart_.assign(1, 0);
+        return;
+    }
+
+    auto [minLat, maxLat] = std::minmax_element(
+        spots.begin(), spots.end(), [](const Spot& a, const Spot& b) { return a.lat < b.lat; });
+    auto [minLon, maxLon] = std::minmax_element(
+        spots.begin(), spots.end(), [](const Spot& a, const Spot& b) { return a.lon < b.lon; });
+    originLat_ = minLat->lat;
+    originLon_ = minLon->lon;
+    double latSpan = maxLat->lat - originLat_;
+    double lonSpan = maxLon->lon - originLon_;
+
+    auto dimension = [this](double span) { return static_cast<int>(span / cellSize_) + 1; };
+    while (static_cast<size_t>(dimension(latSpan)) * dimension(lonSpan) > kMaxCells) {
+        cellSize_ *= 2.0;
+    }
+    rows_ = dimension(latSpan);
+    cols_ = dimension(lonSpan);
+
+    // Counting sort by cell: count, prefix-sum into offsets, then scatter
+    size_t cellCount = static_cast<size_t>(rows_) * cols_;
+    std::vector<uint32_t> cellOf(spots.size());
+    cellStart_.assign(cellCount + 1, 0);
+    for (size_t i = 0; i < spots.size(); ++i) {
+        cellOf[i] = static_cast<uint32_t>(static_cast<size_t>(cellRow(spots[i].lat)) * cols_ +
+                                          cellCol(spots[i].lon));
+        cellStart_[cellOf[i] + 1]++;
+    }
+    for (size_t c = 0; c < cellCount; ++c) {
+        cellStart_[c + 1] += cellStart_[c];
+    }
+
+    std::vector<uint32_t> next(cellStart_.begin(), cellStart_.end() - 1);
+    lats_.resize(spots.size());
+    lons_.resize(spots.size());
+    spots_.resize(spots.size());
+    for (size_t i = 0; i < spots.size(); ++i) {
+        uint32_t id = next[cellOf[i]]++;
+        lats_[id] = spots[i].lat;
+        lons_[id] = spots[i].lon;
+        spots_[id] = std::move(spots[i]);
+    }
+}
+
+std::vector<Spot> SpotIndex::loadCsv(const std::string& path) {
+    std::vector<Spot> spots;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        LOG_WARN << "Spots CSV not found: " << path;
+        return spots;
+    }
+
+    std::string line;
+    size_t skipped = 0;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        std::stringstream ss(line);
+        Spot spot;
+        std::string lat, lon, rating;
+        if (!std::getline(ss, spot.name, ',') || !std::getline(ss, spot.type, ',') ||
+            !std::getline(ss, lat, ',') || !std::getline(ss, lon, ',')) {
+            skipped++;
+            continue;
+        }
+        std::getline(ss, rating, ',');
+        try {
+            spot.lat = std::stod(lat);
+            spot.lon = std::stod(lon);
+            spot.rating = rating.empty() ? 0.0 : std::stod(rating);
+        } catch (...) {
+            skipped++;  // Header row or malformed numbers
+            continue;
+        }
+        spots.push_back(std::move(spot));
+    }
+
+    LOG_INFO << "Loaded " << spots.size() << " spots from " << path << " (skipped " << skipped
+             << " lines)";
+    return spots;
+}
+
+std::vector<size_t> SpotIndex::queryRadius(const Coordinate& center, double radiusMeters) const {
+    std::vector<size_t> hits;
+    if (spots_.empty() || radiusMeters < 0) return hits;
+
+    double dLat = radiusMeters / kMetersPerDegree;
+    double cosLat = std::max(std::cos(center.lat * std::numbers::pi / 180.0), 1e-6);
+    double dLon = dLat / cosLat;
+    forEachInBox(center.lat - dLat, center.lon - dLon, center.lat + dLat, center.lon + dLon,
+                 [&](size_t id, double lat, double lon) {
+                     if (distanceMeters(center, {lat, lon}) <= radiusMeters) hits.push_back(id);
+                 });
+    return hits;
+}
+
+std::vector<CorridorHit> SpotIndex::queryCorridor(std::span<const Coordinate> path,
+                                                  double bufferMeters) const {
+    std::vector<CorridorHit> hits;
+    if (spots_.empty() || path.empty() || bufferMeters < 0) return hits;
+
+    // Local equirectangular projection around the route; units are degrees of latitude
+    double lat0 = path.front().lat;
+    double lon0 = path.front().lon;
+    double xScale = std::max(std::cos(lat0 * std::numbers::pi / 180.0), 1e-6);
+    double buffer = bufferMeters / kMetersPerDegree;
+    double bufferSq = buffer * buffer;
+    double dLon = buffer / xScale;
+
+    std::unordered_map<size_t, size_t> hitIndex;  // spot id -> position in hits
+    std::vector<double> distSq;
+    std::vector<double> t;
+    double along = 0.0;  // Route distance to the start of the current segment (projected units)
+
+    size_t segments = std::max<size_t>(path.size(), 2) - 1;
+    for (size_t s = 0; s < segments; ++s) {
+        const Coordinate& a = path[s];
+        const Coordinate& b = path.size() > 1 ? path[s + 1] : path[s];
+        double ax = (a.lon - lon0) * xScale, ay = a.lat - lat0;
+        double dx = (b.lon - a.lon) * xScale, dy = b.lat - a.lat;
+        double lenSq = dx * dx + dy * dy;
+        double len = std::sqrt(lenSq);
+        double invLenSq = lenSq > 0.0 ? 1.0 / lenSq : 0.0;
+
+        forEachSpanInBox(
+            std::min(a.lat, b.lat) - buffer, std::min(a.lon, b.lon) - dLon,
+            std::max(a.lat, b.lat) + buffer, std::max(a.lon, b.lon) + dLon,
+            [&](size_t begin, size_t end) {
+                size_t n = end - begin;
+                distSq.resize(n);
+                t.resize(n);
+                pointSegmentDistances(lats_.data() + begin, lons_.data() + begin, n, lat0, lon0,
+                                      xScale, ax, ay, dx, dy, invLenSq, distSq.data(), t.data());
+                for (size_t i = 0; i < n; ++i) {
+                    if (distSq[i] > bufferSq) continue;
+                    double offset = std::sqrt(distSq[i]) * kMetersPerDegree;
+                    double alongMeters = (along + t[i] * len) * kMetersPerDegree;
+                    auto [it, inserted] = hitIndex.try_emplace(begin + i, hits.size());
+                    if (inserted) {
+                        hits.push_back({begin + i, alongMeters, offset});
+                    } else if (offset < hits[it->second].offsetMeters) {
+                        hits[it->second].alongMeters = alongMeters;
+                        hits[it->second].offsetMeters = offset;
+                    }
+                }
+            });
+        along += len;
+    }
+
+    std::sort(hits.begin(), hits.end(), [](const CorridorHit& x, const CorridorHit& y) {
+        return x.alongMeters < y.alongMeters;
+    });
+    return hits;
+}
+
+double SpotIndex::distanceMeters(const Coordinate& a, const Coordinate& b) {
+    double meanLat = (a.lat + b.lat) * 0.5 * std::numbers::pi / 180.0;
+    double dx = (b.lon - a.lon) * std::cos(meanLat);
+    double dy = b.lat - a.lat;
+    return std::sqrt(dx * dx + dy * dy) * kMetersPerDegree;
+}
+
+int SpotIndex::cellRow(double lat) const {
+    return std::clamp(static_cast<int>(std::floor((lat - originLat_) / cellSize_)), 0, rows_ - 1);
+}
+
+int SpotIndex::cellCol(double lon) const {
+    return std::clamp(static_cast<int>(std::floor((lon - originLon_) / cellSize_)), 0, cols_ - 1);
+}
+
+}  // namespace services
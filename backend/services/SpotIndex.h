@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Coordinate.h"
+#include "Spot.h"
+
+namespace services {
+
+/**
+ * @brief A spot found by a corridor query
+ */
+struct CorridorHit {
+    size_t id;            // Spot id in the index
+    double alongMeters;   // Distance along the route to the closest point
+    double offsetMeters;  // Distance from the route
+};
+
+/**
+ * @brief Read-only spatial index over a fixed set of spots
+ *
+ * Spots are bucketed into a uniform lat/lon grid and stored cell by cell (CSR layout): cell `c`
+ * owns ids `[cellStart_[c], cellStart_[c + 1])`. Coordinates are kept in separate contiguous
+ * arrays so range scans only touch the values they test; names and types are read only for hits.
+ */
+class SpotIndex {
+   public:
+    static constexpr double kDefaultCellSizeDegrees = 0.01;  // ~1.1 km
+
+    explicit SpotIndex(std::vector<Spot> spots = {},
+                       double cellSizeDegrees = kDefaultCellSizeDegrees);
+
+    /**
+     * @brief Load spots from a CSV file (name,type,lat,lon,rating; no header)
+     *
+     * Lines that cannot be parsed are skipped. Returns an empty vector if the file is missing.
+     */
+    static std::vector<Spot> loadCsv(const std::string& path);
+
+    [[nodiscard]] size_t size() const { return spots_.size(); }
+    [[nodiscard]] bool empty() const { return spots_.empty(); }
+    [[nodiscard]] const Spot& spot(size_t id) const { return spots_[id]; }
+
+    /**
+     * @brief Ids of spots within `radiusMeters` of `center`
+     */
+    [[nodiscard]] std::vector<size_t> queryRadius(const Coordinate& center,
+                                                  double radiusMeters) const;
+
+    /**
+     * @brief Spots within `bufferMeters` of the polyline, ordered by distance along it
+     *
+     * Each spot is reported once, at its closest approach to the route. Candidates come from the
+     * grid cells around each segment and are tested with a branch-free point-to-segment kernel
+     * over the contiguous coordinate arrays.
+     */
+    [[nodiscard]] std::vector<CorridorHit> queryCorridor(std::span<const Coordinate> path,
+                                                         double bufferMeters) const;
+
+    /**
+     * @brief Call `visit(id, lat, lon)` for every spot in cells overlapping the box
+     *
+     * Candidates may lie slightly outside the box; callers apply their own exact test.
+     */
+    template <typename Visitor>
+    void forEachInBox(double minLat, double minLon, double maxLat, double maxLon,
+                      Visitor&& visit) const {
+        forEachSpanInBox(minLat, minLon, maxLat, maxLon, [&](size_t begin, size_t end) {
+            for (size_t id = begin; id < end; ++id) {
+                visit(id, lats_[id], lons_[id]);
+            }
+        });
+    }
+
+    // Approximate distance in metres (equirectangular; accurate for the short ranges queried)
+    static double distanceMeters(const Coordinate& a, const Coordinate& b);
+
+   private:
+    // Call `visit(begin, end)` for each contiguous id range covering the box
+    template <typename SpanVisitor>
+    void forEachSpanInBox(double minLat, double minLon, double maxLat, double maxLon,
+                          SpanVisitor&& visit) const {
+        if (spots_.empty()) return;
+        int row0 = cellRow(minLat), row1 = cellRow(maxLat);
+        int col0 = cellCol(minLon), col1 = cellCol(maxLon);
+        for (int row = row0; row <= row1; ++row) {
+            // Cells of a row are adjacent, so a row span is one contiguous id range
+            size_t begin = cellStart_[static_cast<size_t>(row) * cols_ + col0];
+            size_t end = cellStart_[static_cast<size_t>(row) * cols_ + col1 + 1];
+            if (begin < end) visit(begin, end);
+        }
+    }
+
+    int cellRow(double lat) const;
+    int cellCol(double lon) const;
+
+    double cellSize_;
+    double originLat_ = 0.0;
+    double originLon_ = 0.0;
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<uint32_t> cellStart_;
+    std::vector<double> lats_;
+    std::vector<double> lons_;
+    std::vector<Spot> spots_;
+};
+
+}  // namespace services
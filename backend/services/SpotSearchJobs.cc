@@ -0,0 +1,114 @@
+#include "SpotSearchJobs.h"
+
+#include <drogon/drogon.h>
+#include <drogon/utils/Utilities.h>
+
+#include <algorithm>
+
+namespace services {
+
+SpotSearchJobs::SpotSearchJobs(std::shared_ptr<SpotService> spotService, size_t workers,
+                               size_t maxPending, std::chrono::seconds ttl)
+    : spotService_(std::move(spotService)),
+      maxPending_(std::max<size_t>(maxPending, 1)),
+      ttl_(ttl) {
+    workers = std::max<size_t>(workers, 1);
+    workers_.reserve(workers);
+    for (size_t i = 0; i < workers; ++i) {
+        workers_.emplace_back(&SpotSearchJobs::workerLoop, this);
+    }
+}
+
+SpotSearchJobs::~SpotSearchJobs() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    cv_.notify_all();
+    for (auto& worker : workers_) {
+        if (worker.joinable()) worker.join();
+    }
+}
+
+std::optional<std::string> SpotSearchJobs::submit(
+    std::shared_ptr<const std::vector<Coordinate>> path, double bufferMeters) {
+    auto job = std::make_shared<Job>();
+    job->path = std::move(path);
+    job->bufferMeters = bufferMeters;
+
+    std::string token = drogon::utils::getUuid();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        pruneExpired(Clock::now());
+        if (pending_ >= maxPending_) {
+            return std::nullopt;
+        }
+        jobs_.emplace(token, std::move(job));
+        queue_.push_back(token);
+        pending_++;
+    }
+    cv_.notify_one();
+    return token;
+}
+
+SpotSearchJobs::Lookup SpotSearchJobs::lookup(const std::string& token) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    pruneExpired(Clock::now());
+
+    Lookup result;
+    auto it = jobs_.find(token);
+    if (it == jobs_.end()) {
+        return result;
+    }
+    if (!it->second->done) {
+        result.status = Status::Pending;
+        return result;
+    }
+    result.status = Status::Ready;
+    result.spots = it->second->spots;
+    return result;
+}
+
+size_t SpotSearchJobs::pendingCount() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return pending_;
+}
+
+void SpotSearchJobs::workerLoop() {
+    while (true) {
+        std::string token;
+        std::shared_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+            if (stopping_) return;
+            token = std::move(queue_.front());
+            queue_.pop_front();
+            job = jobs_.at(token);
+        }
+
+        std::vector<Spot> spots;
+        try {
+            spots = spotService_->searchSpotsAlongRoute(*job->path, job->bufferMeters);
+        } catch (const std::exception& e) {
+            // 失敗してもスポットなしとして完了させ、クライアントのポーリングを終わらせる
+            LOG_ERROR << "Deferred spot search failed: " << e.what();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        job->spots = std::move(spots);
+        job->done = true;
+        job->path.reset();
+        expiries_.emplace_back(Clock::now() + ttl_, std::move(token));
+        pending_--;
+    }
+}
+
+void SpotSearchJobs::pruneExpired(Clock::time_point now) {
+    while (!expiries_.empty() && expiries_.front().first <= now) {
+        jobs_.erase(expiries_.front().second);
+        expiries_.pop_front();
+    }
+}
+
+}  // namespace services
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Coordinate.h"
+#include "Spot.h"
+#include "SpotService.h"
+
+namespace services {
+
+/**
+ * @brief Runs spot searches in the background so a route can be returned before its spots
+ *
+ * submit() queues a search and returns a token right away; a fixed pool of workers runs the
+ * searches (SpotService blocks on Places) and the result is kept under the token for `ttl`
+ * after it completes. Unknown, expired and already-evicted tokens all look the same to callers.
+ */
+class SpotSearchJobs {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class Status { Pending, Ready, NotFound };
+
+    struct Lookup {
+        Status status = Status::NotFound;
+        std::vector<Spot> spots;  // Ready のときのみ
+    };
+
+    SpotSearchJobs(std::shared_ptr<SpotService> spotService, size_t workers, size_t maxPending,
+                   std::chrono::seconds ttl);
+    ~SpotSearchJobs();
+
+    SpotSearchJobs(const SpotSearchJobs&) = delete;
+    SpotSearchJobs& operator=(const SpotSearchJobs&) = delete;
+
+    /**
+     * @brief Queue a spot search for a route
+     *
+     * @return token to poll with lookup(), or std::nullopt when `maxPending` searches are
+     *         already queued (the caller should search inline instead)
+     */
+    std::optional<std::string> submit(std::shared_ptr<const std::vector<Coordinate>> path,
+                                      double bufferMeters);
+
+    Lookup lookup(const std::string& token);
+
+    [[nodiscard]] size_t pendingCount() const;
+
+   private:
+    struct Job {
+        std::shared_ptr<const std::vector<Coordinate>> path;
+        double bufferMeters = 0.0;
+        bool done = false;
+        std::vector<Spot> spots;
+    };
+
+    void workerLoop();
+    void pruneExpired(Clock::time_point now);
+
+    std::shared_ptr<SpotService> spotService_;
+    size_t maxPending_;
+    std::chrono::seconds ttl_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::string> queue_;
+    std::unordered_map<std::string, std::shared_ptr<Job>> jobs_;
+    // 完了順 (TTL は一定なので期限順でもある) の (期限, トークン)
+    std::deque<std::pair<Clock::time_point, std::string>> expiries_;
+    size_t pending_ = 0;  // キュー待ちと実行中の合計
+    bool stopping_ = false;
+    std::vector<std::thread> workers_;
+};
+
+}  // namespace services
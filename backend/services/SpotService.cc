@@ -4,151 +4,344 @@
 #include <trantor/utils/Logger.h>
 
 #include <algorithm>
-#include <future>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
 #include <memory>
+#include <mutex>
+#include <random>
 #include <set>
-#include <thread>
 #include <vector>
 
+#include "../utils/Geohash.h"
 #include "../utils/PolylineDecoder.h"
+#include "../utils/Deadline.h"
+#include "../utils/Trace.h"
 
 namespace services {
 
-SpotService::SpotService(const ConfigService& configService) : configService_(configService) {}
+SpotService::SpotService(const ConfigService& configService)
+    : SpotService(configService, std::make_shared<const SpotIndex>(
+                                     SpotIndex::loadCsv(configService.getSpotsCsvPath()))) {}
+
+SpotService::SpotService(const ConfigService& configService,
+                         std::shared_ptr<const SpotIndex> spotIndex)
+    : configService_(configService), spotIndex_(std::move(spotIndex)) {
+    if (!spotIndex_) spotIndex_ = std::make_shared<const SpotIndex>();
+    placesCache_ = std::make_shared<PlacesCache>(
+        static_cast<size_t>(std::max(configService_.getPlacesCacheCapacity(), 1)),
+        std::chrono::seconds(configService_.getPlacesCacheTtlSeconds()));
+    if (!configService_.getGoogleApiKey().empty()) {
+        placesClient_ = drogon::HttpClient::newHttpClient(configService_.getGoogleMapsApiBaseUrl());
+    }
+}
 
 std::vector<Spot> SpotService::searchSpotsAlongRoute(const std::string& polylineGeometry,
-                                                     double bufferMeters) {
+                                                     double bufferMeters, double precision) {
     if (polylineGeometry.empty()) return {};
 
+    // Decode polyline
+    auto path = utils::PolylineDecoder::decode(polylineGeometry, precision);
+    return searchSpotsAlongRoute(path, bufferMeters);
+}
+
+std::vector<Spot> SpotService::searchSpotsAlongRoute(std::span<const Coordinate> path,
+                                                     double bufferMeters) {
+    if (path.empty()) return {};
+
+    if (bufferMeters <= 0) bufferMeters = configService_.getSpotSearchRadius();
+
+    auto spots = searchLocalIndex(path, bufferMeters);
+
+    // Places はネットワーク往復が発生するため、
+    // 明示的に有効化された場合かローカルデータが無い場合のみ使う
+    // (リクエストの期限切れ・取り消し後はローカルの結果だけを返す)
+    if ((spotIndex_->empty() || configService_.isPlacesEnrichmentEnabled()) &&
+        !utils::Deadline::currentExpired()) {
+        std::set<std::string> seenNames;
+        for (const auto& spot : spots) seenNames.insert(spot.name);
+        for (auto& spot : searchPlacesAlongRoute(path)) {
+            if (seenNames.insert(spot.name).second) spots.push_back(std::move(spot));
+        }
+    }
+
+    LOG_INFO << "Found total " << spots.size() << " unique spots.";
+    return spots;
+}
+
+std::vector<Spot> SpotService::searchLocalIndex(std::span<const Coordinate> path,
+                                                double bufferMeters) const {
+    std::vector<Spot> spots;
+    if (spotIndex_->empty()) return spots;
+
+    // ルートから bufferMeters 以内のスポットを、ルートに沿った距離順で返す
+    auto hits = spotIndex_->queryCorridor(path, bufferMeters);
+    spots.reserve(hits.size());
+    for (const auto& hit : hits) {
+        spots.push_back(spotIndex_->spot(hit.id));
+    }
+    return spots;
+}
+
+namespace {
+
+constexpr char kPlacesTypeFilter[] = "restaurant|cafe|convenience_store|point_of_interest";
+
+// 1 回の検索の状態。コールバックやタイマーからは shared_ptr 経由でのみ参照する
+// (期限切れ後に遅れて届いた応答や、SpotService の破棄後に発火した再試行でも安全)
+struct PlacesSearch {
+    drogon::HttpClientPtr client;
+    std::shared_ptr<PlacesCache> cache;
+    std::string apiPath;
+    std::string apiKey;
+    int maxRetries = 0;
+    std::chrono::steady_clock::time_point deadline;
+    std::vector<Coordinate> points;       // 検索するセルの中心
+    std::vector<double> radii;           // Places に送る検索半径 (points と同じ順)
+    std::vector<std::string> cacheKeys;  // points と同じ順
+    // 呼び出し元リクエストのトレース (応答が遅れて届いた場合は破棄済みで記録しない)
+    std::weak_ptr<utils::Trace> trace;
+    int traceParent = utils::Trace::kNoSpan;
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::vector<std::vector<Spot>> results;  // サンプル地点ごと
+    size_t remaining = 0;
+};
+
+void finishPoint(const std::shared_ptr<PlacesSearch>& search, size_t index,
+                 std::vector<Spot> spots) {
+    {
+        std::lock_guard<std::mutex> lock(search->mutex);
+        search->results[index] = std::move(spots);
+        search->remaining--;
+    }
+    search->cv.notify_all();
+}
+
+void sendPlacesRequest(const std::shared_ptr<PlacesSearch>& search, size_t index, int attempt) {
+    auto remaining = search->deadline - std::chrono::steady_clock::now();
+    double timeoutSec = std::chrono::duration<double>(remaining).count();
+    if (timeoutSec <= 0) {
+        finishPoint(search, index, {});
+        return;
+    }
+
+    const auto& point = search->points[index];
+    auto req = drogon::HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Get);
+    req->setPath(search->apiPath);
+    req->setParameter("location", std::to_string(point.lat) + "," + std::to_string(point.lon));
+    req->setParameter("radius", std::to_string(search->radii[index]));
+    req->setParameter("type", kPlacesTypeFilter);
+    req->setParameter("key", search->apiKey);
+    req->setParameter("language", "ja");
+
+    auto sentAt = std::chrono::steady_clock::now();
+    search->client->sendRequest(
+        req,
+        [search, index, attempt, sentAt](drogon::ReqResult result,
+                                         const drogon::HttpResponsePtr& response) {
+            std::vector<Spot> spots;
+            auto status = SpotService::PlacesStatus::Retryable;
+            if (result == drogon::ReqResult::Ok && response) {
+                auto jsonPtr = response->getJsonObject();
+                if (response->getStatusCode() == 200 && jsonPtr) {
+                    status = SpotService::parsePlacesResponse(*jsonPtr, spots);
+                } else if (response->getStatusCode() < 500 &&
+                           response->getStatusCode() != 429) {
+                    status = SpotService::PlacesStatus::Failed;
+                }
+            }
+            if (auto trace = search->trace.lock()) {
+                const char* outcome = status == SpotService::PlacesStatus::Ok       ? "ok"
+                                      : status == SpotService::PlacesStatus::Failed ? "failed"
+                                                                                    : "retryable";
+                trace->add("places", search->traceParent, sentAt, std::chrono::steady_clock::now(),
+                           std::string(outcome) + " attempt=" + std::to_string(attempt));
+            }
+
+            if (status == SpotService::PlacesStatus::Ok) {
+                search->cache->put(search->cacheKeys[index], spots);
+                finishPoint(search, index, std::move(spots));
+                return;
+            }
+            LOG_ERROR << "Places request failed. Result: " << (int)result
+                      << ", Status: " << (response ? response->getStatusCode() : 0);
+
+            if (status == SpotService::PlacesStatus::Failed || attempt >= search->maxRetries) {
+                finishPoint(search, index, {});
+                return;
+            }
+
+            // ジッター付き指数バックオフで再試行 (期限を越える場合は諦める)
+            thread_local std::mt19937 rng(std::random_device{}());
+            std::uniform_real_distribution<double> jitter(0.0, 1.0);
+            auto delay = SpotService::retryDelay(attempt + 1, jitter(rng));
+            if (std::chrono::steady_clock::now() + delay >= search->deadline) {
+                finishPoint(search, index, {});
+                return;
+            }
+            LOG_INFO << "Retrying spot search (attempt " << attempt + 1 << "/"
+                     << search->maxRetries << ") in " << delay.count() << "ms";
+            search->client->getLoop()->runAfter(
+                std::chrono::duration<double>(delay).count(),
+                [search, index, attempt]() { sendPlacesRequest(search, index, attempt + 1); });
+        },
+        timeoutSec);
+}
+
+}  // namespace
+
+std::vector<Spot> SpotService::searchPlacesAlongRoute(std::span<const Coordinate> path) {
     std::string apiKey = configService_.getGoogleApiKey();
-    if (apiKey.empty()) {
+    if (apiKey.empty() || !placesClient_) {
         LOG_WARN << "Google API Key is not set. Skipping spot search.";
         return {};
     }
 
-    // Decode polyline
-    auto path = utils::PolylineDecoder::decode(polylineGeometry);
-    if (path.empty()) return {};
-
-    std::vector<Spot> allSpots;
-    std::set<std::string> seenNames;
+    utils::TraceSpan span("places_search");
+    auto search = std::make_shared<PlacesSearch>();
+    if (auto* trace = utils::Trace::current()) {
+        search->trace = trace->weak_from_this();
+        search->traceParent = utils::Trace::currentSpan();
+    }
 
     // Sample points along the route (e.g., every 25% or max 5 points)
+    std::vector<Coordinate> samplePoints;
     size_t step = std::max(static_cast<size_t>(1), path.size() / 4);
-    std::vector<Coordinate> searchPoints;
     for (size_t i = 0; i < path.size(); i += step) {
-        searchPoints.push_back(path[i]);
+        samplePoints.push_back(path[i]);
     }
     // Ensure end point is included
-    if (searchPoints.back().lat != path.back().lat || searchPoints.back().lon != path.back().lon) {
-        searchPoints.push_back(path.back());
+    if (samplePoints.back().lat != path.back().lat || samplePoints.back().lon != path.back().lon) {
+        samplePoints.push_back(path.back());
     }
 
     double radius = configService_.getSpotSearchRadius();
     if (radius <= 0) radius = 1000.0;
 
+    // サンプル地点を Geohash セルの中心に寄せ、近くのリクエスト同士でキャッシュを共有する。
+    // セルは長辺が半径以下の大きさとし、中心からの検索半径をセルの半対角線分だけ広げて
+    // 元の地点の検索範囲を必ず含むようにする
+    int precision = utils::Geohash::precisionForMaxCellSize(radius);
+    std::set<std::string> seenCells;
+    for (const auto& point : samplePoints) {
+        std::string hash = utils::Geohash::encode(point, precision);
+        if (!seenCells.insert(hash).second) continue;
+        auto cell = utils::Geohash::decode(hash);
+        search->points.push_back(cell.center());
+        double halfDiagonal = SpotIndex::distanceMeters(cell.center(), {cell.minLat, cell.minLon});
+        // キーには実際に Places に送る半径を使う (キーの丸めと一致するよう整数に切り上げる)
+        double queryRadius = std::ceil(radius + halfDiagonal);
+        search->radii.push_back(queryRadius);
+        search->cacheKeys.push_back(PlacesCache::makeKey(hash, queryRadius, kPlacesTypeFilter));
+    }
+
+    // 全サンプル地点・再試行を含めた全体の期限。超えた時点で得られている結果を返す
     int timeoutSec = configService_.getApiTimeoutSeconds();
     if (timeoutSec <= 0) timeoutSec = 5;
+    // (リクエストの期限の方が早ければそちらに合わせる)
+    search->deadline = utils::Deadline::clamp(std::chrono::steady_clock::now() +
+                                              std::chrono::seconds(timeoutSec));
 
-    int maxRetries = configService_.getApiRetryCount();
-    if (maxRetries < 0) maxRetries = 0;
+    search->maxRetries = std::max(configService_.getApiRetryCount(), 0);
+    search->client = placesClient_;
+    search->cache = placesCache_;
+    search->apiPath = configService_.getGoogleMapsNearbySearchPath();
+    search->apiKey = std::move(apiKey);
+    search->results.resize(search->points.size());
 
-    std::string baseUrl = configService_.getGoogleMapsApiBaseUrl();
-    std::string apiPath = configService_.getGoogleMapsNearbySearchPath();
-
-    // Reuse HttpClient
-    auto client = drogon::HttpClient::newHttpClient(baseUrl);
+    // キャッシュにないセルだけ、リクエストを同時に発行する
+    // (L2 はルート上の全セルをまとめて 1 往復で引く)
+    std::vector<size_t> misses;
+    auto cachedCells = placesCache_->getMany(search->cacheKeys);
+    for (size_t i = 0; i < search->points.size(); ++i) {
+        if (cachedCells[i]) {
+            search->results[i] = std::move(*cachedCells[i]);
+        } else {
+            misses.push_back(i);
+        }
+    }
+    search->remaining = misses.size();
+    LOG_INFO << "Searching spots around " << search->points.size() << " cells ("
+             << search->points.size() - misses.size() << " cached)";
+    for (size_t i : misses) {
+        sendPlacesRequest(search, i, 0);
+    }
 
-    for (const auto& point : searchPoints) {
-        LOG_INFO << "Searching spots around: " << point.lat << ", " << point.lon;
+    std::vector<std::vector<Spot>> results;
+    {
+        std::unique_lock<std::mutex> lock(search->mutex);
+        if (!search->cv.wait_until(lock, search->deadline,
+                                   [&search] { return search->remaining == 0; })) {
+            LOG_WARN << "Spot search deadline exceeded; returning partial results ("
+                     << search->remaining << " of " << misses.size() << " pending)";
+        }
+        results = search->results;
+    }
 
-        for (int attempt = 0; attempt <= maxRetries; ++attempt) {
-            if (attempt > 0) {
-                LOG_INFO << "Retrying spot search (attempt " << attempt << "/" << maxRetries
-                         << ")...";
-                std::this_thread::sleep_for(std::chrono::milliseconds(500 * attempt));
+    // ルート順に結合し、名前で重複を除く。セル単位で広めに取得しているので、
+    // 元のサンプル地点から半径内のものに絞る
+    std::vector<Spot> allSpots;
+    std::set<std::string> seenNames;
+    for (auto& cellSpots : results) {
+        for (auto& spot : cellSpots) {
+            bool nearSample = std::any_of(
+                samplePoints.begin(), samplePoints.end(), [&](const Coordinate& point) {
+                    return SpotIndex::distanceMeters(point, {spot.lat, spot.lon}) <= radius;
+                });
+            if (nearSample && seenNames.insert(spot.name).second) {
+                allSpots.push_back(std::move(spot));
             }
+        }
+    }
+    return allSpots;
+}
 
-            // Use shared_ptr for promise to avoid use-after-free on timeout
-            auto promise = std::make_shared<std::promise<std::pair<bool, std::vector<Spot>>>>();
-            auto future = promise->get_future();
-
-            auto req = drogon::HttpRequest::newHttpRequest();
-            req->setMethod(drogon::Get);
-            req->setPath(apiPath);
-            req->setParameter("location",
-                              std::to_string(point.lat) + "," + std::to_string(point.lon));
-            req->setParameter("radius", std::to_string(radius));
-            req->setParameter("type", "restaurant|cafe|convenience_store|point_of_interest");
-            req->setParameter("key", apiKey);
-            req->setParameter("language", "ja");
-
-            // Capture client to keep it alive if needed, though here we wait for it.
-            // Capture promise by value (shared_ptr copy)
-            client->sendRequest(req, [promise](drogon::ReqResult result,
-                                               const drogon::HttpResponsePtr& response) {
-                std::vector<Spot> spots;
-                bool success = false;
-
-                if (result == drogon::ReqResult::Ok && response->getStatusCode() == 200) {
-                    auto jsonPtr = response->getJsonObject();
-                    if (jsonPtr && jsonPtr->isMember("results") &&
-                        (*jsonPtr)["results"].isArray()) {
-                        success = true;
-                        const auto& results = (*jsonPtr)["results"];
-                        for (const auto& item : results) {
-                            Spot spot;
-                            spot.name = item.get("name", "").asString();
-                            if (item.isMember("geometry") &&
-                                item["geometry"].isMember("location")) {
-                                spot.lat = item["geometry"]["location"].get("lat", 0.0).asDouble();
-                                spot.lon = item["geometry"]["location"].get("lng", 0.0).asDouble();
-                            }
-                            spot.rating = item.get("rating", 0.0).asDouble();
-
-                            if (item.isMember("types") && item["types"].isArray() &&
-                                !item["types"].empty()) {
-                                spot.type = item["types"][0].asString();
-                            } else {
-                                spot.type = "unknown";
-                            }
-
-                            spots.push_back(spot);
-                        }
-                    } else if (jsonPtr && jsonPtr->isMember("status") &&
-                               (*jsonPtr)["status"].asString() == "ZERO_RESULTS") {
-                        // Success but no results
-                        success = true;
-                    } else {
-                        LOG_ERROR << "Invalid response or API error.";
-                        if (jsonPtr) LOG_DEBUG << "JSON: " << jsonPtr->toStyledString();
-                    }
-                } else {
-                    LOG_ERROR << "Request failed. Result: " << (int)result
-                              << ", Status: " << (response ? response->getStatusCode() : 0);
-                }
-                promise->set_value({success, spots});
-            });
-
-            if (future.wait_for(std::chrono::seconds(timeoutSec)) == std::future_status::ready) {
-                auto result = future.get();
-                if (result.first) {
-                    for (const auto& spot : result.second) {
-                        if (seenNames.find(spot.name) == seenNames.end()) {
-                            allSpots.push_back(spot);
-                            seenNames.insert(spot.name);
-                        }
-                    }
-                    break;  // Success, exit retry loop
-                }
-            } else {
-                LOG_WARN << "Spot search timed out for point.";
-            }
+SpotService::PlacesStatus SpotService::parsePlacesResponse(const Json::Value& json,
+                                                           std::vector<Spot>& spots) {
+    std::string status = json.get("status", "").asString();
+    if (status == "ZERO_RESULTS") {
+        // Success but no results
+        return PlacesStatus::Ok;
+    }
+    if (status == "OVER_QUERY_LIMIT" || status == "UNKNOWN_ERROR") {
+        return PlacesStatus::Retryable;
+    }
+    if (!json.isMember("results") || !json["results"].isArray()) {
+        LOG_ERROR << "Invalid response or API error.";
+        LOG_DEBUG << "JSON: " << json.toStyledString();
+        return PlacesStatus::Failed;
+    }
+
+    for (const auto& item : json["results"]) {
+        Spot spot;
+        spot.name = item.get("name", "").asString();
+        spot.lat = 0.0;
+        spot.lon = 0.0;
+        if (item.isMember("geometry") && item["geometry"].isMember("location")) {
+            spot.lat = item["geometry"]["location"].get("lat", 0.0).asDouble();
+            spot.lon = item["geometry"]["location"].get("lng", 0.0).asDouble();
         }
+        spot.rating = item.get("rating", 0.0).asDouble();
+
+        if (item.isMember("types") && item["types"].isArray() && !item["types"].empty()) {
+            spot.type = item["types"][0].asString();
+        } else {
+            spot.type = "unknown";
+        }
+
+        spots.push_back(spot);
     }
+    return PlacesStatus::Ok;
+}
 
-    LOG_INFO << "Found total " << allSpots.size() << " unique spots.";
-    return allSpots;
+std::chrono::milliseconds SpotService::retryDelay(int attempt, double jitter) {
+    // 500ms, 1s, 2s, ... に 50%〜150% のジッターをかける (再試行が同時に集中しないように)
+    double base = kRetryBaseDelayMs * static_cast<double>(int64_t{1} << std::min(attempt - 1, 10));
+    double factor = 0.5 + std::clamp(jitter, 0.0, 1.0);
+    return std::chrono::milliseconds(static_cast<int64_t>(base * factor));
 }
 
 }  // namespace services
@@ -1,32 +1,67 @@
 #pragma once
 
+#include <drogon/HttpClient.h>
+#include <json/json.h>
+
+#include <chrono>
+#include <memory>
+#include <span>
 #include <string>
 #include <vector>
 
 #include "ConfigService.h"
 #include "Coordinate.h"
+#include "PlacesCache.h"
+#include "Spot.h"
+#include "SpotIndex.h"
 
 namespace services {
 
-struct Spot {
-    std::string name;
-    std::string type;
-    double lat;
-    double lon;
-    double rating;
-};
-
 class SpotService {
    public:
+    // 設定された spots CSV からローカルインデックスを構築する
     explicit SpotService(const ConfigService& configService);
+    SpotService(const ConfigService& configService, std::shared_ptr<const SpotIndex> spotIndex);
     virtual ~SpotService() = default;
 
-    // ルートの中間地点周辺のスポットをGoogle Places APIで検索（簡易実装のため同期ブロック）
+    // ルート沿い (bufferMeters 以内) のスポットを検索する
+    // ローカルインデックスを優先し、Google Places API は補完
+    // (設定で有効時、またはインデックスが空の場合) に使う
+    // polylineGeometry は precision (1e5 / 1e6) でエンコードされたポリライン
+    // (RouteResult::geometry なら RouteService::kGeometryPrecision)
     virtual std::vector<Spot> searchSpotsAlongRoute(const std::string& polylineGeometry,
+                                                    double bufferMeters, double precision);
+    // デコード済みの座標列 (OSRM の full overview) から検索する
+    virtual std::vector<Spot> searchSpotsAlongRoute(std::span<const Coordinate> path,
                                                     double bufferMeters);
 
+    // Places 検索結果のキャッシュ (Redis 層の接続やヒット率の参照用)
+    std::shared_ptr<PlacesCache> placesCache() const { return placesCache_; }
+
+    // Places API 応答の判定結果
+    enum class PlacesStatus {
+        Ok,         // 結果あり、または ZERO_RESULTS
+        Retryable,  // OVER_QUERY_LIMIT など、時間をおけば成功しうる
+        Failed      // REQUEST_DENIED など、再試行しても無駄なもの
+    };
+    static PlacesStatus parsePlacesResponse(const Json::Value& json, std::vector<Spot>& spots);
+
+    // attempt 回目 (1 始まり) の再試行までの待ち時間。jitter は [0, 1]
+    static std::chrono::milliseconds retryDelay(int attempt, double jitter);
+
    private:
+    static constexpr double kRetryBaseDelayMs = 500.0;
+
+    std::vector<Spot> searchLocalIndex(std::span<const Coordinate> path,
+                                       double bufferMeters) const;
+    // ルート上のサンプル地点周辺のスポットを Google Places API で検索する
+    // 全地点のリクエストを並行に発行し、API_TIMEOUT_SECONDS の期限で打ち切って途中結果を返す
+    std::vector<Spot> searchPlacesAlongRoute(std::span<const Coordinate> path);
+
     const ConfigService& configService_;
+    std::shared_ptr<const SpotIndex> spotIndex_;
+    drogon::HttpClientPtr placesClient_;  // API キー設定時のみ
+    std::shared_ptr<PlacesCache> placesCache_;
 };
 
 }  // namespace services
@@ -2,17 +2,40 @@
 
 #include <drogon/drogon.h>
 
+#include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
+#include <cstdio>
+#include <fstream>
 #include <future>
 #include <numbers>
 #include <sstream>
+#include <thread>
 
+#include "../../utils/Deadline.h"
+#include "../../utils/Trace.h"
 #include "GSIElevationProvider.h"  // Include for dynamic_pointer_cast
 #include "SmartRefreshService.h"
 
 namespace services::elevation {
 
+namespace {
+
+// Snapshot layout: header, then per tile int32 z/x/y followed by 256*256 doubles
+constexpr char kSnapshotMagic[4] = {'P', 'M', 'L', '1'};
+constexpr uint32_t kSnapshotVersion = 1;
+constexpr uint32_t kTileValues = 256 * 256;
+
+struct SnapshotHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t tileValues;
+    uint32_t count;
+};
+
+}  // namespace
+
 ElevationCacheManager::ElevationCacheManager(std::shared_ptr<IElevationCacheRepository> repository,
                                              std::shared_ptr<IElevationProvider> backendProvider,
                                              std::shared_ptr<SmartRefreshService> refreshService,
@@ -23,7 +46,7 @@ ElevationCacheManager::ElevationCacheManager(std::shared_ptr<IElevationCacheRepo
       l1Cache_(lruCapacity) {}
 
 void ElevationCacheManager::getElevation(const Coordinate& coord, ElevationCallback&& callback) {
-    auto tc = calculateTileCoord(coord);
+    auto tc = GSIElevationProvider::calculateTileCoord(coord);
     auto tileData = getTile(tc.z, tc.x, tc.y);
 
     if (tileData && !tileData->empty()) {
@@ -42,28 +65,18 @@ void ElevationCacheManager::getElevations(const std::vector<Coordinate>& coords,
         return;
     }
 
-    auto results = std::make_shared<std::vector<double>>(coords.size(), 0.0);
-    // Note: This is synchronous/blocking in getTile, but we are inside drogon loop usually.
-    // Ideally getTile should be async. But for now we proceed with synchronous cache/async fetch
-    // approach wrapped in synchronous looking method for getTile, but wait...
-
-    // If getTile fetches from API using GSI provider async fetch, we need to wait.
-    // But getTile implementation below blocks?
-    // We need to implement getTile carefully.
-
-    for (size_t i = 0; i < coords.size(); ++i) {
-        auto tc = calculateTileCoord(coords[i]);
-        auto tileData = getTile(tc.z, tc.x, tc.y);
-        if (tileData && !tileData->empty()) {
-            (*results)[i] = (*tileData)[tc.pixel_y * 256 + tc.pixel_x];
+    std::vector<double> results(coords.size(), 0.0);
+    auto elevations = getElevationsSync(coords);
+    for (size_t i = 0; i < elevations.size(); ++i) {
+        if (elevations[i]) {
+            results[i] = *elevations[i];
         }
     }
-
-    callback(*results);
+    callback(results);
 }
 
 std::optional<double> ElevationCacheManager::getElevationSync(const Coordinate& coord) {
-    auto tc = calculateTileCoord(coord);
+    auto tc = GSIElevationProvider::calculateTileCoord(coord);
     auto tileData = getTile(tc.z, tc.x, tc.y);
 
     if (tileData && !tileData->empty()) {
@@ -72,29 +85,80 @@ std::optional<double> ElevationCacheManager::getElevationSync(const Coordinate&
     return std::nullopt;
 }
 
+std::vector<std::optional<double>> ElevationCacheManager::getElevationsSync(
+    std::span<const Coordinate> coords) {
+    // タイル座標はスレッドごとの作業領域に求める (呼び出しのたびに確保しない)
+    thread_local std::vector<GSIElevationProvider::TileCoord> tileCoords;
+    tileCoords.resize(coords.size());
+    GSIElevationProvider::calculateTileCoords(coords, tileCoords);
+    return lookupElevations(tileCoords);
+}
+
+std::vector<std::optional<double>> ElevationCacheManager::getElevationsSyncE7(
+    std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) {
+    // CompactPath のレーンから直接タイル座標を求める (Coordinate の配列を作らない)
+    thread_local std::vector<GSIElevationProvider::TileCoord> tileCoords;
+    tileCoords.resize(std::min(latsE7.size(), lonsE7.size()));
+    GSIElevationProvider::calculateTileCoords(latsE7, lonsE7, tileCoords);
+    return lookupElevations(tileCoords);
+}
+
+std::vector<std::optional<double>> ElevationCacheManager::lookupElevations(
+    std::span<const GSIElevationProvider::TileCoord> tileCoords) {
+    std::vector<std::optional<double>> results(tileCoords.size());
+
+    // 経路上の連続する地点は同じタイルに入ることが多いので、タイルが変わったときだけ引く
+    // (アクセス記録もタイルの連続区間ごとに 1 回になる)
+    std::shared_ptr<std::vector<double>> tileData;
+    for (size_t i = 0; i < tileCoords.size(); ++i) {
+        const auto& tc = tileCoords[i];
+        if (i == 0 || !GSIElevationProvider::sameTile(tc, tileCoords[i - 1])) {
+            tileData = getTile(tc.z, tc.x, tc.y);
+        }
+        if (tileData && !tileData->empty()) {
+            results[i] = (*tileData)[tc.pixel_y * 256 + tc.pixel_x];
+        }
+    }
+    return results;
+}
+
 std::shared_ptr<std::vector<double>> ElevationCacheManager::getTile(int z, int x, int y) {
     std::string key = makeKey(z, x, y);
+    utils::TraceSpan span("tile");
 
     // 1. L1 Cache (Memory)
     auto l1Result = l1Cache_.get(key);
     if (l1Result.has_value()) {
+        span.setDetail("l1");
+        l1Hits_.fetch_add(1, std::memory_order_relaxed);
         if (refreshService_) refreshService_->recordAccess(z, x, y);
         return *l1Result;
     }
+    l1Misses_.fetch_add(1, std::memory_order_relaxed);
 
     // 2. L2 Cache (Redis)
-    auto l2Result = repository_->getTile(z, x, y);
+    std::optional<ElevationCacheEntry> l2Result;
+    {
+        ::cycling::utils::ScopedTimer timer(l2Latency_);
+        l2Result = repository_->getTile(z, x, y);
+    }
     if (l2Result.has_value()) {
         auto elevations = parseContent(l2Result->content);
         if (elevations) {
+            span.setDetail("l2");
+            l2Hits_.fetch_add(1, std::memory_order_relaxed);
             l1Cache_.put(key, elevations);
-            if (refreshService_) {
-                refreshService_->recordAccess(z, x, y);
-                refreshService_->checkAndQueueRefresh(z, x, y, l2Result->updated_at);
-            }
+            if (refreshService_) refreshService_->recordAccess(z, x, y);
             return elevations;
         }
     }
+    l2Misses_.fetch_add(1, std::memory_order_relaxed);
+
+    // 期限切れ・取り消し後は GSI に取りに行かない (標高なしとして扱う)
+    if (utils::Deadline::currentExpired()) {
+        span.setDetail("skipped (deadline)");
+        return nullptr;
+    }
 
     // 3. API Fetch with Cache Stampede Protection
     std::shared_future<std::shared_ptr<std::vector<double>>> future;
@@ -102,6 +166,8 @@ std::shared_ptr<std::vector<double>> ElevationCacheManager::getTile(int z, int x
         std::lock_guard<std::mutex> lock(inFlightMutex_);
         auto it = inFlightRequests_.find(key);
         if (it != inFlightRequests_.end()) {
+            span.setDetail("gsi (coalesced)");
+            coalescedWaits_.fetch_add(1, std::memory_order_relaxed);
             future = it->second;
         } else {
             // Start new request using a shared pointer to promise to satisfy copyability
@@ -115,10 +181,18 @@ std::shared_ptr<std::vector<double>> ElevationCacheManager::getTile(int z, int x
                 LOG_ERROR << "Backend provider is not GSIElevationProvider";
                 promise->set_value(nullptr);
             } else {
+                span.setDetail("gsi");
+                gsiFetches_.fetch_add(1, std::memory_order_relaxed);
+                auto fetchStart = std::chrono::steady_clock::now();
                 gsiProvider->fetchTile(
                     z, x, y,
-                    [this, z, x, y, key,
-                     promise](std::shared_ptr<GSIElevationProvider::TileData> data) {
+                    [this, z, x, y, key, promise,
+                     fetchStart](std::shared_ptr<GSIElevationProvider::TileData> data) {
+                        gsiLatency_.observe(std::chrono::duration<double>(
+                                                std::chrono::steady_clock::now() - fetchStart)
+                                                .count());
+                        if (!data) gsiFailures_.fetch_add(1, std::memory_order_relaxed);
+
                         std::shared_ptr<std::vector<double>> elevations = nullptr;
                         if (data) {
                             elevations = std::make_shared<std::vector<double>>(data->elevations);
@@ -133,7 +207,7 @@ std::shared_ptr<std::vector<double>> ElevationCacheManager::getTile(int z, int x
                                 else
                                     ss << ",";
                             }
-                            repository_->saveTile(z, x, y, ss.str());
+                            repository_->saveTile(z, x, y, ss.str(), data->source);
                         }
                         promise->set_value(elevations);
 
@@ -148,13 +222,187 @@ std::shared_ptr<std::vector<double>> ElevationCacheManager::getTile(int z, int x
     }
 
     // Wait for the shared future
-    if (future.wait_for(std::chrono::seconds(10)) == std::future_status::ready) {
+    // (リクエストの期限があればそこまでしか待たない。取得自体は続き、キャッシュされる)
+    auto waitUntil =
+        utils::Deadline::clamp(std::chrono::steady_clock::now() + std::chrono::seconds(10));
+    if (future.wait_until(waitUntil) == std::future_status::ready) {
         return future.get();
     }
 
     return nullptr;
 }
 
+ElevationCacheStats ElevationCacheManager::getStats() const {
+    ElevationCacheStats stats;
+    stats.l1Hits = l1Hits_.load(std::memory_order_relaxed);
+    stats.l1Misses = l1Misses_.load(std::memory_order_relaxed);
+    stats.l2Hits = l2Hits_.load(std::memory_order_relaxed);
+    stats.l2Misses = l2Misses_.load(std::memory_order_relaxed);
+    stats.gsiFetches = gsiFetches_.load(std::memory_order_relaxed);
+    stats.gsiFailures = gsiFailures_.load(std::memory_order_relaxed);
+    stats.coalescedWaits = coalescedWaits_.load(std::memory_order_relaxed);
+    stats.l1Size = l1Cache_.size();
+    stats.l1Capacity = l1Cache_.capacity();
+    return stats;
+}
+
+WarmUpStats ElevationCacheManager::warmUp(const std::string& snapshotPath, size_t topN,
+                                          size_t parallelism, std::chrono::milliseconds budget) {
+    auto start = std::chrono::steady_clock::now();
+    auto deadline = start + budget;
+    WarmUpStats stats;
+
+    if (!snapshotPath.empty()) {
+        stats.fromSnapshot = loadSnapshot(snapshotPath, deadline);
+    }
+    stats.fromRanking = warmFromRanking(topN, parallelism, deadline);
+
+    auto end = std::chrono::steady_clock::now();
+    stats.budgetExhausted = end >= deadline;
+    stats.elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    LOG_INFO << "L1 warm-up: " << stats.fromSnapshot << " tiles from snapshot, "
+             << stats.fromRanking << " tiles from ranking in " << stats.elapsed.count() << "ms"
+             << (stats.budgetExhausted ? " (budget exhausted)" : "");
+    return stats;
+}
+
+size_t ElevationCacheManager::saveSnapshot(const std::string& path) {
+    auto entries = l1Cache_.snapshot();
+
+    // Write to a temporary file first so a crash never leaves a truncated snapshot behind
+    std::string tmpPath = path + ".tmp";
+    std::ofstream out(tmpPath, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LOG_ERROR << "Failed to open L1 snapshot for writing: " << tmpPath;
+        return 0;
+    }
+
+    SnapshotHeader header{};
+    std::copy(std::begin(kSnapshotMagic), std::end(kSnapshotMagic), header.magic);
+    header.version = kSnapshotVersion;
+    header.tileValues = kTileValues;
+    header.count = 0;
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    uint32_t written = 0;
+    for (const auto& [key, elevations] : entries) {
+        int32_t zxy[3];
+        if (!elevations || elevations->size() != kTileValues ||
+            sscanf(key.c_str(), "%d:%d:%d", &zxy[0], &zxy[1], &zxy[2]) != 3) {
+            continue;
+        }
+        out.write(reinterpret_cast<const char*>(zxy), sizeof(zxy));
+        out.write(reinterpret_cast<const char*>(elevations->data()),
+                  static_cast<std::streamsize>(kTileValues * sizeof(double)));
+        written++;
+    }
+
+    header.count = written;
+    out.seekp(0);
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.close();
+
+    if (!out || std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        LOG_ERROR << "Failed to write L1 snapshot: " << path;
+        std::remove(tmpPath.c_str());
+        return 0;
+    }
+
+    LOG_INFO << "Saved L1 snapshot with " << written << " tiles to " << path;
+    return written;
+}
+
+size_t ElevationCacheManager::loadSnapshot(const std::string& path,
+                                           std::chrono::steady_clock::time_point deadline) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) {
+        LOG_DEBUG << "No L1 snapshot at " << path;
+        return 0;
+    }
+
+    SnapshotHeader header{};
+    in.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!in || !std::equal(std::begin(kSnapshotMagic), std::end(kSnapshotMagic), header.magic) ||
+        header.version != kSnapshotVersion || header.tileValues != kTileValues) {
+        LOG_WARN << "Ignoring incompatible L1 snapshot: " << path;
+        return 0;
+    }
+
+    // Entries are stored most recently used first; keep only what fits and insert the coldest
+    // first so that the hottest tile ends up at the front of the LRU list.
+    size_t count = std::min<size_t>(header.count, l1Cache_.capacity());
+    std::vector<std::pair<std::string, std::shared_ptr<std::vector<double>>>> loaded;
+    loaded.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (std::chrono::steady_clock::now() >= deadline) break;
+
+        int32_t zxy[3];
+        auto elevations = std::make_shared<std::vector<double>>(kTileValues);
+        in.read(reinterpret_cast<char*>(zxy), sizeof(zxy));
+        in.read(reinterpret_cast<char*>(elevations->data()),
+                static_cast<std::streamsize>(kTileValues * sizeof(double)));
+        if (!in) {
+            LOG_WARN << "L1 snapshot truncated after " << i << " tiles: " << path;
+            break;
+        }
+        loaded.emplace_back(makeKey(zxy[0], zxy[1], zxy[2]), std::move(elevations));
+    }
+
+    for (auto it = loaded.rbegin(); it != loaded.rend(); ++it) {
+        l1Cache_.put(it->first, it->second);
+    }
+    return loaded.size();
+}
+
+size_t ElevationCacheManager::warmFromRanking(size_t topN, size_t parallelism,
+                                              std::chrono::steady_clock::time_point deadline) {
+    topN = std::min(topN, l1Cache_.capacity());
+    if (topN == 0 || std::chrono::steady_clock::now() >= deadline) return 0;
+
+    // Only fill up to topN: loading more would evict tiles restored from the snapshot.
+    // contains() does not promote, so the snapshot's LRU order is kept as well.
+    size_t cached = l1Cache_.size();
+    if (cached >= topN) return 0;
+    size_t budget = topN - cached;
+
+    std::vector<std::string> pending;
+    for (auto& key : repository_->getTopRankedTiles(topN, 0.0)) {
+        if (pending.size() == budget) break;
+        if (!l1Cache_.contains(key)) pending.push_back(std::move(key));
+    }
+    if (pending.empty()) return 0;
+
+    // Each worker claims the next-hottest tile, so an exhausted budget drops the coldest ones
+    std::atomic<size_t> next{0};
+    std::atomic<size_t> loaded{0};
+    auto worker = [&]() {
+        for (size_t i = next++; i < pending.size(); i = next++) {
+            if (std::chrono::steady_clock::now() >= deadline) return;
+
+            int z, x, y;
+            if (sscanf(pending[i].c_str(), "%d:%d:%d", &z, &x, &y) != 3) continue;
+            auto l2Result = repository_->getTile(z, x, y);
+            if (!l2Result) continue;
+            auto elevations = parseContent(l2Result->content);
+            if (!elevations) continue;
+            l1Cache_.put(pending[i], elevations);
+            loaded++;
+        }
+    };
+
+    size_t threadCount = std::clamp<size_t>(parallelism, 1, pending.size());
+    std::vector<std::thread> threads;
+    threads.reserve(threadCount);
+    for (size_t t = 0; t < threadCount; ++t) {
+        threads.emplace_back(worker);
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    return loaded;
+}
+
 std::shared_ptr<std::vector<double>> ElevationCacheManager::parseContent(
     const std::string& content) {
     auto elevations = std::make_shared<std::vector<double>>();
@@ -190,21 +438,4 @@ std::string ElevationCacheManager::makeKey(int z, int x, int y) const {
     return std::to_string(z) + ":" + std::to_string(x) + ":" + std::to_string(y);
 }
 
-ElevationCacheManager::TileCoord ElevationCacheManager::calculateTileCoord(const Coordinate& coord,
-                                                                           int zoom) {
-    // Re-use logic from GSIElevationProvider or implement here.
-    // Since we made it static in GSIElevationProvider header (but need to link),
-    // we can call GSIElevationProvider::calculateTileCoord if we include the header.
-    // But TileCoord struct needs to be compatible.
-
-    auto tc = GSIElevationProvider::calculateTileCoord(coord, zoom);
-    TileCoord myTc;
-    myTc.z = tc.z;
-    myTc.x = tc.x;
-    myTc.y = tc.y;
-    myTc.pixel_x = tc.pixel_x;
-    myTc.pixel_y = tc.pixel_y;
-    return myTc;
-}
-
 }  // namespace services::elevation
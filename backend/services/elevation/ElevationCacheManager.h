@@ -1,14 +1,20 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstdint>
 #include <future>
 #include <memory>
 #include <mutex>
 #include <optional>
+#include <span>
 #include <string>
 #include <unordered_map>
 #include <vector>
 
+#include "../../utils/Histogram.h"
 #include "../../utils/LruCache.h"
+#include "GSIElevationProvider.h"
 #include "IElevationCacheRepository.h"
 #include "IElevationProvider.h"
 
@@ -16,6 +22,31 @@ namespace services::elevation {
 
 class SmartRefreshService;
 
+/**
+ * @brief Result of a startup L1 warm-up
+ */
+struct WarmUpStats {
+    size_t fromSnapshot = 0;  // Tiles restored from the on-disk snapshot
+    size_t fromRanking = 0;   // Hot tiles loaded from L2 by access ranking
+    bool budgetExhausted = false;
+    std::chrono::milliseconds elapsed{0};
+};
+
+/**
+ * @brief Tile lookup counters per cache level
+ */
+struct ElevationCacheStats {
+    uint64_t l1Hits = 0;
+    uint64_t l1Misses = 0;
+    uint64_t l2Hits = 0;
+    uint64_t l2Misses = 0;
+    uint64_t gsiFetches = 0;      // Fetches started by this manager
+    uint64_t gsiFailures = 0;     // Fetches that returned no data
+    uint64_t coalescedWaits = 0;  // Misses that joined a fetch already in flight
+    size_t l1Size = 0;
+    size_t l1Capacity = 0;
+};
+
 /**
  * @brief Manages multi-level caching (L1: Memory, L2: Redis) and coordinates data fetching.
  */
@@ -32,13 +63,17 @@ class ElevationCacheManager : public IElevationProvider {
     void getElevations(const std::vector<Coordinate>& coords,
                        ElevationsCallback&& callback) override;
     std::optional<double> getElevationSync(const Coordinate& coord) override;
+    std::vector<std::optional<double>> getElevationsSync(
+        std::span<const Coordinate> coords) override;
+    std::vector<std::optional<double>> getElevationsSyncE7(
+        std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) override;
 
     /**
      * @brief Get elevation data for a specific tile.
      *
      * Flow:
      * 1. Check L1 (Memory)
-     * 2. Check L2 (Redis) -> If hit, populate L1 and trigger async refresh check
+     * 2. Check L2 (Redis) -> If hit, populate L1 and record the access
      * 3. Fetch from API -> Populate L1 & L2
      *
      * @param z Zoom level
@@ -48,6 +83,46 @@ class ElevationCacheManager : public IElevationProvider {
      */
     std::shared_ptr<std::vector<double>> getTile(int z, int x, int y);
 
+    /**
+     * @brief Pre-populate L1 before the server starts accepting requests.
+     *
+     * Restores the snapshot written at the previous shutdown (if `snapshotPath` is set), then
+     * loads the hottest tiles of the access ranking from L2 until L1 holds `topN` tiles.
+     * Never calls the GSI API. Stops when `budget` is spent.
+     */
+    WarmUpStats warmUp(const std::string& snapshotPath, size_t topN, size_t parallelism,
+                       std::chrono::milliseconds budget);
+
+    /**
+     * @brief Write L1 contents to disk (most recently used first)
+     *
+     * @return size_t number of tiles written
+     */
+    size_t saveSnapshot(const std::string& path);
+
+    /**
+     * @brief Load a snapshot written by saveSnapshot() into L1
+     *
+     * @return size_t number of tiles loaded
+     */
+    size_t loadSnapshot(const std::string& path, std::chrono::steady_clock::time_point deadline);
+
+    /**
+     * @brief Load top-ranked tiles from L2 into L1 using `parallelism` threads
+     *
+     * @return size_t number of tiles loaded
+     */
+    size_t warmFromRanking(size_t topN, size_t parallelism,
+                           std::chrono::steady_clock::time_point deadline);
+
+    size_t l1Size() const { return l1Cache_.size(); }
+
+    [[nodiscard]] ElevationCacheStats getStats() const;
+
+    // Latency (seconds) of L2 lookups and of GSI fetches, hits and misses alike
+    const ::cycling::utils::Histogram& l2Latency() const { return l2Latency_; }
+    const ::cycling::utils::Histogram& gsiLatency() const { return gsiLatency_; }
+
    private:
     std::shared_ptr<IElevationCacheRepository> repository_;
     std::shared_ptr<IElevationProvider> backendProvider_;
@@ -60,6 +135,10 @@ class ElevationCacheManager : public IElevationProvider {
     // Helper to parse CSV content
     std::shared_ptr<std::vector<double>> parseContent(const std::string& content);
 
+    // Look up the elevation at each tile coordinate (one getTile per run of the same tile)
+    std::vector<std::optional<double>> lookupElevations(
+        std::span<const GSIElevationProvider::TileCoord> tileCoords);
+
     // Helper to generate cache key
     std::string makeKey(int z, int x, int y) const;
 
@@ -68,15 +147,16 @@ class ElevationCacheManager : public IElevationProvider {
     std::unordered_map<std::string, std::shared_future<std::shared_ptr<std::vector<double>>>>
         inFlightRequests_;
 
-    // Helper to calculate tile coord (Shared logic)
-    struct TileCoord {
-        int z;
-        int x;
-        int y;
-        int pixel_x;
-        int pixel_y;
-    };
-    TileCoord calculateTileCoord(const Coordinate& coord, int zoom = 15);
+    // Stats (updated lock-free on the request path)
+    std::atomic<uint64_t> l1Hits_{0};
+    std::atomic<uint64_t> l1Misses_{0};
+    std::atomic<uint64_t> l2Hits_{0};
+    std::atomic<uint64_t> l2Misses_{0};
+    std::atomic<uint64_t> gsiFetches_{0};
+    std::atomic<uint64_t> gsiFailures_{0};
+    std::atomic<uint64_t> coalescedWaits_{0};
+    ::cycling::utils::Histogram l2Latency_{::cycling::utils::Histogram::latencyBuckets()};
+    ::cycling::utils::Histogram gsiLatency_{::cycling::utils::Histogram::latencyBuckets()};
 };
 
 }  // namespace services::elevation
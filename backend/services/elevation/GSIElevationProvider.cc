@@ -1,20 +1,133 @@
 #include "GSIElevationProvider.h"
 
+#include <algorithm>
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <future>
 #include <iostream>
+#include <mutex>
 #include <numbers>
 #include <sstream>
 
+#include "../../utils/Deadline.h"
+#include "../../utils/Trace.h"
+
 namespace services::elevation {
 
+namespace {
+
+struct TileSource {
+    const char* name;
+    double timeoutSeconds;
+};
+// 優先順 (高解像度から)。DEM5A は欠損が多いので、待ちすぎないようタイムアウトを短くする
+constexpr std::array<TileSource, 2> kSources = {{{"dem5a", 2.5}, {"dem", 5.0}}};
+// 上位ソースがこの時間内に応答しなければ、次のソースへの要求も並行して出す
+// (DEM5A のタイムアウトを待ってから DEM を引き始めると、末尾レイテンシが倍になる)
+constexpr double kHedgeDelaySeconds = 0.5;
+// 同期取得の最大待ち時間 (ヘッジ遅延 + 最も長いソースのタイムアウト + 余裕)
+constexpr auto kSyncWaitTimeout = std::chrono::milliseconds(6500);
+constexpr size_t kTileCacheTtlSeconds = 3600;
+// 存在しないタイルはほぼ変化しないが、新規整備に追従できるよう短めにする
+constexpr size_t kMissingTileTtlSeconds = 600;
+// 一時的な障害はすぐに回復しうるので、連続リクエストを抑える程度に留める
+constexpr size_t kFailedTileTtlSeconds = 30;
+
+// Web メルカトル: x = (lon + 180) / 360 * n, y = (1 - asinh(tan(lat)) / pi) / 2 * n
+// ルックアップテーブルを持たないズーム (kMaxTableZoom より上) で使う
+class MercatorProjection {
+   public:
+    explicit MercatorProjection(int zoom)
+        : zoom_(zoom),
+          xScale_(std::ldexp(1.0, zoom) / 360.0),
+          yScale_(std::ldexp(1.0, zoom) / 2.0) {}
+
+    GSIElevationProvider::TileCoord operator()(double lat, double lon) const {
+        constexpr double kRadiansPerDegree = std::numbers::pi / 180.0;
+        constexpr double kInvPi = 1.0 / std::numbers::pi;
+        double x = (lon + 180.0) * xScale_;
+        double y = (1.0 - std::asinh(std::tan(lat * kRadiansPerDegree)) * kInvPi) * yScale_;
+        int tileX = static_cast<int>(x);
+        int tileY = static_cast<int>(y);
+        // 範囲外チェック
+        return {zoom_, tileX, tileY, std::clamp(static_cast<int>((x - tileX) * 256), 0, 255),
+                std::clamp(static_cast<int>((y - tileY) * 256), 0, 255)};
+    }
+
+   private:
+    int zoom_;
+    double xScale_;
+    double yScale_;
+};
+
+// テーブルを作るズームの上限 (z18 で 262,145 要素 = 1 MB)。GSI の標高タイルは z15 まで
+constexpr int kMaxTableZoom = 18;
+// 経度 360 度 (1e-7 度単位)
+constexpr int64_t kLonSpanE7 = 3600000000;
+
+// タイル行 k (0..n) の上端の緯度 (1e-7 度、北から南へ単調減少)。ズームごとに初回だけ作る
+const std::vector<int32_t>& rowTopLatsE7(int zoom) {
+    static std::array<std::once_flag, kMaxTableZoom + 1> once;
+    static std::array<std::vector<int32_t>, kMaxTableZoom + 1> tables;
+    std::call_once(once[zoom], [zoom] {
+        size_t rows = size_t{1} << zoom;
+        auto& table = tables[zoom];
+        table.resize(rows + 1);
+        for (size_t k = 0; k <= rows; ++k) {
+            double mercatorY = std::numbers::pi * (1.0 - 2.0 * static_cast<double>(k) / rows);
+            table[k] = toFixedE7(std::atan(std::sinh(mercatorY)) * 180.0 / std::numbers::pi);
+        }
+    });
+    return tables[zoom];
+}
+
+// 緯度からタイル行と行内のピクセルを求める。tan/asinh は使わず、行は境界の表を二分探索し
+// (経路の隣り合う点はたいてい同じ行なので、直前の行を先に確かめる)、ピクセルは行の上端と
+// 下端の間で線形に補間する。z15 の行の高さは約 0.01 度で、補間の誤差は中緯度で 0.01 ピクセル未満
+class LatitudeRows {
+   public:
+    explicit LatitudeRows(const std::vector<int32_t>& tops)
+        : tops_(tops), lastRow_(static_cast<int>(tops.size()) - 2) {}
+
+    // 行 k は tops[k + 1] < lat <= tops[k] (範囲外の緯度は端の行に丸める)
+    std::pair<int, int> locate(int32_t latE7) {
+        if (!(tops_[row_ + 1] < latE7 && latE7 <= tops_[row_])) {
+            auto it = std::partition_point(tops_.begin(), tops_.end(),
+                                           [latE7](int32_t top) { return top >= latE7; });
+            row_ = std::clamp(static_cast<int>(it - tops_.begin()) - 1, 0, lastRow_);
+        }
+        int64_t top = tops_[row_];
+        int64_t height = top - tops_[row_ + 1];
+        int pixel = static_cast<int>((top - latE7) * 256 / height);
+        return {row_, std::clamp(pixel, 0, 255)};
+    }
+
+   private:
+    const std::vector<int32_t>& tops_;
+    int lastRow_;
+    int row_ = 0;
+};
+
+std::string tileKey(const GSIElevationProvider::TileCoord& tc) {
+    return std::to_string(tc.z) + "/" + std::to_string(tc.x) + "/" + std::to_string(tc.y);
+}
+
+}  // namespace
+
 GSIElevationProvider::GSIElevationProvider()
     : httpClient_(drogon::HttpClient::newHttpClient("https://cyberjapandata.gsi.go.jp")),
-      tileCache_(drogon::app().getLoop()) {}
+      tileCache_(drogon::app().getLoop()),
+      negativeCache_(drogon::app().getLoop()) {}
+
+void GSIElevationProvider::setCircuitBreakerOptions(
+    const ::cycling::utils::CircuitBreaker::Options& options) {
+    circuitBreaker_.configure(options);
+}
 
 void GSIElevationProvider::getElevation(const Coordinate& coord, ElevationCallback&& callback) {
     auto tileCoord = calculateTileCoord(coord);
-    std::string cacheKey = std::to_string(tileCoord.z) + "/" + std::to_string(tileCoord.x) + "/" +
-                           std::to_string(tileCoord.y);
+    std::string cacheKey = tileKey(tileCoord);
 
     std::shared_ptr<TileData> tileData;
     if (tileCache_.findAndFetch(cacheKey, tileData)) {
@@ -42,117 +155,350 @@ void GSIElevationProvider::getElevations(const std::vector<Coordinate>& coords,
         return;
     }
 
+    auto tileCoords = std::make_shared<const std::vector<TileCoord>>(calculateTileCoords(coords));
     auto results = std::make_shared<std::vector<double>>(coords.size(), 0.0);
-    auto remaining = std::make_shared<size_t>(coords.size());
 
-    for (size_t i = 0; i < coords.size(); ++i) {
-        getElevation(coords[i], [results, i, remaining, callback](std::optional<double> elev) {
-            if (elev) {
-                (*results)[i] = *elev;
+    // 連続して同じタイルに入る地点をまとめ、タイルごとに 1 回だけ引く
+    std::vector<std::pair<size_t, size_t>> runs;
+    for (size_t begin = 0; begin < tileCoords->size();) {
+        size_t end = begin + 1;
+        while (end < tileCoords->size() && sameTile((*tileCoords)[begin], (*tileCoords)[end])) {
+            end++;
+        }
+        runs.emplace_back(begin, end);
+        begin = end;
+    }
+
+    // キャッシュヒットは呼び出し元のスレッド、取得結果は HTTP クライアントのループで完了する
+    auto remaining = std::make_shared<std::atomic<size_t>>(runs.size());
+    auto done = std::make_shared<ElevationsCallback>(std::move(callback));
+    for (auto [begin, end] : runs) {
+        auto fill = [tileCoords, results, remaining, done, begin,
+                     end](std::shared_ptr<TileData> tileData) {
+            if (tileData) {
+                for (size_t i = begin; i < end; ++i) {
+                    const auto& tc = (*tileCoords)[i];
+                    (*results)[i] = tileData->elevations[tc.pixel_y * 256 + tc.pixel_x];
+                }
             }
-            (*remaining)--;
-            if (*remaining == 0) {
-                callback(*results);
+            if (remaining->fetch_sub(1) == 1) {
+                (*done)(*results);
             }
-        });
+        };
+
+        const auto& first = (*tileCoords)[begin];
+        std::shared_ptr<TileData> cached;
+        if (tileCache_.findAndFetch(tileKey(first), cached)) {
+            fill(std::move(cached));
+        } else {
+            fetchTile(first.z, first.x, first.y, std::move(fill));
+        }
     }
 }
 
 std::optional<double> GSIElevationProvider::getElevationSync(const Coordinate& coord) {
     auto tileCoord = calculateTileCoord(coord);
-    std::string cacheKey = std::to_string(tileCoord.z) + "/" + std::to_string(tileCoord.x) + "/" +
-                           std::to_string(tileCoord.y);
+    auto tileData = getTileSync(tileCoord);
+    if (!tileData) {
+        return std::nullopt;
+    }
+    return tileData->elevations[tileCoord.pixel_y * 256 + tileCoord.pixel_x];
+}
+
+std::vector<std::optional<double>> GSIElevationProvider::getElevationsSync(
+    std::span<const Coordinate> coords) {
+    // タイル座標はスレッドごとの作業領域に求める (呼び出しのたびに確保しない)
+    thread_local std::vector<TileCoord> tileCoords;
+    tileCoords.resize(coords.size());
+    calculateTileCoords(coords, tileCoords);
+    return lookupElevations(tileCoords);
+}
+
+std::vector<std::optional<double>> GSIElevationProvider::getElevationsSyncE7(
+    std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) {
+    thread_local std::vector<TileCoord> tileCoords;
+    tileCoords.resize(std::min(latsE7.size(), lonsE7.size()));
+    calculateTileCoords(latsE7, lonsE7, tileCoords);
+    return lookupElevations(tileCoords);
+}
+
+std::vector<std::optional<double>> GSIElevationProvider::lookupElevations(
+    std::span<const TileCoord> tileCoords) {
+    std::vector<std::optional<double>> results(tileCoords.size());
+
+    std::shared_ptr<TileData> tileData;
+    for (size_t i = 0; i < tileCoords.size(); ++i) {
+        const auto& tc = tileCoords[i];
+        if (i == 0 || !sameTile(tc, tileCoords[i - 1])) {
+            tileData = getTileSync(tc);
+        }
+        if (tileData) {
+            results[i] = tileData->elevations[tc.pixel_y * 256 + tc.pixel_x];
+        }
+    }
+    return results;
+}
+
+std::shared_ptr<GSIElevationProvider::TileData> GSIElevationProvider::getTileSync(
+    const TileCoord& tileCoord) {
+    std::string cacheKey = tileKey(tileCoord);
+    utils::TraceSpan span("tile");
 
     std::shared_ptr<TileData> tileData;
     if (tileCache_.findAndFetch(cacheKey, tileData)) {
-        return tileData->elevations[tileCoord.pixel_y * 256 + tileCoord.pixel_x];
+        span.setDetail("memory");
+        return tileData;
+    }
+    if (utils::Deadline::currentExpired()) {
+        span.setDetail("skipped (deadline)");
+        return nullptr;
     }
+    span.setDetail("gsi");
 
-    // 同期リクエスト
-    auto req = drogon::HttpRequest::newHttpRequest();
-    // タイルサーバーのURLを確認
-    // DEM5A (5mメッシュ) を優先的に試用
-    req->setPath("/xyz/dem5a/" + cacheKey + ".txt");
-    LOG_DEBUG << "Sync fetching tile (dem5a): " << cacheKey;
-    auto respResult = httpClient_->sendRequest(req, 5.0);
-
-    if (respResult.first != drogon::ReqResult::Ok || respResult.second->statusCode() != 200) {
-        // DEM5Aがなければ通常のDEMを試行
-        req->setPath("/xyz/dem/" + cacheKey + ".txt");
-        LOG_DEBUG << "Sync fetching tile (dem): " << cacheKey;
-        respResult = httpClient_->sendRequest(req, 5.0);
-    }
-
-    if (respResult.first == drogon::ReqResult::Ok && respResult.second->statusCode() == 200) {
-        LOG_DEBUG << "Sync fetch success, parsing tile: " << cacheKey;
-        auto tileData = parseTileText(std::string(respResult.second->body()));
-        if (tileData) {
-            tileCache_.insert(cacheKey, tileData, 3600);  // 1時間キャッシュ
-            return tileData->elevations[tileCoord.pixel_y * 256 + tileCoord.pixel_x];
-        } else {
-            LOG_DEBUG << "Sync parse failed for tile: " << cacheKey;
+    // 非同期パイプラインの結果を待つ (コールバックは HTTP クライアントのループで実行される)
+    auto promise = std::make_shared<std::promise<std::shared_ptr<TileData>>>();
+    auto future = promise->get_future();
+    fetchTile(tileCoord.z, tileCoord.x, tileCoord.y,
+              [promise](std::shared_ptr<TileData> data) { promise->set_value(std::move(data)); });
+
+    // リクエストの期限があればそこまでしか待たない (取得自体は続き、キャッシュされる)
+    auto waitUntil = utils::Deadline::clamp(std::chrono::steady_clock::now() + kSyncWaitTimeout);
+    if (future.wait_until(waitUntil) != std::future_status::ready) {
+        LOG_DEBUG << "Sync fetch timed out for tile: " << cacheKey;
+        return nullptr;
+    }
+    tileData = future.get();
+    if (!tileData) {
+        LOG_DEBUG << "Sync fetch failed for tile: " << cacheKey;
+    }
+    return tileData;
+}
+
+GSIElevationProvider::TileCoord GSIElevationProvider::calculateTileCoord(const Coordinate& coord,
+                                                                         int zoom) {
+    TileCoord tc;
+    calculateTileCoords(std::span<const Coordinate>(&coord, 1), std::span<TileCoord>(&tc, 1),
+                        zoom);
+    return tc;
+}
+
+void GSIElevationProvider::calculateTileCoords(std::span<const Coordinate> coords,
+                                               std::span<TileCoord> out, int zoom) {
+    // 固定小数点に直して整数版で求める (作業領域はスタック上の固定長で、確保しない)
+    constexpr size_t kChunk = 256;
+    std::array<int32_t, kChunk> lats;
+    std::array<int32_t, kChunk> lons;
+    size_t count = std::min(coords.size(), out.size());
+    for (size_t begin = 0; begin < count; begin += kChunk) {
+        size_t n = std::min(kChunk, count - begin);
+        for (size_t i = 0; i < n; ++i) {
+            lats[i] = toFixedE7(coords[begin + i].lat);
+            lons[i] = toFixedE7(coords[begin + i].lon);
         }
-    } else {
-        LOG_DEBUG << "Sync fetch failed for tile: " << cacheKey
-                  << " Result: " << (int)respResult.first
-                  << " Status: " << (respResult.second ? respResult.second->statusCode() : 0);
-        // エラー内容を確認するためにbodyの先頭を出力
-        if (respResult.second) {
-            LOG_DEBUG << "Response body head: " << respResult.second->body().substr(0, 100);
+        calculateTileCoords(std::span<const int32_t>(lats.data(), n),
+                            std::span<const int32_t>(lons.data(), n), out.subspan(begin, n),
+                            zoom);
+    }
+}
+
+void GSIElevationProvider::calculateTileCoords(std::span<const int32_t> latsE7,
+                                               std::span<const int32_t> lonsE7,
+                                               std::span<TileCoord> out, int zoom) {
+    size_t count = std::min({latsE7.size(), lonsE7.size(), out.size()});
+    if (zoom < 0 || zoom > kMaxTableZoom) {
+        MercatorProjection projection(zoom);
+        for (size_t i = 0; i < count; ++i) {
+            out[i] = projection(fromFixedE7(latsE7[i]), fromFixedE7(lonsE7[i]));
         }
+        return;
     }
 
-    return std::nullopt;
+    // 経度は線形なので整数演算だけで正確に求まる: x = (lon + 180) * n / 360
+    const int64_t n = int64_t{1} << zoom;
+    LatitudeRows rows(rowTopLatsE7(zoom));
+    for (size_t i = 0; i < count; ++i) {
+        int64_t x = (static_cast<int64_t>(lonsE7[i]) + kLonSpanE7 / 2) * n;
+        int tileX = static_cast<int>(x / kLonSpanE7);
+        int pixelX = static_cast<int>(x % kLonSpanE7 * 256 / kLonSpanE7);
+        auto [tileY, pixelY] = rows.locate(latsE7[i]);
+        out[i] = {zoom, tileX, tileY, std::clamp(pixelX, 0, 255), pixelY};
+    }
 }
 
-GSIElevationProvider::TileCoord GSIElevationProvider::calculateTileCoord(const Coordinate& coord,
-                                                                         int zoom) {
-    double lat_rad = coord.lat * std::numbers::pi / 180.0;
-    double n = std::pow(2, zoom);
-    double x = (coord.lon + 180.0) / 360.0 * n;
-    double y = (1.0 - std::asinh(std::tan(lat_rad)) / std::numbers::pi) / 2.0 * n;
+std::vector<GSIElevationProvider::TileCoord> GSIElevationProvider::calculateTileCoords(
+    std::span<const Coordinate> coords, int zoom) {
+    std::vector<TileCoord> tileCoords(coords.size());
+    calculateTileCoords(coords, tileCoords, zoom);
+    return tileCoords;
+}
 
-    TileCoord tc;
-    tc.z = zoom;
-    tc.x = static_cast<int>(x);
-    tc.y = static_cast<int>(y);
-    tc.pixel_x = static_cast<int>((x - tc.x) * 256);
-    tc.pixel_y = static_cast<int>((y - tc.y) * 256);
+struct GSIElevationProvider::PendingFetch {
+    std::string cacheKey;
+    bool bypassFailedCache = false;
+    TileCallback callback;
 
-    // 15/29105/12903.txt などは存在する
-    // Zoom 15 で OK
+    std::mutex mutex;
+    size_t nextSource = 0;              // 次に要求するソース
+    size_t inFlight = 0;                // 応答待ちの要求数
+    bool done = false;                  // callback を呼んだか
+    size_t servedBy = kSources.size();  // キャッシュに入れたタイルのソース
+};
+
+void GSIElevationProvider::fetchTile(int z, int x, int y, TileCallback&& callback,
+                                     bool bypassFailedCache) {
+    auto fetch = std::make_shared<PendingFetch>();
+    fetch->cacheKey = std::to_string(z) + "/" + std::to_string(x) + "/" + std::to_string(y);
+    fetch->bypassFailedCache = bypassFailedCache;
+    fetch->callback = std::move(callback);
+    startNextSource(fetch, 0);
+}
+
+void GSIElevationProvider::startNextSource(const std::shared_ptr<PendingFetch>& fetch,
+                                           size_t from) {
+    size_t sourceIndex = kSources.size();
+    bool giveUp = false;
+    {
+        std::lock_guard<std::mutex> lock(fetch->mutex);
+        if (fetch->done) return;
+        // ヘッジやフォールバックで既に出していれば重ねて出さない
+        if (fetch->nextSource <= from || fetch->inFlight == 0) {
+            // 存在しない・直近で失敗したソースは飛ばす
+            while (fetch->nextSource < kSources.size() &&
+                   isKnownUnavailable(kSources[fetch->nextSource].name, fetch->cacheKey,
+                                      fetch->bypassFailedCache)) {
+                fetch->nextSource++;
+            }
+            // ブレーカーが開いている場合は残りのソースも試さない
+            if (fetch->nextSource < kSources.size() && circuitBreaker_.allowRequest()) {
+                sourceIndex = fetch->nextSource++;
+                fetch->inFlight++;
+            } else {
+                fetch->nextSource = kSources.size();
+            }
+        }
+        if (sourceIndex == kSources.size() && fetch->inFlight == 0 &&
+            fetch->nextSource >= kSources.size()) {
+            fetch->done = true;
+            giveUp = true;
+        }
+    }
+    if (giveUp) {
+        fetch->callback(nullptr);
+        return;
+    }
+    if (sourceIndex == kSources.size()) return;  // 応答待ちの要求に任せる
 
-    // 範囲外チェック
-    tc.pixel_x = std::clamp(tc.pixel_x, 0, 255);
-    tc.pixel_y = std::clamp(tc.pixel_y, 0, 255);
+    const auto& source = kSources[sourceIndex];
+    std::string path = "/xyz/" + std::string(source.name) + "/" + fetch->cacheKey + ".txt";
+    LOG_DEBUG << "Fetching tile (" << source.name << "): " << fetch->cacheKey;
 
-    LOG_DEBUG << "Coord: (" << coord.lat << ", " << coord.lon << ") -> Tile: " << tc.z << "/"
-              << tc.x << "/" << tc.y << " Pixel: " << tc.pixel_x << "," << tc.pixel_y;
+    auto startedAt = std::chrono::steady_clock::now();
+    sendTileRequest(path, source.timeoutSeconds,
+                    [this, fetch, sourceIndex, startedAt](drogon::ReqResult result,
+                                                          const drogon::HttpResponsePtr& resp) {
+                        onSourceResponse(fetch, sourceIndex, result, resp, startedAt);
+                    });
 
-    return tc;
+    // 応答が遅ければ、タイムアウトを待たずに次のソースも引き始める
+    if (sourceIndex + 1 < kSources.size()) {
+        scheduleHedge(kHedgeDelaySeconds,
+                      [this, fetch, sourceIndex]() { startNextSource(fetch, sourceIndex + 1); });
+    }
 }
 
-void GSIElevationProvider::fetchTile(int z, int x, int y,
-                                     std::function<void(std::shared_ptr<TileData>)>&& callback) {
-    std::string cacheKey = std::to_string(z) + "/" + std::to_string(x) + "/" + std::to_string(y);
-    std::string path = "/xyz/dem/" + cacheKey + ".txt";
+void GSIElevationProvider::onSourceResponse(const std::shared_ptr<PendingFetch>& fetch,
+                                            size_t sourceIndex, drogon::ReqResult result,
+                                            const drogon::HttpResponsePtr& resp,
+                                            std::chrono::steady_clock::time_point startedAt) {
+    const auto& source = kSources[sourceIndex];
+    auto outcome = recordResponse(result, resp, startedAt);
+    std::shared_ptr<TileData> tileData;
+    if (outcome == FetchOutcome::Ok) {
+        tileData = parseTileText(std::string(resp->body()));
+        if (tileData) {
+            tileData->source = source.name;
+        } else {
+            LOG_DEBUG << "Parse failed for tile (" << source.name << "): " << fetch->cacheKey;
+            outcome = FetchOutcome::Failed;
+        }
+    }
+    if (!tileData) {
+        rememberUnavailable(source.name, fetch->cacheKey, outcome);
+    }
+
+    bool deliver = false;
+    {
+        std::lock_guard<std::mutex> lock(fetch->mutex);
+        fetch->inFlight--;
+        // 先に下位ソースのタイルを返していても、上位ソースのタイルはキャッシュを置き換える
+        if (tileData && sourceIndex < fetch->servedBy) {
+            fetch->servedBy = sourceIndex;
+            tileCache_.insert(fetch->cacheKey, tileData, kTileCacheTtlSeconds);
+            deliver = !fetch->done;
+            fetch->done = true;
+        }
+    }
+    if (deliver) {
+        fetch->callback(tileData);
+    } else if (!tileData) {
+        // 次の (低解像度の) ソースへフォールバック
+        startNextSource(fetch, sourceIndex + 1);
+    }
+}
 
+void GSIElevationProvider::sendTileRequest(const std::string& path, double timeoutSeconds,
+                                           drogon::HttpReqCallback&& callback) {
     auto req = drogon::HttpRequest::newHttpRequest();
     req->setPath(path);
+    httpClient_->sendRequest(req, std::move(callback), timeoutSeconds);
+}
 
-    httpClient_->sendRequest(
-        req, [this, cacheKey, callback = std::move(callback)](drogon::ReqResult result,
-                                                              const drogon::HttpResponsePtr& resp) {
-            if (result == drogon::ReqResult::Ok && resp->statusCode() == 200) {
-                auto tileData = parseTileText(std::string(resp->body()));
-                if (tileData) {
-                    tileCache_.insert(cacheKey, tileData, 3600);
-                    callback(tileData);
-                    return;
-                }
-            }
-            callback(nullptr);
-        });
+void GSIElevationProvider::scheduleHedge(double delaySeconds, std::function<void()> fn) {
+    drogon::app().getLoop()->runAfter(delaySeconds, std::move(fn));
+}
+
+GSIElevationProvider::FetchOutcome GSIElevationProvider::classifyResponse(
+    drogon::ReqResult result, const drogon::HttpResponsePtr& resp) {
+    if (result != drogon::ReqResult::Ok || !resp) {
+        return FetchOutcome::Failed;
+    }
+    int status = static_cast<int>(resp->statusCode());
+    if (status == 200) {
+        return FetchOutcome::Ok;
+    }
+    if (status == 429 || status >= 500) {
+        return FetchOutcome::Failed;
+    }
+    // 404 など: タイルが存在しない
+    return FetchOutcome::Missing;
+}
+
+bool GSIElevationProvider::isKnownUnavailable(const std::string& source,
+                                              const std::string& cacheKey, bool ignoreFailed) {
+    FetchOutcome outcome;
+    if (!negativeCache_.findAndFetch(source + "/" + cacheKey, outcome)) return false;
+    return !(ignoreFailed && outcome == FetchOutcome::Failed);
+}
+
+void GSIElevationProvider::rememberUnavailable(const std::string& source,
+                                               const std::string& cacheKey, FetchOutcome outcome) {
+    if (outcome == FetchOutcome::Ok) return;
+    negativeCache_.insert(
+        source + "/" + cacheKey, outcome,
+        outcome == FetchOutcome::Missing ? kMissingTileTtlSeconds : kFailedTileTtlSeconds);
+}
+
+GSIElevationProvider::FetchOutcome GSIElevationProvider::recordResponse(
+    drogon::ReqResult result, const drogon::HttpResponsePtr& resp,
+    std::chrono::steady_clock::time_point startedAt) {
+    auto outcome = classifyResponse(result, resp);
+    if (outcome == FetchOutcome::Failed) {
+        circuitBreaker_.recordFailure();
+    } else {
+        // 404 も GSI が正常に応答した結果なので成功として扱う (遅い場合は失敗扱い)
+        circuitBreaker_.recordSuccess(std::chrono::steady_clock::now() - startedAt);
+    }
+    return outcome;
 }
 
 std::shared_ptr<GSIElevationProvider::TileData> GSIElevationProvider::parseTileText(
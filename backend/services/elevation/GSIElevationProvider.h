@@ -5,9 +5,14 @@
 #include <drogon/HttpClient.h>
 #include <drogon/utils/Utilities.h>
 
+#include <chrono>
+#include <cstdint>
+#include <functional>
 #include <memory>
+#include <span>
 #include <string>
 
+#include "../../utils/CircuitBreaker.h"
 #include "../RouteService.h"
 #include "IElevationProvider.h"
 
@@ -22,13 +27,25 @@ class GSIElevationProvider : public IElevationProvider {
     void getElevations(const std::vector<Coordinate>& coords,
                        ElevationsCallback&& callback) override;
     std::optional<double> getElevationSync(const Coordinate& coord) override;
+    std::vector<std::optional<double>> getElevationsSync(
+        std::span<const Coordinate> coords) override;
+    std::vector<std::optional<double>> getElevationsSyncE7(
+        std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) override;
 
     struct TileData {
         std::vector<double> elevations;  // 256x256
+        std::string source;              // 取得元のデータセット ("dem5a" / "dem")
     };
+    using TileCallback = std::function<void(std::shared_ptr<TileData>)>;
 
     // 公開: タイルデータの取得とパース
-    void fetchTile(int z, int x, int y, std::function<void(std::shared_ptr<TileData>)>&& callback);
+    // 高解像度のソースから順に非同期で試行し、最初に取得できたタイルを返す
+    // (全ソース失敗時は nullptr)。上位ソースが失敗するか、一定時間 (ヘッジ遅延) 応答しなければ
+    // 次のソースへの要求も出す。遅れて届いた上位ソースのタイルはキャッシュだけを置き換える
+    // bypassFailedCache: 直近の取得失敗 (Failed) をネガティブキャッシュで飛ばさずに再取得する。
+    // 自前でバックオフして再試行する呼び出し元 (SmartRefreshService) 用。
+    // 欠損 (Missing) は常に飛ばす
+    void fetchTile(int z, int x, int y, TileCallback&& callback, bool bypassFailedCache = false);
 
     // 公開: タイル座標の計算
     struct TileCoord {
@@ -40,13 +57,76 @@ class GSIElevationProvider : public IElevationProvider {
     };
     static TileCoord calculateTileCoord(const Coordinate& coord, int zoom = 15);
 
+    // 座標列をまとめてタイル座標に変換する (out は coords と同じ長さ)
+    // 1e-7 度の固定小数点に直して求める。経度は整数演算、緯度はズームごとのタイル行の境界表
+    // (初回に作る) の探索と行内の線形補間で、点ごとに tan/asinh を計算しない
+    static void calculateTileCoords(std::span<const Coordinate> coords, std::span<TileCoord> out,
+                                    int zoom = 15);
+    static std::vector<TileCoord> calculateTileCoords(std::span<const Coordinate> coords,
+                                                      int zoom = 15);
+    // 固定小数点 (1e-7 度) の緯度・経度列から変換する (CompactPath のレーンをそのまま渡せる)
+    static void calculateTileCoords(std::span<const int32_t> latsE7,
+                                    std::span<const int32_t> lonsE7, std::span<TileCoord> out,
+                                    int zoom = 15);
+
+    static bool sameTile(const TileCoord& a, const TileCoord& b) {
+        return a.z == b.z && a.x == b.x && a.y == b.y;
+    }
+
+    // GSI の遅延・エラー率が閾値を超えたらフェイルファストするサーキットブレーカーの設定
+    void setCircuitBreakerOptions(const ::cycling::utils::CircuitBreaker::Options& options);
+
    protected:
     std::shared_ptr<TileData> parseTileText(const std::string& text);
 
+    enum class FetchOutcome {
+        Ok,       // 200
+        Missing,  // タイルが存在しない (海上・国外など)。GSI 自体は正常
+        Failed    // 通信エラー・タイムアウト・5xx
+    };
+    static FetchOutcome classifyResponse(drogon::ReqResult result,
+                                         const drogon::HttpResponsePtr& resp);
+
+    // ネガティブキャッシュ: 存在しない・取得に失敗したタイルをソースごとに短時間再取得しない
+    // (ignoreFailed のときは欠損 (Missing) だけを見る)
+    bool isKnownUnavailable(const std::string& source, const std::string& cacheKey,
+                            bool ignoreFailed = false);
+    void rememberUnavailable(const std::string& source, const std::string& cacheKey,
+                             FetchOutcome outcome);
+
+    // レスポンスをブレーカーに記録し、結果を分類する
+    FetchOutcome recordResponse(drogon::ReqResult result, const drogon::HttpResponsePtr& resp,
+                                std::chrono::steady_clock::time_point startedAt);
+
+    // 1 ソース分のタイルを HTTP で要求する (テストで差し替え可能)
+    virtual void sendTileRequest(const std::string& path, double timeoutSeconds,
+                                 drogon::HttpReqCallback&& callback);
+    // delaySeconds 後に fn を実行する (ヘッジ用。テストで差し替え可能)
+    virtual void scheduleHedge(double delaySeconds, std::function<void()> fn);
+
+    ::cycling::utils::CircuitBreaker circuitBreaker_;
+
    private:
+    // キャッシュを確認し、なければ取得完了まで待つ (失敗時は nullptr)
+    std::shared_ptr<TileData> getTileSync(const TileCoord& tileCoord);
+
+    // タイル座標の列に対応する標高を引く (連続して同じタイルなら 1 回だけ引く)
+    std::vector<std::optional<double>> lookupElevations(std::span<const TileCoord> tileCoords);
+
+    // 1 タイル分の取得状態 (ソースごとの要求が共有する)
+    struct PendingFetch;
+    // from 番目以降で利用できる最初のソースへ要求を出す (既に出していれば何もしない)。
+    // 出せるソースがなく、応答待ちもなければ nullptr を返して終える
+    void startNextSource(const std::shared_ptr<PendingFetch>& fetch, size_t from);
+    void onSourceResponse(const std::shared_ptr<PendingFetch>& fetch, size_t sourceIndex,
+                          drogon::ReqResult result, const drogon::HttpResponsePtr& resp,
+                          std::chrono::steady_clock::time_point startedAt);
+
     drogon::HttpClientPtr httpClient_;
     // タイルデータのキャッシュ (キー: "z/x/y", 有効期限: 1時間)
     drogon::CacheMap<std::string, std::shared_ptr<TileData>> tileCache_;
+    // ネガティブキャッシュ (キー: "source/z/x/y")
+    drogon::CacheMap<std::string, FetchOutcome> negativeCache_;
 };
 
 }  // namespace services::elevation
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <optional>
 #include <string>
 #include <vector>
@@ -12,6 +13,7 @@ namespace services::elevation {
 struct ElevationCacheEntry {
     std::string content;
     uint64_t updated_at;
+    std::string source;  // DEM dataset that served the tile (empty for legacy entries)
 };
 
 /**
@@ -38,9 +40,11 @@ class IElevationCacheRepository {
      * @param x tile x
      * @param y tile y
      * @param content CSV string
+     * @param source DEM dataset the content came from (e.g. "dem5a", "dem")
      * @return true if success
      */
-    virtual bool saveTile(int z, int x, int y, const std::string& content) = 0;
+    virtual bool saveTile(int z, int x, int y, const std::string& content,
+                          const std::string& source) = 0;
 
     /**
      * @brief Increment access score for a tile
@@ -60,6 +64,16 @@ class IElevationCacheRepository {
      */
     virtual void addToRefreshQueue(int z, int x, int y) = 0;
 
+    /**
+     * @brief Add many tiles to refresh queue and wait until they are stored
+     *
+     * Unlike addToRefreshQueue, returns only after the queue holds the tiles, so a
+     * popRefreshQueue() right after it sees them.
+     *
+     * @param tileKeys tile keys "z:x:y"
+     */
+    virtual void addToRefreshQueueBatch(const std::vector<std::string>& tileKeys) = 0;
+
     /**
      * @brief Pop a tile from refresh queue
      *
@@ -67,6 +81,13 @@ class IElevationCacheRepository {
      */
     virtual std::optional<std::string> popRefreshQueue() = 0;
 
+    /**
+     * @brief Get number of tiles waiting in refresh queue
+     *
+     * @return size_t queue depth
+     */
+    virtual size_t getRefreshQueueSize() = 0;
+
     /**
      * @brief Apply decay factor to all access scores
      *
@@ -83,6 +104,24 @@ class IElevationCacheRepository {
      * @return double score
      */
     virtual double getAccessScore(int z, int x, int y) = 0;
+
+    /**
+     * @brief Get the highest-ranked tiles by access score
+     *
+     * @param limit maximum number of tiles
+     * @param minScore only tiles with score >= minScore
+     * @return std::vector<std::string> tile keys "z:x:y", highest score first
+     */
+    virtual std::vector<std::string> getTopRankedTiles(size_t limit, double minScore) = 0;
+
+    /**
+     * @brief Get `updated_at` of many tiles in one batch
+     *
+     * @param tileKeys tile keys "z:x:y"
+     * @return std::vector<std::optional<uint64_t>> same order as tileKeys (nullopt if not cached)
+     */
+    virtual std::vector<std::optional<uint64_t>> getUpdatedAtBatch(
+        const std::vector<std::string>& tileKeys) = 0;
 };
 
 }  // namespace services::elevation
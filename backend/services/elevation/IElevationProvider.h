@@ -1,15 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 #include <optional>
+#include <span>
 #include <vector>
 
-namespace services {
+#include "../Coordinate.h"
 
-// RouteService.h に定義されている Coordinate を使用
-struct Coordinate;
-
-namespace elevation {
+namespace services::elevation {
 
 class IElevationProvider {
    public:
@@ -39,7 +39,42 @@ class IElevationProvider {
      * @brief 同期的に標高を取得（テストや特定のユースケース用）
      */
     virtual std::optional<double> getElevationSync(const Coordinate& coord) = 0;
+
+    /**
+     * @brief 複数地点の標高を同期的に一括取得
+     *
+     * 既定の実装は地点ごとに getElevationSync を呼ぶ。
+     * タイル単位でまとめて引ける実装は上書きする
+     *
+     * @param coords 座標リスト
+     * @return 各地点の標高（取得失敗箇所は nullopt）
+     */
+    virtual std::vector<std::optional<double>> getElevationsSync(
+        std::span<const Coordinate> coords) {
+        std::vector<std::optional<double>> results;
+        results.reserve(coords.size());
+        for (const auto& coord : coords) {
+            results.push_back(getElevationSync(coord));
+        }
+        return results;
+    }
+
+    /**
+     * @brief 固定小数点 (1e-7 度) の緯度・経度列から標高を同期的に一括取得
+     *
+     * CompactPath::latsE7() / lonsE7() をそのまま渡せる。既定の実装は Coordinate に戻して
+     * getElevationsSync を呼ぶ。整数のままタイル座標を求められる実装は上書きする
+     *
+     * @return 各地点の標高（取得失敗箇所は nullopt）
+     */
+    virtual std::vector<std::optional<double>> getElevationsSyncE7(
+        std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) {
+        std::vector<Coordinate> coords(std::min(latsE7.size(), lonsE7.size()));
+        for (size_t i = 0; i < coords.size(); ++i) {
+            coords[i] = {fromFixedE7(latsE7[i]), fromFixedE7(lonsE7[i])};
+        }
+        return getElevationsSync(coords);
+    }
 };
 
-}  // namespace elevation
-}  // namespace services
+}  // namespace services::elevation
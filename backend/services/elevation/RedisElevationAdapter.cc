@@ -3,6 +3,8 @@
 #include <drogon/utils/Utilities.h>
 
 #include <chrono>
+#include <future>
+#include <mutex>
 
 namespace services::elevation {
 
@@ -31,6 +33,8 @@ std::optional<ElevationCacheEntry> RedisElevationAdapter::getTile(int z, int x,
                         entry.content = arr[i + 1].asString();
                     } else if (field == "updated_at") {
                         entry.updated_at = std::stoull(arr[i + 1].asString());
+                    } else if (field == "source") {
+                        entry.source = arr[i + 1].asString();
                     }
                 }
                 if (!entry.content.empty()) return entry;
@@ -43,15 +47,17 @@ std::optional<ElevationCacheEntry> RedisElevationAdapter::getTile(int z, int x,
     return std::nullopt;
 }
 
-bool RedisElevationAdapter::saveTile(int z, int x, int y, const std::string& content) {
+bool RedisElevationAdapter::saveTile(int z, int x, int y, const std::string& content,
+                                     const std::string& source) {
     std::string key = makeDataKey(z, x, y);
     uint64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
     try {
         // HSET command
         redisClient_->execCommandSync([](const drogon::nosql::RedisResult& r) { return r; },
-                                      "HSET %s content %s updated_at %llu", key.c_str(),
-                                      content.c_str(), (unsigned long long)now);
+                                      "HSET %s content %s updated_at %llu source %s",
+                                      key.c_str(), content.c_str(), (unsigned long long)now,
+                                      source.c_str());
 
         // EXPIRE command (365 days)
         redisClient_->execCommandSync([](const drogon::nosql::RedisResult& r) { return r; },
@@ -92,6 +98,40 @@ void RedisElevationAdapter::addToRefreshQueue(int z, int x, int y) {
                                    "SADD %s %s", refreshQueueKey_.c_str(), tileId.c_str());
 }
 
+void RedisElevationAdapter::addToRefreshQueueBatch(const std::vector<std::string>& tileKeys) {
+    if (tileKeys.empty()) return;
+
+    struct BatchState {
+        std::mutex mutex;
+        size_t remaining;
+        std::promise<void> done;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->remaining = tileKeys.size();
+
+    auto finishOne = [](const std::shared_ptr<BatchState>& s) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (--s->remaining == 0) s->done.set_value();
+    };
+
+    // SADD を返事を待たずに続けて書き込み (パイプライン)、全部の返事が来てから戻る。
+    // 戻った直後の SPOP で取り出せるようにするため
+    for (const auto& tileKey : tileKeys) {
+        redisClient_->execCommandAsync(
+            [state, finishOne](const drogon::nosql::RedisResult&) { finishOne(state); },
+            [state, finishOne](const std::exception& e) {
+                LOG_ERROR << "Redis error in addToRefreshQueueBatch: " << e.what();
+                finishOne(state);
+            },
+            "SADD %s %s", refreshQueueKey_.c_str(), tileKey.c_str());
+    }
+
+    auto future = state->done.get_future();
+    if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+        LOG_WARN << "Timeout waiting for addToRefreshQueueBatch replies";
+    }
+}
+
 std::optional<std::string> RedisElevationAdapter::popRefreshQueue() {
     try {
         // SPOP
@@ -107,6 +147,21 @@ std::optional<std::string> RedisElevationAdapter::popRefreshQueue() {
     return std::nullopt;
 }
 
+size_t RedisElevationAdapter::getRefreshQueueSize() {
+    try {
+        // SCARD
+        auto result =
+            redisClient_->execCommandSync([](const drogon::nosql::RedisResult& r) { return r; },
+                                          "SCARD %s", refreshQueueKey_.c_str());
+        if (result.type() == drogon::nosql::RedisResultType::kInteger) {
+            return static_cast<size_t>(result.asInteger());
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Redis error in getRefreshQueueSize: " << e.what();
+    }
+    return 0;
+}
+
 void RedisElevationAdapter::decayScores(double factor) {
     // 計画 3.3.3節に基づき、ZSCAN を使ったバッチ処理に分割して Redis ブロックを回避する
     scanStep("0", factor);
@@ -165,9 +220,80 @@ double RedisElevationAdapter::getAccessScore(int z, int x, int y) {
     return 0.0;
 }
 
+std::vector<std::string> RedisElevationAdapter::getTopRankedTiles(size_t limit, double minScore) {
+    std::vector<std::string> tiles;
+    if (limit == 0) return tiles;
+
+    try {
+        // ZREVRANGEBYSCORE (highest score first, below-threshold tiles never leave Redis)
+        auto result = redisClient_->execCommandSync(
+            [](const drogon::nosql::RedisResult& r) { return r; },
+            "ZREVRANGEBYSCORE %s +inf %f LIMIT 0 %llu", rankKey_.c_str(), minScore,
+            (unsigned long long)limit);
+        if (result.type() == drogon::nosql::RedisResultType::kArray) {
+            for (const auto& member : result.asArray()) {
+                tiles.push_back(member.asString());
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR << "Redis error in getTopRankedTiles: " << e.what();
+    }
+    return tiles;
+}
+
+std::vector<std::optional<uint64_t>> RedisElevationAdapter::getUpdatedAtBatch(
+    const std::vector<std::string>& tileKeys) {
+    if (tileKeys.empty()) return {};
+
+    struct BatchState {
+        std::mutex mutex;
+        std::vector<std::optional<uint64_t>> values;
+        size_t remaining;
+        std::promise<void> done;
+    };
+    auto state = std::make_shared<BatchState>();
+    state->values.resize(tileKeys.size());
+    state->remaining = tileKeys.size();
+
+    auto finishOne = [](const std::shared_ptr<BatchState>& s) {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        if (--s->remaining == 0) s->done.set_value();
+    };
+
+    // HGET for every tile is written back to back without waiting for replies, so hiredis
+    // pipelines the whole batch instead of paying one round trip per tile.
+    for (size_t i = 0; i < tileKeys.size(); ++i) {
+        std::string key = dataKeyPrefix_ + tileKeys[i];
+        redisClient_->execCommandAsync(
+            [state, i, finishOne](const drogon::nosql::RedisResult& r) {
+                if (r.type() == drogon::nosql::RedisResultType::kString) {
+                    try {
+                        auto updatedAt = std::stoull(r.asString());
+                        std::lock_guard<std::mutex> lock(state->mutex);
+                        state->values[i] = updatedAt;
+                    } catch (const std::exception&) {
+                        // Leave as nullopt
+                    }
+                }
+                finishOne(state);
+            },
+            [state, finishOne](const std::exception& e) {
+                LOG_ERROR << "Redis error in getUpdatedAtBatch: " << e.what();
+                finishOne(state);
+            },
+            "HGET %s updated_at", key.c_str());
+    }
+
+    auto future = state->done.get_future();
+    if (future.wait_for(std::chrono::seconds(5)) != std::future_status::ready) {
+        LOG_WARN << "Timeout waiting for getUpdatedAtBatch replies";
+    }
+    std::lock_guard<std::mutex> lock(state->mutex);
+    return state->values;
+}
+
 std::string RedisElevationAdapter::makeDataKey(int z, int x, int y) const {
-    return "cycling:elevation:v1:data:" + std::to_string(z) + ":" + std::to_string(x) + ":" +
-           std::to_string(y);
+    return dataKeyPrefix_ + makeTileId(z, x, y);
 }
 
 std::string RedisElevationAdapter::makeTileId(int z, int x, int y) const {
@@ -13,12 +13,18 @@ class RedisElevationAdapter : public IElevationCacheRepository,
     ~RedisElevationAdapter() override = default;
 
     std::optional<ElevationCacheEntry> getTile(int z, int x, int y) override;
-    bool saveTile(int z, int x, int y, const std::string& content) override;
+    bool saveTile(int z, int x, int y, const std::string& content,
+                  const std::string& source) override;
     void incrementAccessScore(int z, int x, int y) override;
     void addToRefreshQueue(int z, int x, int y) override;
+    void addToRefreshQueueBatch(const std::vector<std::string>& tileKeys) override;
     std::optional<std::string> popRefreshQueue() override;
+    size_t getRefreshQueueSize() override;
     void decayScores(double factor) override;
     double getAccessScore(int z, int x, int y) override;
+    std::vector<std::string> getTopRankedTiles(size_t limit, double minScore) override;
+    std::vector<std::optional<uint64_t>> getUpdatedAtBatch(
+        const std::vector<std::string>& tileKeys) override;
 
    private:
     std::string makeDataKey(int z, int x, int y) const;
@@ -27,6 +33,7 @@ class RedisElevationAdapter : public IElevationCacheRepository,
     drogon::nosql::RedisClientPtr redisClient_;
     const std::string rankKey_ = "cycling:elevation:v1:stats:rank";
     const std::string refreshQueueKey_ = "cycling:elevation:v1:queue:refresh";
+    const std::string dataKeyPrefix_ = "cycling:elevation:v1:data:";
 
     void scanStep(const std::string& cursor, double factor);
 };
@@ -2,12 +2,23 @@
 
 #include <drogon/drogon.h>
 
+#include <algorithm>
 #include <chrono>
-
-#include "GSIElevationProvider.h"  // For dynamic_pointer_cast
+#include <cstdio>
+#include <sstream>
 
 namespace services::elevation {
 
+namespace {
+
+constexpr auto kFetchTimeout = std::chrono::seconds(10);
+constexpr auto kStatsInterval = std::chrono::seconds(1);
+constexpr auto kDecayInterval = std::chrono::hours(24);
+// Tiles older than 3 months (90 days) are refreshed
+constexpr uint64_t kRefreshAgeSeconds = 90 * 24 * 60 * 60;
+
+}  // namespace
+
 SmartRefreshService::SmartRefreshService(std::shared_ptr<IElevationCacheRepository> repository,
                                          std::shared_ptr<IElevationProvider> provider)
     : repository_(std::move(repository)), provider_(std::move(provider)) {}
@@ -18,144 +29,371 @@ void SmartRefreshService::startWorker() {
     if (running_.exchange(true)) {
         return;  // Already running
     }
+    {
+        std::lock_guard<std::mutex> lock(signal_->mutex);
+        signal_->stopping = false;
+    }
     workerThread_ = std::thread(&SmartRefreshService::workerLoop, this);
 }
 
 void SmartRefreshService::stopWorker() {
     if (running_.exchange(false)) {
+        {
+            std::lock_guard<std::mutex> lock(signal_->mutex);
+            signal_->stopping = true;
+        }
+        signal_->cv.notify_all();
         if (workerThread_.joinable()) {
             workerThread_.join();
         }
     }
 }
 
+void SmartRefreshService::notifyQueued() {
+    {
+        std::lock_guard<std::mutex> lock(signal_->mutex);
+        signal_->queued = true;
+    }
+    signal_->cv.notify_one();
+}
+
 void SmartRefreshService::recordAccess(int z, int x, int y) {
     // Fire and forget (Async handled by Redis adapter)
     repository_->incrementAccessScore(z, x, y);
 }
 
-void SmartRefreshService::checkAndQueueRefresh(int z, int x, int y, uint64_t lastUpdated) {
-    auto now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-    // 3 months = 90 days
-    const uint64_t threeMonthsSeconds = 90 * 24 * 60 * 60;
+size_t SmartRefreshService::scanForStaleTiles() {
+    auto tiles = repository_->getTopRankedTiles(stalenessScanTopN_, refreshThreshold_);
+    if (tiles.empty()) return 0;
 
-    if (now - lastUpdated > threeMonthsSeconds) {
-        // Check Access Score (Synchronously here, or move logic to Redis side via Lua/job)
-        // Ideally we shouldn't block.
-        // Let's assume we do a quick check or just queue it and let worker decide.
-        // But plan says "Lazy Check: updated_at > 3 months & score high -> queue".
+    auto updatedAt = repository_->getUpdatedAtBatch(tiles);
+    uint64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
 
-        // Blocking here for ZSCORE might be slow.
-        // Instead, just queue it if old? Or fire async check?
-        // Let's fire async task to check score and queue.
+    std::vector<std::string> stale;
+    for (size_t i = 0; i < tiles.size() && i < updatedAt.size(); ++i) {
+        // Tiles missing from L2 are fetched on demand, not refreshed
+        if (!updatedAt[i] || !isStale(*updatedAt[i], now)) continue;
 
-        // Using drogon's thread pool for this small task
-        drogon::app().getLoop()->runInLoop([this, z, x, y]() {
-            double score = repository_->getAccessScore(z, x, y);
-            if (score >= refreshThreshold_) {
-                repository_->addToRefreshQueue(z, x, y);
-            }
-        });
+        int z, x, y;
+        if (!parseKey(tiles[i], z, x, y)) {
+            LOG_ERROR << "Invalid tile key in access ranking: " << tiles[i];
+            continue;
+        }
+        stale.push_back(makeKey(z, x, y));
     }
+
+    // Wait for the queue writes so that fillReadyTasks() right after the scan pops these tiles
+    // instead of finding the queue empty and leaving them for the next poll
+    if (!stale.empty()) {
+        repository_->addToRefreshQueueBatch(stale);
+    }
+
+    LOG_DEBUG << "Staleness scan checked " << tiles.size() << " tiles, queued " << stale.size();
+    return stale.size();
+}
+
+bool SmartRefreshService::isStale(uint64_t lastUpdated, uint64_t now) {
+    return now > lastUpdated && now - lastUpdated > kRefreshAgeSeconds;
 }
 
 void SmartRefreshService::setRefreshThreshold(double threshold) { refreshThreshold_ = threshold; }
 
 void SmartRefreshService::setDecayFactor(double factor) { decayFactor_ = factor; }
 
+void SmartRefreshService::setMaxConcurrentFetches(size_t maxConcurrent) {
+    maxConcurrentFetches_ = std::max<size_t>(maxConcurrent, 1);
+}
+
+void SmartRefreshService::setRateLimit(double requestsPerSecond, double burst) {
+    rateLimiter_.setRate(requestsPerSecond, burst);
+}
+
+void SmartRefreshService::setRetryPolicy(int maxRetries, std::chrono::milliseconds baseDelay) {
+    maxRetries_ = std::max(maxRetries, 0);
+    retryBaseDelayMs_ = baseDelay.count();
+}
+
+void SmartRefreshService::setIdlePollInterval(std::chrono::milliseconds interval) {
+    idlePollIntervalMs_ = interval.count();
+}
+
+void SmartRefreshService::setStalenessScan(size_t topN, std::chrono::seconds interval) {
+    stalenessScanTopN_ = topN;
+    stalenessScanIntervalSec_ = interval.count();
+}
+
+RefreshStats SmartRefreshService::getStats() const {
+    RefreshStats stats;
+    stats.queueDepth = queueDepth_;
+    stats.pendingRetries = pendingRetries_;
+    stats.inFlight = inFlight_;
+    stats.refreshedTotal = refreshedTotal_;
+    stats.failedTotal = failedTotal_;
+    stats.refreshesPerSecond = refreshesPerSecond_;
+    return stats;
+}
+
 void SmartRefreshService::workerLoop() {
     LOG_INFO << "SmartRefreshService worker started.";
 
-    int loopCount = 0;
+    auto lastDecay = Clock::now();
+    queueDrained_ = false;
+    nextStalenessScan_ = Clock::now();
+
     while (running_) {
+        auto now = Clock::now();
         try {
-            processRefreshQueue();
+            drainCompletions();
+            expireTimedOutFetches(now);
 
-            // Perform decay once a day (approx)
-            // Assuming 1s loop interval, 86400 loops = 1 day
-            if (++loopCount >= 86400) {
+            if (now >= nextStalenessScan_) {
+                nextStalenessScan_ = now + std::chrono::seconds(stalenessScanIntervalSec_.load());
+                if (scanForStaleTiles() > 0) {
+                    queueDrained_ = false;
+                }
+            }
+
+            fillReadyTasks(now);
+            dispatchReadyTasks();
+
+            // Perform decay once a day
+            if (now - lastDecay >= kDecayInterval) {
                 performDecay();
-                loopCount = 0;
+                lastDecay = now;
             }
+            updateStats(now);
         } catch (const std::exception& e) {
             LOG_ERROR << "Exception in SmartRefreshService worker: " << e.what();
         }
 
-        // Sleep 1s (Rate limit for API check loop)
-        // Also serves as minimal interval between tasks if queue is empty
-        // If queue is full, we process one by one with 1s interval (1 QPS)
-        std::this_thread::sleep_for(std::chrono::milliseconds(1000));
+        // Sleep until something happens: a fetch completes, a tile is queued, a retry becomes
+        // due, a rate-limit token is available, or the idle poll interval elapses (tiles queued
+        // by other processes are only discovered by polling).
+        std::unique_lock<std::mutex> lock(signal_->mutex);
+        signal_->cv.wait_until(lock, nextWakeup(Clock::now()), [this] {
+            return signal_->stopping || signal_->queued || !signal_->completions.empty();
+        });
+        if (signal_->queued) {
+            signal_->queued = false;
+            queueDrained_ = false;
+        }
     }
 
+    // Graceful shutdown: let outstanding fetches finish so their results are persisted
+    auto shutdownDeadline = Clock::now() + kFetchTimeout;
+    while (!inFlightFetches_.empty() && Clock::now() < shutdownDeadline) {
+        {
+            std::unique_lock<std::mutex> lock(signal_->mutex);
+            signal_->cv.wait_until(lock, shutdownDeadline,
+                                   [this] { return !signal_->completions.empty(); });
+        }
+        drainCompletions();
+    }
+    if (!inFlightFetches_.empty()) {
+        LOG_WARN << "SmartRefreshService stopped with " << inFlightFetches_.size()
+                 << " fetches still in flight.";
+        for (const auto& [id, fetch] : inFlightFetches_) {
+            ready_.push_back(fetch.task);
+        }
+        inFlightFetches_.clear();
+        inFlight_ = 0;
+    }
+
+    // Hand tiles we popped but never refreshed back to the shared queue
+    while (!retries_.empty()) {
+        ready_.push_back(retries_.top());
+        retries_.pop();
+    }
+    for (const auto& task : ready_) {
+        repository_->addToRefreshQueue(task.z, task.x, task.y);
+    }
+    ready_.clear();
+    pendingRetries_ = 0;
+
     LOG_INFO << "SmartRefreshService worker stopped.";
 }
 
-void SmartRefreshService::processRefreshQueue() {
-    auto tileKeyOpt = repository_->popRefreshQueue();
-    if (!tileKeyOpt) {
+void SmartRefreshService::drainCompletions() {
+    std::deque<Completion> completions;
+    {
+        std::lock_guard<std::mutex> lock(signal_->mutex);
+        completions.swap(signal_->completions);
+    }
+
+    for (auto& completion : completions) {
+        auto it = inFlightFetches_.find(completion.id);
+        if (it == inFlightFetches_.end()) {
+            continue;  // Already given up on (timed out)
+        }
+        RefreshTask task = it->second.task;
+        inFlightFetches_.erase(it);
+        inFlight_ = inFlightFetches_.size();
+        handleResult(task, completion.data);
+    }
+}
+
+void SmartRefreshService::expireTimedOutFetches(Clock::time_point now) {
+    for (auto it = inFlightFetches_.begin(); it != inFlightFetches_.end();) {
+        if (now - it->second.startedAt >= kFetchTimeout) {
+            RefreshTask task = it->second.task;
+            LOG_WARN << "Timeout during tile fetch for refresh: "
+                     << makeKey(task.z, task.x, task.y);
+            it = inFlightFetches_.erase(it);
+            inFlight_ = inFlightFetches_.size();
+            handleResult(task, nullptr);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void SmartRefreshService::fillReadyTasks(Clock::time_point now) {
+    while (!retries_.empty() && retries_.top().due <= now) {
+        ready_.push_back(retries_.top());
+        retries_.pop();
+    }
+    pendingRetries_ = retries_.size();
+
+    if (queueDrained_ && now >= nextQueuePoll_) {
+        queueDrained_ = false;
+    }
+
+    // Only pull as many tiles from the shared queue as we can start right now, so that other
+    // processes can pick up the rest.
+    while (!queueDrained_ && ready_.size() + inFlightFetches_.size() < maxConcurrentFetches_) {
+        auto tileKeyOpt = repository_->popRefreshQueue();
+        if (!tileKeyOpt) {
+            queueDrained_ = true;
+            nextQueuePoll_ = now + std::chrono::milliseconds(idlePollIntervalMs_.load());
+            break;
+        }
+
+        int z, x, y;
+        if (!parseKey(*tileKeyOpt, z, x, y)) {
+            LOG_ERROR << "Invalid tile key in refresh queue: " << *tileKeyOpt;
+            continue;
+        }
+        ready_.push_back(RefreshTask{z, x, y, 0, now});
+    }
+}
+
+void SmartRefreshService::dispatchReadyTasks() {
+    while (!ready_.empty() && inFlightFetches_.size() < maxConcurrentFetches_) {
+        if (!rateLimiter_.tryAcquire()) {
+            return;
+        }
+        RefreshTask task = ready_.front();
+        ready_.pop_front();
+        dispatch(task);
+    }
+}
+
+void SmartRefreshService::dispatch(const RefreshTask& task) {
+    uint64_t id = nextFetchId_++;
+    inFlightFetches_[id] = InFlightFetch{task, Clock::now()};
+    inFlight_ = inFlightFetches_.size();
+
+    if (task.attempt == 0) {
+        LOG_INFO << "Refreshing tile: " << makeKey(task.z, task.x, task.y);
+    }
+
+    std::weak_ptr<WorkerSignal> weakSignal = signal_;
+    fetchTile(task.z, task.x, task.y, [weakSignal, id](FetchedTile data) {
+        auto signal = weakSignal.lock();
+        if (!signal) return;
+        {
+            std::lock_guard<std::mutex> lock(signal->mutex);
+            signal->completions.push_back(Completion{id, std::move(data)});
+        }
+        signal->cv.notify_one();
+    });
+}
+
+void SmartRefreshService::handleResult(const RefreshTask& task, const FetchedTile& data) {
+    std::string tileKey = makeKey(task.z, task.x, task.y);
+
+    if (data) {
+        repository_->saveTile(task.z, task.x, task.y, serializeElevations(data->elevations),
+                              data->source);
+        refreshedTotal_++;
+        LOG_DEBUG << "Tile refreshed successfully (" << data->source << "): " << tileKey;
         return;
     }
 
-    std::string tileKey = *tileKeyOpt;
-    int z, x, y;
-    if (sscanf(tileKey.c_str(), "%d:%d:%d", &z, &x, &y) != 3) {
-        LOG_ERROR << "Invalid tile key in refresh queue: " << tileKey;
+    if (task.attempt < maxRetries_) {
+        // Exponential backoff without blocking the worker: the task is parked until it is due
+        RefreshTask retry = task;
+        retry.attempt++;
+        auto delay = std::chrono::milliseconds(retryBaseDelayMs_.load() *
+                                               (int64_t{1} << (retry.attempt - 1)));
+        retry.due = Clock::now() + delay;
+        LOG_INFO << "Retrying tile refresh (" << retry.attempt << "/" << maxRetries_ << ") after "
+                 << delay.count() << "ms: " << tileKey;
+        retries_.push(retry);
+        pendingRetries_ = retries_.size();
         return;
     }
 
-    LOG_INFO << "Refreshing tile: " << tileKey;
+    failedTotal_++;
+    LOG_ERROR << "Failed to refresh tile after retries: " << tileKey;
+}
 
-    auto gsiProvider = std::dynamic_pointer_cast<GSIElevationProvider>(provider_);
-    if (!gsiProvider) return;
-
-    int retryCount = 0;
-    const int maxRetries = 3;
-    int baseDelayMs = 1000;
-    bool success = false;
-
-    while (retryCount <= maxRetries && !success) {
-        if (retryCount > 0) {
-            int delay = baseDelayMs * std::pow(2, retryCount - 1);
-            LOG_INFO << "Retrying tile refresh (" << retryCount << "/" << maxRetries << ") after "
-                     << delay << "ms: " << tileKey;
-            std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-        }
+void SmartRefreshService::updateStats(Clock::time_point now) {
+    if (lastStatsAt_ != Clock::time_point{} && now - lastStatsAt_ < kStatsInterval) {
+        return;
+    }
 
-        std::promise<bool> promise;
-        auto future = promise.get_future();
-
-        gsiProvider->fetchTile(
-            z, x, y,
-            [this, z, x, y, &promise](std::shared_ptr<GSIElevationProvider::TileData> data) {
-                if (data) {
-                    std::stringstream ss;
-                    for (size_t i = 0; i < data->elevations.size(); ++i) {
-                        ss << data->elevations[i];
-                        if ((i + 1) % 256 == 0)
-                            ss << "\n";
-                        else
-                            ss << ",";
-                    }
-                    repository_->saveTile(z, x, y, ss.str());
-                    promise.set_value(true);
-                } else {
-                    promise.set_value(false);
-                }
-            });
+    uint64_t refreshed = refreshedTotal_;
+    if (lastStatsAt_ != Clock::time_point{}) {
+        std::chrono::duration<double> elapsed = now - lastStatsAt_;
+        refreshesPerSecond_ = static_cast<double>(refreshed - refreshedAtLastStats_) /
+                              std::max(elapsed.count(), 1e-3);
+    }
+    refreshedAtLastStats_ = refreshed;
+    lastStatsAt_ = now;
 
-        if (future.wait_for(std::chrono::seconds(10)) == std::future_status::ready) {
-            success = future.get();
-        } else {
-            LOG_WARN << "Timeout during tile fetch for refresh: " << tileKey;
+    queueDepth_ = repository_->getRefreshQueueSize() + ready_.size();
+}
+
+SmartRefreshService::Clock::time_point SmartRefreshService::nextWakeup(Clock::time_point now) {
+    auto wakeup = std::min(now + kStatsInterval, nextStalenessScan_);
+
+    if (queueDrained_) {
+        wakeup = std::min(wakeup, nextQueuePoll_);
+    }
+    if (!retries_.empty()) {
+        wakeup = std::min(wakeup, retries_.top().due);
+    }
+    if (!ready_.empty() && inFlightFetches_.size() < maxConcurrentFetches_) {
+        auto tokenWait = rateLimiter_.timeUntilAvailable();
+        if (tokenWait < kStatsInterval) {
+            wakeup = std::min(wakeup, now + tokenWait);
         }
-        retryCount++;
     }
+    for (const auto& [id, fetch] : inFlightFetches_) {
+        wakeup = std::min(wakeup, fetch.startedAt + kFetchTimeout);
+    }
+    if (!queueDrained_ && ready_.size() + inFlightFetches_.size() < maxConcurrentFetches_) {
+        wakeup = now;  // More tiles may be waiting in the shared queue
+    }
+    return wakeup;
+}
 
-    if (success) {
-        LOG_DEBUG << "Tile refreshed successfully: " << tileKey;
-    } else {
-        LOG_ERROR << "Failed to refresh tile after retries: " << tileKey;
+void SmartRefreshService::fetchTile(int z, int x, int y, FetchCallback&& callback) {
+    auto gsiProvider = std::dynamic_pointer_cast<GSIElevationProvider>(provider_);
+    if (!gsiProvider) {
+        callback(nullptr);
+        return;
     }
+
+    // Retries are paced by our own backoff, which is shorter than the provider's negative-cache
+    // TTL for failed tiles, so they must not be answered from that cache
+    gsiProvider->fetchTile(
+        z, x, y,
+        [callback = std::move(callback)](std::shared_ptr<GSIElevationProvider::TileData> data) {
+            callback(std::move(data));
+        },
+        true);
 }
 
 void SmartRefreshService::performDecay() {
@@ -167,4 +405,20 @@ std::string SmartRefreshService::makeKey(int z, int x, int y) const {
     return std::to_string(z) + ":" + std::to_string(x) + ":" + std::to_string(y);
 }
 
+bool SmartRefreshService::parseKey(const std::string& key, int& z, int& x, int& y) {
+    return sscanf(key.c_str(), "%d:%d:%d", &z, &x, &y) == 3;
+}
+
+std::string SmartRefreshService::serializeElevations(const std::vector<double>& elevations) {
+    std::stringstream ss;
+    for (size_t i = 0; i < elevations.size(); ++i) {
+        ss << elevations[i];
+        if ((i + 1) % 256 == 0)
+            ss << "\n";
+        else
+            ss << ",";
+    }
+    return ss.str();
+}
+
 }  // namespace services::elevation
@@ -1,11 +1,21 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <mutex>
+#include <queue>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
+#include "../../utils/TokenBucket.h"
+#include "GSIElevationProvider.h"
 #include "IElevationCacheRepository.h"
 #include "IElevationProvider.h"
 
@@ -13,12 +23,33 @@ namespace services::elevation {
 
 class ElevationCacheManager;
 
+/**
+ * @brief Snapshot of refresh worker activity
+ */
+struct RefreshStats {
+    size_t queueDepth = 0;      // Tiles waiting in the shared refresh queue (last observed)
+    size_t pendingRetries = 0;  // Failed tiles waiting for their backoff to expire
+    size_t inFlight = 0;        // Fetches currently outstanding
+    uint64_t refreshedTotal = 0;
+    uint64_t failedTotal = 0;
+    double refreshesPerSecond = 0.0;  // Throughput over the last stats window
+};
+
 /**
  * @brief Manages smart refreshing of elevation cache.
  * Handles access statistics, decay algorithms, and background fetching.
+ *
+ * The worker sleeps until it is notified (tile queued, fetch completed, retry due) and keeps up
+ * to `maxConcurrentFetches` fetches in flight, paced by a token bucket toward GSI.
+ * Stale tiles are found by a periodic scan of the access ranking, so the request path only
+ * records accesses.
  */
 class SmartRefreshService {
    public:
+    using Clock = std::chrono::steady_clock;
+    using FetchedTile = std::shared_ptr<const GSIElevationProvider::TileData>;
+    using FetchCallback = std::function<void(FetchedTile)>;
+
     SmartRefreshService(std::shared_ptr<IElevationCacheRepository> repository,
                         std::shared_ptr<IElevationProvider> provider);
     virtual ~SmartRefreshService();
@@ -29,29 +60,129 @@ class SmartRefreshService {
 
     // Stats & Queue
     void recordAccess(int z, int x, int y);
-    void checkAndQueueRefresh(int z, int x, int y, uint64_t lastUpdated);
+
+    /**
+     * @brief Queue the top-ranked tiles whose data is older than the refresh age
+     *
+     * Takes up to `stalenessScanTopN` tiles with score >= threshold from the ranking, reads their
+     * `updated_at` in one batch and queues the stale ones. Runs periodically on the worker.
+     *
+     * @return size_t number of tiles queued
+     */
+    size_t scanForStaleTiles();
+
+    /**
+     * @brief Whether a tile last updated at `lastUpdated` (unix seconds) needs a refresh
+     */
+    static bool isStale(uint64_t lastUpdated, uint64_t now);
+
+    /**
+     * @brief Wake the worker because tiles were added to the refresh queue
+     */
+    void notifyQueued();
 
     // Configuration
     void setRefreshThreshold(double threshold);
     void setDecayFactor(double factor);
+    void setMaxConcurrentFetches(size_t maxConcurrent);
+    void setRateLimit(double requestsPerSecond, double burst);
+    void setRetryPolicy(int maxRetries, std::chrono::milliseconds baseDelay);
+    void setIdlePollInterval(std::chrono::milliseconds interval);
+    void setStalenessScan(size_t topN, std::chrono::seconds interval);
+
+    /**
+     * @brief Current queue depth, in-flight fetches and refresh throughput
+     */
+    [[nodiscard]] RefreshStats getStats() const;
+
+   protected:
+    /**
+     * @brief Fetch fresh tile data from the backend provider (nullptr on failure)
+     *
+     * The callback may run on any thread. Overridable for tests.
+     */
+    virtual void fetchTile(int z, int x, int y, FetchCallback&& callback);
 
    private:
+    struct RefreshTask {
+        int z;
+        int x;
+        int y;
+        int attempt;
+        Clock::time_point due;
+    };
+    struct RetryLater {
+        bool operator()(const RefreshTask& a, const RefreshTask& b) const { return a.due > b.due; }
+    };
+    struct Completion {
+        uint64_t id;
+        FetchedTile data;
+    };
+    // Shared with fetch callbacks so that a late callback never touches a destroyed service
+    struct WorkerSignal {
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<Completion> completions;
+        bool queued = false;
+        bool stopping = false;
+    };
+
     std::shared_ptr<IElevationCacheRepository> repository_;
     std::shared_ptr<IElevationProvider> provider_;
 
     // Configuration
     double refreshThreshold_ = 10.0;
     double decayFactor_ = 0.95;
+    std::atomic<size_t> maxConcurrentFetches_{4};
+    std::atomic<int> maxRetries_{3};
+    std::atomic<int64_t> retryBaseDelayMs_{1000};
+    std::atomic<int64_t> idlePollIntervalMs_{5000};
+    std::atomic<size_t> stalenessScanTopN_{1000};
+    std::atomic<int64_t> stalenessScanIntervalSec_{600};
+    ::cycling::utils::TokenBucket rateLimiter_{1.0, 1.0};
 
     // Background Worker
     std::atomic<bool> running_{false};
     std::thread workerThread_;
+    std::shared_ptr<WorkerSignal> signal_ = std::make_shared<WorkerSignal>();
     void workerLoop();
-    void processRefreshQueue();
+    void drainCompletions();
+    void expireTimedOutFetches(Clock::time_point now);
+    void fillReadyTasks(Clock::time_point now);
+    void dispatchReadyTasks();
+    void dispatch(const RefreshTask& task);
+    void handleResult(const RefreshTask& task, const FetchedTile& data);
+    void updateStats(Clock::time_point now);
+    Clock::time_point nextWakeup(Clock::time_point now);
     void performDecay();
 
+    // Worker-thread state
+    std::deque<RefreshTask> ready_;
+    std::priority_queue<RefreshTask, std::vector<RefreshTask>, RetryLater> retries_;
+    struct InFlightFetch {
+        RefreshTask task;
+        Clock::time_point startedAt;
+    };
+    std::unordered_map<uint64_t, InFlightFetch> inFlightFetches_;
+    uint64_t nextFetchId_ = 0;
+    bool queueDrained_ = false;
+    Clock::time_point nextQueuePoll_{};
+    Clock::time_point nextStalenessScan_{};
+    Clock::time_point lastStatsAt_{};
+    uint64_t refreshedAtLastStats_ = 0;
+
+    // Stats (read from any thread)
+    std::atomic<size_t> queueDepth_{0};
+    std::atomic<size_t> pendingRetries_{0};
+    std::atomic<size_t> inFlight_{0};
+    std::atomic<uint64_t> refreshedTotal_{0};
+    std::atomic<uint64_t> failedTotal_{0};
+    std::atomic<double> refreshesPerSecond_{0.0};
+
     // Helper to generate cache key
     std::string makeKey(int z, int x, int y) const;
+    static bool parseKey(const std::string& key, int& z, int& x, int& y);
+    static std::string serializeElevations(const std::vector<double>& elevations);
 };
 
 }  // namespace services::elevation
@@ -0,0 +1,71 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "../utils/AllocationCounter.h"
+#include "../utils/Trace.h"
+
+using utils::AllocationCounter;
+
+namespace {
+
+// 確保が最適化で消されないよう、ポインタを外に逃がす
+void* volatile sink;
+
+}  // namespace
+
+TEST(AllocationCounterTest, CountsAllocationsOnThisThread) {
+    auto before = AllocationCounter::thisThread();
+    auto* values = new std::vector<int>(1000);
+    sink = values;
+    auto delta = AllocationCounter::thisThread() - before;
+    delete values;
+
+    if (!AllocationCounter::enabled()) {
+        EXPECT_EQ(delta.allocations, 0u);
+        EXPECT_EQ(delta.bytes, 0u);
+        return;
+    }
+    EXPECT_EQ(delta.allocations, 2u);
+    EXPECT_EQ(delta.bytes, sizeof(std::vector<int>) + 1000 * sizeof(int));
+}
+
+TEST(AllocationCounterTest, IgnoresOtherThreads) {
+    auto before = AllocationCounter::thisThread();
+    std::thread([]() {
+        auto* values = new std::vector<int>(1000);
+        sink = values;
+        delete values;
+    }).join();
+    auto after = AllocationCounter::thisThread();
+
+    // std::thread の起動自体はこのスレッドで確保するので、別スレッドでの確保分だけ少ない
+    EXPECT_LT((after - before).bytes, 1000 * sizeof(int));
+}
+
+TEST(AllocationCounterTest, TraceSpansRecordAllocationsInside) {
+    if (!AllocationCounter::enabled()) GTEST_SKIP() << "built without ENABLE_ALLOCATION_COUNTING";
+
+    auto trace = std::make_shared<utils::Trace>();
+    {
+        utils::Trace::Scope scope(trace.get());
+        utils::TraceSpan outer("outer");
+        {
+            utils::TraceSpan inner("inner");
+            auto* values = new std::vector<int>(1000);
+            sink = values;
+            delete values;
+        }
+    }
+
+    auto spans = trace->spans();
+    ASSERT_EQ(spans.size(), 2u);
+    EXPECT_GE(spans[1].allocations.allocations, 2u);
+    EXPECT_GE(spans[1].allocations.bytes, 1000 * sizeof(int));
+    EXPECT_GE(spans[0].allocations.allocations, spans[1].allocations.allocations);
+
+    auto json = trace->toJson();
+    EXPECT_TRUE(json["spans"][0]["children"][0].isMember("allocated_bytes"));
+}
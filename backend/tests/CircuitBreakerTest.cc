@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "../utils/CircuitBreaker.h"
+
+namespace {
+
+using cycling::utils::CircuitBreaker;
+
+CircuitBreaker::Options testOptions() {
+    CircuitBreaker::Options options;
+    options.windowSize = 4;
+    options.minimumCalls = 4;
+    options.failureRateThreshold = 0.5;
+    options.slowCallThreshold = std::chrono::milliseconds(100);
+    options.openDuration = std::chrono::milliseconds(30);
+    return options;
+}
+
+TEST(CircuitBreakerTest, StaysClosedBelowMinimumCalls) {
+    CircuitBreaker breaker(testOptions());
+
+    for (int i = 0; i < 3; ++i) {
+        ASSERT_TRUE(breaker.allowRequest());
+        breaker.recordFailure();
+    }
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Closed);
+    EXPECT_TRUE(breaker.allowRequest());
+}
+
+TEST(CircuitBreakerTest, OpensWhenFailureRateReachesThreshold) {
+    CircuitBreaker breaker(testOptions());
+
+    breaker.recordSuccess(std::chrono::milliseconds(1));
+    breaker.recordSuccess(std::chrono::milliseconds(1));
+    breaker.recordFailure();
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Closed);
+
+    breaker.recordFailure();
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Open);
+    EXPECT_FALSE(breaker.allowRequest());
+}
+
+TEST(CircuitBreakerTest, SlowCallsCountAsFailures) {
+    CircuitBreaker breaker(testOptions());
+
+    for (int i = 0; i < 4; ++i) {
+        breaker.recordSuccess(std::chrono::milliseconds(500));
+    }
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Open);
+}
+
+TEST(CircuitBreakerTest, OldOutcomesLeaveTheWindow) {
+    CircuitBreaker breaker(testOptions());
+
+    breaker.recordFailure();
+    for (int i = 0; i < 6; ++i) {
+        breaker.recordSuccess(std::chrono::milliseconds(1));
+    }
+    // Window now holds only successes; one more failure is 1/4 < 0.5
+    breaker.recordFailure();
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Closed);
+}
+
+TEST(CircuitBreakerTest, HalfOpenAllowsSingleProbe) {
+    CircuitBreaker breaker(testOptions());
+    for (int i = 0; i < 4; ++i) {
+        breaker.recordFailure();
+    }
+    ASSERT_FALSE(breaker.allowRequest());
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::HalfOpen);
+    EXPECT_TRUE(breaker.allowRequest());
+    EXPECT_FALSE(breaker.allowRequest());
+
+    // Successful probe closes the breaker
+    breaker.recordSuccess(std::chrono::milliseconds(1));
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Closed);
+    EXPECT_TRUE(breaker.allowRequest());
+}
+
+TEST(CircuitBreakerTest, FailedProbeReopens) {
+    CircuitBreaker breaker(testOptions());
+    for (int i = 0; i < 4; ++i) {
+        breaker.recordFailure();
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    ASSERT_TRUE(breaker.allowRequest());
+    breaker.recordFailure();
+    EXPECT_EQ(breaker.state(), CircuitBreaker::State::Open);
+    EXPECT_FALSE(breaker.allowRequest());
+}
+
+}  // namespace
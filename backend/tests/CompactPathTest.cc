@@ -0,0 +1,31 @@
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include "../services/CompactPath.h"
+
+using namespace services;
+
+TEST(CompactPathTest, RoundTripsAtFixedPointResolution) {
+    std::vector<Coordinate> coords{{35.6812362, 139.7671248}, {-33.8688197, 151.2092955}};
+    CompactPath path(coords);
+
+    ASSERT_EQ(path.size(), 2u);
+    EXPECT_EQ(path.latsE7()[0], 356812362);
+    EXPECT_EQ(path.lonsE7()[1], 1512092955);
+    EXPECT_NEAR(path[0].lat, 35.6812362, 1e-7);
+    EXPECT_NEAR(path.back().lon, 151.2092955, 1e-7);
+
+    EXPECT_NEAR(path[1].lat, -33.8688197, 1e-7);
+}
+
+TEST(CompactPathTest, PushBackAndBraceInit) {
+    CompactPath path = {{35.0, 139.0}};
+    path.push_back({35.1, 139.1});
+    EXPECT_EQ(path.size(), 2u);
+    EXPECT_DOUBLE_EQ(path.front().lat, 35.0);
+    EXPECT_NEAR(path[1].lon, 139.1, 1e-7);
+
+    path.clear();
+    EXPECT_TRUE(path.empty());
+}
@@ -0,0 +1,54 @@
+#include <gtest/gtest.h>
+
+#include <optional>
+#include <vector>
+#include <utility>
+
+#include "../utils/ConcurrencyLimiter.h"
+
+namespace {
+
+using cycling::utils::ConcurrencyLimiter;
+
+TEST(ConcurrencyLimiterTest, RejectsBeyondTheLimitUntilAPermitIsReleased) {
+    ConcurrencyLimiter limiter(2);
+    auto first = limiter.tryAcquire();
+    auto second = limiter.tryAcquire();
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_FALSE(limiter.tryAcquire().has_value());
+    EXPECT_EQ(limiter.inFlight(), 2u);
+    EXPECT_EQ(limiter.rejected(), 1u);
+
+    first.reset();
+    EXPECT_EQ(limiter.inFlight(), 1u);
+    EXPECT_TRUE(limiter.tryAcquire().has_value());
+    // 一時オブジェクトの Permit はその場で解放される
+    EXPECT_EQ(limiter.inFlight(), 1u);
+}
+
+TEST(ConcurrencyLimiterTest, MovedPermitReleasesOnce) {
+    ConcurrencyLimiter limiter(1);
+    {
+        auto permit = limiter.tryAcquire();
+        ASSERT_TRUE(permit.has_value());
+        ConcurrencyLimiter::Permit moved = std::move(*permit);
+        permit.reset();
+        EXPECT_EQ(limiter.inFlight(), 1u);
+    }
+    EXPECT_EQ(limiter.inFlight(), 0u);
+}
+
+TEST(ConcurrencyLimiterTest, ZeroLimitIsUnlimited) {
+    ConcurrencyLimiter limiter(0);
+    std::vector<ConcurrencyLimiter::Permit> permits;
+    for (int i = 0; i < 100; ++i) {
+        auto permit = limiter.tryAcquire();
+        ASSERT_TRUE(permit.has_value());
+        permits.push_back(std::move(*permit));
+    }
+    EXPECT_EQ(limiter.inFlight(), 100u);
+    EXPECT_EQ(limiter.rejected(), 0u);
+}
+
+}  // namespace
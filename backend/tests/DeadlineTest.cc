@@ -0,0 +1,60 @@
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "../utils/Deadline.h"
+
+namespace {
+
+using utils::Deadline;
+
+TEST(DeadlineTest, NoCurrentDeadlineNeverExpires) {
+    EXPECT_EQ(Deadline::current(), nullptr);
+    EXPECT_FALSE(Deadline::currentExpired());
+    auto at = Deadline::Clock::now() + std::chrono::seconds(5);
+    EXPECT_EQ(Deadline::clamp(at), at);
+}
+
+TEST(DeadlineTest, ExpiresAfterItsBudgetAndClampsWaits) {
+    auto deadline = Deadline::after(std::chrono::milliseconds(20));
+    {
+        Deadline::Scope scope(deadline.get());
+        EXPECT_EQ(Deadline::current(), deadline.get());
+        EXPECT_FALSE(Deadline::currentExpired());
+        EXPECT_EQ(Deadline::clamp(Deadline::Clock::now() + std::chrono::seconds(10)),
+                  deadline->at());
+
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+        EXPECT_TRUE(Deadline::currentExpired());
+        EXPECT_FALSE(deadline->cancelled());
+    }
+    // スコープを抜けると元に戻る
+    EXPECT_EQ(Deadline::current(), nullptr);
+}
+
+TEST(DeadlineTest, CancelCheckIsPolledUntilItFires) {
+    std::atomic<bool> disconnected{false};
+    int polls = 0;
+    auto deadline = Deadline::after(std::chrono::seconds(10));
+    deadline->setCancelCheck([&]() {
+        polls++;
+        return disconnected.load();
+    });
+
+    EXPECT_FALSE(deadline->expired());
+    disconnected = true;
+    EXPECT_TRUE(deadline->expired());
+    EXPECT_TRUE(deadline->cancelled());
+    // 一度取り消されたら、それ以降は問い合わせない
+    int pollsAfterCancel = polls;
+    EXPECT_TRUE(deadline->expired());
+    EXPECT_EQ(polls, pollsAfterCancel);
+
+    Deadline::Scope scope(deadline.get());
+    auto clamped = Deadline::clamp(Deadline::Clock::now() + std::chrono::seconds(5));
+    EXPECT_LE(clamped, Deadline::Clock::now());
+}
+
+}  // namespace
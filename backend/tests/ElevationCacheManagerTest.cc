@@ -1,13 +1,16 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <cstdint>
+#include <cstdio>
 #include <optional>
 #include <string>
 #include <vector>
 
 #include "../services/Coordinate.h"
 #include "../services/elevation/ElevationCacheManager.h"
+#include "../services/elevation/GSIElevationProvider.h"
 #include "../services/elevation/IElevationCacheRepository.h"
 #include "../services/elevation/IElevationProvider.h"
 #include "../services/elevation/SmartRefreshService.h"
@@ -19,12 +22,21 @@ using namespace testing;
 class MockRepository : public IElevationCacheRepository {
    public:
     MOCK_METHOD(std::optional<ElevationCacheEntry>, getTile, (int z, int x, int y), (override));
-    MOCK_METHOD(bool, saveTile, (int z, int x, int y, const std::string& content), (override));
+    MOCK_METHOD(bool, saveTile,
+                (int z, int x, int y, const std::string& content, const std::string& source),
+                (override));
     MOCK_METHOD(void, incrementAccessScore, (int z, int x, int y), (override));
     MOCK_METHOD(void, addToRefreshQueue, (int z, int x, int y), (override));
+    MOCK_METHOD(void, addToRefreshQueueBatch, (const std::vector<std::string>& tileKeys),
+                (override));
     MOCK_METHOD(std::optional<std::string>, popRefreshQueue, (), (override));
+    MOCK_METHOD(size_t, getRefreshQueueSize, (), (override));
     MOCK_METHOD(void, decayScores, (double factor), (override));
     MOCK_METHOD(double, getAccessScore, (int z, int x, int y), (override));
+    MOCK_METHOD(std::vector<std::string>, getTopRankedTiles, (size_t limit, double minScore),
+                (override));
+    MOCK_METHOD(std::vector<std::optional<uint64_t>>, getUpdatedAtBatch,
+                (const std::vector<std::string>& tileKeys), (override));
 };
 
 class MockProvider : public IElevationProvider {
@@ -57,7 +69,7 @@ TEST(ElevationCacheManagerTest, L1CacheHit) {
 
     // Expect L2 getTile to be called once
     EXPECT_CALL(*mockRepo, getTile(15, 0, 0))
-        .WillOnce(Return(ElevationCacheEntry{csvContent, 123456789}));
+        .WillOnce(Return(ElevationCacheEntry{csvContent, 123456789, "dem"}));
 
     // First call: L2 Hit -> L1 Populated
     auto result1 = manager.getTile(15, 0, 0);
@@ -87,10 +99,209 @@ TEST(ElevationCacheManagerTest, L2CacheHit) {
 
     EXPECT_CALL(*mockRepo, getTile(15, 100, 100))
         .Times(1)
-        .WillOnce(Return(ElevationCacheEntry{csvContent, 123456789}));
+        .WillOnce(Return(ElevationCacheEntry{csvContent, 123456789, "dem"}));
 
     // Call
     auto result = manager.getTile(15, 100, 100);
     ASSERT_NE(result, nullptr);
     EXPECT_EQ((*result)[0], 5.0);
 }
+
+namespace {
+
+std::string makeCsvTile(const std::string& value) {
+    std::string csvContent;
+    for (int i = 0; i < 256 * 256; ++i) {
+        if (i > 0) csvContent += ",";
+        csvContent += value;
+    }
+    return csvContent;
+}
+
+}  // namespace
+
+TEST(ElevationCacheManagerTest, GetElevationsSyncFetchesEachTileOnce) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    ElevationCacheManager manager(mockRepo, mockProvider, nullptr);
+
+    // 東京駅付近の 2 点は同じタイル、お台場は別のタイル
+    std::vector<services::Coordinate> path{{35.681236, 139.767125},
+                                           {35.681300, 139.767200},
+                                           {35.629000, 139.776000},
+                                           {35.681236, 139.767125}};
+    auto tokyo = GSIElevationProvider::calculateTileCoord(path[0]);
+    auto odaiba = GSIElevationProvider::calculateTileCoord(path[2]);
+    ASSERT_FALSE(GSIElevationProvider::sameTile(tokyo, odaiba));
+
+    EXPECT_CALL(*mockRepo, getTile(tokyo.z, tokyo.x, tokyo.y))
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("3.0"), 123456789, "dem"}));
+    EXPECT_CALL(*mockRepo, getTile(odaiba.z, odaiba.x, odaiba.y))
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("7.0"), 123456789, "dem"}));
+    EXPECT_CALL(*mockProvider, getElevationSync(_)).Times(0);
+
+    auto elevations = manager.getElevationsSync(path);
+    ASSERT_EQ(elevations.size(), path.size());
+    EXPECT_EQ(elevations[0], 3.0);
+    EXPECT_EQ(elevations[1], 3.0);
+    EXPECT_EQ(elevations[2], 7.0);
+    // 最初のタイルに戻った地点は L1 から引く
+    EXPECT_EQ(elevations[3], 3.0);
+}
+
+TEST(ElevationCacheManagerTest, GetElevationsSyncE7ReadsCompactPathLanes) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    ElevationCacheManager manager(mockRepo, mockProvider, nullptr);
+
+    services::CompactPath path = {{35.681236, 139.767125}, {35.629000, 139.776000}};
+    auto tokyo = GSIElevationProvider::calculateTileCoord(path[0]);
+    auto odaiba = GSIElevationProvider::calculateTileCoord(path[1]);
+
+    EXPECT_CALL(*mockRepo, getTile(tokyo.z, tokyo.x, tokyo.y))
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("3.0"), 123456789, "dem"}));
+    EXPECT_CALL(*mockRepo, getTile(odaiba.z, odaiba.x, odaiba.y))
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("7.0"), 123456789, "dem"}));
+
+    auto elevations = manager.getElevationsSyncE7(path.latsE7(), path.lonsE7());
+    ASSERT_EQ(elevations.size(), 2u);
+    EXPECT_EQ(elevations[0], 3.0);
+    EXPECT_EQ(elevations[1], 7.0);
+}
+
+TEST(ElevationCacheManagerTest, StatsCountLookupsPerLevel) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    ElevationCacheManager manager(mockRepo, mockProvider, nullptr, 10);
+
+    EXPECT_CALL(*mockRepo, getTile(15, 1, 1))
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("1.0"), 123456789, "dem"}));
+    // L2 にもなく、GSI プロバイダーでもないので取得できない
+    EXPECT_CALL(*mockRepo, getTile(15, 2, 2)).WillOnce(Return(std::nullopt));
+
+    manager.getTile(15, 1, 1);  // L1 miss -> L2 hit
+    manager.getTile(15, 1, 1);  // L1 hit
+    EXPECT_EQ(manager.getTile(15, 2, 2), nullptr);
+
+    auto stats = manager.getStats();
+    EXPECT_EQ(stats.l1Hits, 1u);
+    EXPECT_EQ(stats.l1Misses, 2u);
+    EXPECT_EQ(stats.l2Hits, 1u);
+    EXPECT_EQ(stats.l2Misses, 1u);
+    EXPECT_EQ(stats.gsiFetches, 0u);
+    EXPECT_EQ(stats.l1Size, 1u);
+    EXPECT_EQ(stats.l1Capacity, 10u);
+    EXPECT_EQ(manager.l2Latency().snapshot().count, 2u);
+}
+
+TEST(ElevationCacheManagerTest, WarmUpLoadsTopRankedTilesFromL2) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    auto refreshService = std::make_shared<SmartRefreshService>(mockRepo, mockProvider);
+
+    ElevationCacheManager manager(mockRepo, mockProvider, refreshService);
+
+    EXPECT_CALL(*mockRepo, getTopRankedTiles(2, 0.0))
+        .WillOnce(Return(std::vector<std::string>{"15:1:1", "15:2:2"}));
+    EXPECT_CALL(*mockRepo, getTile(15, 1, 1))
+        .Times(1)
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("1.0"), 123456789, "dem"}));
+    EXPECT_CALL(*mockRepo, getTile(15, 2, 2))
+        .Times(1)
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("2.0"), 123456789, "dem"}));
+    // Warm-up must never go to GSI
+    EXPECT_CALL(*mockProvider, getElevationSync(_)).Times(0);
+
+    auto stats = manager.warmUp("", 2, 2, std::chrono::seconds(10));
+    EXPECT_EQ(stats.fromSnapshot, 0u);
+    EXPECT_EQ(stats.fromRanking, 2u);
+    EXPECT_EQ(manager.l1Size(), 2u);
+
+    // Served from L1: getTile on the repository is not called again
+    auto result = manager.getTile(15, 2, 2);
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ((*result)[0], 2.0);
+}
+
+TEST(ElevationCacheManagerTest, WarmUpWithExpiredBudgetLoadsNothing) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    auto refreshService = std::make_shared<SmartRefreshService>(mockRepo, mockProvider);
+
+    ElevationCacheManager manager(mockRepo, mockProvider, refreshService);
+
+    EXPECT_CALL(*mockRepo, getTopRankedTiles(_, _)).Times(0);
+    EXPECT_CALL(*mockRepo, getTile(_, _, _)).Times(0);
+
+    auto stats = manager.warmUp("", 100, 4, std::chrono::milliseconds(0));
+    EXPECT_EQ(stats.fromRanking, 0u);
+    EXPECT_TRUE(stats.budgetExhausted);
+    EXPECT_EQ(manager.l1Size(), 0u);
+}
+
+TEST(ElevationCacheManagerTest, SnapshotRoundTrip) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    auto refreshService = std::make_shared<SmartRefreshService>(mockRepo, mockProvider);
+    std::string path = ::testing::TempDir() + "elevation_l1_snapshot.bin";
+
+    {
+        ElevationCacheManager manager(mockRepo, mockProvider, refreshService);
+        EXPECT_CALL(*mockRepo, getTile(15, 10, 20))
+            .WillOnce(Return(ElevationCacheEntry{makeCsvTile("7.5"), 123456789, "dem"}));
+        ASSERT_NE(manager.getTile(15, 10, 20), nullptr);
+        EXPECT_EQ(manager.saveSnapshot(path), 1u);
+    }
+
+    ElevationCacheManager restored(mockRepo, mockProvider, refreshService);
+    EXPECT_CALL(*mockRepo, getTopRankedTiles(_, _)).WillOnce(Return(std::vector<std::string>{}));
+    EXPECT_CALL(*mockRepo, getTile(_, _, _)).Times(0);
+
+    auto stats = restored.warmUp(path, 10, 1, std::chrono::seconds(10));
+    EXPECT_EQ(stats.fromSnapshot, 1u);
+
+    auto result = restored.getTile(15, 10, 20);
+    ASSERT_NE(result, nullptr);
+    EXPECT_EQ((*result)[256 * 256 - 1], 7.5);
+
+    std::remove(path.c_str());
+}
+
+TEST(ElevationCacheManagerTest, WarmUpFillsOnlyUpToTopNAndKeepsSnapshotTiles) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    auto refreshService = std::make_shared<SmartRefreshService>(mockRepo, mockProvider);
+    std::string path = ::testing::TempDir() + "elevation_l1_snapshot_topn.bin";
+
+    {
+        ElevationCacheManager manager(mockRepo, mockProvider, refreshService, 3);
+        EXPECT_CALL(*mockRepo, getTile(15, 2, 2))
+            .WillOnce(Return(ElevationCacheEntry{makeCsvTile("2.0"), 123456789, "dem"}));
+        EXPECT_CALL(*mockRepo, getTile(15, 1, 1))
+            .WillOnce(Return(ElevationCacheEntry{makeCsvTile("1.0"), 123456789, "dem"}));
+        ASSERT_NE(manager.getTile(15, 2, 2), nullptr);
+        ASSERT_NE(manager.getTile(15, 1, 1), nullptr);
+        EXPECT_EQ(manager.saveSnapshot(path), 2u);
+    }
+    Mock::VerifyAndClearExpectations(mockRepo.get());
+
+    // L1 holds 2 snapshot tiles, so only one ranked tile fits. Checking 15:2:2 must not
+    // promote it, otherwise 15:1:1 would become the eviction candidate.
+    ElevationCacheManager restored(mockRepo, mockProvider, refreshService, 3);
+    EXPECT_CALL(*mockRepo, getTopRankedTiles(3, 0.0))
+        .WillOnce(Return(std::vector<std::string>{"15:2:2", "15:5:5", "15:6:6"}));
+    EXPECT_CALL(*mockRepo, getTile(15, 5, 5))
+        .WillOnce(Return(ElevationCacheEntry{makeCsvTile("5.0"), 123456789, "dem"}));
+    EXPECT_CALL(*mockRepo, getTile(15, 6, 6)).Times(0);
+    EXPECT_CALL(*mockRepo, getTile(15, 1, 1)).Times(0);
+    EXPECT_CALL(*mockRepo, getTile(15, 2, 2)).Times(0);
+
+    auto stats = restored.warmUp(path, 3, 2, std::chrono::seconds(10));
+    EXPECT_EQ(stats.fromSnapshot, 2u);
+    EXPECT_EQ(stats.fromRanking, 1u);
+    EXPECT_EQ(restored.l1Size(), 3u);
+    ASSERT_NE(restored.getTile(15, 1, 1), nullptr);
+    ASSERT_NE(restored.getTile(15, 2, 2), nullptr);
+
+    std::remove(path.c_str());
+}
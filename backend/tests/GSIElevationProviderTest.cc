@@ -1,6 +1,12 @@
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <functional>
 #include <sstream>
+#include <string>
+#include <vector>
 
 #include "../services/elevation/GSIElevationProvider.h"
 
@@ -12,7 +18,12 @@ class GSIElevationProviderTest : public ::testing::Test {
     class TestableGSIElevationProvider : public GSIElevationProvider {
        public:
         using GSIElevationProvider::calculateTileCoord;
+        using GSIElevationProvider::circuitBreaker_;
+        using GSIElevationProvider::classifyResponse;
+        using GSIElevationProvider::FetchOutcome;
+        using GSIElevationProvider::isKnownUnavailable;
         using GSIElevationProvider::parseTileText;
+        using GSIElevationProvider::rememberUnavailable;
     };
 
     TestableGSIElevationProvider provider_;
@@ -33,6 +44,101 @@ TEST_F(GSIElevationProviderTest, CalculateTileCoord) {
     EXPECT_LE(tc.pixel_y, 255);
 }
 
+TEST_F(GSIElevationProviderTest, CalculateTileCoordsKnownValues) {
+    using TileCoord = GSIElevationProvider::TileCoord;
+    auto expectTile = [](const TileCoord& tc, TileCoord expected) {
+        EXPECT_EQ(tc.z, expected.z);
+        EXPECT_EQ(tc.x, expected.x);
+        EXPECT_EQ(tc.y, expected.y);
+        EXPECT_EQ(tc.pixel_x, expected.pixel_x);
+        EXPECT_EQ(tc.pixel_y, expected.pixel_y);
+    };
+
+    // 期待値は Web メルカトルの式 (asinh(tan(lat))) から求めたもの
+    std::vector<services::Coordinate> coords{
+        {35.681236, 139.767125},    // 東京駅
+        {35.3606, 138.7274},        // 富士山
+        {43.068661, 141.350755},    // 札幌
+        {26.2124, 127.6809},        // 那覇
+        {-33.8688197, 151.2092955}  // シドニー (南半球)
+    };
+    auto batch = GSIElevationProvider::calculateTileCoords(coords, 15);
+    ASSERT_EQ(batch.size(), coords.size());
+    expectTile(batch[0], {15, 29105, 12903, 234, 81});
+    expectTile(batch[1], {15, 29011, 12939, 70, 45});
+    expectTile(batch[2], {15, 29250, 12032, 15, 7});
+    expectTile(batch[3], {15, 28005, 13910, 204, 56});
+    expectTile(batch[4], {15, 30147, 19663, 103, 211});
+
+    // ズームごとの表
+    expectTile(provider_.calculateTileCoord(coords[0], 14), {14, 14552, 6451, 245, 168});
+    expectTile(provider_.calculateTileCoord(coords[0], 10), {10, 909, 403, 143, 58});
+
+    // 固定小数点のレーンから求めても同じ
+    std::vector<int32_t> lats{356812360};
+    std::vector<int32_t> lons{1397671250};
+    TileCoord fromLanes{};
+    GSIElevationProvider::calculateTileCoords(lats, lons, std::span<TileCoord>(&fromLanes, 1));
+    expectTile(fromLanes, {15, 29105, 12903, 234, 81});
+
+    EXPECT_TRUE(GSIElevationProvider::calculateTileCoords({}).empty());
+}
+
+TEST_F(GSIElevationProviderTest, CalculateTileCoordsAtTileBoundaries) {
+    using TileCoord = GSIElevationProvider::TileCoord;
+    auto tileAt = [this](double lat, double lon) {
+        return provider_.calculateTileCoord({lat, lon}, 15);
+    };
+    auto expectTile = [](const TileCoord& tc, int x, int y, int pixelX, int pixelY) {
+        EXPECT_EQ(tc.x, x);
+        EXPECT_EQ(tc.y, y);
+        EXPECT_EQ(tc.pixel_x, pixelX);
+        EXPECT_EQ(tc.pixel_y, pixelY);
+    };
+
+    // 赤道と本初子午線はタイルの境界に一致する
+    expectTile(tileAt(0.0, 0.0), 16384, 16384, 0, 0);
+    expectTile(tileAt(0.000001, 0.0), 16384, 16383, 0, 255);
+    expectTile(tileAt(0.0, -0.000001), 16383, 16384, 255, 0);
+    expectTile(tileAt(0.0, -180.0), 0, 16384, 0, 0);
+
+    // 東京駅の 1 行南のタイルの上端 (35.6751474 度) をまたぐ
+    expectTile(tileAt(35.675148, 139.767125), 29105, 12903, 234, 255);
+    expectTile(tileAt(35.675146, 139.767125), 29105, 12904, 234, 0);
+
+    // 経路のように同じ行が続いた後で遠い行に飛んでも、前の行に引きずられない
+    std::vector<services::Coordinate> jump{
+        {35.681236, 139.767125}, {35.681300, 139.767200}, {43.068661, 141.350755}};
+    auto batch = GSIElevationProvider::calculateTileCoords(jump, 15);
+    EXPECT_EQ(batch[1].y, 12903);
+    EXPECT_EQ(batch[2].y, 12032);
+}
+
+TEST_F(GSIElevationProviderTest, CalculateTileCoordsAgreesWithTheFormula) {
+    // 表と線形補間による結果を、asinh(tan(lat)) で直接求めた値と日本周辺で比べる
+    // (境界の 1e-7 度の丸め分だけピクセルが 1 ずれることは許す)
+    std::vector<services::Coordinate> coords;
+    for (double lat = 24.0; lat <= 46.0; lat += 0.0371) {
+        for (double lon = 122.0; lon <= 154.0; lon += 0.413) {
+            coords.push_back({lat, lon});
+        }
+    }
+    for (int zoom : {10, 14, 15}) {
+        auto batch = GSIElevationProvider::calculateTileCoords(coords, zoom);
+        double n = std::ldexp(1.0, zoom);
+        for (size_t i = 0; i < coords.size(); ++i) {
+            double x = (coords[i].lon + 180.0) / 360.0 * n;
+            double latRad = coords[i].lat * M_PI / 180.0;
+            double y = (1.0 - std::asinh(std::tan(latRad)) / M_PI) / 2.0 * n;
+            double pixelY = (y - std::floor(y)) * 256.0;
+            ASSERT_EQ(batch[i].x, static_cast<int>(x)) << coords[i].lat << "," << coords[i].lon;
+            ASSERT_EQ(batch[i].y, static_cast<int>(y)) << coords[i].lat << "," << coords[i].lon;
+            EXPECT_NEAR(batch[i].pixel_x, static_cast<int>((x - std::floor(x)) * 256.0), 1);
+            EXPECT_NEAR(batch[i].pixel_y, static_cast<int>(pixelY), 1);
+        }
+    }
+}
+
 TEST_F(GSIElevationProviderTest, ParseTileText_Valid) {
     // 2x2 のダミーデータ（実際は256x256が必要だが、parseTileTextのバリデーションに合わせて調整）
     std::stringstream ss;
@@ -70,3 +176,164 @@ TEST_F(GSIElevationProviderTest, ParseTileText_WithInvalidValues) {
     EXPECT_DOUBLE_EQ(data->elevations[0], 0.0);  // 'e' は 0.0
     EXPECT_DOUBLE_EQ(data->elevations[1], 10.5);
 }
+
+TEST_F(GSIElevationProviderTest, ClassifyResponse) {
+    using Outcome = TestableGSIElevationProvider::FetchOutcome;
+    auto withStatus = [](drogon::HttpStatusCode code) {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(code);
+        return resp;
+    };
+
+    EXPECT_EQ(provider_.classifyResponse(drogon::ReqResult::Ok, withStatus(drogon::k200OK)),
+              Outcome::Ok);
+    EXPECT_EQ(provider_.classifyResponse(drogon::ReqResult::Ok, withStatus(drogon::k404NotFound)),
+              Outcome::Missing);
+    EXPECT_EQ(provider_.classifyResponse(drogon::ReqResult::Ok,
+                                         withStatus(drogon::k503ServiceUnavailable)),
+              Outcome::Failed);
+    EXPECT_EQ(provider_.classifyResponse(drogon::ReqResult::Timeout, nullptr), Outcome::Failed);
+}
+
+TEST_F(GSIElevationProviderTest, NegativeCacheFailsFast) {
+    using Outcome = TestableGSIElevationProvider::FetchOutcome;
+    provider_.rememberUnavailable("dem5a", "15/1/1", Outcome::Missing);
+    EXPECT_TRUE(provider_.isKnownUnavailable("dem5a", "15/1/1"));
+    // ソースごとに管理される
+    EXPECT_FALSE(provider_.isKnownUnavailable("dem", "15/1/1"));
+    EXPECT_FALSE(provider_.isKnownUnavailable("dem5a", "15/1/2"));
+
+    provider_.rememberUnavailable("dem", "15/1/1", Outcome::Failed);
+
+    bool called = false;
+    provider_.fetchTile(15, 1, 1, [&called](std::shared_ptr<GSIElevationProvider::TileData> data) {
+        EXPECT_EQ(data, nullptr);
+        called = true;
+    });
+    // 全ソースで既知の欠損タイルは HTTP を送らずに同期的に失敗する
+    EXPECT_TRUE(called);
+}
+
+TEST_F(GSIElevationProviderTest, NegativeCacheCanIgnoreFailures) {
+    using Outcome = TestableGSIElevationProvider::FetchOutcome;
+    provider_.rememberUnavailable("dem5a", "15/3/3", Outcome::Missing);
+    provider_.rememberUnavailable("dem", "15/3/3", Outcome::Failed);
+
+    // 再試行する呼び出し元には失敗を隠さないが、欠損タイルは引き続き飛ばす
+    EXPECT_TRUE(provider_.isKnownUnavailable("dem5a", "15/3/3", true));
+    EXPECT_FALSE(provider_.isKnownUnavailable("dem", "15/3/3", true));
+    EXPECT_TRUE(provider_.isKnownUnavailable("dem", "15/3/3"));
+}
+
+namespace {
+
+// 要求とヘッジを記録するだけで、応答はテストから返す
+class ManualGSIElevationProvider : public GSIElevationProvider {
+   public:
+    struct Request {
+        std::string path;
+        drogon::HttpReqCallback callback;
+    };
+    std::vector<Request> requests;
+    std::vector<std::function<void()>> hedges;
+
+    static void respond(Request& request, drogon::HttpStatusCode status, double elevation = 0) {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        resp->setStatusCode(status);
+        if (status == drogon::k200OK) {
+            std::string body;
+            for (int row = 0; row < 256; ++row) {
+                for (int col = 0; col < 256; ++col) {
+                    body += col == 0 ? "" : ",";
+                    body += std::to_string(elevation);
+                }
+                body += "\n";
+            }
+            resp->setBody(body);
+        }
+        request.callback(drogon::ReqResult::Ok, resp);
+    }
+
+   protected:
+    void sendTileRequest(const std::string& path, double,
+                         drogon::HttpReqCallback&& callback) override {
+        requests.push_back({path, std::move(callback)});
+    }
+    void scheduleHedge(double, std::function<void()> fn) override {
+        hedges.push_back(std::move(fn));
+    }
+};
+
+}  // namespace
+
+TEST(GSIElevationProviderHedgeTest, SlowDem5aIsHedgedWithDem) {
+    ManualGSIElevationProvider provider;
+    std::shared_ptr<GSIElevationProvider::TileData> served;
+    int calls = 0;
+    provider.fetchTile(15, 29105, 12903, [&](std::shared_ptr<GSIElevationProvider::TileData> data) {
+        served = std::move(data);
+        calls++;
+    });
+    ASSERT_EQ(provider.requests.size(), 1u);
+    EXPECT_NE(provider.requests[0].path.find("/dem5a/"), std::string::npos);
+
+    // DEM5A が応答しないままヘッジ遅延が過ぎたら、DEM も引く
+    ASSERT_EQ(provider.hedges.size(), 1u);
+    provider.hedges[0]();
+    ASSERT_EQ(provider.requests.size(), 2u);
+    EXPECT_NE(provider.requests[1].path.find("/dem/"), std::string::npos);
+
+    // 先に届いた DEM のタイルを返す (DEM5A のタイムアウトを待たない)
+    ManualGSIElevationProvider::respond(provider.requests[1], drogon::k200OK, 12.5);
+    ASSERT_EQ(calls, 1);
+    ASSERT_NE(served, nullptr);
+    EXPECT_EQ(served->source, "dem");
+
+    // 遅れて届いた DEM5A はキャッシュだけを置き換え、コールバックは呼ばない
+    ManualGSIElevationProvider::respond(provider.requests[0], drogon::k200OK, 20.0);
+    EXPECT_EQ(calls, 1);
+    auto elevation = provider.getElevationSync({35.681236, 139.767125});
+    ASSERT_TRUE(elevation.has_value());
+    EXPECT_DOUBLE_EQ(*elevation, 20.0);
+}
+
+TEST(GSIElevationProviderHedgeTest, MissingDem5aFallsBackWithoutWaitingForTheHedge) {
+    ManualGSIElevationProvider provider;
+    std::shared_ptr<GSIElevationProvider::TileData> served;
+    int calls = 0;
+    provider.fetchTile(15, 1, 1, [&](std::shared_ptr<GSIElevationProvider::TileData> data) {
+        served = std::move(data);
+        calls++;
+    });
+    ASSERT_EQ(provider.requests.size(), 1u);
+
+    // 欠損ならすぐに DEM を引き、後から来たヘッジでは重ねて要求しない
+    ManualGSIElevationProvider::respond(provider.requests[0], drogon::k404NotFound);
+    ASSERT_EQ(provider.requests.size(), 2u);
+    for (auto& hedge : provider.hedges) hedge();
+    EXPECT_EQ(provider.requests.size(), 2u);
+    EXPECT_EQ(calls, 0);
+
+    // 全ソースが失敗したら一度だけ nullptr を返す
+    ManualGSIElevationProvider::respond(provider.requests[1], drogon::k503ServiceUnavailable);
+    EXPECT_EQ(calls, 1);
+    EXPECT_EQ(served, nullptr);
+}
+
+TEST_F(GSIElevationProviderTest, OpenCircuitFailsFast) {
+    cycling::utils::CircuitBreaker::Options options;
+    options.windowSize = 2;
+    options.minimumCalls = 2;
+    options.openDuration = std::chrono::minutes(1);
+    provider_.setCircuitBreakerOptions(options);
+    provider_.circuitBreaker_.recordFailure();
+    provider_.circuitBreaker_.recordFailure();
+
+    bool called = false;
+    provider_.fetchTile(15, 2, 2, [&called](std::shared_ptr<GSIElevationProvider::TileData> data) {
+        EXPECT_EQ(data, nullptr);
+        called = true;
+    });
+    EXPECT_TRUE(called);
+    EXPECT_EQ(provider_.getElevationSync({35.0, 139.0}), std::nullopt);
+}
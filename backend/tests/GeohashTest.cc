@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include "../utils/Geohash.h"
+
+using namespace utils;
+
+TEST(GeohashTest, EncodesKnownValues) {
+    // 東京駅付近
+    EXPECT_EQ(Geohash::encode({35.681236, 139.767125}, 7), "xn76urx");
+    EXPECT_EQ(Geohash::encode({57.64911, 10.40744}, 11), "u4pruydqqvj");
+}
+
+TEST(GeohashTest, DecodeContainsOriginalPoint) {
+    services::Coordinate tokyo{35.681236, 139.767125};
+    for (int precision = 1; precision <= 12; ++precision) {
+        auto cell = Geohash::decode(Geohash::encode(tokyo, precision));
+        EXPECT_LE(cell.minLat, tokyo.lat);
+        EXPECT_GE(cell.maxLat, tokyo.lat);
+        EXPECT_LE(cell.minLon, tokyo.lon);
+        EXPECT_GE(cell.maxLon, tokyo.lon);
+    }
+}
+
+TEST(GeohashTest, NeighbouringPointsShareCell) {
+    // 数十メートル離れた 2 点は精度 6 (約 1.2km x 0.6km) で同じセルになる
+    auto a = Geohash::encode({35.6812, 139.7671}, 6);
+    auto b = Geohash::encode({35.6815, 139.7675}, 6);
+    EXPECT_EQ(a, b);
+
+    auto center = Geohash::decode(a).center();
+    EXPECT_EQ(Geohash::encode(center, 6), a);
+}
+
+TEST(GeohashTest, PrecisionForMaxCellSize) {
+    EXPECT_EQ(Geohash::precisionForMaxCellSize(500.0), 7);
+    EXPECT_EQ(Geohash::precisionForMaxCellSize(1500.0), 6);
+    EXPECT_EQ(Geohash::precisionForMaxCellSize(10000.0), 5);
+    EXPECT_EQ(Geohash::precisionForMaxCellSize(0.0), 12);
+}
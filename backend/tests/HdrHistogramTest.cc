@@ -0,0 +1,43 @@
+#include <gtest/gtest.h>
+
+#include "../tools/load/HdrHistogram.h"
+
+using tools::load::HdrHistogram;
+
+TEST(HdrHistogramTest, PercentilesKeepSignificantDigits) {
+    HdrHistogram histogram(1, 60'000'000, 3);
+    for (int64_t value = 1; value <= 10000; ++value) {
+        histogram.record(value * 100);  // 100us〜1s
+    }
+    EXPECT_EQ(histogram.totalCount(), 10000);
+    EXPECT_EQ(histogram.min(), 100);
+    EXPECT_EQ(histogram.max(), 1'000'000);
+    EXPECT_NEAR(histogram.mean(), 500'050.0, 1e-6);
+
+    // 有効桁数 3 なので相対誤差は 0.1% 以内
+    EXPECT_NEAR(histogram.valueAtPercentile(50.0), 500'000, 500);
+    EXPECT_NEAR(histogram.valueAtPercentile(99.0), 990'000, 990);
+    EXPECT_NEAR(histogram.valueAtPercentile(99.9), 999'000, 999);
+    EXPECT_EQ(histogram.valueAtPercentile(100.0), 1'000'000);
+}
+
+TEST(HdrHistogramTest, SmallValuesAreExact) {
+    HdrHistogram histogram(1, 1'000'000, 3);
+    for (int64_t value = 0; value < 2000; ++value) {
+        histogram.record(value);
+    }
+    EXPECT_EQ(histogram.valueAtPercentile(50.0), 999);
+    EXPECT_EQ(histogram.valueAtPercentile(0.0), 0);
+}
+
+TEST(HdrHistogramTest, MergeCombinesCountsAndClampsOutOfRange) {
+    HdrHistogram a(1, 10'000, 3);
+    HdrHistogram b(1, 10'000, 3);
+    a.record(10);
+    b.record(20);
+    b.record(1'000'000);  // 上限を超える値は上限として記録
+    a.merge(b);
+    EXPECT_EQ(a.totalCount(), 3);
+    EXPECT_EQ(a.min(), 10);
+    EXPECT_EQ(a.max(), 10'000);
+}
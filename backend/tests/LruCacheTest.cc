@@ -57,6 +57,38 @@ TEST(LruCacheTest, EmptyGet) {
     EXPECT_FALSE(cache.get("non-existent").has_value());
 }
 
+TEST(LruCacheTest, SnapshotIsMostRecentFirst) {
+    cycling::utils::LruCache<std::string, int> cache(3);
+    cache.put("a", 1);
+    cache.put("b", 2);
+    cache.put("c", 3);
+    cache.get("a");
+
+    auto items = cache.snapshot();
+    ASSERT_EQ(items.size(), 3);
+    EXPECT_EQ(items[0].first, "a");
+    EXPECT_EQ(items[1].first, "c");
+    EXPECT_EQ(items[2].first, "b");
+
+    // Taking a snapshot must not touch the access order
+    cache.put("d", 4);
+    EXPECT_FALSE(cache.get("b").has_value());
+}
+
+TEST(LruCacheTest, ContainsDoesNotChangeAccessOrder) {
+    cycling::utils::LruCache<std::string, int> cache(2);
+    cache.put("a", 1);
+    cache.put("b", 2);
+
+    EXPECT_TRUE(cache.contains("a"));
+    EXPECT_FALSE(cache.contains("z"));
+
+    cache.put("c", 3);  // "a" is still the LRU entry and gets evicted
+    EXPECT_FALSE(cache.contains("a"));
+    EXPECT_TRUE(cache.contains("b"));
+    EXPECT_TRUE(cache.contains("c"));
+}
+
 TEST(LruCacheTest, ThreadSafety) {
     cycling::utils::LruCache<int, int> cache(100);
     const int num_threads = 10;
@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../services/MetricsExporter.h"
+#include "../utils/Histogram.h"
+
+using cycling::utils::Histogram;
+using services::MetricsExporter;
+
+TEST(HistogramTest, ObserveUsesInclusiveUpperBounds) {
+    Histogram histogram({0.1, 1.0});
+    histogram.observe(0.05);
+    histogram.observe(0.1);
+    histogram.observe(0.5);
+    histogram.observe(5.0);
+
+    auto snapshot = histogram.snapshot();
+    ASSERT_EQ(snapshot.counts.size(), 3u);
+    EXPECT_EQ(snapshot.counts[0], 2u);
+    EXPECT_EQ(snapshot.counts[1], 1u);
+    EXPECT_EQ(snapshot.counts[2], 1u);  // +Inf
+    EXPECT_EQ(snapshot.count, 4u);
+    EXPECT_DOUBLE_EQ(snapshot.sum, 5.65);
+}
+
+TEST(HistogramTest, ConcurrentObserveLosesNothing) {
+    Histogram histogram(Histogram::latencyBuckets());
+    constexpr int kThreads = 8;
+    constexpr int kPerThread = 10000;
+    std::vector<std::thread> threads;
+    for (int t = 0; t < kThreads; ++t) {
+        threads.emplace_back([&histogram, t]() {
+            for (int i = 0; i < kPerThread; ++i) {
+                histogram.observe(0.001 * (t + 1));
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    auto snapshot = histogram.snapshot();
+    EXPECT_EQ(snapshot.count, static_cast<uint64_t>(kThreads * kPerThread));
+    EXPECT_NEAR(snapshot.sum, 0.001 * kPerThread * (kThreads * (kThreads + 1) / 2), 1e-6);
+}
+
+TEST(MetricsExporterTest, RendersPrometheusTextFormat) {
+    Histogram histogram({0.5, 1.0});
+    histogram.observe(0.25);
+    histogram.observe(2.0);
+
+    MetricsExporter exporter;
+    exporter.addCounter("app_lookups_total", "Lookups", []() { return 3.0; }, "result=\"hit\"");
+    exporter.addGauge("app_queue_depth", "Queue depth", []() { return 7.0; });
+    exporter.addCounter("app_lookups_total", "Lookups", []() { return 1.0; }, "result=\"miss\"");
+    exporter.addHistogram("app_seconds", "Latency", histogram, "stage=\"osrm\"");
+
+    EXPECT_EQ(exporter.render(),
+              "# HELP app_lookups_total Lookups\n"
+              "# TYPE app_lookups_total counter\n"
+              "app_lookups_total{result=\"hit\"} 3\n"
+              "app_lookups_total{result=\"miss\"} 1\n"
+              "# HELP app_queue_depth Queue depth\n"
+              "# TYPE app_queue_depth gauge\n"
+              "app_queue_depth 7\n"
+              "# HELP app_seconds Latency\n"
+              "# TYPE app_seconds histogram\n"
+              "app_seconds_bucket{stage=\"osrm\",le=\"0.5\"} 1\n"
+              "app_seconds_bucket{stage=\"osrm\",le=\"1\"} 1\n"
+              "app_seconds_bucket{stage=\"osrm\",le=\"+Inf\"} 2\n"
+              "app_seconds_sum{stage=\"osrm\"} 2.25\n"
+              "app_seconds_count{stage=\"osrm\"} 2\n");
+}
@@ -1,7 +1,10 @@
 #include <gtest/gtest.h>
 
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <memory>
+#include <sstream>
 #include <osrm/engine_config.hpp>
 #include <osrm/json_container.hpp>
 #include <osrm/nearest_parameters.hpp>
@@ -9,6 +12,8 @@
 #include <osrm/route_parameters.hpp>
 
 #include "../services/RouteService.h"
+#include "../utils/PolylineDecoder.h"
+#include "../utils/PolylineSimplifier.h"
 
 // OSRM統合テスト
 // 実際のデータファイル（/data/kanto-latest.osrm）を使用して、
@@ -110,3 +115,64 @@ TEST_F(OSRMIntegrationTest, RouteCalculationTest) {
     std::cout << "Route Distance: " << distance << "m" << std::endl;
     EXPECT_GT(distance, 0.0);
 }
+
+// simulation_scenarios.csv のルートで、応答ジオメトリの間引きによるサイズ削減を計測する
+TEST_F(OSRMIntegrationTest, GeometrySimplificationPayload) {
+    if (!osrm_) return;
+
+    std::ifstream file;
+    for (const auto &path : {"tests/data/simulation_scenarios.csv",
+                             "backend/tests/data/simulation_scenarios.csv",
+                             "../tests/data/simulation_scenarios.csv"}) {
+        file.open(path);
+        if (file.is_open()) break;
+    }
+    if (!file.is_open()) {
+        GTEST_SKIP() << "simulation_scenarios.csv not found";
+    }
+
+    services::RouteService routeService(nullptr);
+    std::cout << std::left << std::setw(6) << "id" << std::setw(12) << "vertices" << std::setw(12)
+              << "full(B)" << std::setw(12) << "z14(B)" << std::setw(12) << "z11(B)"
+              << std::setw(12) << "overview(B)" << std::endl;
+
+    std::string line;
+    std::getline(file, line);  // header
+    while (std::getline(file, line)) {
+        std::stringstream ss(line);
+        std::vector<std::string> fields;
+        std::string field;
+        while (std::getline(ss, field, ',')) fields.push_back(field);
+        if (fields.size() < 10) continue;
+
+        services::Coordinate start{std::stod(fields[2]), std::stod(fields[3])};
+        services::Coordinate end{std::stod(fields[5]), std::stod(fields[6])};
+        double targetKm = std::stod(fields[7]);
+
+        auto waypoints = routeService.calculatePolygonDetourPoints(start, end, targetKm);
+        auto params = services::RouteService::buildRouteParameters(start, end, waypoints);
+        osrm::json::Object result;
+        if (osrm_->Route(params, result) != osrm::Status::Ok) continue;
+        auto route = routeService.processRoute(result);
+        ASSERT_TRUE(route.has_value());
+
+        auto path = utils::PolylineDecoder::decode(route->geometry,
+                                                   services::RouteService::kGeometryPrecision);
+        ASSERT_FALSE(path.empty());
+        auto encodedSize = [&](double toleranceMeters) {
+            return utils::PolylineDecoder::encode(
+                       utils::PolylineSimplifier::simplify(path, toleranceMeters))
+                .size();
+        };
+        size_t full = utils::PolylineDecoder::encode(path).size();
+        size_t zoom14 = encodedSize(utils::PolylineSimplifier::metersPerPixel(14, start.lat));
+        size_t zoom11 = encodedSize(utils::PolylineSimplifier::metersPerPixel(11, start.lat));
+        size_t overview = encodedSize(utils::PolylineSimplifier::overviewTolerance(path));
+
+        std::cout << std::left << std::setw(6) << fields[0] << std::setw(12) << path.size()
+                  << std::setw(12) << full << std::setw(12) << zoom14 << std::setw(12) << zoom11
+                  << std::setw(12) << overview << std::endl;
+        EXPECT_LE(zoom14, full);
+        EXPECT_LE(zoom11, zoom14);
+    }
+}
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <string>
+#include <vector>
+
+#include "../services/PlacesCache.h"
+
+using namespace services;
+
+namespace {
+
+std::vector<Spot> sampleSpots() {
+    return {{"Cycling Cafe Base", "cafe", 35.681236, 139.767125, 4.5},
+            {"Ramen Energy", "restaurant", 35.698383, 139.773072, 4.2}};
+}
+
+}  // namespace
+
+TEST(PlacesCacheTest, MakeKey) {
+    EXPECT_EQ(PlacesCache::makeKey("xn76urx", 650.4, "cafe|restaurant"),
+              "cycling:places:v1:xn76urx:650:cafe|restaurant");
+}
+
+TEST(PlacesCacheTest, InProcessHitAndMiss) {
+    PlacesCache cache(10, std::chrono::hours(1));
+    auto key = PlacesCache::makeKey("xn76urx", 500, "cafe");
+
+    EXPECT_FALSE(cache.get(key).has_value());
+    cache.put(key, sampleSpots());
+
+    auto cached = cache.get(key);
+    ASSERT_TRUE(cached.has_value());
+    ASSERT_EQ(cached->size(), 2u);
+    EXPECT_EQ((*cached)[1].name, "Ramen Energy");
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.l1Hits, 1u);
+    EXPECT_EQ(stats.l2Hits, 0u);
+    EXPECT_EQ(stats.misses, 1u);
+    EXPECT_DOUBLE_EQ(stats.hitRate(), 0.5);
+}
+
+TEST(PlacesCacheTest, GetManyKeepsKeyOrder) {
+    PlacesCache cache(10, std::chrono::hours(1));
+    auto hit = PlacesCache::makeKey("xn76urx", 500, "cafe");
+    auto miss = PlacesCache::makeKey("xn76ury", 500, "cafe");
+    cache.put(hit, sampleSpots());
+
+    auto results = cache.getMany({miss, hit, miss});
+    ASSERT_EQ(results.size(), 3u);
+    EXPECT_FALSE(results[0].has_value());
+    ASSERT_TRUE(results[1].has_value());
+    EXPECT_EQ(results[1]->size(), 2u);
+    EXPECT_FALSE(results[2].has_value());
+
+    auto stats = cache.getStats();
+    EXPECT_EQ(stats.l1Hits, 1u);
+    EXPECT_EQ(stats.misses, 2u);
+    EXPECT_TRUE(cache.getMany({}).empty());
+}
+
+TEST(PlacesCacheTest, SerializeRoundTrip) {
+    auto payload = PlacesCache::serialize(sampleSpots(), 2000);
+
+    uint64_t expiresAt = 0;
+    auto spots = PlacesCache::deserialize(payload, 1000, &expiresAt);
+    ASSERT_TRUE(spots.has_value());
+    EXPECT_EQ(expiresAt, 2000u);
+    ASSERT_EQ(spots->size(), 2u);
+    EXPECT_EQ((*spots)[0].name, "Cycling Cafe Base");
+    EXPECT_EQ((*spots)[0].type, "cafe");
+    EXPECT_DOUBLE_EQ((*spots)[0].lat, 35.681236);
+    EXPECT_DOUBLE_EQ((*spots)[1].rating, 4.2);
+}
+
+TEST(PlacesCacheTest, ExpiredOrInvalidPayloadIsRejected) {
+    auto payload = PlacesCache::serialize(sampleSpots(), 2000);
+    EXPECT_FALSE(PlacesCache::deserialize(payload, 2000).has_value());
+    EXPECT_FALSE(PlacesCache::deserialize("not json", 0).has_value());
+}
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <random>
+#include <vector>
+
 #include "../utils/PolylineDecoder.h"
 
 using namespace utils;
@@ -54,4 +57,48 @@ TEST(PolylineDecoderTest, HandlesTokyoPath) {
     // エンコードの手動チェックは複雑なので、機能するか生成された単純な文字列を使用しましょう。
     // 実際、以前のテストケースはアルゴリズムの正確性（デルタ、負の値など）をカバーしています。
     // 必要であれば、高精度な動作チェックを追加しますが、1e5が標準です。
-}
\ No newline at end of file
+}
+
+TEST(PolylineDecoderTest, CountPointsMatchesDecode) {
+    // SIMD 経路を通るよう 16 バイトを超える長さを含める
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> step(-0.01, 0.01);
+    std::vector<services::Coordinate> path;
+    services::Coordinate current{35.68, 139.76};
+    for (int i = 0; i < 257; ++i) {
+        path.push_back(current);
+        current.lat += step(rng);
+        current.lon += step(rng);
+    }
+    std::string encoded = PolylineDecoder::encode(path);
+
+    EXPECT_EQ(PolylineDecoder::countPoints(encoded), path.size());
+    EXPECT_EQ(PolylineDecoder::countPoints(""), 0u);
+    // 途中で切れた入力でも decode() と同じ数を返す
+    for (size_t len : {1u, 3u, 17u, 100u}) {
+        std::string truncated = encoded.substr(0, len);
+        EXPECT_EQ(PolylineDecoder::countPoints(truncated),
+                  PolylineDecoder::decode(truncated).size())
+            << "length " << len;
+    }
+
+    auto decoded = PolylineDecoder::decode(encoded);
+    ASSERT_EQ(decoded.size(), path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        EXPECT_NEAR(decoded[i].lat, path[i].lat, 1e-5);
+        EXPECT_NEAR(decoded[i].lon, path[i].lon, 1e-5);
+    }
+}
+
+TEST(PolylineDecoderTest, DecodeIntoStopsAtBufferSize) {
+    std::string encoded = "_p~iF~ps|U_ulLnnqC_mqNvxq`@";
+
+    std::vector<services::Coordinate> buffer(2);
+    ASSERT_EQ(PolylineDecoder::decodeInto(encoded, buffer), 2u);
+    EXPECT_NEAR(buffer[1].lat, 40.7, 1e-5);
+    EXPECT_NEAR(buffer[1].lon, -120.95, 1e-5);
+
+    std::vector<services::Coordinate> large(10);
+    EXPECT_EQ(PolylineDecoder::decodeInto(encoded, large), 3u);
+    EXPECT_NEAR(large[2].lat, 43.252, 1e-5);
+}
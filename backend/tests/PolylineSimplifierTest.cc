@@ -0,0 +1,55 @@
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <vector>
+
+#include "../utils/PolylineSimplifier.h"
+
+using namespace utils;
+using services::Coordinate;
+
+TEST(PolylineSimplifierTest, CollinearPointsCollapseToEndpoints) {
+    std::vector<Coordinate> path;
+    for (int i = 0; i <= 100; ++i) {
+        path.push_back({35.0 + i * 0.0001, 139.0 + i * 0.0001});
+    }
+    auto simplified = PolylineSimplifier::simplify(path, 1.0);
+
+    ASSERT_EQ(simplified.size(), 2u);
+    EXPECT_DOUBLE_EQ(simplified.front().lat, path.front().lat);
+    EXPECT_DOUBLE_EQ(simplified.back().lat, path.back().lat);
+}
+
+TEST(PolylineSimplifierTest, KeepsVerticesBeyondTolerance) {
+    // 中間点が直線から約 111m 北にずれている
+    std::vector<Coordinate> path{{35.0, 139.0}, {35.001, 139.005}, {35.0, 139.01}};
+
+    EXPECT_EQ(PolylineSimplifier::simplify(path, 50.0).size(), 3u);
+    EXPECT_EQ(PolylineSimplifier::simplify(path, 200.0).size(), 2u);
+    // 許容誤差 0 以下は間引かない
+    EXPECT_EQ(PolylineSimplifier::simplify(path, 0.0).size(), 3u);
+}
+
+TEST(PolylineSimplifierTest, SimplifiedPathStaysWithinTolerance) {
+    // ジグザグ (振幅約 20m) の線
+    std::vector<Coordinate> path;
+    for (int i = 0; i < 1000; ++i) {
+        path.push_back({35.0 + (i % 2) * 0.00018, 139.0 + i * 0.0005});
+    }
+    EXPECT_EQ(PolylineSimplifier::simplify(path, 5.0).size(), path.size());
+    EXPECT_EQ(PolylineSimplifier::simplify(path, 30.0).size(), 2u);
+}
+
+TEST(PolylineSimplifierTest, MetersPerPixel) {
+    EXPECT_NEAR(PolylineSimplifier::metersPerPixel(0, 0.0), 156543.03, 0.1);
+    EXPECT_NEAR(PolylineSimplifier::metersPerPixel(1, 0.0), 78271.52, 0.1);
+    EXPECT_NEAR(PolylineSimplifier::metersPerPixel(15, 60.0),
+                PolylineSimplifier::metersPerPixel(15, 0.0) / 2.0, 1e-6);
+}
+
+TEST(PolylineSimplifierTest, OverviewToleranceScalesWithExtent) {
+    // 南北約 110km のルートを 1024px で表示すると 1px あたり約 108m
+    std::vector<Coordinate> path{{35.0, 139.0}, {36.0, 139.0}};
+    EXPECT_NEAR(PolylineSimplifier::overviewTolerance(path), 110540.0 / 1024.0, 1e-6);
+    EXPECT_DOUBLE_EQ(PolylineSimplifier::overviewTolerance(std::vector<Coordinate>{}), 0.0);
+}
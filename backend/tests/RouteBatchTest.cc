@@ -0,0 +1,331 @@
+#include <gtest/gtest.h>
+#include <json/json.h>
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../services/RouteBatch.h"
+#include "../utils/Deadline.h"
+
+using namespace services;
+
+namespace {
+
+RouteResult makeResult(double distance) {
+    RouteResult result;
+    result.distance_m = distance;
+    result.duration_s = distance / 5.0;
+    result.elevation_gain_m = 0.0;
+    return result;
+}
+
+Json::Value parseLine(const std::string& line) {
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    Json::Value value;
+    std::string errors;
+    EXPECT_TRUE(reader->parse(line.data(), line.data() + line.size(), &value, &errors)) << line;
+    return value;
+}
+
+Json::Value request(double lat, const std::string& id = "") {
+    Json::Value value;
+    if (!id.empty()) value["id"] = id;
+    value["start_point"]["lat"] = lat;
+    value["start_point"]["lon"] = 139.0;
+    value["end_point"]["lat"] = lat + 0.1;
+    value["end_point"]["lon"] = 139.1;
+    return value;
+}
+
+// 出力された行を集め、done() を待てるようにする
+struct Collector {
+    std::mutex mutex;
+    std::vector<Json::Value> lines;
+    std::promise<void> finished;
+
+    RouteBatchRunner::Emit emit() {
+        return [this](const std::string& line) {
+            EXPECT_EQ(line.back(), '\n');
+            std::lock_guard<std::mutex> lock(mutex);
+            lines.push_back(parseLine(line));
+            return true;
+        };
+    }
+    RouteBatchRunner::Done done() {
+        return [this]() { finished.set_value(); };
+    }
+};
+
+RouteBatchRunner::Executor inlineExecutor() {
+    return [](std::function<void()> task) { task(); };
+}
+
+}  // namespace
+
+TEST(RouteMemoTest, ComputesEachKeyOnceIncludingFailures) {
+    RouteMemo memo(16);
+    std::vector<Coordinate> waypoints{{35.05, 139.05}};
+    std::string key = RouteMemo::key({35.0, 139.0}, {35.1, 139.1}, waypoints);
+    EXPECT_EQ(key, "35.000000,139.000000;35.050000,139.050000;35.100000,139.100000;");
+
+    int computed = 0;
+    auto found = [&]() -> std::optional<RouteResult> {
+        computed++;
+        return makeResult(1000.0);
+    };
+    EXPECT_EQ(memo.getOrCompute(key, found)->distance_m, 1000.0);
+    EXPECT_EQ(memo.getOrCompute(key, found)->distance_m, 1000.0);
+    EXPECT_EQ(computed, 1);
+
+    auto notFound = [&]() -> std::optional<RouteResult> {
+        computed++;
+        return std::nullopt;
+    };
+    EXPECT_FALSE(memo.getOrCompute("other", notFound).has_value());
+    EXPECT_FALSE(memo.getOrCompute("other", notFound).has_value());
+    EXPECT_EQ(computed, 2);
+    EXPECT_EQ(memo.hits(), 2u);
+}
+
+TEST(RouteMemoTest, ConcurrentLookupsWaitForTheRunningComputation) {
+    RouteMemo memo(16);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> computed{0};
+    auto slow = [&]() -> std::optional<RouteResult> {
+        computed++;
+        released.wait();
+        return makeResult(500.0);
+    };
+
+    auto first = std::async(std::launch::async, [&] { return memo.getOrCompute("k", slow); });
+    while (computed == 0) std::this_thread::yield();
+    auto second = std::async(std::launch::async, [&] { return memo.getOrCompute("k", slow); });
+    while (memo.coalesced() == 0) std::this_thread::yield();
+    release.set_value();
+
+    EXPECT_EQ(first.get()->distance_m, 500.0);
+    EXPECT_EQ(second.get()->distance_m, 500.0);
+    EXPECT_EQ(computed, 1);
+}
+
+TEST(RouteMemoTest, DoesNotRememberExceptions) {
+    RouteMemo memo(16);
+    EXPECT_THROW(memo.getOrCompute(
+                     "k", []() -> std::optional<RouteResult> { throw std::runtime_error("x"); }),
+                 std::runtime_error);
+    auto result = memo.getOrCompute("k", [] { return std::optional(makeResult(1.0)); });
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(memo.hits(), 0u);
+}
+
+TEST(RouteMemoTest, DoesNotRememberResultsCutShortByTheDeadline) {
+    RouteMemo memo(16);
+    int computed = 0;
+    {
+        // 標高の取得中に期限が切れた項目: 獲得標高が途中までの結果になる
+        utils::Deadline expired(utils::Deadline::Clock::now());
+        utils::Deadline::Scope scope(&expired);
+        auto truncated = memo.getOrCompute("k", [&]() -> std::optional<RouteResult> {
+            computed++;
+            auto result = makeResult(1000.0);
+            result.elevation_gain_m = 10.0;
+            result.truncated = true;
+            return result;
+        });
+        ASSERT_TRUE(truncated.has_value());
+        EXPECT_TRUE(truncated->truncated);
+        // 打ち切りで見つからなかった場合も覚えない
+        EXPECT_FALSE(memo.getOrCompute("missing", [&]() -> std::optional<RouteResult> {
+                             computed++;
+                             return std::nullopt;
+                         }).has_value());
+    }
+
+    // 期限の残っている後の項目は計算し直し、その結果を覚える
+    utils::Deadline fresh(utils::Deadline::Clock::now() + std::chrono::minutes(1));
+    utils::Deadline::Scope scope(&fresh);
+    auto complete = [&]() -> std::optional<RouteResult> {
+        computed++;
+        auto result = makeResult(1000.0);
+        result.elevation_gain_m = 50.0;
+        return result;
+    };
+    auto result = memo.getOrCompute("k", complete);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_FALSE(result->truncated);
+    EXPECT_EQ(result->elevation_gain_m, 50.0);
+    EXPECT_EQ(memo.getOrCompute("k", complete)->elevation_gain_m, 50.0);
+    EXPECT_EQ(computed, 3);
+    EXPECT_EQ(memo.hits(), 1u);
+}
+
+TEST(RouteMemoTest, WaitersRecomputeWhenTheRunningComputationExpires) {
+    RouteMemo memo(16);
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+    std::atomic<int> computed{0};
+
+    auto first = std::async(std::launch::async, [&] {
+        utils::Deadline deadline(utils::Deadline::Clock::time_point::max());
+        utils::Deadline::Scope scope(&deadline);
+        return memo.getOrCompute("k", [&]() -> std::optional<RouteResult> {
+            computed++;
+            released.wait();
+            deadline.cancel();  // 計算の途中でクライアントが切断した想定
+            auto result = makeResult(1000.0);
+            result.truncated = true;
+            return result;
+        });
+    });
+    while (computed == 0) std::this_thread::yield();
+    auto second = std::async(std::launch::async, [&] {
+        return memo.getOrCompute("k", [&]() -> std::optional<RouteResult> {
+            computed++;
+            return makeResult(1000.0);
+        });
+    });
+    while (memo.coalesced() == 0) std::this_thread::yield();
+    release.set_value();
+
+    EXPECT_TRUE(first.get()->truncated);
+    EXPECT_FALSE(second.get()->truncated);
+    EXPECT_EQ(computed, 2);
+}
+
+TEST(RouteBatchRunnerTest, ComputesIdenticalRequestsOnceAndReportsEveryIndex) {
+    std::vector<Json::Value> requests{request(35.0, "a"), request(36.0), request(35.0, "b")};
+    std::atomic<int> handled{0};
+    Collector collector;
+    RouteBatchRunner::start(
+        requests, 4, 16,
+        [&](const Json::Value& req, RouteMemo&) {
+            handled++;
+            EXPECT_FALSE(req.isMember("id"));
+            RouteBatchRunner::Outcome outcome;
+            outcome.body["lat"] = req["start_point"]["lat"];
+            return outcome;
+        },
+        inlineExecutor(), collector.emit(), collector.done());
+    collector.finished.get_future().wait();
+
+    EXPECT_EQ(handled, 2);
+    ASSERT_EQ(collector.lines.size(), 4u);
+    std::map<int, Json::Value> byIndex;
+    for (size_t i = 0; i + 1 < collector.lines.size(); ++i) {
+        byIndex[collector.lines[i]["index"].asInt()] = collector.lines[i];
+    }
+    ASSERT_EQ(byIndex.size(), 3u);
+    EXPECT_EQ(byIndex[0]["id"].asString(), "a");
+    EXPECT_EQ(byIndex[2]["id"].asString(), "b");
+    EXPECT_FALSE(byIndex[1].isMember("id"));
+    EXPECT_EQ(byIndex[0]["status"].asInt(), 200);
+    EXPECT_EQ(byIndex[2]["result"]["lat"].asDouble(), 35.0);
+    EXPECT_EQ(byIndex[1]["result"]["lat"].asDouble(), 36.0);
+
+    const Json::Value& summary = collector.lines.back()["summary"];
+    EXPECT_EQ(summary["requests"].asInt(), 3);
+    EXPECT_EQ(summary["unique"].asInt(), 2);
+    EXPECT_EQ(summary["succeeded"].asInt(), 3);
+    EXPECT_EQ(summary["failed"].asInt(), 0);
+}
+
+TEST(RouteBatchRunnerTest, ReportsFailuresAndHandlerExceptionsPerItem) {
+    std::vector<Json::Value> requests{request(35.0), request(36.0), request(37.0)};
+    Collector collector;
+    RouteBatchRunner::start(
+        requests, 1, 16,
+        [](const Json::Value& req, RouteMemo&) {
+            double lat = req["start_point"]["lat"].asDouble();
+            if (lat == 36.0) throw std::runtime_error("boom");
+            RouteBatchRunner::Outcome outcome;
+            if (lat == 37.0) {
+                outcome.status = 400;
+                outcome.error = "Route calculation failed";
+            }
+            return outcome;
+        },
+        inlineExecutor(), collector.emit(), collector.done());
+    collector.finished.get_future().wait();
+
+    ASSERT_EQ(collector.lines.size(), 4u);
+    // 並列度 1 かつ同期実行なので、入力の順に出力される
+    EXPECT_EQ(collector.lines[0]["status"].asInt(), 200);
+    EXPECT_EQ(collector.lines[1]["status"].asInt(), 500);
+    EXPECT_EQ(collector.lines[1]["error"].asString(), "boom");
+    EXPECT_EQ(collector.lines[2]["status"].asInt(), 400);
+    EXPECT_EQ(collector.lines[2]["error"].asString(), "Route calculation failed");
+    EXPECT_FALSE(collector.lines[2].isMember("result"));
+    EXPECT_EQ(collector.lines[3]["summary"]["succeeded"].asInt(), 1);
+    EXPECT_EQ(collector.lines[3]["summary"]["failed"].asInt(), 2);
+}
+
+TEST(RouteBatchRunnerTest, SharesTheMemoAcrossItemsOnAThreadPool) {
+    std::vector<Json::Value> requests;
+    for (int i = 0; i < 16; ++i) requests.push_back(request(35.0 + i * 0.01));
+
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+    std::atomic<int> osrmCalls{0};
+    Collector collector;
+    RouteBatchRunner::start(
+        requests, 3, 64,
+        [&](const Json::Value&, RouteMemo& memo) {
+            int now = ++running;
+            int seen = maxRunning.load();
+            while (now > seen && !maxRunning.compare_exchange_weak(seen, now)) {
+            }
+            // どの項目も同じ候補ルートを評価する
+            memo.getOrCompute("shared-candidate", [&] {
+                osrmCalls++;
+                std::this_thread::sleep_for(std::chrono::milliseconds(5));
+                return std::optional(makeResult(100.0));
+            });
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            running--;
+            return RouteBatchRunner::Outcome{};
+        },
+        [](std::function<void()> task) { std::thread(std::move(task)).detach(); },
+        collector.emit(), collector.done());
+    ASSERT_EQ(collector.finished.get_future().wait_for(std::chrono::seconds(10)),
+              std::future_status::ready);
+
+    EXPECT_LE(maxRunning.load(), 3);
+    EXPECT_EQ(osrmCalls, 1);
+    ASSERT_EQ(collector.lines.size(), 17u);
+    const Json::Value& summary = collector.lines.back()["summary"];
+    EXPECT_EQ(summary["succeeded"].asInt(), 16);
+    EXPECT_EQ(summary["memo_hits"].asInt() + summary["memo_coalesced"].asInt(), 15);
+}
+
+TEST(RouteBatchRunnerTest, StopsStartingItemsWhenTheClientIsGone) {
+    std::vector<Json::Value> requests{request(35.0), request(36.0), request(37.0)};
+    int handled = 0;
+    int emitted = 0;
+    bool done = false;
+    RouteBatchRunner::start(
+        requests, 1, 16,
+        [&](const Json::Value&, RouteMemo&) {
+            handled++;
+            return RouteBatchRunner::Outcome{};
+        },
+        inlineExecutor(),
+        [&](const std::string&) {
+            emitted++;
+            return false;
+        },
+        [&]() { done = true; });
+
+    EXPECT_EQ(handled, 1);
+    EXPECT_EQ(emitted, 1);  // 要約の行も書かない
+    EXPECT_TRUE(done);
+}
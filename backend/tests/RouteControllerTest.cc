@@ -1,10 +1,17 @@
 #include <drogon/drogon.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <thread>
+
 #include "../controllers/RouteController.h"
 #include "../services/OSRMClient.h"
 #include "../services/RouteService.h"
+#include "../services/SpotSearchJobs.h"
 #include "../services/SpotService.h"
+#include "../utils/PolylineDecoder.h"
 
 using namespace api::v1;
 using namespace services;
@@ -15,7 +22,9 @@ class MockSpotService : public SpotService {
    public:
     MockSpotService(const ConfigService& config) : SpotService(config) {}
 
-    std::vector<Spot> searchSpotsAlongRoute(const std::string& polyline, double radius) override {
+    using SpotService::searchSpotsAlongRoute;
+    std::vector<Spot> searchSpotsAlongRoute(std::span<const Coordinate> path,
+                                            double radius) override {
         return mockSpots;
     }
     std::vector<Spot> mockSpots;
@@ -84,6 +93,18 @@ class MockRouteService : public RouteService {
         // For this test, we can just return what processRoute would return.
         return processRoute(osrm::json::Object());
     }
+
+    std::vector<RouteResult> findBestRoutes(const Coordinate& start, const Coordinate& end,
+                                            const std::vector<Coordinate>& fixedWaypoints,
+                                            double targetDistanceKm, double targetElevationM,
+                                            const RouteEvaluator& evaluator, size_t maxRoutes,
+                                            double maxOverlap) override {
+        requestedRoutes = maxRoutes;
+        size_t count = std::min(maxRoutes, rankedRoutes.size());
+        return {rankedRoutes.begin(), rankedRoutes.begin() + static_cast<std::ptrdiff_t>(count)};
+    }
+    std::vector<RouteResult> rankedRoutes;  // findBestRoutes が返す候補 (良い順)
+    size_t requestedRoutes = 0;
 };
 
 class RouteControllerTest : public ::testing::Test {
@@ -99,6 +120,10 @@ class RouteControllerTest : public ::testing::Test {
         controller->setSpotService(mockSpotService);
         controller->setOSRMClient(mockOSRMClient);
         controller->setRouteService(mockRouteService);
+        controller->setSpotSearchJobs(nullptr);
+        controller->setComputePool(nullptr, 1);
+        controller->setConcurrencyLimiter(nullptr);
+        controller->setStreamResponseFactory(nullptr);
     }
 
     std::shared_ptr<ConfigService> configService;
@@ -142,6 +167,23 @@ TEST_F(RouteControllerTest, GenerateRoute_Success) {
     EXPECT_TRUE(callbackCalled);
 }
 
+TEST_F(RouteControllerTest, GenerateRoute_WithoutConnectionIsNotCancelled) {
+    // テストや内部呼び出しで組み立てたリクエストは接続を持たない。切断扱いにしない
+    Json::Value json;
+    json["start_point"]["lat"] = 35.0;
+    json["start_point"]["lon"] = 139.0;
+    json["end_point"]["lat"] = 35.1;
+    json["end_point"]["lon"] = 139.1;
+    auto req = HttpRequest::newHttpJsonRequest(json);
+    req->setMethod(drogon::Post);
+    ASSERT_TRUE(req->getConnectionPtr().expired());
+
+    HttpStatusCode status = k500InternalServerError;
+    controller->generate(req, [&](const HttpResponsePtr& resp) { status = resp->getStatusCode(); });
+    EXPECT_EQ(status, k200OK);
+    EXPECT_EQ(mockRouteService->metrics().requestSeconds.snapshot().count, 1u);
+}
+
 TEST_F(RouteControllerTest, GenerateRoute_MissingParams) {
     auto req = HttpRequest::newHttpRequest();
     req->setMethod(drogon::Post);
@@ -161,3 +203,355 @@ TEST_F(RouteControllerTest, GenerateRoute_MissingParams) {
     });
     EXPECT_TRUE(callbackCalled);
 }
+
+TEST_F(RouteControllerTest, GenerateRoute_InvalidGeometryPrecision) {
+    auto req = HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Post);
+    Json::Value json;
+    json["start_point"]["lat"] = 35.0;
+    json["start_point"]["lon"] = 139.0;
+    json["end_point"]["lat"] = 35.1;
+    json["end_point"]["lon"] = 139.1;
+    json["geometry_options"]["precision"] = 7;
+
+    Json::StreamWriterBuilder builder;
+    req->setBody(Json::writeString(builder, json));
+    req->setContentTypeCode(CT_APPLICATION_JSON);
+
+    bool callbackCalled = false;
+    controller->generate(req, [&](const HttpResponsePtr& resp) {
+        callbackCalled = true;
+        EXPECT_EQ(resp->getStatusCode(), k400BadRequest);
+    });
+    EXPECT_TRUE(callbackCalled);
+}
+
+TEST_F(RouteControllerTest, GenerateRoute_Alternatives) {
+    std::vector<std::vector<Coordinate>> paths;
+    for (int i = 0; i < 3; ++i) {
+        paths.push_back({{35.0, 139.0}, {35.05, 139.05 + 0.01 * i}, {35.1, 139.1}});
+        RouteResult route;
+        route.distance_m = 10000.0 + 1000.0 * i;
+        route.duration_s = 1800.0;
+        route.elevation_gain_m = 100.0;
+        route.geometry = utils::PolylineDecoder::encode(paths.back(), 1e6);
+        mockRouteService->rankedRoutes.push_back(route);
+    }
+
+    Json::Value json;
+    json["start_point"]["lat"] = 35.0;
+    json["start_point"]["lon"] = 139.0;
+    json["end_point"]["lat"] = 35.1;
+    json["end_point"]["lon"] = 139.1;
+    json["preferences"]["target_distance_km"] = 10.0;
+    json["preferences"]["alternatives"] = 9;
+    json["geometry_options"]["precision"] = 6;
+    json["geometry_options"]["overview"] = true;
+
+    Json::Value body;
+    auto generate = [&](const Json::Value& request) {
+        auto req = HttpRequest::newHttpJsonRequest(request);
+        req->setMethod(drogon::Post);
+        HttpStatusCode status = k500InternalServerError;
+        body = Json::Value();
+        controller->generate(req, [&](const HttpResponsePtr& resp) {
+            status = resp->getStatusCode();
+            if (auto jsonBody = resp->getJsonObject()) body = *jsonBody;
+        });
+        return status;
+    };
+
+    // 上限 (5 件) に丸めて探索し、2 位以降を "alternatives" に入れる
+    ASSERT_EQ(generate(json), k200OK);
+    EXPECT_EQ(mockRouteService->requestedRoutes, 5u);
+    EXPECT_EQ(body["summary"]["total_distance_m"].asDouble(), 10000.0);
+    EXPECT_EQ(body["geometry"].asString(), mockRouteService->rankedRoutes[0].geometry);
+    ASSERT_EQ(body["alternatives"].size(), 2u);
+    for (Json::ArrayIndex i = 0; i < 2; ++i) {
+        const Json::Value& alternative = body["alternatives"][i];
+        EXPECT_EQ(alternative["summary"]["total_distance_m"].asDouble(), 11000.0 + 1000.0 * i);
+        EXPECT_EQ(alternative["summary"]["total_elevation_gain_m"].asDouble(), 100.0);
+        // geometry_options は各ルートに適用する
+        EXPECT_EQ(alternative["geometry"].asString(),
+                  mockRouteService->rankedRoutes[i + 1].geometry);
+        EXPECT_EQ(alternative["geometry_precision"].asInt(), 6);
+        EXPECT_TRUE(alternative.isMember("overview_geometry"));
+    }
+
+    json["geometry_options"]["precision"] = 5;
+    json["geometry_options"]["overview"] = false;
+    ASSERT_EQ(generate(json), k200OK);
+    ASSERT_EQ(body["alternatives"].size(), 2u);
+    EXPECT_EQ(body["alternatives"][0]["geometry"].asString(),
+              utils::PolylineDecoder::encode(paths[1], 1e5));
+    EXPECT_EQ(body["alternatives"][0]["geometry_precision"].asInt(), 5);
+    EXPECT_FALSE(body["alternatives"][0].isMember("overview_geometry"));
+
+    // 1 件以下なら従来どおり最良のルートだけを返す
+    mockRouteService->requestedRoutes = 0;
+    json["preferences"]["alternatives"] = 0;
+    ASSERT_EQ(generate(json), k200OK);
+    EXPECT_EQ(mockRouteService->requestedRoutes, 0u);
+    EXPECT_FALSE(body.isMember("alternatives"));
+
+    // 目標距離が無ければ alternatives は無視する
+    json["preferences"]["alternatives"] = 3;
+    json["preferences"]["target_distance_km"] = 0.0;
+    ASSERT_EQ(generate(json), k200OK);
+    EXPECT_EQ(mockRouteService->requestedRoutes, 0u);
+    EXPECT_FALSE(body.isMember("alternatives"));
+}
+
+TEST_F(RouteControllerTest, GenerateRoute_DeferredSpots) {
+    Spot spot;
+    spot.name = "Test Spot";
+    mockSpotService->mockSpots.push_back(spot);
+    auto jobs = std::make_shared<SpotSearchJobs>(mockSpotService, 1, 10, std::chrono::seconds(60));
+    controller->setSpotSearchJobs(jobs);
+
+    auto req = HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Post);
+    req->setPath("/api/v1/route/generate");
+
+    Json::Value json;
+    json["start_point"]["lat"] = 35.0;
+    json["start_point"]["lon"] = 139.0;
+    json["end_point"]["lat"] = 35.1;
+    json["end_point"]["lon"] = 139.1;
+    json["spots_mode"] = "deferred";
+
+    Json::StreamWriterBuilder builder;
+    req->setBody(Json::writeString(builder, json));
+    req->setContentTypeCode(CT_APPLICATION_JSON);
+
+    std::string token;
+    controller->generate(req, [&](const HttpResponsePtr& resp) {
+        EXPECT_EQ(resp->getStatusCode(), k200OK);
+        auto jsonBody = resp->getJsonObject();
+        ASSERT_NE(jsonBody, nullptr);
+        // Route is returned without waiting for the spot search
+        EXPECT_FALSE(jsonBody->isMember("stops"));
+        token = (*jsonBody)["spots_token"].asString();
+    });
+    ASSERT_FALSE(token.empty());
+
+    // Poll the follow-up endpoint until the search has finished
+    HttpStatusCode status = k202Accepted;
+    Json::Value spotsBody;
+    for (int i = 0; i < 500 && status == k202Accepted; ++i) {
+        controller->spots(
+            HttpRequest::newHttpRequest(),
+            [&](const HttpResponsePtr& resp) {
+                status = resp->getStatusCode();
+                if (auto body = resp->getJsonObject()) spotsBody = *body;
+            },
+            token);
+        if (status == k202Accepted) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(status, k200OK);
+    ASSERT_EQ(spotsBody["stops"].size(), 1);
+    EXPECT_EQ(spotsBody["stops"][0]["name"].asString(), "Test Spot");
+
+    controller->spots(
+        HttpRequest::newHttpRequest(),
+        [&](const HttpResponsePtr& resp) { EXPECT_EQ(resp->getStatusCode(), k404NotFound); },
+        "unknown-token");
+}
+
+TEST_F(RouteControllerTest, GenerateBatch_RejectsWithoutPoolOrRequests) {
+    auto req = HttpRequest::newHttpRequest();
+    req->setMethod(drogon::Post);
+    req->setPath("/api/v1/route/generate/batch");
+    Json::Value json;
+    json["requests"] = Json::Value(Json::arrayValue);
+    Json::StreamWriterBuilder builder;
+    req->setBody(Json::writeString(builder, json));
+    req->setContentTypeCode(CT_APPLICATION_JSON);
+
+    HttpStatusCode status = k200OK;
+    controller->generateBatch(req, [&](const HttpResponsePtr& resp) {
+        status = resp->getStatusCode();
+    });
+    EXPECT_EQ(status, k503ServiceUnavailable);
+
+    controller->setComputePool(std::make_shared<trantor::ConcurrentTaskQueue>(1, "test"), 1);
+    controller->generateBatch(req, [&](const HttpResponsePtr& resp) {
+        status = resp->getStatusCode();
+    });
+    EXPECT_EQ(status, k400BadRequest);
+}
+
+// バッチのストリーム応答の本文を行ごとに集める
+struct CapturedStream {
+    std::mutex mutex;
+    std::vector<Json::Value> lines;
+    std::promise<void> closed;
+    // 設定すると、行を書くたびに使用中の枠の数を記録する
+    std::shared_ptr<cycling::utils::ConcurrencyLimiter> limiter;
+    std::vector<size_t> inFlightAtLine;
+};
+
+Route::StreamResponseFactory capturingStream(const std::shared_ptr<CapturedStream>& captured) {
+    return [captured](Route::NdjsonWriter writer) {
+        writer(
+            [captured](const std::string& line) {
+                EXPECT_EQ(line.back(), '\n');
+                Json::Value value;
+                std::string errors;
+                std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
+                EXPECT_TRUE(reader->parse(line.data(), line.data() + line.size(), &value, &errors))
+                    << errors;
+                std::lock_guard<std::mutex> lock(captured->mutex);
+                captured->lines.push_back(std::move(value));
+                if (captured->limiter) {
+                    captured->inFlightAtLine.push_back(captured->limiter->inFlight());
+                }
+                return true;
+            },
+            [captured]() { captured->closed.set_value(); });
+        return HttpResponse::newHttpResponse();
+    };
+}
+
+TEST_F(RouteControllerTest, GenerateBatch_StreamsNdjson) {
+    auto captured = std::make_shared<CapturedStream>();
+    auto closed = captured->closed.get_future();
+    controller->setStreamResponseFactory(capturingStream(captured));
+    controller->setComputePool(std::make_shared<trantor::ConcurrentTaskQueue>(2, "test"), 2);
+
+    Json::Value ok;
+    ok["id"] = "a";
+    ok["start_point"]["lat"] = 35.0;
+    ok["start_point"]["lon"] = 139.0;
+    ok["end_point"]["lat"] = 35.1;
+    ok["end_point"]["lon"] = 139.1;
+    Json::Value missingEnd;
+    missingEnd["id"] = "b";
+    missingEnd["start_point"] = ok["start_point"];
+    Json::Value json;
+    json["requests"].append(ok);
+    json["requests"].append(missingEnd);
+    auto req = HttpRequest::newHttpJsonRequest(json);
+    req->setMethod(drogon::Post);
+
+    HttpStatusCode status = k500InternalServerError;
+    controller->generateBatch(req, [&](const HttpResponsePtr& resp) {
+        status = resp->getStatusCode();
+    });
+    EXPECT_EQ(status, k200OK);
+    ASSERT_EQ(closed.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+
+    // 項目ごとに 1 行 (終わった順)、最後に集計の行
+    std::lock_guard<std::mutex> lock(captured->mutex);
+    ASSERT_EQ(captured->lines.size(), 3u);
+    EXPECT_NE(captured->lines[0]["id"], captured->lines[1]["id"]);
+    for (size_t i = 0; i < 2; ++i) {
+        const Json::Value& line = captured->lines[i];
+        if (line["id"].asString() == "a") {
+            EXPECT_EQ(line["index"].asUInt(), 0u);
+            EXPECT_EQ(line["status"].asInt(), 200);
+            EXPECT_EQ(line["result"]["summary"]["total_elevation_gain_m"].asDouble(), 50.0);
+            EXPECT_TRUE(line["result"].isMember("geometry"));
+        } else {
+            EXPECT_EQ(line["id"].asString(), "b");
+            EXPECT_EQ(line["index"].asUInt(), 1u);
+            EXPECT_EQ(line["status"].asInt(), 400);
+            EXPECT_EQ(line["error"].asString(), "Missing start_point or end_point");
+        }
+    }
+    const Json::Value& summary = captured->lines[2]["summary"];
+    EXPECT_EQ(summary["requests"].asUInt(), 2u);
+    EXPECT_EQ(summary["succeeded"].asUInt(), 1u);
+    EXPECT_EQ(summary["failed"].asUInt(), 1u);
+
+    // バッチの項目は単発のリクエストとは別のヒストグラムに記録する
+    EXPECT_EQ(mockRouteService->metrics().batchItemSeconds.snapshot().count, 2u);
+    EXPECT_EQ(mockRouteService->metrics().requestSeconds.snapshot().count, 0u);
+}
+
+TEST_F(RouteControllerTest, GenerateBatch_TakesASlotPerRunningItem) {
+    auto limiter = std::make_shared<cycling::utils::ConcurrencyLimiter>(3);
+    controller->setConcurrencyLimiter(limiter);
+    controller->setComputePool(std::make_shared<trantor::ConcurrentTaskQueue>(4, "test"), 4);
+
+    Json::Value json;
+    for (int i = 0; i < 3; ++i) {
+        Json::Value item;
+        item["start_point"]["lat"] = 35.0;
+        item["start_point"]["lon"] = 139.0;
+        item["end_point"]["lat"] = 35.1 + 0.01 * i;
+        item["end_point"]["lon"] = 139.1;
+        json["requests"].append(item);
+    }
+    auto req = HttpRequest::newHttpJsonRequest(json);
+    req->setMethod(drogon::Post);
+
+    auto runBatch = [&]() {
+        auto captured = std::make_shared<CapturedStream>();
+        captured->limiter = limiter;
+        auto closed = captured->closed.get_future();
+        controller->setStreamResponseFactory(capturingStream(captured));
+        HttpStatusCode status = k500InternalServerError;
+        controller->generateBatch(req, [&](const HttpResponsePtr& resp) {
+            status = resp->getStatusCode();
+        });
+        if (status == k200OK) {
+            EXPECT_EQ(closed.wait_for(std::chrono::seconds(5)), std::future_status::ready);
+        }
+        return std::make_pair(status, captured);
+    };
+    // 枠はバッチの後始末で返すので、書き終わった直後にはまだ残っていることがある
+    auto waitForInFlight = [&](size_t expected) {
+        for (int i = 0; i < 500 && limiter->inFlight() > expected; ++i) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        EXPECT_EQ(limiter->inFlight(), expected);
+    };
+
+    // 4 スレッドのプールでは 2 件まで並列に計算し、その 2 枠をバッチが終わるまで保持する
+    auto [status, captured] = runBatch();
+    EXPECT_EQ(status, k200OK);
+    EXPECT_EQ(captured->lines.size(), 4u);
+    for (size_t inFlight : captured->inFlightAtLine) EXPECT_EQ(inFlight, 2u);
+    waitForInFlight(0);
+
+    // 空きが 1 枠なら 1 件ずつ計算する
+    auto first = limiter->tryAcquire();
+    auto second = limiter->tryAcquire();
+    std::tie(status, captured) = runBatch();
+    EXPECT_EQ(status, k200OK);
+    EXPECT_EQ(captured->lines.size(), 4u);
+    for (size_t inFlight : captured->inFlightAtLine) EXPECT_EQ(inFlight, 3u);
+    waitForInFlight(2);
+
+    // 空きが無ければ 503
+    auto third = limiter->tryAcquire();
+    std::tie(status, captured) = runBatch();
+    EXPECT_EQ(status, k503ServiceUnavailable);
+    EXPECT_TRUE(captured->lines.empty());
+}
+
+TEST_F(RouteControllerTest, GenerateRoute_ShedsWhenSaturated) {
+    auto limiter = std::make_shared<cycling::utils::ConcurrencyLimiter>(1);
+    controller->setConcurrencyLimiter(limiter);
+    auto held = limiter->tryAcquire();
+    ASSERT_TRUE(held.has_value());
+
+    Json::Value json;
+    json["start_point"]["lat"] = 35.0;
+    json["start_point"]["lon"] = 139.0;
+    json["end_point"]["lat"] = 35.1;
+    json["end_point"]["lon"] = 139.1;
+    auto req = HttpRequest::newHttpJsonRequest(json);
+    req->setMethod(drogon::Post);
+
+    HttpStatusCode status = k200OK;
+    controller->generate(req, [&](const HttpResponsePtr& resp) { status = resp->getStatusCode(); });
+    EXPECT_EQ(status, k503ServiceUnavailable);
+
+    // 枠が空けば受け付け、処理が終わると枠を返す
+    held.reset();
+    controller->generate(req, [&](const HttpResponsePtr& resp) { status = resp->getStatusCode(); });
+    EXPECT_NE(status, k503ServiceUnavailable);
+    EXPECT_EQ(limiter->inFlight(), 0u);
+}
@@ -1,10 +1,15 @@
 #include <gtest/gtest.h>
 #include <json/json.h>
 
+#include <algorithm>
+#include <cmath>
 #include <osrm/json_container.hpp>
 
 #include "../services/RouteService.h"
 #include "../services/elevation/IElevationProvider.h"
+#include "../utils/AllocationCounter.h"
+#include "../utils/Deadline.h"
+#include "../utils/PolylineDecoder.h"
 
 using namespace services;
 using namespace services::elevation;
@@ -135,3 +140,216 @@ TEST_F(RouteServiceTest, ProcessRoute_WithElevation) {
     // Elevation diff: 35.1*100 - 35.0*100 = 10.0
     EXPECT_NEAR(result->elevation_gain_m, 10.0, 0.001);
 }
+
+TEST_F(RouteServiceTest, FindBestRoute_AppendsFixedWaypointsToEachDetour) {
+    Coordinate start{35.0, 139.0};
+    Coordinate end{35.0, 139.1};
+    std::vector<Coordinate> fixed = {{35.05, 139.05}};
+
+    std::vector<std::vector<Coordinate>> evaluated;
+    auto evaluator = [&evaluated](const std::vector<Coordinate>& wps) {
+        evaluated.push_back(wps);
+        RouteResult res{};
+        res.distance_m = 1000.0 * static_cast<double>(evaluated.size());
+        return std::optional<RouteResult>(res);
+    };
+
+    auto result = service_->findBestRoute(start, end, fixed, 30.0, 0.0, evaluator);
+    ASSERT_TRUE(result.has_value());
+    ASSERT_GT(evaluated.size(), 1u);
+
+    // 最初の候補は固定経由地のみ。以降は迂回点 (1〜2 点) の後ろに固定経由地が続く
+    ASSERT_EQ(evaluated[0].size(), 1u);
+    for (const auto& wps : evaluated) {
+        ASSERT_GE(wps.size(), 1u);
+        ASSERT_LE(wps.size(), 3u);
+        EXPECT_DOUBLE_EQ(wps.back().lat, 35.05);
+        EXPECT_DOUBLE_EQ(wps.back().lon, 139.05);
+    }
+}
+
+TEST_F(RouteServiceTest, FindBestRoute_StopsEvaluatingWhenTheDeadlineIsReached) {
+    Coordinate start{35.0, 139.0};
+    Coordinate end{35.0, 139.1};
+    utils::Deadline deadline(utils::Deadline::Clock::time_point::max());
+    utils::Deadline::Scope scope(&deadline);
+
+    int evaluated = 0;
+    auto evaluator = [&](const std::vector<Coordinate>& wps) {
+        // 2 件目の評価中にクライアントが切断した想定
+        if (++evaluated == 2) deadline.cancel();
+        RouteResult res{};
+        res.distance_m = 1000.0 * evaluated;
+        return std::optional<RouteResult>(res);
+    };
+
+    auto result = service_->findBestRoute(start, end, {}, 30.0, 0.0, evaluator);
+    EXPECT_EQ(evaluated, 2);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_DOUBLE_EQ(result->distance_m, 2000.0);
+}
+
+TEST_F(RouteServiceTest, ProcessRoute_MarksElevationCutShortByTheDeadline) {
+    // 標高の取得中に期限が切れる (クライアントの切断で取り消される) プロバイダ
+    class CancellingElevationProvider : public MockElevationProvider {
+       public:
+        std::vector<std::optional<double>> getElevationsSyncE7(
+            std::span<const int32_t> latsE7, std::span<const int32_t> lonsE7) override {
+            utils::Deadline::current()->cancel();
+            std::vector<std::optional<double>> results(latsE7.size());
+            if (!results.empty()) results[0] = 100.0;
+            return results;
+        }
+    };
+    RouteService service(std::make_shared<CancellingElevationProvider>());
+
+    osrm::json::Array loc1, loc2;
+    loc1.values.push_back(osrm::json::Number(139.0));
+    loc1.values.push_back(osrm::json::Number(35.0));
+    loc2.values.push_back(osrm::json::Number(139.0));
+    loc2.values.push_back(osrm::json::Number(35.1));
+    osrm::json::Object intersection1, intersection2;
+    intersection1.values["location"] = loc1;
+    intersection2.values["location"] = loc2;
+    osrm::json::Array intersections;
+    intersections.values.push_back(intersection1);
+    intersections.values.push_back(intersection2);
+    osrm::json::Object step;
+    step.values["intersections"] = intersections;
+    osrm::json::Array steps;
+    steps.values.push_back(step);
+    osrm::json::Object leg;
+    leg.values["steps"] = steps;
+    osrm::json::Array legs;
+    legs.values.push_back(leg);
+    osrm::json::Object route;
+    route.values["distance"] = osrm::json::Number(1000.0);
+    route.values["duration"] = osrm::json::Number(100.0);
+    route.values["geometry"] = osrm::json::String("geom");
+    route.values["legs"] = legs;
+    osrm::json::Array routes;
+    routes.values.push_back(route);
+    osrm::json::Object osrmResult;
+    osrmResult.values["routes"] = routes;
+
+    auto complete = service_->processRoute(osrmResult);
+    ASSERT_TRUE(complete.has_value());
+    EXPECT_FALSE(complete->truncated);
+
+    utils::Deadline deadline(utils::Deadline::Clock::time_point::max());
+    utils::Deadline::Scope scope(&deadline);
+    auto truncated = service.processRoute(osrmResult);
+    ASSERT_TRUE(truncated.has_value());
+    EXPECT_TRUE(truncated->truncated);
+}
+
+TEST_F(RouteServiceTest, FindBestRoute_SkipsCandidatesWithTruncatedElevation) {
+    Coordinate start{35.0, 139.0};
+    Coordinate end{35.0, 139.1};
+
+    // 1 件目は獲得標高が目標に一致して見えるが、途中で打ち切られている
+    int evaluated = 0;
+    auto evaluator = [&](const std::vector<Coordinate>& wps) {
+        RouteResult res{};
+        res.distance_m = 30000.0;
+        res.elevation_gain_m = ++evaluated == 1 ? 300.0 : 100.0;
+        res.truncated = evaluated == 1;
+        return std::optional<RouteResult>(res);
+    };
+
+    auto result = service_->findBestRoute(start, end, {}, 30.0, 300.0, evaluator);
+    ASSERT_GT(evaluated, 1);
+    ASSERT_TRUE(result.has_value());
+    EXPECT_FALSE(result->truncated);
+    EXPECT_DOUBLE_EQ(result->elevation_gain_m, 100.0);
+}
+
+TEST_F(RouteServiceTest, OverlapRatio) {
+    // 東西に約 5.5 km の直線と、その途中から北へ分かれる経路
+    std::vector<Coordinate> straight = {{35.0, 139.0}, {35.0, 139.06}};
+    std::vector<Coordinate> branch = {{35.0, 139.0}, {35.0, 139.03}, {35.03, 139.03}};
+    std::vector<Coordinate> far = {{35.2, 139.0}, {35.2, 139.06}};
+
+    EXPECT_DOUBLE_EQ(RouteService::overlapRatio(straight, straight), 1.0);
+    EXPECT_DOUBLE_EQ(RouteService::overlapRatio(straight, far), 0.0);
+    double shared = RouteService::overlapRatio(straight, branch);
+    EXPECT_GT(shared, 0.4);
+    EXPECT_LT(shared, 0.6);
+    EXPECT_DOUBLE_EQ(RouteService::overlapRatio({}, straight), 0.0);
+}
+
+TEST_F(RouteServiceTest, FindBestRoutes_RanksByCostAndSkipsOverlappingRoutes) {
+    Coordinate start{35.0, 139.0};
+    Coordinate end{35.0, 139.1};
+
+    // 迂回点を通る折れ線をジオメトリにする。北側 (lat > 35) の迂回点はすべて同じ地点に寄せ、
+    // 北側の候補がどれも同じ道を通るようにする
+    auto evaluator = [&](const std::vector<Coordinate>& wps) {
+        std::vector<Coordinate> line{start};
+        for (const auto& wp : wps) {
+            line.push_back(wp.lat > 35.0 ? Coordinate{35.05, 139.05} : wp);
+        }
+        line.push_back(end);
+        RouteResult res{};
+        double km = 0.0;
+        for (size_t i = 1; i < line.size(); ++i) {
+            km += std::hypot(line[i].lat - line[i - 1].lat, line[i].lon - line[i - 1].lon) * 100.0;
+        }
+        res.distance_m = km * 1000.0;
+        res.geometry = utils::PolylineDecoder::encode(line, RouteService::kGeometryPrecision);
+        return std::optional<RouteResult>(res);
+    };
+
+    auto best = service_->findBestRoute(start, end, {}, 15.0, 0.0, evaluator);
+    auto routes = service_->findBestRoutes(start, end, {}, 15.0, 0.0, evaluator, 10);
+    ASSERT_TRUE(best.has_value());
+    ASSERT_GE(routes.size(), 2u);
+    EXPECT_EQ(routes[0].geometry, best->geometry);
+
+    // 目標距離との差が小さい順で、北側の経路は 1 本だけ
+    int north = 0;
+    for (size_t i = 0; i < routes.size(); ++i) {
+        if (i > 0) {
+            EXPECT_GE(std::abs(routes[i].distance_m / 1000.0 - 15.0),
+                      std::abs(routes[i - 1].distance_m / 1000.0 - 15.0));
+        }
+        auto path = utils::PolylineDecoder::decode(routes[i].geometry,
+                                                   RouteService::kGeometryPrecision);
+        if (std::any_of(path.begin(), path.end(), [](const auto& c) { return c.lat > 35.0; })) {
+            north++;
+        }
+        for (size_t j = 0; j < i; ++j) {
+            auto other = utils::PolylineDecoder::decode(routes[j].geometry,
+                                                        RouteService::kGeometryPrecision);
+            EXPECT_LE(RouteService::overlapRatio(path, other), RouteService::kDefaultMaxOverlap);
+        }
+    }
+    EXPECT_EQ(north, 1);
+
+    EXPECT_EQ(service_->findBestRoutes(start, end, {}, 15.0, 0.0, evaluator, 2).size(), 2u);
+}
+
+TEST_F(RouteServiceTest, FindBestRoute_DoesNotAllocateAfterWarmup) {
+    if (!utils::AllocationCounter::enabled()) {
+        GTEST_SKIP() << "built without ENABLE_ALLOCATION_COUNTING";
+    }
+
+    Coordinate start{35.0, 139.0};
+    Coordinate end{35.0, 139.1};
+    std::vector<Coordinate> fixed = {{35.05, 139.05}};
+    auto evaluator = [](const std::vector<Coordinate>& wps) {
+        RouteResult res{};
+        res.distance_m = 5000.0 * static_cast<double>(wps.size());
+        return std::optional<RouteResult>(res);
+    };
+    RouteService::RouteEvaluator wrapped = evaluator;
+
+    // 1 回目でスレッドごとの作業領域が確保される
+    service_->findBestRoute(start, end, fixed, 30.0, 0.0, wrapped);
+
+    auto before = utils::AllocationCounter::thisThread();
+    auto result = service_->findBestRoute(start, end, fixed, 30.0, 0.0, wrapped);
+    auto delta = utils::AllocationCounter::thisThread() - before;
+    ASSERT_TRUE(result.has_value());
+    EXPECT_EQ(delta.allocations, 0u);
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+
+#include "../services/RouteService.h"
+#include "../tools/replay/ReplayOSRMClient.h"
+#include "../tools/replay/Scenario.h"
+#include "../tools/replay/SyntheticElevationProvider.h"
+
+using namespace services;
+using namespace tools::replay;
+
+namespace {
+
+osrm::RouteParameters routeParameters() {
+    return RouteService::buildRouteParameters({35.681236, 139.767125}, {35.714074, 139.774109},
+                                              {{35.698383, 139.773072}});
+}
+
+}  // namespace
+
+TEST(ScenarioReplayTest, SynthesizedRouteIsProcessable) {
+    ReplayOSRMClient client;
+    osrm::json::Object result;
+    ASSERT_EQ(client.Route(routeParameters(), result), osrm::Status::Ok);
+
+    RouteService service(std::make_shared<SyntheticElevationProvider>());
+    auto route = service.processRoute(result);
+    ASSERT_TRUE(route.has_value());
+    // 直線距離 (約 3.7km) より長く、極端に遠回りではない
+    EXPECT_GT(route->distance_m, 3700.0);
+    EXPECT_LT(route->distance_m, 5000.0);
+    EXPECT_GE(route->path.size(), 3u);
+    EXPECT_FALSE(route->geometry.empty());
+
+    auto counters = client.counters();
+    EXPECT_EQ(counters.calls, 1u);
+    EXPECT_EQ(counters.synthesized, 1u);
+}
+
+TEST(ScenarioReplayTest, RecordingsAreReplayed) {
+    auto params = routeParameters();
+    auto recorded = ReplayOSRMClient::synthesizeRoute({{35.0, 139.0}, {35.1, 139.1}});
+    std::string path = "scenario_replay_test_recordings.jsonl";
+    {
+        Json::Value entry;
+        entry["key"] = ReplayOSRMClient::requestKey(params);
+        entry["response"] = ReplayOSRMClient::toJson(recorded);
+        Json::StreamWriterBuilder builder;
+        builder["indentation"] = "";
+        std::ofstream out(path);
+        out << Json::writeString(builder, entry) << "\n";
+    }
+
+    ReplayOSRMClient client;
+    EXPECT_EQ(client.loadRecordings(path), 1u);
+    std::remove(path.c_str());
+
+    osrm::json::Object result;
+    ASSERT_EQ(client.Route(params, result), osrm::Status::Ok);
+    EXPECT_EQ(client.counters().replayed, 1u);
+
+    RouteService service;
+    auto expected = service.processRoute(recorded);
+    auto actual = service.processRoute(result);
+    ASSERT_TRUE(expected && actual);
+    EXPECT_DOUBLE_EQ(actual->distance_m, expected->distance_m);
+    EXPECT_EQ(actual->geometry, expected->geometry);
+}
+
+TEST(ScenarioReplayTest, GeneratedScenariosAreDeterministic) {
+    std::vector<Scenario> seeds{
+        {"1", "loop", {35.681236, 139.767125}, {35.681236, 139.767125}, 30.0, 0.0},
+        {"2", "one_way", {35.658034, 139.701636}, {35.465981, 139.622062}, 40.0, 100.0},
+    };
+    auto a = generateScenarios(seeds, 10, 7);
+    auto b = generateScenarios(seeds, 10, 7);
+    ASSERT_EQ(a.size(), 10u);
+    for (size_t i = 0; i < a.size(); ++i) {
+        EXPECT_DOUBLE_EQ(a[i].start.lat, b[i].start.lat);
+        EXPECT_DOUBLE_EQ(a[i].targetDistanceKm, b[i].targetDistanceKm);
+    }
+    // 周回は周回のまま
+    EXPECT_DOUBLE_EQ(a[0].start.lat, a[0].end.lat);
+    EXPECT_DOUBLE_EQ(a[0].start.lon, a[0].end.lon);
+    EXPECT_NE(a[1].start.lat, a[1].end.lat);
+    EXPECT_EQ(a[1].type, "one_way");
+}
@@ -1,7 +1,11 @@
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <functional>
+#include <mutex>
 #include <optional>
 #include <string>
 #include <thread>
@@ -18,12 +22,21 @@ using namespace testing;
 class MockRepository : public IElevationCacheRepository {
    public:
     MOCK_METHOD(std::optional<ElevationCacheEntry>, getTile, (int z, int x, int y), (override));
-    MOCK_METHOD(bool, saveTile, (int z, int x, int y, const std::string& content), (override));
+    MOCK_METHOD(bool, saveTile,
+                (int z, int x, int y, const std::string& content, const std::string& source),
+                (override));
     MOCK_METHOD(void, incrementAccessScore, (int z, int x, int y), (override));
     MOCK_METHOD(void, addToRefreshQueue, (int z, int x, int y), (override));
+    MOCK_METHOD(void, addToRefreshQueueBatch, (const std::vector<std::string>& tileKeys),
+                (override));
     MOCK_METHOD(std::optional<std::string>, popRefreshQueue, (), (override));
+    MOCK_METHOD(size_t, getRefreshQueueSize, (), (override));
     MOCK_METHOD(void, decayScores, (double factor), (override));
     MOCK_METHOD(double, getAccessScore, (int z, int x, int y), (override));
+    MOCK_METHOD(std::vector<std::string>, getTopRankedTiles, (size_t limit, double minScore),
+                (override));
+    MOCK_METHOD(std::vector<std::optional<uint64_t>>, getUpdatedAtBatch,
+                (const std::vector<std::string>& tileKeys), (override));
 };
 
 class MockProvider : public IElevationProvider {
@@ -50,9 +63,47 @@ TEST(SmartRefreshServiceTest, RecordAccess) {
     service.recordAccess(15, 10, 20);
 }
 
-// checkAndQueueRefresh involves async call on event loop, hard to test synchronously without full
-// Drogon setup. We can test the logic flow if we could intercept the loop. For unit test, we might
-// skip the async part or rely on Integration test.
+TEST(SmartRefreshServiceTest, IsStale) {
+    const uint64_t now = 1700000000;
+    const uint64_t day = 24 * 60 * 60;
+
+    EXPECT_FALSE(SmartRefreshService::isStale(now, now));
+    EXPECT_FALSE(SmartRefreshService::isStale(now - 89 * day, now));
+    EXPECT_TRUE(SmartRefreshService::isStale(now - 91 * day, now));
+    EXPECT_FALSE(SmartRefreshService::isStale(now + day, now));  // Clock skew
+}
+
+TEST(SmartRefreshServiceTest, ScanQueuesOnlyStaleRankedTiles) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    SmartRefreshService service(mockRepo, mockProvider);
+    service.setRefreshThreshold(10.0);
+    service.setStalenessScan(3, std::chrono::seconds(600));
+
+    uint64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    uint64_t old = now - 100ULL * 24 * 60 * 60;
+    std::vector<std::string> ranked = {"15:1:1", "15:2:2", "15:3:3"};
+
+    EXPECT_CALL(*mockRepo, getTopRankedTiles(3, 10.0)).WillOnce(Return(ranked));
+    EXPECT_CALL(*mockRepo, getUpdatedAtBatch(ranked))
+        .WillOnce(Return(std::vector<std::optional<uint64_t>>{old, now, std::nullopt}));
+    EXPECT_CALL(*mockRepo, addToRefreshQueueBatch(std::vector<std::string>{"15:1:1"})).Times(1);
+    EXPECT_CALL(*mockRepo, addToRefreshQueue(_, _, _)).Times(0);
+    EXPECT_CALL(*mockRepo, getAccessScore(_, _, _)).Times(0);
+
+    EXPECT_EQ(service.scanForStaleTiles(), 1u);
+}
+
+TEST(SmartRefreshServiceTest, ScanWithEmptyRankingSkipsBatchLookup) {
+    auto mockRepo = std::make_shared<MockRepository>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    SmartRefreshService service(mockRepo, mockProvider);
+
+    EXPECT_CALL(*mockRepo, getTopRankedTiles(_, _)).WillOnce(Return(std::vector<std::string>{}));
+    EXPECT_CALL(*mockRepo, getUpdatedAtBatch(_)).Times(0);
+
+    EXPECT_EQ(service.scanForStaleTiles(), 0u);
+}
 
 TEST(SmartRefreshServiceTest, Lifecycle) {
     auto mockRepo = std::make_shared<MockRepository>();
@@ -63,3 +114,300 @@ TEST(SmartRefreshServiceTest, Lifecycle) {
     std::this_thread::sleep_for(std::chrono::milliseconds(100));
     service.stopWorker();
 }
+
+namespace {
+
+// Replaces the GSI fetch so the worker can be driven without network access
+class TestableSmartRefreshService : public SmartRefreshService {
+   public:
+    using SmartRefreshService::SmartRefreshService;
+
+    // Result of each fetch (nullptr simulates a failure)
+    std::function<FetchedTile(int z, int x, int y)> fetchHandler = [](int, int, int) {
+        return nullptr;
+    };
+
+    // While holding, fetches stay in flight until releaseHeld() is called
+    void holdFetches() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        holding_ = true;
+    }
+
+    void releaseHeld() {
+        std::vector<FetchCallback> held;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            holding_ = false;
+            held.swap(held_);
+        }
+        for (auto& callback : held) callback(nullptr);
+    }
+
+    int fetchCount() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return fetchCount_;
+    }
+
+   protected:
+    void fetchTile(int z, int x, int y, FetchCallback&& callback) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        fetchCount_++;
+        if (holding_) {
+            held_.push_back(std::move(callback));
+            return;
+        }
+        lock.unlock();
+        callback(fetchHandler(z, x, y));
+    }
+
+   private:
+    std::mutex mutex_;
+    bool holding_ = false;
+    int fetchCount_ = 0;
+    std::vector<FetchCallback> held_;
+};
+
+SmartRefreshService::FetchedTile makeTile(double value) {
+    return std::make_shared<const GSIElevationProvider::TileData>(
+        GSIElevationProvider::TileData{std::vector<double>(256 * 256, value), "dem"});
+}
+
+template <typename Predicate>
+bool waitFor(Predicate predicate, std::chrono::milliseconds timeout = std::chrono::seconds(3)) {
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    while (std::chrono::steady_clock::now() < deadline) {
+        if (predicate()) return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return predicate();
+}
+
+}  // namespace
+
+TEST(SmartRefreshServiceTest, WorkerRefreshesQueuedTiles) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    service.fetchHandler = [](int, int, int) { return makeTile(1.0); };
+    service.setRateLimit(1000.0, 10.0);
+
+    EXPECT_CALL(*mockRepo, popRefreshQueue())
+        .WillOnce(Return(std::optional<std::string>("15:1:2")))
+        .WillOnce(Return(std::optional<std::string>("15:3:4")))
+        .WillRepeatedly(Return(std::nullopt));
+    EXPECT_CALL(*mockRepo, saveTile(15, 1, 2, _, "dem")).WillOnce(Return(true));
+    EXPECT_CALL(*mockRepo, saveTile(15, 3, 4, _, _)).WillOnce(Return(true));
+
+    service.startWorker();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().refreshedTotal == 2; }));
+    service.stopWorker();
+
+    EXPECT_EQ(service.getStats().failedTotal, 0u);
+}
+
+TEST(SmartRefreshServiceTest, NotifyWakesIdleWorker) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    service.fetchHandler = [](int, int, int) { return makeTile(1.0); };
+    service.setRateLimit(1000.0, 10.0);
+    service.setIdlePollInterval(std::chrono::minutes(10));
+
+    std::atomic<bool> tileQueued{false};
+    ON_CALL(*mockRepo, popRefreshQueue()).WillByDefault([&]() -> std::optional<std::string> {
+        if (tileQueued.exchange(false)) return "15:5:6";
+        return std::nullopt;
+    });
+    EXPECT_CALL(*mockRepo, saveTile(15, 5, 6, _, _)).WillOnce(Return(true));
+
+    service.startWorker();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Worker is now idle
+
+    tileQueued = true;
+    service.notifyQueued();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().refreshedTotal == 1; },
+                        std::chrono::milliseconds(500)));
+    service.stopWorker();
+}
+
+TEST(SmartRefreshServiceTest, ScannedTilesAreRefreshedWithoutWaitingForIdlePoll) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    service.fetchHandler = [](int, int, int) { return makeTile(1.0); };
+    service.setRateLimit(1000.0, 10.0);
+    service.setIdlePollInterval(std::chrono::minutes(10));
+    service.setStalenessScan(10, std::chrono::seconds(600));
+
+    uint64_t now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+    uint64_t old = now - 100ULL * 24 * 60 * 60;
+    std::vector<std::string> ranked = {"15:4:4"};
+    ON_CALL(*mockRepo, getTopRankedTiles(_, _)).WillByDefault(Return(ranked));
+    ON_CALL(*mockRepo, getUpdatedAtBatch(_))
+        .WillByDefault(Return(std::vector<std::optional<uint64_t>>{old}));
+
+    // The batch write is complete when it returns, so the pop that follows sees the tile
+    std::mutex queueMutex;
+    std::vector<std::string> queue;
+    EXPECT_CALL(*mockRepo, addToRefreshQueueBatch(_))
+        .WillOnce([&](const std::vector<std::string>& keys) {
+            std::lock_guard<std::mutex> lock(queueMutex);
+            queue.insert(queue.end(), keys.begin(), keys.end());
+        });
+    ON_CALL(*mockRepo, popRefreshQueue()).WillByDefault([&]() -> std::optional<std::string> {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        if (queue.empty()) return std::nullopt;
+        std::string key = queue.back();
+        queue.pop_back();
+        return key;
+    });
+    EXPECT_CALL(*mockRepo, saveTile(15, 4, 4, _, _)).WillOnce(Return(true));
+
+    service.startWorker();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().refreshedTotal == 1; },
+                        std::chrono::milliseconds(500)));
+    service.stopWorker();
+}
+
+TEST(SmartRefreshServiceTest, ConcurrencyLimitCapsInFlightFetches) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    service.holdFetches();
+    service.setRateLimit(1000.0, 100.0);
+    service.setMaxConcurrentFetches(3);
+
+    ON_CALL(*mockRepo, popRefreshQueue()).WillByDefault(Return(std::string("15:1:1")));
+
+    service.startWorker();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().inFlight == 3; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(service.fetchCount(), 3);
+
+    service.releaseHeld();
+    service.stopWorker();
+}
+
+TEST(SmartRefreshServiceTest, FailedFetchIsRetriedWithBackoff) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    std::atomic<int> attempts{0};
+    service.fetchHandler = [&](int, int, int) {
+        return attempts++ < 2 ? nullptr : makeTile(2.0);
+    };
+    service.setRateLimit(1000.0, 10.0);
+    service.setRetryPolicy(3, std::chrono::milliseconds(10));
+
+    EXPECT_CALL(*mockRepo, popRefreshQueue())
+        .WillOnce(Return(std::optional<std::string>("15:7:8")))
+        .WillRepeatedly(Return(std::nullopt));
+    EXPECT_CALL(*mockRepo, saveTile(15, 7, 8, _, _)).WillOnce(Return(true));
+
+    service.startWorker();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().refreshedTotal == 1; }));
+    service.stopWorker();
+
+    EXPECT_EQ(attempts.load(), 3);
+    EXPECT_EQ(service.getStats().failedTotal, 0u);
+}
+
+TEST(SmartRefreshServiceTest, GivesUpAfterMaxRetries) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    service.setRateLimit(1000.0, 10.0);
+    service.setRetryPolicy(2, std::chrono::milliseconds(5));
+
+    EXPECT_CALL(*mockRepo, popRefreshQueue())
+        .WillOnce(Return(std::optional<std::string>("15:9:9")))
+        .WillRepeatedly(Return(std::nullopt));
+    EXPECT_CALL(*mockRepo, saveTile(_, _, _, _, _)).Times(0);
+
+    service.startWorker();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().failedTotal == 1; }));
+    service.stopWorker();
+
+    EXPECT_EQ(service.fetchCount(), 3);  // 1 attempt + 2 retries
+}
+
+TEST(SmartRefreshServiceTest, RateLimitPacesFetches) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    auto mockProvider = std::make_shared<MockProvider>();
+    TestableSmartRefreshService service(mockRepo, mockProvider);
+    service.fetchHandler = [](int, int, int) { return makeTile(1.0); };
+    service.setMaxConcurrentFetches(8);
+    service.setRateLimit(20.0, 1.0);  // One fetch every 50ms
+
+    ON_CALL(*mockRepo, popRefreshQueue()).WillByDefault(Return(std::string("15:1:1")));
+    ON_CALL(*mockRepo, saveTile(_, _, _, _, _)).WillByDefault(Return(true));
+
+    service.startWorker();
+    std::this_thread::sleep_for(std::chrono::milliseconds(275));
+    service.stopWorker();
+
+    // 1 burst token + ~5 refills; allow scheduling slack but no more than the limit permits
+    EXPECT_GE(service.fetchCount(), 3);
+    EXPECT_LE(service.fetchCount(), 7);
+}
+
+namespace {
+
+// GSI provider whose HTTP layer is scripted: DEM5A is missing, DEM fails `demFailures` times
+// before it answers
+class ScriptedGSIElevationProvider : public GSIElevationProvider {
+   public:
+    explicit ScriptedGSIElevationProvider(int demFailures) : demFailures_(demFailures) {}
+
+    int demRequests() const { return demRequests_.load(); }
+
+   protected:
+    void sendTileRequest(const std::string& path, double,
+                         drogon::HttpReqCallback&& callback) override {
+        auto resp = drogon::HttpResponse::newHttpResponse();
+        if (path.find("/dem5a/") != std::string::npos) {
+            resp->setStatusCode(drogon::k404NotFound);
+        } else if (demRequests_++ < demFailures_) {
+            resp->setStatusCode(drogon::k503ServiceUnavailable);
+        } else {
+            std::string body;
+            for (int row = 0; row < 256; ++row) {
+                for (int col = 0; col < 256; ++col) {
+                    body += col == 0 ? "" : ",";
+                    body += "12.5";
+                }
+                body += "\n";
+            }
+            resp->setStatusCode(drogon::k200OK);
+            resp->setBody(body);
+        }
+        callback(drogon::ReqResult::Ok, resp);
+    }
+
+   private:
+    int demFailures_;
+    std::atomic<int> demRequests_{0};
+};
+
+}  // namespace
+
+TEST(SmartRefreshServiceTest, RetriesReachGsiDespiteTheNegativeCache) {
+    auto mockRepo = std::make_shared<NiceMock<MockRepository>>();
+    // The provider caches the failed DEM fetch for far longer than the retry backoff
+    auto provider = std::make_shared<ScriptedGSIElevationProvider>(2);
+    SmartRefreshService service(mockRepo, provider);
+    service.setRateLimit(1000.0, 10.0);
+    service.setRetryPolicy(3, std::chrono::milliseconds(5));
+
+    EXPECT_CALL(*mockRepo, popRefreshQueue())
+        .WillOnce(Return(std::optional<std::string>("15:29105:12903")))
+        .WillRepeatedly(Return(std::nullopt));
+    EXPECT_CALL(*mockRepo, saveTile(15, 29105, 12903, _, "dem")).WillOnce(Return(true));
+
+    service.startWorker();
+    EXPECT_TRUE(waitFor([&] { return service.getStats().refreshedTotal == 1; }));
+    service.stopWorker();
+
+    EXPECT_EQ(provider->demRequests(), 3);
+    EXPECT_EQ(service.getStats().failedTotal, 0u);
+}
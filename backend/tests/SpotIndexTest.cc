@@ -0,0 +1,178 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../services/SpotIndex.h"
+
+using namespace services;
+
+namespace {
+
+std::vector<Spot> tokyoSpots() {
+    return {
+        {"Cycling Cafe Base", "cafe", 35.681236, 139.767125, 4.5},
+        {"Ramen Energy", "restaurant", 35.698383, 139.773072, 4.2},
+        {"Imperial Palace Rest", "park", 35.685175, 139.752800, 4.8},
+        {"Odaiba Seaside", "park", 35.629000, 139.776000, 4.4},
+    };
+}
+
+std::vector<std::string> namesOf(const SpotIndex& index, const std::vector<size_t>& ids) {
+    std::vector<std::string> names;
+    for (size_t id : ids) names.push_back(index.spot(id).name);
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+}  // namespace
+
+TEST(SpotIndexTest, EmptyIndex) {
+    SpotIndex index;
+    EXPECT_TRUE(index.empty());
+    EXPECT_TRUE(index.queryRadius({35.68, 139.76}, 1000.0).empty());
+}
+
+TEST(SpotIndexTest, QueryRadius) {
+    SpotIndex index(tokyoSpots());
+    ASSERT_EQ(index.size(), 4u);
+
+    // 東京駅から 1.5km 以内: Cycling Cafe Base (0m), Imperial Palace Rest (~1.4km)
+    auto names = namesOf(index, index.queryRadius({35.681236, 139.767125}, 1500.0));
+    EXPECT_EQ(names, (std::vector<std::string>{"Cycling Cafe Base", "Imperial Palace Rest"}));
+
+    EXPECT_TRUE(index.queryRadius({35.0, 135.0}, 1000.0).empty());
+}
+
+TEST(SpotIndexTest, MatchesBruteForce) {
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> lat(35.5, 35.9);
+    std::uniform_real_distribution<double> lon(139.5, 139.9);
+    std::vector<Spot> spots;
+    for (int i = 0; i < 2000; ++i) {
+        spots.push_back({"spot" + std::to_string(i), "cafe", lat(rng), lon(rng), 0.0});
+    }
+    SpotIndex index(spots, 0.005);
+
+    for (int q = 0; q < 20; ++q) {
+        Coordinate center{lat(rng), lon(rng)};
+        std::vector<std::string> expected;
+        for (const auto& spot : spots) {
+            if (SpotIndex::distanceMeters(center, {spot.lat, spot.lon}) <= 2000.0) {
+                expected.push_back(spot.name);
+            }
+        }
+        std::sort(expected.begin(), expected.end());
+        EXPECT_EQ(namesOf(index, index.queryRadius(center, 2000.0)), expected);
+    }
+}
+
+TEST(SpotIndexTest, LoadCsvSkipsInvalidLines) {
+    std::string path = ::testing::TempDir() + "spot_index_test.csv";
+    {
+        std::ofstream out(path);
+        out << "name,type,lat,lon,rating\n";  // Header is skipped
+        out << "Cycling Cafe Base,cafe,35.681236,139.767125,4.5\r\n";
+        out << "broken line\n";
+        out << "No Rating,park,35.0,139.0\n";
+    }
+
+    auto spots = SpotIndex::loadCsv(path);
+    ASSERT_EQ(spots.size(), 2u);
+    EXPECT_EQ(spots[0].name, "Cycling Cafe Base");
+    EXPECT_DOUBLE_EQ(spots[0].rating, 4.5);
+    EXPECT_DOUBLE_EQ(spots[1].rating, 0.0);
+
+    std::remove(path.c_str());
+    EXPECT_TRUE(SpotIndex::loadCsv(path).empty());
+}
+
+TEST(SpotIndexTest, CorridorFindsSpotsBetweenVertices) {
+    // 2 頂点だけの長い直線区間 (東西約 9km)。中間のスポットも区間との距離で判定される
+    std::vector<Coordinate> path = {{35.68, 139.70}, {35.68, 139.80}};
+    std::vector<Spot> spots = {
+        {"east", "cafe", 35.6810, 139.79, 0.0},    // ~110m north, near the end
+        {"middle", "cafe", 35.6795, 139.75, 0.0},  // ~55m south, halfway
+        {"far", "cafe", 35.6900, 139.75, 0.0},     // ~1.1km north
+        {"beyond", "cafe", 35.68, 139.81, 0.0},    // past the end of the route
+    };
+    SpotIndex index(spots);
+
+    auto hits = index.queryCorridor(path, 200.0);
+    ASSERT_EQ(hits.size(), 2u);
+    EXPECT_EQ(index.spot(hits[0].id).name, "middle");
+    EXPECT_EQ(index.spot(hits[1].id).name, "east");
+    EXPECT_NEAR(hits[0].offsetMeters, 55.6, 1.0);
+    EXPECT_NEAR(hits[0].alongMeters, 4510.0, 50.0);
+    EXPECT_LT(hits[0].alongMeters, hits[1].alongMeters);
+}
+
+TEST(SpotIndexTest, CorridorReportsEachSpotOnceAtClosestApproach) {
+    // U ターンするルート: スポットは往路・復路の両方で範囲内だが、近い方の位置で 1 回だけ返る
+    std::vector<Coordinate> path = {{35.680, 139.700}, {35.680, 139.710}, {35.681, 139.710},
+                                    {35.681, 139.700}};
+    SpotIndex index({{"spot", "cafe", 35.6808, 139.705, 0.0}});
+
+    auto hits = index.queryCorridor(path, 150.0);
+    ASSERT_EQ(hits.size(), 1u);
+    EXPECT_NEAR(hits[0].offsetMeters, 22.2, 1.0);
+    // 復路側 (2 区間目の終点以降) が最も近い
+    EXPECT_GT(hits[0].alongMeters, 1000.0);
+}
+
+TEST(SpotIndexTest, CorridorMatchesBruteForce) {
+    std::mt19937 rng(7);
+    std::uniform_real_distribution<double> lat(35.5, 35.9);
+    std::uniform_real_distribution<double> lon(139.5, 139.9);
+    std::vector<Spot> spots;
+    for (int i = 0; i < 1000; ++i) {
+        spots.push_back({"spot" + std::to_string(i), "cafe", lat(rng), lon(rng), 0.0});
+    }
+    SpotIndex index(spots);
+
+    std::vector<Coordinate> path;
+    std::normal_distribution<double> step(0.0, 0.002);
+    Coordinate current{35.7, 139.7};
+    for (int i = 0; i < 100; ++i) {
+        path.push_back(current);
+        current.lat += step(rng);
+        current.lon += step(rng);
+    }
+
+    auto hits = index.queryCorridor(path, 300.0);
+    std::vector<std::string> actual;
+    for (const auto& hit : hits) actual.push_back(index.spot(hit.id).name);
+    std::sort(actual.begin(), actual.end());
+
+    // 各区間上の点との距離で期待値を作る
+    std::vector<std::string> expected;
+    for (const auto& spot : spots) {
+        Coordinate p{spot.lat, spot.lon};
+        for (size_t s = 0; s + 1 < path.size(); ++s) {
+            // 区間を細かく分割して最近傍を近似
+            bool inside = false;
+            for (int k = 0; k <= 50 && !inside; ++k) {
+                double f = k / 50.0;
+                Coordinate q{path[s].lat + (path[s + 1].lat - path[s].lat) * f,
+                             path[s].lon + (path[s + 1].lon - path[s].lon) * f};
+                inside = SpotIndex::distanceMeters(p, q) <= 299.0;
+            }
+            if (inside) {
+                expected.push_back(spot.name);
+                break;
+            }
+        }
+    }
+    std::sort(expected.begin(), expected.end());
+
+    // 境界付近の近似誤差を許容するため、期待値 (内側 299m) はすべて含まれることを確認する
+    EXPECT_TRUE(std::includes(actual.begin(), actual.end(), expected.begin(), expected.end()));
+    for (const auto& hit : hits) EXPECT_LE(hit.offsetMeters, 300.0);
+    EXPECT_TRUE(std::is_sorted(hits.begin(), hits.end(), [](const auto& x, const auto& y) {
+        return x.alongMeters < y.alongMeters;
+    }));
+}
@@ -0,0 +1,120 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../services/ConfigService.h"
+#include "../services/SpotSearchJobs.h"
+#include "../services/SpotService.h"
+
+using namespace services;
+
+namespace {
+
+// Blocks every search until release() so tests can observe the pending state
+class BlockingSpotService : public SpotService {
+   public:
+    explicit BlockingSpotService(const ConfigService& config) : SpotService(config) {}
+
+    using SpotService::searchSpotsAlongRoute;
+    std::vector<Spot> searchSpotsAlongRoute(std::span<const Coordinate> path,
+                                            double radius) override {
+        std::unique_lock<std::mutex> lock(mutex_);
+        cv_.wait(lock, [this] { return released_; });
+        Spot spot;
+        spot.name = "Spot for " + std::to_string(path.size()) + " points";
+        return {spot};
+    }
+
+    void release() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            released_ = true;
+        }
+        cv_.notify_all();
+    }
+
+   private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    bool released_ = false;
+};
+
+std::shared_ptr<const std::vector<Coordinate>> makePath(size_t points) {
+    return std::make_shared<const std::vector<Coordinate>>(points, Coordinate{35.0, 139.0});
+}
+
+SpotSearchJobs::Lookup waitForResult(SpotSearchJobs& jobs, const std::string& token) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    auto lookup = jobs.lookup(token);
+    while (lookup.status == SpotSearchJobs::Status::Pending &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        lookup = jobs.lookup(token);
+    }
+    return lookup;
+}
+
+}  // namespace
+
+TEST(SpotSearchJobsTest, PendingUntilSearchCompletes) {
+    ConfigService config;
+    auto spotService = std::make_shared<BlockingSpotService>(config);
+    SpotSearchJobs jobs(spotService, 1, 10, std::chrono::seconds(60));
+
+    auto token = jobs.submit(makePath(3), 100.0);
+    ASSERT_TRUE(token.has_value());
+    EXPECT_EQ(jobs.lookup(*token).status, SpotSearchJobs::Status::Pending);
+    EXPECT_EQ(jobs.pendingCount(), 1u);
+
+    spotService->release();
+    auto lookup = waitForResult(jobs, *token);
+    ASSERT_EQ(lookup.status, SpotSearchJobs::Status::Ready);
+    ASSERT_EQ(lookup.spots.size(), 1u);
+    EXPECT_EQ(lookup.spots[0].name, "Spot for 3 points");
+    EXPECT_EQ(jobs.pendingCount(), 0u);
+
+    // Results stay readable until they expire
+    EXPECT_EQ(jobs.lookup(*token).status, SpotSearchJobs::Status::Ready);
+}
+
+TEST(SpotSearchJobsTest, UnknownTokenIsNotFound) {
+    ConfigService config;
+    auto spotService = std::make_shared<BlockingSpotService>(config);
+    SpotSearchJobs jobs(spotService, 1, 10, std::chrono::seconds(60));
+
+    EXPECT_EQ(jobs.lookup("no-such-token").status, SpotSearchJobs::Status::NotFound);
+    spotService->release();
+}
+
+TEST(SpotSearchJobsTest, RejectsWhenQueueIsFull) {
+    ConfigService config;
+    auto spotService = std::make_shared<BlockingSpotService>(config);
+    SpotSearchJobs jobs(spotService, 1, 2, std::chrono::seconds(60));
+
+    auto first = jobs.submit(makePath(1), 100.0);
+    auto second = jobs.submit(makePath(2), 100.0);
+    ASSERT_TRUE(first.has_value());
+    ASSERT_TRUE(second.has_value());
+    EXPECT_NE(*first, *second);
+    EXPECT_FALSE(jobs.submit(makePath(3), 100.0).has_value());
+
+    spotService->release();
+    EXPECT_EQ(waitForResult(jobs, *second).status, SpotSearchJobs::Status::Ready);
+    EXPECT_TRUE(jobs.submit(makePath(3), 100.0).has_value());
+}
+
+TEST(SpotSearchJobsTest, ResultsExpireAfterTtl) {
+    ConfigService config;
+    auto spotService = std::make_shared<BlockingSpotService>(config);
+    spotService->release();
+    SpotSearchJobs jobs(spotService, 1, 10, std::chrono::seconds(0));
+
+    auto token = jobs.submit(makePath(3), 100.0);
+    ASSERT_TRUE(token.has_value());
+    EXPECT_EQ(waitForResult(jobs, *token).status, SpotSearchJobs::Status::NotFound);
+}
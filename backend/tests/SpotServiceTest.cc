@@ -28,6 +28,83 @@ class SpotServiceTest : public ::testing::Test {
 // Google Maps
 // APIへのモック実装が難しいため、実際のネットワーク呼び出しを行うテストはスキップします。
 // 将来的には、HttpClientをモックできるようにリファクタリングしてテストを有効化すべきです。
+TEST_F(SpotServiceTest, SearchSpotsAlongRoute_LocalIndex) {
+    auto index = std::make_shared<const SpotIndex>(std::vector<Spot>{
+        {"Ueno Park Cafe", "cafe", 35.714074, 139.774109, 4.3},
+        {"Cycling Cafe Base", "cafe", 35.681236, 139.767125, 4.5},
+        {"Odaiba Seaside", "park", 35.629000, 139.776000, 4.4},
+    });
+    SpotService service(*configService, index);
+
+    // 東京駅 -> 上野 (お台場は経路から離れている)
+    // RouteResult::geometry と同じ polyline6 で渡す
+    std::string polyline = PolylineDecoder::encode(
+        {{35.681236, 139.767125}, {35.698383, 139.773072}, {35.714074, 139.774109}}, 1e6);
+    auto spots = service.searchSpotsAlongRoute(polyline, 300.0, 1e6);
+
+    ASSERT_EQ(spots.size(), 2u);
+    // ルート順に並ぶ
+    EXPECT_EQ(spots[0].name, "Cycling Cafe Base");
+    EXPECT_EQ(spots[1].name, "Ueno Park Cafe");
+}
+
+TEST_F(SpotServiceTest, SearchSpotsAlongRoute_DecodedPath) {
+    auto index = std::make_shared<const SpotIndex>(std::vector<Spot>{
+        {"Ueno Park Cafe", "cafe", 35.714074, 139.774109, 4.3},
+        {"Odaiba Seaside", "park", 35.629000, 139.776000, 4.4},
+    });
+    SpotService service(*configService, index);
+
+    // 座標列をそのまま渡す (ポリラインを経由しない)
+    std::vector<Coordinate> path{{35.681236, 139.767125}, {35.714074, 139.774109}};
+    auto spots = service.searchSpotsAlongRoute(std::span<const Coordinate>(path), 300.0);
+
+    ASSERT_EQ(spots.size(), 1u);
+    EXPECT_EQ(spots[0].name, "Ueno Park Cafe");
+    EXPECT_TRUE(service.searchSpotsAlongRoute(std::span<const Coordinate>(), 300.0).empty());
+}
+
+TEST_F(SpotServiceTest, ParsePlacesResponse) {
+    Json::Value json;
+    json["status"] = "OK";
+    Json::Value item;
+    item["name"] = "Cycling Cafe Base";
+    item["geometry"]["location"]["lat"] = 35.681236;
+    item["geometry"]["location"]["lng"] = 139.767125;
+    item["rating"] = 4.5;
+    item["types"].append("cafe");
+    json["results"].append(item);
+
+    std::vector<Spot> spots;
+    EXPECT_EQ(SpotService::parsePlacesResponse(json, spots), SpotService::PlacesStatus::Ok);
+    ASSERT_EQ(spots.size(), 1u);
+    EXPECT_EQ(spots[0].name, "Cycling Cafe Base");
+    EXPECT_EQ(spots[0].type, "cafe");
+    EXPECT_DOUBLE_EQ(spots[0].lon, 139.767125);
+
+    Json::Value zero;
+    zero["status"] = "ZERO_RESULTS";
+    EXPECT_EQ(SpotService::parsePlacesResponse(zero, spots), SpotService::PlacesStatus::Ok);
+
+    Json::Value overLimit;
+    overLimit["status"] = "OVER_QUERY_LIMIT";
+    EXPECT_EQ(SpotService::parsePlacesResponse(overLimit, spots),
+              SpotService::PlacesStatus::Retryable);
+
+    Json::Value denied;
+    denied["status"] = "REQUEST_DENIED";
+    EXPECT_EQ(SpotService::parsePlacesResponse(denied, spots), SpotService::PlacesStatus::Failed);
+}
+
+TEST_F(SpotServiceTest, RetryDelayBacksOffWithJitter) {
+    EXPECT_EQ(SpotService::retryDelay(1, 0.5).count(), 500);
+    EXPECT_EQ(SpotService::retryDelay(2, 0.5).count(), 1000);
+    EXPECT_EQ(SpotService::retryDelay(3, 0.5).count(), 2000);
+    // ジッターは 50%〜150%
+    EXPECT_EQ(SpotService::retryDelay(2, 0.0).count(), 500);
+    EXPECT_EQ(SpotService::retryDelay(2, 1.0).count(), 1500);
+}
+
 TEST_F(SpotServiceTest, DISABLED_SearchSpotsAlongPath_Simple) {
     // ...
 }
@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <thread>
+
+#include "../utils/TokenBucket.h"
+
+namespace {
+
+TEST(TokenBucketTest, BurstThenEmpty) {
+    cycling::utils::TokenBucket bucket(1.0, 3.0);
+
+    EXPECT_TRUE(bucket.tryAcquire());
+    EXPECT_TRUE(bucket.tryAcquire());
+    EXPECT_TRUE(bucket.tryAcquire());
+    EXPECT_FALSE(bucket.tryAcquire());
+}
+
+TEST(TokenBucketTest, RefillsOverTime) {
+    cycling::utils::TokenBucket bucket(100.0, 1.0);
+    EXPECT_TRUE(bucket.tryAcquire());
+    EXPECT_FALSE(bucket.tryAcquire());
+
+    // 100 tokens/s -> one token every 10ms
+    std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    EXPECT_TRUE(bucket.tryAcquire());
+}
+
+TEST(TokenBucketTest, TimeUntilAvailable) {
+    cycling::utils::TokenBucket bucket(10.0, 1.0);
+    EXPECT_EQ(bucket.timeUntilAvailable(), cycling::utils::TokenBucket::Clock::duration::zero());
+
+    EXPECT_TRUE(bucket.tryAcquire());
+    auto wait = bucket.timeUntilAvailable();
+    EXPECT_GT(wait, std::chrono::milliseconds(0));
+    EXPECT_LE(wait, std::chrono::milliseconds(101));
+}
+
+TEST(TokenBucketTest, ZeroRateNeverRefills) {
+    cycling::utils::TokenBucket bucket(0.0, 1.0);
+    EXPECT_TRUE(bucket.tryAcquire());
+    EXPECT_FALSE(bucket.tryAcquire());
+    EXPECT_EQ(bucket.timeUntilAvailable(), cycling::utils::TokenBucket::Clock::duration::max());
+}
+
+}  // namespace
@@ -0,0 +1,81 @@
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+
+#include "../utils/Trace.h"
+
+using utils::Trace;
+using utils::TraceSpan;
+
+TEST(TraceTest, SpansWithoutCurrentTraceAreNoOps) {
+    EXPECT_EQ(Trace::current(), nullptr);
+    TraceSpan span("osrm");
+    EXPECT_FALSE(span.active());
+}
+
+TEST(TraceTest, NestedSpansFormATree) {
+    auto trace = std::make_shared<Trace>();
+    {
+        Trace::Scope scope(trace.get());
+        TraceSpan candidate("candidate");
+        {
+            TraceSpan osrm("osrm");
+        }
+        {
+            TraceSpan tile("tile");
+            tile.setDetail("l1");
+        }
+    }
+    EXPECT_EQ(Trace::current(), nullptr);
+
+    auto spans = trace->spans();
+    ASSERT_EQ(spans.size(), 3u);
+    EXPECT_EQ(spans[0].parent, Trace::kNoSpan);
+    EXPECT_EQ(spans[1].parent, 0);
+    EXPECT_EQ(spans[2].parent, 0);
+    EXPECT_EQ(spans[2].detail, "l1");
+
+    auto json = trace->toJson();
+    ASSERT_EQ(json["spans"].size(), 1u);
+    const auto& root = json["spans"][0];
+    EXPECT_EQ(root["name"].asString(), "candidate");
+    ASSERT_EQ(root["children"].size(), 2u);
+    EXPECT_EQ(root["children"][1]["detail"].asString(), "l1");
+    EXPECT_GE(root["duration_ms"].asDouble(), root["children"][0]["duration_ms"].asDouble());
+}
+
+TEST(TraceTest, ServerTimingAggregatesByName) {
+    auto trace = std::make_shared<Trace>();
+    auto now = Trace::Clock::now();
+    trace->add("osrm", Trace::kNoSpan, now, now + std::chrono::milliseconds(2));
+    trace->add("tile", Trace::kNoSpan, now, now + std::chrono::microseconds(500));
+    trace->add("osrm", Trace::kNoSpan, now, now + std::chrono::milliseconds(3));
+
+    std::string header = trace->serverTiming();
+    EXPECT_EQ(header.rfind("osrm;desc=\"x2\";dur=5.00, tile;dur=0.50, total;dur=", 0), 0u)
+        << header;
+}
+
+TEST(TraceTest, RecordsSpansFromOtherThreadsAndCapsTheArena) {
+    auto trace = std::make_shared<Trace>(2);
+    int parent;
+    {
+        Trace::Scope scope(trace.get());
+        TraceSpan search("places_search");
+        parent = Trace::currentSpan();
+        std::thread([trace, parent]() {
+            auto now = Trace::Clock::now();
+            trace->add("places", parent, now, now, "ok attempt=0");
+            trace->add("places", parent, now, now, "ok attempt=0");
+        }).join();
+    }
+    EXPECT_EQ(trace->spans().size(), 2u);
+    EXPECT_EQ(trace->spans()[1].parent, parent);
+    EXPECT_EQ(trace->dropped(), 1u);
+
+    auto chrome = trace->toChromeTrace();
+    ASSERT_EQ(chrome["traceEvents"].size(), 2u);
+    EXPECT_EQ(chrome["traceEvents"][1]["ph"].asString(), "X");
+    EXPECT_NE(chrome["traceEvents"][0]["tid"], chrome["traceEvents"][1]["tid"]);
+}
@@ -9,6 +9,7 @@
 #include <iostream>
 #include <thread>
 
+#include "../../services/PlacesCache.h"
 #include "../../services/elevation/RedisElevationAdapter.h"
 
 using namespace services::elevation;
@@ -165,7 +166,7 @@ TEST_F(RedisIntegrationTest, SaveAndGetTile) {
     std::string content = "1.0,2.0,3.0";
 
     // Save
-    bool saved = adapter_->saveTile(z, x, y, content);
+    bool saved = adapter_->saveTile(z, x, y, content, "dem5a");
     EXPECT_TRUE(saved);
 
     // Get
@@ -173,6 +174,7 @@ TEST_F(RedisIntegrationTest, SaveAndGetTile) {
     ASSERT_TRUE(entry.has_value());
     EXPECT_EQ(entry->content, content);
     EXPECT_GT(entry->updated_at, 0);
+    EXPECT_EQ(entry->source, "dem5a");
 }
 
 TEST_F(RedisIntegrationTest, BinarySafety) {
@@ -182,7 +184,7 @@ TEST_F(RedisIntegrationTest, BinarySafety) {
     std::string binaryContent = "start\0middle\0end"s;
 
     // Save
-    bool saved = adapter_->saveTile(z, x, y, binaryContent);
+    bool saved = adapter_->saveTile(z, x, y, binaryContent, "dem");
     EXPECT_TRUE(saved);
 
     // Get
@@ -204,6 +206,42 @@ TEST_F(RedisIntegrationTest, RefreshQueue) {
     EXPECT_EQ(*popped, "10:1:2");
 }
 
+TEST_F(RedisIntegrationTest, RefreshQueueBatchIsVisibleOnReturn) {
+    if (!redisClient_ || !adapter_) GTEST_SKIP() << "Redis client or adapter is null";
+    adapter_->addToRefreshQueueBatch({"10:3:4"});
+
+    // No wait: the batch returns after the SADD replies
+    auto popped = adapter_->popRefreshQueue();
+    ASSERT_TRUE(popped.has_value());
+    EXPECT_EQ(*popped, "10:3:4");
+}
+
+TEST_F(RedisIntegrationTest, PlacesCacheGetManyReadsL2InOneBatch) {
+    if (!redisClient_) GTEST_SKIP() << "Redis client is null";
+    services::PlacesCache writer(10, std::chrono::hours(1));
+    writer.setRedisClient(redisClient_);
+    auto first = services::PlacesCache::makeKey("xn76urx", 500, "cafe");
+    auto second = services::PlacesCache::makeKey("xn76ury", 500, "cafe");
+    writer.put(first, {services::Spot{"Cafe A", "cafe", 35.0, 139.0, 4.0}});
+    writer.put(second, {services::Spot{"Cafe B", "cafe", 35.1, 139.1, 4.5}});
+
+    // A fresh instance has an empty L1, so every hit comes from Redis
+    services::PlacesCache reader(10, std::chrono::hours(1));
+    reader.setRedisClient(redisClient_);
+    std::vector<std::optional<std::vector<services::Spot>>> results;
+    for (int attempt = 0; attempt < 20; ++attempt) {
+        results = reader.getMany({first, "cycling:places:v1:absent", second});
+        if (results[0] && results[2]) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));  // SETEX is async
+    }
+    ASSERT_TRUE(results[0].has_value());
+    EXPECT_EQ((*results[0])[0].name, "Cafe A");
+    EXPECT_FALSE(results[1].has_value());
+    ASSERT_TRUE(results[2].has_value());
+    EXPECT_EQ((*results[2])[0].name, "Cafe B");
+    EXPECT_GE(reader.getStats().l2Hits, 2u);
+}
+
 TEST_F(RedisIntegrationTest, ScoreAndDecay) {
     if (!redisClient_ || !adapter_) GTEST_SKIP() << "Redis client or adapter is null";
     int z = 15, x = 0, y = 0;
@@ -0,0 +1,452 @@
+// 負荷生成器: 一定の到着レート (オープンループ) で /api/v1/route/generate に要求を送り、
+// 応答時間の分布と実際に捌けたスループットを計測する
+//
+// 使い方:
+//   load_generator [--url http://localhost:8080] [--path /api/v1/route/generate]
+//                  [--rate 50] [--duration-sec 30] [--warmup-sec 5] [--connections 64]
+//                  [--threads 4] [--timeout-sec 30] [--poisson]
+//                  [--routes tests/integration/data/test_routes.json]
+//                  [--scenarios tests/data/simulation_scenarios.csv] [--generate 1000]
+//                  [--seed 1] [--csv latency.csv] [--json report.json]
+//
+//   --rate        1 秒あたりの要求数。応答を待たずに予定時刻どおり送る
+//   --poisson     送信間隔を一定ではなく指数分布にする (到着をポアソン過程にする)
+//   --routes      地点一覧の JSON。近い地点同士の組み合わせを出発地・目的地にする
+//   --scenarios   指定するとシナリオ CSV の条件 (目標距離・獲得標高つき) を使う
+//
+// 応答時間は予定していた送信時刻から測る (協調的欠落の補正)。サーバーが詰まって
+// 送信が遅れた分も待ち時間として数えるので、飽和点を過ぎると p99 がはっきり伸びる。
+// 比較用に実際に送信した時刻から測った値 (補正なし) も出力する。
+// タイムアウト・通信エラー・終了時に応答待ちのまま打ち切った要求も、その時点までの
+// 経過時間で全体の分布に含める (除くと飽和点付近の最も遅い標本だけが抜け落ちる)。
+// 2xx とそれ以外 (すぐ返る 503 など) の分布は別にも出す。
+
+#include <drogon/HttpClient.h>
+#include <json/json.h>
+#include <trantor/net/EventLoopThreadPool.h>
+#include <trantor/utils/Logger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "load/HdrHistogram.h"
+#include "replay/Scenario.h"
+
+using tools::load::HdrHistogram;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// 1us〜1 時間を有効桁数 3 で記録する
+constexpr int64_t kHistogramLowestMicros = 1;
+constexpr int64_t kHistogramHighestMicros = 3'600'000'000;
+constexpr int kHistogramDigits = 3;
+// test_routes.json の地点は、この距離 (度) 以内の組み合わせだけを使う
+constexpr double kMaxPairDegrees = 0.5;
+constexpr double kPercentiles[] = {50.0, 75.0, 90.0, 95.0, 99.0, 99.9, 99.99, 100.0};
+
+struct Options {
+    std::string url = "http://localhost:8080";
+    std::string path = "/api/v1/route/generate";
+    double rate = 50.0;
+    double durationSec = 30.0;
+    double warmupSec = 5.0;
+    size_t connections = 64;
+    size_t threads = 4;
+    double timeoutSec = 30.0;
+    bool poisson = false;
+    std::string routesPath = "tests/integration/data/test_routes.json";
+    std::string scenariosPath;
+    size_t generate = 0;
+    uint32_t seed = 1;
+    std::string csvPath;
+    std::string jsonPath;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--poisson") {
+            options.poisson = true;
+            continue;
+        }
+        if (!(value = next())) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        if (arg == "--url") {
+            options.url = value;
+        } else if (arg == "--path") {
+            options.path = value;
+        } else if (arg == "--rate") {
+            options.rate = std::strtod(value, nullptr);
+        } else if (arg == "--duration-sec") {
+            options.durationSec = std::strtod(value, nullptr);
+        } else if (arg == "--warmup-sec") {
+            options.warmupSec = std::strtod(value, nullptr);
+        } else if (arg == "--connections") {
+            options.connections = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--threads") {
+            options.threads = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--timeout-sec") {
+            options.timeoutSec = std::strtod(value, nullptr);
+        } else if (arg == "--routes") {
+            options.routesPath = value;
+        } else if (arg == "--scenarios") {
+            options.scenariosPath = value;
+        } else if (arg == "--generate") {
+            options.generate = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--csv") {
+            options.csvPath = value;
+        } else if (arg == "--json") {
+            options.jsonPath = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.rate <= 0 || options.durationSec <= 0 || options.connections == 0 ||
+        options.threads == 0) {
+        std::cerr << "--rate, --duration-sec, --connections and --threads must be positive"
+                  << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::string toBody(const Json::Value& json) {
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    return Json::writeString(builder, json);
+}
+
+Json::Value point(double lat, double lon) {
+    Json::Value json;
+    json["lat"] = lat;
+    json["lon"] = lon;
+    return json;
+}
+
+std::vector<std::string> loadRouteBodies(const std::string& path) {
+    std::ifstream file(path);
+    Json::Value places;
+    if (!file.is_open() ||
+        !Json::parseFromStream(Json::CharReaderBuilder(), file, &places, nullptr) ||
+        !places.isArray()) {
+        return {};
+    }
+    std::vector<std::string> bodies;
+    for (const auto& from : places) {
+        for (const auto& to : places) {
+            double dLat = from["lat"].asDouble() - to["lat"].asDouble();
+            double dLon = from["lon"].asDouble() - to["lon"].asDouble();
+            if (&from == &to || std::hypot(dLat, dLon) > kMaxPairDegrees) continue;
+            Json::Value body;
+            body["start_point"] = point(from["lat"].asDouble(), from["lon"].asDouble());
+            body["end_point"] = point(to["lat"].asDouble(), to["lon"].asDouble());
+            bodies.push_back(toBody(body));
+        }
+    }
+    return bodies;
+}
+
+std::vector<std::string> loadScenarioBodies(const Options& options) {
+    auto scenarios = tools::replay::loadScenarios(options.scenariosPath);
+    if (options.generate > 0 && !scenarios.empty()) {
+        scenarios = tools::replay::generateScenarios(scenarios, options.generate, options.seed);
+    }
+    std::vector<std::string> bodies;
+    bodies.reserve(scenarios.size());
+    for (const auto& scenario : scenarios) {
+        Json::Value body;
+        body["start_point"] = point(scenario.start.lat, scenario.start.lon);
+        body["end_point"] = point(scenario.end.lat, scenario.end.lon);
+        body["preferences"]["target_distance_km"] = scenario.targetDistanceKm;
+        body["preferences"]["target_elevation_gain_m"] = scenario.targetElevationM;
+        bodies.push_back(toBody(body));
+    }
+    return bodies;
+}
+
+// 送信した 1 要求。応答のコールバックか、終了時に打ち切るメインスレッドの一方だけが集計する
+struct PendingRequest {
+    Clock::time_point intended;
+    Clock::time_point dispatched;
+    bool measured = false;
+    std::atomic<bool> settled{false};
+
+    bool claim() { return !settled.exchange(true, std::memory_order_acq_rel); }
+};
+
+// 予定時刻から (補正あり) と実際の送信時刻から (補正なし) の応答時間
+struct Latency {
+    HdrHistogram corrected{kHistogramLowestMicros, kHistogramHighestMicros, kHistogramDigits};
+    HdrHistogram uncorrected{kHistogramLowestMicros, kHistogramHighestMicros, kHistogramDigits};
+
+    void record(const PendingRequest& request, Clock::time_point now) {
+        corrected.record(
+            std::chrono::duration_cast<std::chrono::microseconds>(now - request.intended).count());
+        uncorrected.record(std::chrono::duration_cast<std::chrono::microseconds>(
+                               now - request.dispatched)
+                               .count());
+    }
+    void merge(const Latency& other) {
+        corrected.merge(other.corrected);
+        uncorrected.merge(other.uncorrected);
+    }
+};
+
+// イベントループごとの集計。そのループのスレッドからしか触らない
+struct LoopStats {
+    Latency all;     // 全要求 (タイムアウト・エラー・打ち切りを含む)
+    Latency ok;      // 2xx のみ
+    Latency failed;  // 2xx 以外・タイムアウト・エラー・打ち切り
+    uint64_t okCount = 0;
+    uint64_t non2xx = 0;
+    uint64_t timeouts = 0;
+    uint64_t errors = 0;
+    uint64_t abandoned = 0;
+
+    void merge(const LoopStats& other) {
+        all.merge(other.all);
+        ok.merge(other.ok);
+        failed.merge(other.failed);
+        okCount += other.okCount;
+        non2xx += other.non2xx;
+        timeouts += other.timeouts;
+        errors += other.errors;
+        abandoned += other.abandoned;
+    }
+};
+
+double toMillis(int64_t micros) { return static_cast<double>(micros) / 1000.0; }
+
+Json::Value latencyJson(const HdrHistogram& histogram) {
+    Json::Value json;
+    json["count"] = static_cast<Json::Int64>(histogram.totalCount());
+    json["mean"] = histogram.mean() / 1000.0;
+    json["min"] = toMillis(histogram.min());
+    for (double p : kPercentiles) {
+        std::ostringstream name;
+        name << "p" << p;
+        json[p == 100.0 ? "max" : name.str()] = toMillis(histogram.valueAtPercentile(p));
+    }
+    return json;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    auto bodies = options.scenariosPath.empty() ? loadRouteBodies(options.routesPath)
+                                                : loadScenarioBodies(options);
+    if (bodies.empty()) {
+        std::cerr << "No requests loaded from "
+                  << (options.scenariosPath.empty() ? options.routesPath : options.scenariosPath)
+                  << std::endl;
+        return 1;
+    }
+    trantor::Logger::setLogLevel(trantor::Logger::kWarn);
+
+    trantor::EventLoopThreadPool pool(options.threads, "LoadGenerator");
+    pool.start();
+    std::vector<LoopStats> stats(options.threads);
+    std::vector<drogon::HttpClientPtr> clients;
+    std::vector<size_t> clientLoop;
+    for (size_t c = 0; c < options.connections; ++c) {
+        size_t loopIndex = c % options.threads;
+        auto client = drogon::HttpClient::newHttpClient(options.url, pool.getLoop(loopIndex));
+        // 1 接続 1 要求。空いている接続がなければクライアント内で順番待ちになり、
+        // その待ち時間も予定時刻からの応答時間に含まれる
+        client->setPipeliningDepth(0);
+        clients.push_back(std::move(client));
+        clientLoop.push_back(loopIndex);
+    }
+
+    std::cout << "Sending " << options.rate << " req/s to " << options.url << options.path
+              << " for " << options.warmupSec << "s warmup + " << options.durationSec
+              << "s (" << bodies.size() << " request bodies, " << options.connections
+              << " connections)" << std::endl;
+
+    std::mt19937 rng(options.seed);
+    std::uniform_int_distribution<size_t> pickBody(0, bodies.size() - 1);
+    std::exponential_distribution<double> poissonGap(options.rate);
+    std::atomic<int64_t> inFlight{0};
+    std::vector<std::shared_ptr<PendingRequest>> requests;
+    uint64_t sent = 0;
+    uint64_t measuredSent = 0;
+    double maxLagMs = 0.0;
+
+    auto start = Clock::now();
+    auto measureStart = start + std::chrono::duration_cast<Clock::duration>(
+                                    std::chrono::duration<double>(options.warmupSec));
+    auto end = measureStart + std::chrono::duration_cast<Clock::duration>(
+                                  std::chrono::duration<double>(options.durationSec));
+    double offsetSec = 0.0;
+    while (true) {
+        auto intended = start + std::chrono::duration_cast<Clock::duration>(
+                                    std::chrono::duration<double>(offsetSec));
+        if (intended >= end) break;
+        offsetSec += options.poisson ? poissonGap(rng) : 1.0 / options.rate;
+
+        std::this_thread::sleep_until(intended);
+        auto dispatched = Clock::now();
+        maxLagMs = std::max(
+            maxLagMs, std::chrono::duration<double, std::milli>(dispatched - intended).count());
+
+        size_t c = sent++ % clients.size();
+        auto pending = std::make_shared<PendingRequest>();
+        pending->intended = intended;
+        pending->dispatched = dispatched;
+        pending->measured = intended >= measureStart;
+        measuredSent += pending->measured ? 1 : 0;
+        requests.push_back(pending);
+
+        auto req = drogon::HttpRequest::newHttpRequest();
+        req->setMethod(drogon::Post);
+        req->setPath(options.path);
+        req->setContentTypeCode(drogon::CT_APPLICATION_JSON);
+        req->setBody(bodies[pickBody(rng)]);
+
+        inFlight.fetch_add(1, std::memory_order_relaxed);
+        LoopStats& loopStats = stats[clientLoop[c]];
+        clients[c]->sendRequest(
+            req,
+            [&loopStats, &inFlight, pending](drogon::ReqResult result,
+                                             const drogon::HttpResponsePtr& resp) {
+                // 終了時に打ち切り済みなら集計には触らない
+                if (!pending->claim()) return;
+                if (pending->measured) {
+                    auto now = Clock::now();
+                    bool ok = false;
+                    if (result == drogon::ReqResult::Ok && resp) {
+                        int status = resp->getStatusCode();
+                        ok = status >= 200 && status < 300;
+                        (ok ? loopStats.okCount : loopStats.non2xx)++;
+                    } else if (result == drogon::ReqResult::Timeout) {
+                        loopStats.timeouts++;
+                    } else {
+                        loopStats.errors++;
+                    }
+                    loopStats.all.record(*pending, now);
+                    (ok ? loopStats.ok : loopStats.failed).record(*pending, now);
+                }
+                // 集計の書き込みを、inFlight を読んだメインスレッドから見えるようにする
+                inFlight.fetch_sub(1, std::memory_order_release);
+            },
+            options.timeoutSec);
+    }
+
+    // 送信済みの要求の応答 (またはタイムアウト) を待つ
+    auto drainDeadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                                            std::chrono::duration<double>(options.timeoutSec + 1));
+    while (inFlight.load(std::memory_order_acquire) > 0 && Clock::now() < drainDeadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // それでも応答のない要求は打ち切り、ここまでの経過時間で数える
+    LoopStats total;
+    auto abandonedAt = Clock::now();
+    for (const auto& pending : requests) {
+        if (!pending->claim()) continue;
+        inFlight.fetch_sub(1, std::memory_order_relaxed);
+        if (!pending->measured) continue;
+        total.abandoned++;
+        total.all.record(*pending, abandonedAt);
+        total.failed.record(*pending, abandonedAt);
+    }
+    // 打ち切る前に集計を始めていたコールバックが書き終えるのを待つ
+    while (inFlight.load(std::memory_order_acquire) > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    if (total.abandoned > 0) {
+        std::cerr << total.abandoned << " requests still in flight after the timeout"
+                  << std::endl;
+    }
+    double measuredSec = std::chrono::duration<double>(end - measureStart).count();
+
+    for (const auto& loopStats : stats) {
+        total.merge(loopStats);
+    }
+
+    Json::Value report;
+    report["target_rate"] = options.rate;
+    report["arrival"] = options.poisson ? "poisson" : "constant";
+    report["duration_sec"] = measuredSec;
+    report["connections"] = static_cast<Json::UInt64>(options.connections);
+    report["sent"] = static_cast<Json::UInt64>(measuredSent);
+    report["ok"] = static_cast<Json::UInt64>(total.okCount);
+    report["non_2xx"] = static_cast<Json::UInt64>(total.non2xx);
+    report["timeouts"] = static_cast<Json::UInt64>(total.timeouts);
+    report["errors"] = static_cast<Json::UInt64>(total.errors);
+    report["abandoned"] = static_cast<Json::UInt64>(total.abandoned);
+    report["achieved_rate"] = static_cast<double>(total.okCount) / measuredSec;
+    report["max_send_lag_ms"] = maxLagMs;
+    report["latency_ms"]["corrected"] = latencyJson(total.all.corrected);
+    report["latency_ms"]["uncorrected"] = latencyJson(total.all.uncorrected);
+    report["latency_ms"]["ok"]["corrected"] = latencyJson(total.ok.corrected);
+    report["latency_ms"]["ok"]["uncorrected"] = latencyJson(total.ok.uncorrected);
+    report["latency_ms"]["failed"]["corrected"] = latencyJson(total.failed.corrected);
+    report["latency_ms"]["failed"]["uncorrected"] = latencyJson(total.failed.uncorrected);
+
+    // 列: 全要求 (補正あり・なし)、2xx のみ、2xx 以外 (いずれも補正あり)
+    std::cout << std::fixed << std::setprecision(2) << "Sent: " << measuredSent
+              << "  OK: " << total.okCount << "  Non-2xx: " << total.non2xx
+              << "  Timeouts: " << total.timeouts << "  Errors: " << total.errors
+              << "  Abandoned: " << total.abandoned << "\n"
+              << "Throughput: " << report["achieved_rate"].asDouble() << " req/s (target "
+              << options.rate << ")  Max send lag: " << maxLagMs << " ms\n\n"
+              << std::setw(10) << "percentile" << std::setw(16) << "corrected_ms"
+              << std::setw(16) << "uncorrected_ms" << std::setw(16) << "ok_ms" << std::setw(16)
+              << "failed_ms" << "\n";
+    for (double p : kPercentiles) {
+        std::cout << std::setw(10) << p << std::setw(16)
+                  << toMillis(total.all.corrected.valueAtPercentile(p)) << std::setw(16)
+                  << toMillis(total.all.uncorrected.valueAtPercentile(p)) << std::setw(16)
+                  << toMillis(total.ok.corrected.valueAtPercentile(p)) << std::setw(16)
+                  << toMillis(total.failed.corrected.valueAtPercentile(p)) << "\n";
+    }
+
+    if (!options.csvPath.empty()) {
+        std::ofstream out(options.csvPath, std::ios::trunc);
+        out << "percentile,corrected_ms,uncorrected_ms,ok_ms,failed_ms\n";
+        for (double p : kPercentiles) {
+            out << p << "," << toMillis(total.all.corrected.valueAtPercentile(p)) << ","
+                << toMillis(total.all.uncorrected.valueAtPercentile(p)) << ","
+                << toMillis(total.ok.corrected.valueAtPercentile(p)) << ","
+                << toMillis(total.failed.corrected.valueAtPercentile(p)) << "\n";
+        }
+        std::cout << "\nWrote " << options.csvPath << std::endl;
+    }
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath, std::ios::trunc);
+        out << report.toStyledString();
+        std::cout << "\nWrote " << options.jsonPath << std::endl;
+    }
+    if (total.abandoned > 0) {
+        // 応答待ちの要求を抱えたクライアントを破棄しないよう、そのまま終える
+        std::cout.flush();
+        std::_Exit(1);
+    }
+    return 0;
+}
@@ -0,0 +1,325 @@
+// シナリオリプレイ: OSRM・GSI・Places なしで Route::generate を大量に実行し、
+// 段階ごとの処理時間と結果の品質を集計する
+//
+// 使い方:
+//   scenario_replay [--scenarios tests/data/simulation_scenarios.csv] [--generate 2000]
+//                   [--seed 1] [--recordings osrm_recordings.jsonl] [--record]
+//                   [--cold-tile-us 0] [--json report.json]
+//
+//   --recordings  記録済みの OSRM 応答。記録にない要求は合成ルートで応答する
+//   --record      記録にない要求を実際の OSRM (OSRM_DATA_PATH) に問い合わせ、
+//                 読み込んだ記録と合わせて --recordings に保存する
+//   --cold-tile-us 初めて参照する標高タイルごとに入れる待ち時間 (L1 が空の状態を模擬)
+
+#include <drogon/drogon.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../controllers/RouteController.h"
+#include "../services/ConfigService.h"
+#include "../services/OSRMClient.h"
+#include "../services/RouteService.h"
+#include "../services/SpotService.h"
+#include "replay/ReplayOSRMClient.h"
+#include "replay/Scenario.h"
+#include "replay/SyntheticElevationProvider.h"
+
+using namespace tools::replay;
+
+namespace {
+
+struct Options {
+    std::string scenariosPath = "tests/data/simulation_scenarios.csv";
+    size_t generate = 0;
+    uint32_t seed = 1;
+    std::string recordingsPath;
+    bool record = false;
+    long coldTileMicros = 0;
+    std::string jsonPath;
+};
+
+bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto next = [&]() -> const char* { return i + 1 < argc ? argv[++i] : nullptr; };
+        const char* value = nullptr;
+        if (arg == "--record") {
+            options.record = true;
+            continue;
+        }
+        if (!(value = next())) {
+            std::cerr << "Missing value for " << arg << std::endl;
+            return false;
+        }
+        if (arg == "--scenarios") {
+            options.scenariosPath = value;
+        } else if (arg == "--generate") {
+            options.generate = std::strtoul(value, nullptr, 10);
+        } else if (arg == "--seed") {
+            options.seed = static_cast<uint32_t>(std::strtoul(value, nullptr, 10));
+        } else if (arg == "--recordings") {
+            options.recordingsPath = value;
+        } else if (arg == "--cold-tile-us") {
+            options.coldTileMicros = std::strtol(value, nullptr, 10);
+        } else if (arg == "--json") {
+            options.jsonPath = value;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return false;
+        }
+    }
+    if (options.record && options.recordingsPath.empty()) {
+        std::cerr << "--record requires --recordings" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// スポット検索の時間だけを測る
+class TimedSpotService : public services::SpotService {
+   public:
+    explicit TimedSpotService(const services::ConfigService& config) : SpotService(config) {}
+
+    using SpotService::searchSpotsAlongRoute;
+    std::vector<services::Spot> searchSpotsAlongRoute(std::span<const services::Coordinate> path,
+                                                      double bufferMeters) override {
+        auto start = std::chrono::steady_clock::now();
+        auto spots = SpotService::searchSpotsAlongRoute(path, bufferMeters);
+        std::chrono::duration<double, std::milli> elapsed =
+            std::chrono::steady_clock::now() - start;
+        elapsedMs += elapsed.count();
+        return spots;
+    }
+
+    double elapsedMs = 0.0;
+};
+
+struct Sample {
+    const Scenario* scenario;
+    bool ok;
+    double totalMs;
+    double osrmMs;
+    double elevationMs;
+    double spotsMs;
+    double otherMs;
+    size_t osrmCalls;
+    size_t tilesTouched;
+    double distanceErrorPct;  // 目標距離に対する誤差 (%)
+    double elevationErrorM;   // 目標獲得標高がある場合のみ (それ以外は NaN)
+};
+
+double percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * values.size()));
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+Json::Value summarize(const std::vector<double>& values) {
+    Json::Value json;
+    double sum = 0.0;
+    for (double v : values) sum += v;
+    json["count"] = static_cast<Json::UInt64>(values.size());
+    json["mean"] = values.empty() ? 0.0 : sum / values.size();
+    json["p50"] = percentile(values, 50);
+    json["p90"] = percentile(values, 90);
+    json["p99"] = percentile(values, 99);
+    json["max"] = percentile(values, 100);
+    return json;
+}
+
+template <typename F>
+std::vector<double> collect(const std::vector<Sample>& samples, F&& field) {
+    std::vector<double> values;
+    values.reserve(samples.size());
+    for (const auto& sample : samples) {
+        double value = field(sample);
+        if (sample.ok && !std::isnan(value)) values.push_back(value);
+    }
+    return values;
+}
+
+Json::Value buildReport(const std::vector<Sample>& samples) {
+    Json::Value report;
+    size_t failures = 0;
+    for (const auto& sample : samples) failures += sample.ok ? 0 : 1;
+    report["requests"] = static_cast<Json::UInt64>(samples.size());
+    report["failures"] = static_cast<Json::UInt64>(failures);
+
+    Json::Value& stages = report["latency_ms"];
+    stages["total"] = summarize(collect(samples, [](const Sample& s) { return s.totalMs; }));
+    stages["osrm"] = summarize(collect(samples, [](const Sample& s) { return s.osrmMs; }));
+    stages["elevation"] =
+        summarize(collect(samples, [](const Sample& s) { return s.elevationMs; }));
+    stages["spots"] = summarize(collect(samples, [](const Sample& s) { return s.spotsMs; }));
+    stages["other"] = summarize(collect(samples, [](const Sample& s) { return s.otherMs; }));
+
+    report["osrm_calls_per_request"] = summarize(
+        collect(samples, [](const Sample& s) { return static_cast<double>(s.osrmCalls); }));
+    report["tiles_touched_per_request"] = summarize(
+        collect(samples, [](const Sample& s) { return static_cast<double>(s.tilesTouched); }));
+
+    report["quality"]["distance_error_pct"] =
+        summarize(collect(samples, [](const Sample& s) { return s.distanceErrorPct; }));
+    report["quality"]["elevation_error_m"] =
+        summarize(collect(samples, [](const Sample& s) { return s.elevationErrorM; }));
+
+    std::map<std::string, std::vector<Sample>> byType;
+    for (const auto& sample : samples) byType[sample.scenario->type].push_back(sample);
+    for (const auto& [type, group] : byType) {
+        Json::Value& entry = report["by_type"][type.empty() ? "-" : type];
+        entry["requests"] = static_cast<Json::UInt64>(group.size());
+        entry["total_ms"] = summarize(collect(group, [](const Sample& s) { return s.totalMs; }));
+        entry["distance_error_pct"] =
+            summarize(collect(group, [](const Sample& s) { return s.distanceErrorPct; }));
+        entry["elevation_error_m"] =
+            summarize(collect(group, [](const Sample& s) { return s.elevationErrorM; }));
+    }
+    return report;
+}
+
+void printReport(const Json::Value& report) {
+    std::cout << "Requests: " << report["requests"].asUInt64()
+              << "  Failures: " << report["failures"].asUInt64() << "\n\n";
+
+    auto row = [](const std::string& name, const Json::Value& s) {
+        std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+                  << std::setprecision(2) << std::setw(10) << s["mean"].asDouble()
+                  << std::setw(10) << s["p50"].asDouble() << std::setw(10)
+                  << s["p90"].asDouble() << std::setw(10) << s["p99"].asDouble()
+                  << std::setw(10) << s["max"].asDouble() << "\n";
+    };
+    std::cout << std::left << std::setw(28) << "" << std::right << std::setw(10) << "mean"
+              << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99"
+              << std::setw(10) << "max" << "\n";
+    for (const char* stage : {"total", "osrm", "elevation", "spots", "other"}) {
+        row(std::string("latency_ms.") + stage, report["latency_ms"][stage]);
+    }
+    row("osrm_calls_per_request", report["osrm_calls_per_request"]);
+    row("tiles_touched_per_request", report["tiles_touched_per_request"]);
+    row("distance_error_pct", report["quality"]["distance_error_pct"]);
+    row("elevation_error_m", report["quality"]["elevation_error_m"]);
+
+    std::cout << "\nBy type (distance_error_pct p50 / elevation_error_m p50):\n";
+    for (const auto& type : report["by_type"].getMemberNames()) {
+        const auto& entry = report["by_type"][type];
+        std::cout << "  " << std::left << std::setw(20) << type << std::right << std::setw(6)
+                  << entry["requests"].asUInt64() << std::setw(10)
+                  << entry["distance_error_pct"]["p50"].asDouble() << std::setw(10)
+                  << entry["elevation_error_m"]["p50"].asDouble() << "\n";
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        return 2;
+    }
+
+    auto seeds = loadScenarios(options.scenariosPath);
+    if (seeds.empty()) {
+        std::cerr << "No scenarios loaded from " << options.scenariosPath << std::endl;
+        return 1;
+    }
+    auto scenarios =
+        options.generate > 0 ? generateScenarios(seeds, options.generate, options.seed) : seeds;
+
+    // Places API には問い合わせない (ローカルのスポットのみ)
+    unsetenv("GOOGLE_PLACES_API_KEY");
+    trantor::Logger::setLogLevel(trantor::Logger::kWarn);
+
+    auto configService = std::make_shared<services::ConfigService>();
+    std::shared_ptr<services::OSRMClient> upstream;
+    if (options.record) {
+        upstream = std::make_shared<services::OSRMClient>(*configService);
+    }
+    auto osrmClient = std::make_shared<ReplayOSRMClient>(upstream);
+    if (!options.recordingsPath.empty()) {
+        std::cout << "Loaded " << osrmClient->loadRecordings(options.recordingsPath)
+                  << " recorded OSRM responses" << std::endl;
+    }
+    auto elevationProvider = std::make_shared<SyntheticElevationProvider>(
+        std::chrono::microseconds(options.coldTileMicros));
+    auto spotService = std::make_shared<TimedSpotService>(*configService);
+
+    api::v1::Route::setConfigService(configService);
+    api::v1::Route::setOSRMClient(osrmClient);
+    api::v1::Route::setSpotService(spotService);
+    api::v1::Route::setRouteService(std::make_shared<services::RouteService>(elevationProvider));
+    api::v1::Route::setSpotSearchJobs(nullptr);
+    api::v1::Route controller;
+
+    std::vector<Sample> samples;
+    samples.reserve(scenarios.size());
+    for (const auto& scenario : scenarios) {
+        Json::Value body;
+        body["start_point"]["lat"] = scenario.start.lat;
+        body["start_point"]["lon"] = scenario.start.lon;
+        body["end_point"]["lat"] = scenario.end.lat;
+        body["end_point"]["lon"] = scenario.end.lon;
+        body["preferences"]["target_distance_km"] = scenario.targetDistanceKm;
+        body["preferences"]["target_elevation_gain_m"] = scenario.targetElevationM;
+        auto req = drogon::HttpRequest::newHttpJsonRequest(body);
+
+        osrmClient->resetCounters();
+        elevationProvider->resetCounters();
+        spotService->elapsedMs = 0.0;
+
+        drogon::HttpResponsePtr resp;
+        auto start = std::chrono::steady_clock::now();
+        controller.generate(req, [&resp](const drogon::HttpResponsePtr& r) { resp = r; });
+        std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - start;
+
+        Sample sample{&scenario, false, total.count(), 0, 0, 0, 0, 0, 0, NAN, NAN};
+        auto osrm = osrmClient->counters();
+        auto elevation = elevationProvider->counters();
+        sample.osrmMs = osrm.elapsedMs;
+        sample.elevationMs = elevation.elapsedMs;
+        sample.spotsMs = spotService->elapsedMs;
+        sample.otherMs =
+            std::max(0.0, sample.totalMs - sample.osrmMs - sample.elevationMs - sample.spotsMs);
+        sample.osrmCalls = osrm.calls;
+        sample.tilesTouched = elevation.tilesTouched;
+
+        auto json = resp ? resp->getJsonObject() : nullptr;
+        if (resp && resp->getStatusCode() == drogon::k200OK && json) {
+            sample.ok = true;
+            double distanceKm = (*json)["summary"]["total_distance_m"].asDouble() / 1000.0;
+            double gain = (*json)["summary"]["total_elevation_gain_m"].asDouble();
+            if (scenario.targetDistanceKm > 0) {
+                sample.distanceErrorPct = std::abs(distanceKm - scenario.targetDistanceKm) /
+                                          scenario.targetDistanceKm * 100.0;
+            }
+            if (scenario.targetElevationM > 0) {
+                sample.elevationErrorM = std::abs(gain - scenario.targetElevationM);
+            }
+        }
+        samples.push_back(sample);
+    }
+
+    if (options.record) {
+        std::cout << "Saved " << osrmClient->saveRecordings(options.recordingsPath)
+                  << " OSRM responses to " << options.recordingsPath << std::endl;
+    }
+
+    auto report = buildReport(samples);
+    printReport(report);
+    if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath, std::ios::trunc);
+        out << report.toStyledString();
+        std::cout << "\nWrote " << options.jsonPath << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,124 @@
+#include "HdrHistogram.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace tools::load {
+
+namespace {
+
+int floorLog2(int64_t value) { return 63 - __builtin_clzll(static_cast<uint64_t>(value)); }
+
+}  // namespace
+
+HdrHistogram::HdrHistogram(int64_t lowestTrackableValue, int64_t highestTrackableValue,
+                           int significantDigits)
+    : highestTrackableValue_(highestTrackableValue) {
+    lowestTrackableValue = std::max<int64_t>(lowestTrackableValue, 1);
+    significantDigits = std::clamp(significantDigits, 1, 5);
+
+    // 有効桁数を保てるサブバケット数 (3 桁なら 2048)
+    int64_t largestSingleUnitValue = 2 * static_cast<int64_t>(std::pow(10, significantDigits));
+    int subBucketCountMagnitude = static_cast<int>(std::ceil(std::log2(largestSingleUnitValue)));
+    unitMagnitude_ = floorLog2(lowestTrackableValue);
+    subBucketHalfCountMagnitude_ = std::max(subBucketCountMagnitude, 1) - 1;
+    int64_t subBucketCount = int64_t{1} << (subBucketHalfCountMagnitude_ + 1);
+    subBucketHalfCount_ = subBucketCount / 2;
+    subBucketMask_ = (subBucketCount - 1) << unitMagnitude_;
+
+    int64_t smallestUntrackable = subBucketCount << unitMagnitude_;
+    int bucketCount = 1;
+    while (smallestUntrackable <= highestTrackableValue_) {
+        if (smallestUntrackable > INT64_MAX / 2) {
+            bucketCount++;
+            break;
+        }
+        smallestUntrackable <<= 1;
+        bucketCount++;
+    }
+    counts_.assign(static_cast<size_t>((bucketCount + 1) * subBucketHalfCount_), 0);
+}
+
+void HdrHistogram::record(int64_t value) {
+    value = std::clamp<int64_t>(value, 0, highestTrackableValue_);
+    counts_[countsIndex(value)]++;
+    totalCount_++;
+    sum_ += static_cast<double>(value);
+    minValue_ = std::min(minValue_, value);
+    maxValue_ = std::max(maxValue_, value);
+}
+
+void HdrHistogram::merge(const HdrHistogram& other) {
+    if (other.counts_.size() == counts_.size() && other.unitMagnitude_ == unitMagnitude_ &&
+        other.subBucketHalfCount_ == subBucketHalfCount_) {
+        for (size_t i = 0; i < counts_.size(); ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        totalCount_ += other.totalCount_;
+        sum_ += other.sum_;
+        minValue_ = std::min(minValue_, other.minValue_);
+        maxValue_ = std::max(maxValue_, other.maxValue_);
+        return;
+    }
+    // 構成が違う場合は各バケットの代表値で記録し直す
+    for (size_t i = 0; i < other.counts_.size(); ++i) {
+        for (int64_t n = 0; n < other.counts_[i]; ++n) {
+            record(other.valueFromIndex(i));
+        }
+    }
+}
+
+int64_t HdrHistogram::valueAtPercentile(double percentile) const {
+    if (totalCount_ == 0) return 0;
+    percentile = std::clamp(percentile, 0.0, 100.0);
+    int64_t countAtPercentile = static_cast<int64_t>(std::ceil(percentile / 100.0 * totalCount_));
+    countAtPercentile = std::max<int64_t>(countAtPercentile, 1);
+
+    int64_t cumulative = 0;
+    for (size_t i = 0; i < counts_.size(); ++i) {
+        cumulative += counts_[i];
+        if (cumulative >= countAtPercentile) {
+            return std::min(highestEquivalentValue(valueFromIndex(i)), maxValue_);
+        }
+    }
+    return maxValue_;
+}
+
+int64_t HdrHistogram::min() const { return totalCount_ == 0 ? 0 : minValue_; }
+
+int64_t HdrHistogram::max() const { return maxValue_; }
+
+double HdrHistogram::mean() const {
+    return totalCount_ == 0 ? 0.0 : sum_ / static_cast<double>(totalCount_);
+}
+
+size_t HdrHistogram::countsIndex(int64_t value) const {
+    int bucketIndex = floorLog2(value | subBucketMask_) - unitMagnitude_ -
+                      subBucketHalfCountMagnitude_;
+    int64_t subBucketIndex = value >> (bucketIndex + unitMagnitude_);
+    int64_t bucketBaseIndex = static_cast<int64_t>(bucketIndex + 1)
+                              << subBucketHalfCountMagnitude_;
+    return static_cast<size_t>(bucketBaseIndex + subBucketIndex - subBucketHalfCount_);
+}
+
+int64_t HdrHistogram::valueFromIndex(size_t index) const {
+    int bucketIndex = static_cast<int>(index >> subBucketHalfCountMagnitude_) - 1;
+    int64_t subBucketIndex =
+        static_cast<int64_t>(index & static_cast<size_t>(subBucketHalfCount_ - 1)) +
+        subBucketHalfCount_;
+    if (bucketIndex < 0) {
+        subBucketIndex -= subBucketHalfCount_;
+        bucketIndex = 0;
+    }
+    return subBucketIndex << (bucketIndex + unitMagnitude_);
+}
+
+int64_t HdrHistogram::highestEquivalentValue(int64_t value) const {
+    int bucketIndex = floorLog2(value | subBucketMask_) - unitMagnitude_ -
+                      subBucketHalfCountMagnitude_;
+    int64_t subBucketIndex = value >> (bucketIndex + unitMagnitude_);
+    int64_t lowest = subBucketIndex << (bucketIndex + unitMagnitude_);
+    return lowest + (int64_t{1} << (bucketIndex + unitMagnitude_)) - 1;
+}
+
+}  // namespace tools::load
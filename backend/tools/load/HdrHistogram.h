@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace tools::load {
+
+/**
+ * @brief 値の範囲に対して相対精度を保つ HDR (High Dynamic Range) ヒストグラム
+ *
+ * HdrHistogram と同じバケット配置 (2 のべき乗ごとのバケットを、有効桁数に応じた
+ * サブバケットに等分) で、記録は配列のインクリメントのみ。スレッドセーフではないので、
+ * スレッドごとに持って最後に merge する。
+ *
+ * 協調的欠落 (coordinated omission) の補正は記録側で行う: 負荷生成器は応答時間を
+ * 実際の送信時刻ではなく予定していた送信時刻から測って記録する。
+ */
+class HdrHistogram {
+   public:
+    HdrHistogram(int64_t lowestTrackableValue, int64_t highestTrackableValue,
+                 int significantDigits);
+
+    // highestTrackableValue を超える値は最大値として記録する
+    void record(int64_t value);
+
+    void merge(const HdrHistogram& other);
+
+    // percentile は 0〜100。その百分位以下に収まる値の上限 (同値範囲の最大値) を返す
+    int64_t valueAtPercentile(double percentile) const;
+
+    int64_t totalCount() const { return totalCount_; }
+    int64_t min() const;
+    int64_t max() const;
+    double mean() const;
+
+   private:
+    size_t countsIndex(int64_t value) const;
+    int64_t valueFromIndex(size_t index) const;
+    int64_t highestEquivalentValue(int64_t value) const;
+
+    int64_t highestTrackableValue_;
+    int unitMagnitude_;
+    int subBucketHalfCountMagnitude_;
+    int64_t subBucketHalfCount_;
+    int64_t subBucketMask_;
+
+    std::vector<int64_t> counts_;
+    int64_t totalCount_ = 0;
+    double sum_ = 0.0;
+    int64_t minValue_ = INT64_MAX;
+    int64_t maxValue_ = 0;
+};
+
+}  // namespace tools::load
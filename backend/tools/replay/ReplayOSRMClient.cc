@@ -0,0 +1,294 @@
+#include "ReplayOSRMClient.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <numbers>
+
+#include "../../services/RouteService.h"
+#include "../../utils/PolylineDecoder.h"
+
+namespace tools::replay {
+
+namespace {
+
+constexpr double kEarthRadiusMeters = 6371000.0;
+constexpr double kMetersPerDegreeLat = kEarthRadiusMeters * std::numbers::pi / 180.0;
+// 合成ルートの形状: 頂点間隔、直線からの膨らみ (直線距離に対する比)、細かい蛇行
+constexpr double kVertexSpacingMeters = 100.0;
+constexpr double kDetourRatio = 0.15;
+constexpr double kWiggleMeters = 30.0;
+constexpr double kWigglePeriodMeters = 400.0;
+constexpr size_t kIntersectionEvery = 5;
+// 自転車の平均速度 (18 km/h)
+constexpr double kSpeedMetersPerSecond = 5.0;
+
+double distanceMeters(const services::Coordinate& a, const services::Coordinate& b) {
+    double lat1 = a.lat * std::numbers::pi / 180.0;
+    double lat2 = b.lat * std::numbers::pi / 180.0;
+    double dLat = lat2 - lat1;
+    double dLon = (b.lon - a.lon) * std::numbers::pi / 180.0;
+    double h = std::sin(dLat / 2) * std::sin(dLat / 2) +
+               std::cos(lat1) * std::cos(lat2) * std::sin(dLon / 2) * std::sin(dLon / 2);
+    return 2 * kEarthRadiusMeters * std::atan2(std::sqrt(h), std::sqrt(1 - h));
+}
+
+std::vector<services::Coordinate> requestCoordinates(const osrm::RouteParameters& parameters) {
+    std::vector<services::Coordinate> coords;
+    coords.reserve(parameters.coordinates.size());
+    for (const auto& c : parameters.coordinates) {
+        coords.push_back({static_cast<double>(osrm::util::toFloating(c.lat)),
+                          static_cast<double>(osrm::util::toFloating(c.lon))});
+    }
+    return coords;
+}
+
+osrm::json::Array location(const services::Coordinate& c) {
+    osrm::json::Array loc;
+    loc.values.push_back(osrm::json::Number(c.lon));
+    loc.values.push_back(osrm::json::Number(c.lat));
+    return loc;
+}
+
+struct ToJsonVisitor {
+    Json::Value operator()(const osrm::json::String& value) const { return value.value; }
+    Json::Value operator()(const osrm::json::Number& value) const { return value.value; }
+    Json::Value operator()(const osrm::json::True&) const { return true; }
+    Json::Value operator()(const osrm::json::False&) const { return false; }
+    Json::Value operator()(const osrm::json::Null&) const { return Json::Value(); }
+    Json::Value operator()(const osrm::json::Object& value) const {
+        Json::Value json(Json::objectValue);
+        for (const auto& [key, child] : value.values) {
+            json[key] = mapbox::util::apply_visitor(*this, child);
+        }
+        return json;
+    }
+    Json::Value operator()(const osrm::json::Array& value) const {
+        Json::Value json(Json::arrayValue);
+        for (const auto& child : value.values) {
+            json.append(mapbox::util::apply_visitor(*this, child));
+        }
+        return json;
+    }
+};
+
+osrm::json::Value fromJsonValue(const Json::Value& json) {
+    switch (json.type()) {
+        case Json::objectValue:
+            return ReplayOSRMClient::fromJson(json);
+        case Json::arrayValue: {
+            osrm::json::Array array;
+            array.values.reserve(json.size());
+            for (const auto& child : json) {
+                array.values.push_back(fromJsonValue(child));
+            }
+            return array;
+        }
+        case Json::stringValue:
+            return osrm::json::String(json.asString());
+        case Json::booleanValue:
+            return json.asBool() ? osrm::json::Value(osrm::json::True())
+                                 : osrm::json::Value(osrm::json::False());
+        case Json::nullValue:
+            return osrm::json::Null();
+        default:
+            return osrm::json::Number(json.asDouble());
+    }
+}
+
+}  // namespace
+
+ReplayOSRMClient::ReplayOSRMClient(std::shared_ptr<services::OSRMClient> upstream)
+    : upstream_(std::move(upstream)) {}
+
+osrm::Status ReplayOSRMClient::Route(const osrm::RouteParameters& parameters,
+                                     osrm::json::Object& result) const {
+    auto start = std::chrono::steady_clock::now();
+    std::string key = requestKey(parameters);
+
+    Json::Value recorded;
+    bool found = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = recordings_.find(key);
+        if (it != recordings_.end()) {
+            recorded = it->second;
+            found = true;
+        }
+    }
+
+    osrm::Status status = osrm::Status::Ok;
+    if (found) {
+        result = fromJson(recorded);
+    } else if (upstream_) {
+        status = upstream_->Route(parameters, result);
+        if (status == osrm::Status::Ok) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            recordings_[key] = toJson(result);
+        }
+    } else {
+        result = synthesizeRoute(requestCoordinates(parameters));
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.calls++;
+    counters_.elapsedMs += elapsed.count();
+    if (found) {
+        counters_.replayed++;
+    } else if (upstream_) {
+        counters_.recorded++;
+    } else {
+        counters_.synthesized++;
+    }
+    return status;
+}
+
+size_t ReplayOSRMClient::loadRecordings(const std::string& path) {
+    std::ifstream file(path);
+    if (!file.is_open()) return 0;
+
+    Json::CharReaderBuilder builder;
+    std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+    size_t loaded = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        Json::Value entry;
+        std::string errors;
+        if (line.empty() ||
+            !reader->parse(line.data(), line.data() + line.size(), &entry, &errors) ||
+            !entry["key"].isString() || !entry["response"].isObject()) {
+            continue;
+        }
+        std::lock_guard<std::mutex> lock(mutex_);
+        recordings_[entry["key"].asString()] = entry["response"];
+        loaded++;
+    }
+    return loaded;
+}
+
+size_t ReplayOSRMClient::saveRecordings(const std::string& path) const {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file.is_open()) return 0;
+
+    Json::StreamWriterBuilder builder;
+    builder["indentation"] = "";
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [key, response] : recordings_) {
+        Json::Value entry;
+        entry["key"] = key;
+        entry["response"] = response;
+        file << Json::writeString(builder, entry) << "\n";
+    }
+    return file ? recordings_.size() : 0;
+}
+
+ReplayOSRMClient::Counters ReplayOSRMClient::counters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counters_;
+}
+
+void ReplayOSRMClient::resetCounters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_ = Counters{};
+}
+
+std::string ReplayOSRMClient::requestKey(const osrm::RouteParameters& parameters) {
+    std::string key;
+    char buffer[48];
+    for (const auto& c : requestCoordinates(parameters)) {
+        std::snprintf(buffer, sizeof(buffer), "%.5f,%.5f;", c.lat, c.lon);
+        key += buffer;
+    }
+    return key;
+}
+
+osrm::json::Object ReplayOSRMClient::synthesizeRoute(
+    const std::vector<services::Coordinate>& coords) {
+    std::vector<services::Coordinate> geometry;
+    osrm::json::Array legs;
+    double totalDistance = 0.0;
+
+    for (size_t leg = 0; leg + 1 < coords.size(); ++leg) {
+        const auto& a = coords[leg];
+        const auto& b = coords[leg + 1];
+        double straight = distanceMeters(a, b);
+        size_t segments = std::max<size_t>(1, std::ceil(straight / kVertexSpacingMeters));
+
+        // 直線に垂直な単位ベクトル (メートル座標系)。膨らむ向きは区間ごとに交互にする
+        double metersPerDegreeLon =
+            kMetersPerDegreeLat * std::cos(a.lat * std::numbers::pi / 180.0);
+        double dx = (b.lon - a.lon) * metersPerDegreeLon;
+        double dy = (b.lat - a.lat) * kMetersPerDegreeLat;
+        double length = std::max(std::hypot(dx, dy), 1e-9);
+        double side = leg % 2 == 0 ? 1.0 : -1.0;
+        double px = -dy / length * side;
+        double py = dx / length * side;
+
+        std::vector<services::Coordinate> vertices;
+        vertices.reserve(segments + 1);
+        for (size_t k = 0; k <= segments; ++k) {
+            double t = static_cast<double>(k) / static_cast<double>(segments);
+            double offset = straight * kDetourRatio * std::sin(std::numbers::pi * t) +
+                            kWiggleMeters * std::sin(t * straight / kWigglePeriodMeters) *
+                                std::sin(std::numbers::pi * t);
+            vertices.push_back({a.lat + (b.lat - a.lat) * t + py * offset / kMetersPerDegreeLat,
+                                a.lon + (b.lon - a.lon) * t + px * offset / metersPerDegreeLon});
+        }
+
+        double legDistance = 0.0;
+        osrm::json::Array intersections;
+        for (size_t k = 0; k < vertices.size(); ++k) {
+            if (k > 0) legDistance += distanceMeters(vertices[k - 1], vertices[k]);
+            if (k % kIntersectionEvery == 0 || k + 1 == vertices.size()) {
+                osrm::json::Object intersection;
+                intersection.values["location"] = location(vertices[k]);
+                intersections.values.push_back(intersection);
+            }
+        }
+        geometry.insert(geometry.end(), vertices.begin() + (leg == 0 ? 0 : 1), vertices.end());
+        totalDistance += legDistance;
+
+        osrm::json::Object step;
+        step.values["distance"] = osrm::json::Number(legDistance);
+        step.values["duration"] = osrm::json::Number(legDistance / kSpeedMetersPerSecond);
+        step.values["intersections"] = intersections;
+        osrm::json::Array steps;
+        steps.values.push_back(step);
+
+        osrm::json::Object legObject;
+        legObject.values["distance"] = osrm::json::Number(legDistance);
+        legObject.values["duration"] = osrm::json::Number(legDistance / kSpeedMetersPerSecond);
+        legObject.values["steps"] = steps;
+        legs.values.push_back(legObject);
+    }
+
+    osrm::json::Object route;
+    route.values["distance"] = osrm::json::Number(totalDistance);
+    route.values["duration"] = osrm::json::Number(totalDistance / kSpeedMetersPerSecond);
+    route.values["geometry"] = osrm::json::String(
+        utils::PolylineDecoder::encode(geometry, services::RouteService::kGeometryPrecision));
+    route.values["legs"] = legs;
+    osrm::json::Array routes;
+    routes.values.push_back(route);
+
+    osrm::json::Object result;
+    result.values["code"] = osrm::json::String("Ok");
+    result.values["routes"] = routes;
+    return result;
+}
+
+Json::Value ReplayOSRMClient::toJson(const osrm::json::Object& object) {
+    return ToJsonVisitor()(object);
+}
+
+osrm::json::Object ReplayOSRMClient::fromJson(const Json::Value& json) {
+    osrm::json::Object object;
+    for (const auto& name : json.getMemberNames()) {
+        object.values[name] = fromJsonValue(json[name]);
+    }
+    return object;
+}
+
+}  // namespace tools::replay
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../../services/Coordinate.h"
+#include "../../services/OSRMClient.h"
+
+namespace tools::replay {
+
+/**
+ * @brief 地図データなしで Route を返す OSRM の代替
+ *
+ * 1. 記録済みの応答 (loadRecordings) があれば、それをそのまま返す
+ * 2. 記録がなく upstream が設定されていれば、実際の OSRM に問い合わせて記録する
+ * 3. どちらもなければ、経由点を結ぶ決定的な合成ルートを返す
+ *
+ * 応答のキーは要求座標 (小数点以下 5 桁) なので、同じシナリオ・同じアルゴリズムなら
+ * 記録時と同じ応答が返る。
+ */
+class ReplayOSRMClient : public services::OSRMClient {
+   public:
+    explicit ReplayOSRMClient(std::shared_ptr<services::OSRMClient> upstream = nullptr);
+
+    osrm::Status Route(const osrm::RouteParameters& parameters,
+                       osrm::json::Object& result) const override;
+
+    // 1 行に {"key": ..., "response": ...} を 1 件ずつ書いた JSON Lines
+    size_t loadRecordings(const std::string& path);
+    size_t saveRecordings(const std::string& path) const;
+
+    struct Counters {
+        size_t calls = 0;
+        size_t replayed = 0;
+        size_t recorded = 0;
+        size_t synthesized = 0;
+        double elapsedMs = 0.0;
+    };
+    Counters counters() const;
+    void resetCounters();
+
+    static std::string requestKey(const osrm::RouteParameters& parameters);
+
+    // 経由点の間を約 100m 間隔の頂点で結び、道路らしく左右に振った合成ルート
+    // (steps: true, geometries: polyline6 の応答と同じ構造)
+    static osrm::json::Object synthesizeRoute(const std::vector<services::Coordinate>& coords);
+
+    static Json::Value toJson(const osrm::json::Object& object);
+    static osrm::json::Object fromJson(const Json::Value& json);
+
+   private:
+    std::shared_ptr<services::OSRMClient> upstream_;
+
+    mutable std::mutex mutex_;
+    mutable std::unordered_map<std::string, Json::Value> recordings_;
+    mutable Counters counters_;
+};
+
+}  // namespace tools::replay
@@ -0,0 +1,94 @@
+#include "Scenario.h"
+
+#include <cmath>
+#include <fstream>
+#include <numbers>
+#include <random>
+#include <sstream>
+
+namespace tools::replay {
+
+namespace {
+
+constexpr double kJitterKm = 3.0;
+constexpr double kKmPerDegreeLat = 111.0;
+
+bool parseDouble(const std::string& text, double& value) {
+    try {
+        size_t used = 0;
+        value = std::stod(text, &used);
+        return used > 0;
+    } catch (...) {
+        return false;
+    }
+}
+
+}  // namespace
+
+std::vector<Scenario> loadScenarios(const std::string& path) {
+    std::vector<Scenario> scenarios;
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        return scenarios;
+    }
+
+    std::string line;
+    std::getline(file, line);  // ヘッダー
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        std::vector<std::string> columns;
+        std::stringstream ss(line);
+        std::string column;
+        while (std::getline(ss, column, ',')) {
+            columns.push_back(column);
+        }
+        if (columns.size() < 9) continue;
+
+        Scenario scenario;
+        scenario.id = columns[0];
+        scenario.type = columns.size() > 9 ? columns[9] : "";
+        if (!parseDouble(columns[2], scenario.start.lat) ||
+            !parseDouble(columns[3], scenario.start.lon) ||
+            !parseDouble(columns[5], scenario.end.lat) ||
+            !parseDouble(columns[6], scenario.end.lon) ||
+            !parseDouble(columns[7], scenario.targetDistanceKm) ||
+            !parseDouble(columns[8], scenario.targetElevationM)) {
+            continue;
+        }
+        scenarios.push_back(std::move(scenario));
+    }
+    return scenarios;
+}
+
+std::vector<Scenario> generateScenarios(const std::vector<Scenario>& seeds, size_t count,
+                                        uint32_t seed) {
+    std::vector<Scenario> scenarios;
+    if (seeds.empty()) return scenarios;
+    scenarios.reserve(count);
+
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<double> jitter(-kJitterKm, kJitterKm);
+    std::uniform_real_distribution<double> scale(0.7, 1.5);
+
+    auto shift = [&](const services::Coordinate& base) {
+        double kmPerDegreeLon = kKmPerDegreeLat * std::cos(base.lat * std::numbers::pi / 180.0);
+        return services::Coordinate{base.lat + jitter(rng) / kKmPerDegreeLat,
+                                    base.lon + jitter(rng) / kmPerDegreeLon};
+    };
+
+    for (size_t i = 0; i < count; ++i) {
+        const Scenario& base = seeds[i % seeds.size()];
+        bool loop = base.start.lat == base.end.lat && base.start.lon == base.end.lon;
+
+        Scenario scenario = base;
+        scenario.id = base.id + "-" + std::to_string(i);
+        scenario.start = shift(base.start);
+        scenario.end = loop ? scenario.start : shift(base.end);
+        scenario.targetDistanceKm = base.targetDistanceKm * scale(rng);
+        scenario.targetElevationM = base.targetElevationM * scale(rng);
+        scenarios.push_back(std::move(scenario));
+    }
+    return scenarios;
+}
+
+}  // namespace tools::replay
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../../services/Coordinate.h"
+
+namespace tools::replay {
+
+/**
+ * @brief リプレイする 1 リクエスト分の条件 (simulation_scenarios.csv の 1 行)
+ */
+struct Scenario {
+    std::string id;
+    std::string type;  // loop, one_way など (集計のグループ分けに使う)
+    services::Coordinate start{};
+    services::Coordinate end{};
+    double targetDistanceKm = 0.0;
+    double targetElevationM = 0.0;
+};
+
+/**
+ * @brief simulation_scenarios.csv 形式のファイルを読み込む
+ *
+ * 列: id,start_name,start_lat,start_lon,end_name,end_lat,end_lon,target_dist_km,target_elev_m,type
+ * 1 行目はヘッダーとして読み飛ばし、数値に変換できない行は無視する。
+ */
+std::vector<Scenario> loadScenarios(const std::string& path);
+
+/**
+ * @brief 元のシナリオを種にして count 件のシナリオを生成する
+ *
+ * 出発地・目的地を数 km の範囲でずらし、目標距離と目標獲得標高を 0.7〜1.5 倍に振る。
+ * 周回ルート (出発地 = 目的地) は周回のまま保つ。同じ seed なら常に同じ結果になる。
+ */
+std::vector<Scenario> generateScenarios(const std::vector<Scenario>& seeds, size_t count,
+                                        uint32_t seed);
+
+}  // namespace tools::replay
@@ -0,0 +1,117 @@
+#include "SyntheticElevationProvider.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#include "../../services/elevation/GSIElevationProvider.h"
+
+namespace tools::replay {
+
+namespace {
+
+using services::elevation::GSIElevationProvider;
+
+struct Mountain {
+    double lat;
+    double lon;
+    double height;
+    double spread;  // 度
+};
+// 高尾・丹沢・箱根付近に山を置き、平野部はほぼ平坦にする
+constexpr Mountain kMountains[] = {
+    {35.625, 139.243, 600.0, 0.08},
+    {35.470, 139.160, 1500.0, 0.12},
+    {35.233, 139.020, 1200.0, 0.10},
+};
+
+uint64_t tileKey(const GSIElevationProvider::TileCoord& tc) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(tc.x)) << 32) |
+           static_cast<uint32_t>(tc.y);
+}
+
+}  // namespace
+
+SyntheticElevationProvider::SyntheticElevationProvider(std::chrono::microseconds coldTileLatency)
+    : coldTileLatency_(coldTileLatency) {}
+
+void SyntheticElevationProvider::getElevation(const services::Coordinate& coord,
+                                              ElevationCallback&& callback) {
+    callback(getElevationSync(coord));
+}
+
+void SyntheticElevationProvider::getElevations(const std::vector<services::Coordinate>& coords,
+                                               ElevationsCallback&& callback) {
+    std::vector<double> results;
+    results.reserve(coords.size());
+    for (const auto& elevation : getElevationsSync(coords)) {
+        results.push_back(elevation.value_or(0.0));
+    }
+    callback(results);
+}
+
+std::optional<double> SyntheticElevationProvider::getElevationSync(
+    const services::Coordinate& coord) {
+    return getElevationsSync(std::span<const services::Coordinate>(&coord, 1))[0];
+}
+
+std::vector<std::optional<double>> SyntheticElevationProvider::getElevationsSync(
+    std::span<const services::Coordinate> coords) {
+    auto start = std::chrono::steady_clock::now();
+    touchTiles(coords);
+
+    std::vector<std::optional<double>> results;
+    results.reserve(coords.size());
+    for (const auto& coord : coords) {
+        results.push_back(elevationAt(coord));
+    }
+
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_.lookups += coords.size();
+    counters_.elapsedMs += elapsed.count();
+    return results;
+}
+
+double SyntheticElevationProvider::elevationAt(const services::Coordinate& coord) {
+    double height = 20.0 + 15.0 * std::sin(coord.lat * 90.0) * std::cos(coord.lon * 70.0);
+    for (const auto& mountain : kMountains) {
+        double dLat = (coord.lat - mountain.lat) / mountain.spread;
+        double dLon = (coord.lon - mountain.lon) / mountain.spread;
+        height += mountain.height * std::exp(-(dLat * dLat + dLon * dLon));
+    }
+    return std::max(height, 0.0);
+}
+
+SyntheticElevationProvider::Counters SyntheticElevationProvider::counters() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return counters_;
+}
+
+void SyntheticElevationProvider::resetCounters() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    counters_ = Counters{};
+    touchedTiles_.clear();
+}
+
+void SyntheticElevationProvider::touchTiles(std::span<const services::Coordinate> coords) {
+    size_t cold = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        for (const auto& tc : GSIElevationProvider::calculateTileCoords(coords)) {
+            uint64_t key = tileKey(tc);
+            if (touchedTiles_.insert(key).second) {
+                counters_.tilesTouched++;
+            }
+            if (warmTiles_.insert(key).second) {
+                counters_.coldTiles++;
+                cold++;
+            }
+        }
+    }
+    if (cold > 0 && coldTileLatency_.count() > 0) {
+        std::this_thread::sleep_for(coldTileLatency_ * cold);
+    }
+}
+
+}  // namespace tools::replay
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_set>
+#include <vector>
+
+#include "../../services/elevation/IElevationProvider.h"
+
+namespace tools::replay {
+
+/**
+ * @brief GSI を使わない決定的な標高プロバイダー
+ *
+ * 標高は座標だけで決まる合成地形 (関東西部の山地を模した起伏) を返す。
+ * 参照したタイルを GSIElevationProvider と同じズーム 15 のタイル座標で数え、
+ * 初めて参照したタイルには coldTileLatency の待ちを入れる (L1 が空の状態の取得待ちを模擬)。
+ */
+class SyntheticElevationProvider : public services::elevation::IElevationProvider {
+   public:
+    explicit SyntheticElevationProvider(
+        std::chrono::microseconds coldTileLatency = std::chrono::microseconds(0));
+
+    void getElevation(const services::Coordinate& coord, ElevationCallback&& callback) override;
+    void getElevations(const std::vector<services::Coordinate>& coords,
+                       ElevationsCallback&& callback) override;
+    std::optional<double> getElevationSync(const services::Coordinate& coord) override;
+    std::vector<std::optional<double>> getElevationsSync(
+        std::span<const services::Coordinate> coords) override;
+
+    static double elevationAt(const services::Coordinate& coord);
+
+    struct Counters {
+        size_t lookups = 0;
+        size_t tilesTouched = 0;  // resetCounters 以降に参照した異なるタイルの数
+        size_t coldTiles = 0;     // 起動後初めて参照したタイルの数
+        double elapsedMs = 0.0;
+    };
+    Counters counters() const;
+    void resetCounters();
+
+   private:
+    void touchTiles(std::span<const services::Coordinate> coords);
+
+    std::chrono::microseconds coldTileLatency_;
+
+    mutable std::mutex mutex_;
+    std::unordered_set<uint64_t> touchedTiles_;
+    std::unordered_set<uint64_t> warmTiles_;
+    Counters counters_;
+};
+
+}  // namespace tools::replay
@@ -0,0 +1,71 @@
+#include "AllocationCounter.h"
+
+#include <cstdlib>
+#include <new>
+
+namespace utils {
+
+namespace {
+
+// 自明に初期化できる型なので、operator new の中から参照しても初期化で確保が起きない
+thread_local AllocationCount counts;
+
+}  // namespace
+
+bool AllocationCounter::enabled() {
+#ifdef PEDALMAP_COUNT_ALLOCATIONS
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationCount AllocationCounter::thisThread() { return counts; }
+
+#ifdef PEDALMAP_COUNT_ALLOCATIONS
+namespace {
+
+void* countedAllocate(std::size_t size) {
+    counts.allocations++;
+    counts.bytes += size;
+    if (size == 0) size = 1;
+    while (true) {
+        if (void* p = std::malloc(size)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+
+}  // namespace
+#endif
+
+}  // namespace utils
+
+#ifdef PEDALMAP_COUNT_ALLOCATIONS
+// アラインメント指定付きの operator new は置き換えない (数えない)
+void* operator new(std::size_t size) { return utils::countedAllocate(size); }
+void* operator new[](std::size_t size) { return utils::countedAllocate(size); }
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return utils::countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return utils::countedAllocate(size);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, std::size_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::size_t) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
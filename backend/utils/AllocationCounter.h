@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstdint>
+
+namespace utils {
+
+struct AllocationCount {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+
+    AllocationCount operator-(const AllocationCount& other) const {
+        return {allocations - other.allocations, bytes - other.bytes};
+    }
+};
+
+/**
+ * @brief スレッドごとのヒープ確保の回数とバイト数
+ *
+ * ENABLE_ALLOCATION_COUNTING (PEDALMAP_COUNT_ALLOCATIONS) でビルドしたときだけ
+ * グローバルな operator new を置き換えて数える。それ以外のビルドでは enabled() が false で、
+ * 値は常に 0 (計測用のビルドでのみ使い、本番のビルドには影響しない)。
+ * 区間ごとの値は、前後の thisThread() の差で求める (Trace の区間はこれを記録する)。
+ */
+class AllocationCounter {
+   public:
+    static bool enabled();
+
+    // このスレッドでこれまでに確保した回数とバイト数の累計
+    static AllocationCount thisThread();
+};
+
+}  // namespace utils
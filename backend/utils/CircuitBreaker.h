@@ -0,0 +1,157 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+namespace cycling::utils {
+
+/**
+ * @brief Thread-safe circuit breaker for calls to an external service
+ *
+ * Outcomes of the last `windowSize` calls are kept in a ring buffer. Once at least
+ * `minimumCalls` have been recorded and the share of failed (or slower than `slowCallThreshold`)
+ * calls reaches `failureRateThreshold`, the breaker opens and allowRequest() fails fast for
+ * `openDuration`. After that a single probe is let through (half-open); its outcome closes or
+ * re-opens the breaker.
+ */
+class CircuitBreaker {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    enum class State { Closed, Open, HalfOpen };
+
+    struct Options {
+        size_t windowSize = 20;
+        size_t minimumCalls = 10;
+        double failureRateThreshold = 0.5;
+        std::chrono::milliseconds slowCallThreshold{3000};
+        std::chrono::milliseconds openDuration{30000};
+    };
+
+    CircuitBreaker() : CircuitBreaker(Options{}) {}
+    explicit CircuitBreaker(const Options& options) { configure(options); }
+
+    /**
+     * @brief Whether a call may be made now
+     *
+     * In the half-open state only one probe is allowed until its outcome is recorded.
+     *
+     * @return false if the call must fail fast
+     */
+    bool allowRequest() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ == State::Open) {
+            if (Clock::now() < openUntil_) {
+                return false;
+            }
+            state_ = State::HalfOpen;
+            probeInFlight_ = false;
+        }
+        if (state_ == State::HalfOpen) {
+            if (probeInFlight_) {
+                return false;
+            }
+            probeInFlight_ = true;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Record a completed call (slow calls count as failures)
+     *
+     * @param latency
+     */
+    void recordSuccess(Clock::duration latency) { record(latency >= options_.slowCallThreshold); }
+
+    /**
+     * @brief Record a failed call (transport error, timeout, 5xx)
+     */
+    void recordFailure() { record(true); }
+
+    State state() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ == State::Open && Clock::now() >= openUntil_) {
+            return State::HalfOpen;
+        }
+        return state_;
+    }
+
+    /**
+     * @brief Replace the options and reset to the closed state
+     *
+     * @param options
+     */
+    void configure(const Options& options) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        options_ = options;
+        options_.windowSize = std::max<size_t>(options_.windowSize, 1);
+        options_.minimumCalls = std::clamp<size_t>(options_.minimumCalls, 1, options_.windowSize);
+        window_.assign(options_.windowSize, false);
+        reset();
+    }
+
+   private:
+    void record(bool failed) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (state_ == State::HalfOpen) {
+            // The probe decides: close and start a fresh window, or open for another period
+            if (failed) {
+                trip();
+            } else {
+                reset();
+            }
+            return;
+        }
+        if (state_ == State::Open) {
+            // Late result of a call started before the breaker opened
+            return;
+        }
+
+        if (calls_ == window_.size()) {
+            failures_ -= window_[next_] ? 1 : 0;
+        } else {
+            calls_++;
+        }
+        window_[next_] = failed;
+        failures_ += failed ? 1 : 0;
+        next_ = (next_ + 1) % window_.size();
+
+        if (calls_ >= options_.minimumCalls &&
+            static_cast<double>(failures_) >=
+                options_.failureRateThreshold * static_cast<double>(calls_)) {
+            trip();
+        }
+    }
+
+    void trip() {
+        state_ = State::Open;
+        openUntil_ = Clock::now() + options_.openDuration;
+        probeInFlight_ = false;
+    }
+
+    void reset() {
+        state_ = State::Closed;
+        std::fill(window_.begin(), window_.end(), false);
+        calls_ = 0;
+        failures_ = 0;
+        next_ = 0;
+        probeInFlight_ = false;
+    }
+
+    Options options_;
+    State state_ = State::Closed;
+    Clock::time_point openUntil_{};
+    bool probeInFlight_ = false;
+
+    // Ring buffer of recent outcomes (true = failed)
+    std::vector<bool> window_;
+    size_t calls_ = 0;
+    size_t failures_ = 0;
+    size_t next_ = 0;
+    mutable std::mutex mutex_;
+};
+
+}  // namespace cycling::utils
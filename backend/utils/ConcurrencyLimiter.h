@@ -0,0 +1,79 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+
+namespace cycling::utils {
+
+/**
+ * @brief Thread-safe cap on the number of requests in progress (admission control)
+ *
+ * tryAcquire() never blocks: it either hands out a Permit that releases its slot when
+ * destroyed, or returns std::nullopt so the caller can reject the request right away
+ * (queueing it would only make it time out later). A limit of 0 disables the cap.
+ * The limiter must outlive the permits it hands out.
+ */
+class ConcurrencyLimiter {
+   public:
+    class Permit {
+       public:
+        Permit(Permit&& other) noexcept : limiter_(other.limiter_) { other.limiter_ = nullptr; }
+        Permit& operator=(Permit&& other) noexcept {
+            if (this != &other) {
+                release();
+                limiter_ = other.limiter_;
+                other.limiter_ = nullptr;
+            }
+            return *this;
+        }
+        ~Permit() { release(); }
+
+        Permit(const Permit&) = delete;
+        Permit& operator=(const Permit&) = delete;
+
+       private:
+        friend class ConcurrencyLimiter;
+        explicit Permit(ConcurrencyLimiter* limiter) : limiter_(limiter) {}
+
+        void release() {
+            if (limiter_) {
+                limiter_->inFlight_.fetch_sub(1, std::memory_order_acq_rel);
+                limiter_ = nullptr;
+            }
+        }
+
+        ConcurrencyLimiter* limiter_;
+    };
+
+    explicit ConcurrencyLimiter(size_t limit) : limit_(limit) {}
+
+    /**
+     * @brief Take a slot if fewer than `limit` permits are outstanding
+     *
+     * @return std::optional<Permit>
+     */
+    std::optional<Permit> tryAcquire() {
+        size_t current = inFlight_.load(std::memory_order_relaxed);
+        do {
+            if (limit_ > 0 && current >= limit_) {
+                rejected_.fetch_add(1, std::memory_order_relaxed);
+                return std::nullopt;
+            }
+        } while (!inFlight_.compare_exchange_weak(current, current + 1, std::memory_order_acq_rel,
+                                                  std::memory_order_relaxed));
+        return Permit(this);
+    }
+
+    [[nodiscard]] size_t limit() const { return limit_; }
+    [[nodiscard]] size_t inFlight() const { return inFlight_.load(std::memory_order_relaxed); }
+    [[nodiscard]] uint64_t rejected() const { return rejected_.load(std::memory_order_relaxed); }
+
+   private:
+    size_t limit_;
+    std::atomic<size_t> inFlight_{0};
+    std::atomic<uint64_t> rejected_{0};
+};
+
+}  // namespace cycling::utils
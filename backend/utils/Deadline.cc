@@ -0,0 +1,40 @@
+#include "Deadline.h"
+
+#include <algorithm>
+
+namespace utils {
+
+namespace {
+
+thread_local Deadline* currentDeadline = nullptr;
+
+}  // namespace
+
+Deadline* Deadline::current() { return currentDeadline; }
+
+bool Deadline::currentExpired() { return currentDeadline && currentDeadline->expired(); }
+
+Deadline::Clock::time_point Deadline::clamp(Clock::time_point at) {
+    if (!currentDeadline) return at;
+    if (currentDeadline->cancelled()) return Clock::now();
+    return std::min(at, currentDeadline->at());
+}
+
+Deadline::Scope::Scope(Deadline* deadline) : previous_(currentDeadline) {
+    currentDeadline = deadline;
+}
+
+Deadline::Scope::~Scope() { currentDeadline = previous_; }
+
+bool Deadline::expired() const { return cancelled() || Clock::now() >= at_; }
+
+bool Deadline::cancelled() const {
+    if (cancelled_.load(std::memory_order_relaxed)) return true;
+    if (cancelCheck_ && cancelCheck_()) {
+        cancelled_.store(true, std::memory_order_relaxed);
+        return true;
+    }
+    return false;
+}
+
+}  // namespace utils
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+
+namespace utils {
+
+/**
+ * @brief 1 リクエスト分の期限と取り消し
+ *
+ * Deadline::Scope でスレッドの「現在の期限」に設定すると、候補ルートの評価 (findBestRoute)、
+ * 標高タイルの取得、スポット検索がそれを見て、期限を過ぎた後や取り消された後の処理を打ち切る
+ * (設定されていなければ何もしない)。取り消しは cancel() のほか、setCancelCheck() で渡した関数
+ * (クライアントが切断していれば true を返すなど) を expired() のたびに問い合わせて検出する。
+ */
+class Deadline {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit Deadline(Clock::time_point at) : at_(at) {}
+
+    static std::shared_ptr<Deadline> after(Clock::duration budget) {
+        return std::make_shared<Deadline>(Clock::now() + budget);
+    }
+
+    // このスレッドの現在の期限 (無ければ nullptr)
+    static Deadline* current();
+
+    // 現在の期限を過ぎたか取り消されていれば true (期限が無ければ false)
+    static bool currentExpired();
+
+    // at と現在の期限のうち早い方 (待ち時間の上限に使う)
+    static Clock::time_point clamp(Clock::time_point at);
+
+    /**
+     * @brief スコープの間、deadline をこのスレッドの現在の期限にする (入れ子可)
+     */
+    class Scope {
+       public:
+        explicit Scope(Deadline* deadline);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        Deadline* previous_;
+    };
+
+    // 設定は処理を始める前に行う (expired() と同時には呼ばない)。check は処理中のスレッドから
+    // 呼ばれるので、他のスレッドが更新する状態を読むならアトミックに読む
+    void setCancelCheck(std::function<bool()> check) { cancelCheck_ = std::move(check); }
+    void cancel() { cancelled_.store(true, std::memory_order_relaxed); }
+
+    [[nodiscard]] bool expired() const;
+    [[nodiscard]] bool cancelled() const;
+    [[nodiscard]] Clock::time_point at() const { return at_; }
+
+   private:
+    Clock::time_point at_;
+    std::function<bool()> cancelCheck_;
+    mutable std::atomic<bool> cancelled_{false};
+};
+
+}  // namespace utils
@@ -0,0 +1,93 @@
+#include "Geohash.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace utils {
+
+namespace {
+
+constexpr char kBase32[] = "0123456789bcdefghjkmnpqrstuvwxyz";
+constexpr int kMaxPrecision = 12;
+
+int base32Index(char c) {
+    for (int i = 0; i < 32; ++i) {
+        if (kBase32[i] == c) return i;
+    }
+    return -1;
+}
+
+}  // namespace
+
+std::string Geohash::encode(const services::Coordinate& coord, int precision) {
+    precision = std::clamp(precision, 1, kMaxPrecision);
+    double latLo = -90.0, latHi = 90.0;
+    double lonLo = -180.0, lonHi = 180.0;
+
+    std::string hash;
+    hash.reserve(precision);
+    bool evenBit = true;  // 経度から交互に二分する
+    int bit = 0;
+    int ch = 0;
+    while (static_cast<int>(hash.size()) < precision) {
+        if (evenBit) {
+            double mid = (lonLo + lonHi) / 2.0;
+            if (coord.lon >= mid) {
+                ch = (ch << 1) | 1;
+                lonLo = mid;
+            } else {
+                ch <<= 1;
+                lonHi = mid;
+            }
+        } else {
+            double mid = (latLo + latHi) / 2.0;
+            if (coord.lat >= mid) {
+                ch = (ch << 1) | 1;
+                latLo = mid;
+            } else {
+                ch <<= 1;
+                latHi = mid;
+            }
+        }
+        evenBit = !evenBit;
+        if (++bit == 5) {
+            hash.push_back(kBase32[ch]);
+            bit = 0;
+            ch = 0;
+        }
+    }
+    return hash;
+}
+
+Geohash::Cell Geohash::decode(const std::string& hash) {
+    Cell cell{-90.0, -180.0, 90.0, 180.0};
+    bool evenBit = true;
+    for (char c : hash) {
+        int index = base32Index(c);
+        if (index < 0) return {-90.0, -180.0, 90.0, 180.0};
+        for (int mask = 16; mask > 0; mask >>= 1) {
+            if (evenBit) {
+                double mid = (cell.minLon + cell.maxLon) / 2.0;
+                (index & mask ? cell.minLon : cell.maxLon) = mid;
+            } else {
+                double mid = (cell.minLat + cell.maxLat) / 2.0;
+                (index & mask ? cell.minLat : cell.maxLat) = mid;
+            }
+            evenBit = !evenBit;
+        }
+    }
+    return cell;
+}
+
+int Geohash::precisionForMaxCellSize(double meters) {
+    // 精度ごとのセル長辺 (赤道付近, メートル)
+    static constexpr double kCellLongSideMeters[kMaxPrecision] = {
+        5009400.0, 1252300.0, 156500.0, 39100.0, 4900.0, 1200.0,
+        152.9,     38.2,      4.8,      1.2,     0.149,  0.037};
+    for (int p = 1; p <= kMaxPrecision; ++p) {
+        if (kCellLongSideMeters[p - 1] <= meters) return p;
+    }
+    return kMaxPrecision;
+}
+
+}  // namespace utils
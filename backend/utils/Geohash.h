@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+#include "../services/Coordinate.h"
+
+namespace utils {
+
+class Geohash {
+   public:
+    struct Cell {
+        double minLat;
+        double minLon;
+        double maxLat;
+        double maxLon;
+
+        services::Coordinate center() const {
+            return {(minLat + maxLat) / 2.0, (minLon + maxLon) / 2.0};
+        }
+    };
+
+    // 座標を指定した文字数 (1〜12) の Geohash にエンコードします
+    static std::string encode(const services::Coordinate& coord, int precision);
+
+    // Geohash が表すセルの範囲を返します (不正な文字を含む場合は全球)
+    static Cell decode(const std::string& hash);
+
+    // セルの長辺が meters 以下になる最小の精度 (= 最も大きいセル) を返します
+    static int precisionForMaxCellSize(double meters);
+};
+
+}  // namespace utils
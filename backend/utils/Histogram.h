@@ -0,0 +1,94 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace cycling::utils {
+
+/**
+ * @brief Fixed-bucket histogram with lock-free recording
+ *
+ * Buckets are defined by their inclusive upper bounds (Prometheus "le" semantics) plus an
+ * implicit +Inf bucket. observe() is a binary search and two relaxed atomic additions, so it can
+ * be called from request threads without taking a lock.
+ */
+class Histogram {
+   public:
+    struct Snapshot {
+        std::vector<double> upperBounds;
+        std::vector<uint64_t> counts;  // Per bucket (not cumulative); last entry is +Inf
+        uint64_t count = 0;
+        double sum = 0.0;
+    };
+
+    explicit Histogram(std::vector<double> upperBounds)
+        : upperBounds_(std::move(upperBounds)),
+          buckets_(std::make_unique<std::atomic<uint64_t>[]>(upperBounds_.size() + 1)) {
+        std::sort(upperBounds_.begin(), upperBounds_.end());
+    }
+
+    /**
+     * @brief Request-latency buckets in seconds (1ms to 30s)
+     */
+    static std::vector<double> latencyBuckets() {
+        return {0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1,
+                0.25,  0.5,    1.0,   2.5,  5.0,   10.0, 30.0};
+    }
+
+    void observe(double value) {
+        size_t index = std::lower_bound(upperBounds_.begin(), upperBounds_.end(), value) -
+                       upperBounds_.begin();
+        buckets_[index].fetch_add(1, std::memory_order_relaxed);
+        sum_.fetch_add(value, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Copy the current counts (buckets are read individually, not as one atomic unit)
+     */
+    Snapshot snapshot() const {
+        Snapshot snapshot;
+        snapshot.upperBounds = upperBounds_;
+        snapshot.counts.reserve(upperBounds_.size() + 1);
+        for (size_t i = 0; i <= upperBounds_.size(); ++i) {
+            uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+            snapshot.counts.push_back(n);
+            snapshot.count += n;
+        }
+        snapshot.sum = sum_.load(std::memory_order_relaxed);
+        return snapshot;
+    }
+
+   private:
+    std::vector<double> upperBounds_;
+    std::unique_ptr<std::atomic<uint64_t>[]> buckets_;
+    std::atomic<double> sum_{0.0};
+};
+
+/**
+ * @brief Records the lifetime of the scope, in seconds, into a histogram
+ */
+class ScopedTimer {
+   public:
+    explicit ScopedTimer(Histogram& histogram)
+        : histogram_(histogram), start_(std::chrono::steady_clock::now()) {}
+    // 計測を始めた時刻を指定する (キューで待った時間も含める場合など)
+    ScopedTimer(Histogram& histogram, std::chrono::steady_clock::time_point start)
+        : histogram_(histogram), start_(start) {}
+    ~ScopedTimer() {
+        histogram_.observe(
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start_).count());
+    }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    Histogram& histogram_;
+    std::chrono::steady_clock::time_point start_;
+};
+
+}  // namespace cycling::utils
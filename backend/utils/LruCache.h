@@ -4,6 +4,8 @@
 #include <mutex>
 #include <optional>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 namespace cycling::utils {
 
@@ -36,6 +38,17 @@ class LruCache {
         return it->second->second;
     }
 
+    /**
+     * @brief Check whether a key is cached without changing the access order
+     *
+     * @param key
+     * @return true if the key is in the cache
+     */
+    bool contains(const K& key) const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return map_.find(key) != map_.end();
+    }
+
     /**
      * @brief Insert or update an item in the cache
      *
@@ -99,6 +112,23 @@ class LruCache {
         return list_.size();
     }
 
+    /**
+     * @brief Get maximum number of items
+     *
+     * @return size_t
+     */
+    size_t capacity() const { return capacity_; }
+
+    /**
+     * @brief Copy all items, most recently used first (does not change access order)
+     *
+     * @return std::vector<std::pair<K, V>>
+     */
+    std::vector<std::pair<K, V>> snapshot() const {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return std::vector<std::pair<K, V>>(list_.begin(), list_.end());
+    }
+
    private:
     size_t capacity_;
     mutable std::mutex mutex_;
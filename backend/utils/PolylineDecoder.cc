@@ -1,48 +1,87 @@
 #include "PolylineDecoder.h"
 
+#include <bit>
 #include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 namespace utils {
 
+namespace {
+
+// これ未満のバイトは varint の終端 (値 - 63 が 0x20 未満)
+constexpr char kContinuationMin = 63 + 0x20;
+
+// 1 つの varint をデコードします。入力の途中で終わった場合はそこまでの値を返します
+inline int decodeValue(const char*& p, const char* end) {
+    uint32_t result = 0;
+    int shift = 0;
+    int b = 0;
+    do {
+        if (p == end) break;  // Prevent buffer overrun
+        b = *p++ - 63;
+        if (shift < 32) result |= static_cast<uint32_t>(b & 0x1f) << shift;
+        shift += 5;
+    } while (b >= 0x20);
+    int value = static_cast<int>(result);
+    return (value & 1) ? ~(value >> 1) : (value >> 1);
+}
+
+}  // namespace
+
 std::vector<services::Coordinate> PolylineDecoder::decode(const std::string& encodedPolyline,
                                                           double precision) {
-    std::vector<services::Coordinate> coordinates;
-    size_t index = 0;
-    size_t len = encodedPolyline.length();
+    std::vector<services::Coordinate> coordinates(countPoints(encodedPolyline));
+    coordinates.resize(decodeInto(encodedPolyline, coordinates, precision));
+    return coordinates;
+}
+
+size_t PolylineDecoder::countPoints(std::string_view encodedPolyline) {
+    const char* data = encodedPolyline.data();
+    size_t len = encodedPolyline.size();
+    size_t terminators = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    // 有効な文字は 63..126 なので符号付き比較で足りる
+    const __m128i threshold = _mm_set1_epi8(kContinuationMin);
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmplt_epi8(chunk, threshold)));
+        terminators += static_cast<size_t>(std::popcount(mask));
+    }
+#endif
+    for (; i < len; ++i) {
+        terminators += data[i] < kContinuationMin ? 1 : 0;
+    }
+
+    // 末尾の途中で切れた varint も decode() では 1 つの値として扱われる
+    size_t values = terminators;
+    if (len > 0 && data[len - 1] >= kContinuationMin) values++;
+    return (values + 1) / 2;
+}
+
+size_t PolylineDecoder::decodeInto(std::string_view encodedPolyline,
+                                   std::span<services::Coordinate> out, double precision) {
+    const char* p = encodedPolyline.data();
+    const char* end = p + encodedPolyline.size();
     int lat = 0;
     int lng = 0;
+    size_t count = 0;
+    // 除算はループ外で 1 回だけ
+    const double scale = 1.0 / precision;
 
-    while (index < len) {
-        int b;
-        int shift = 0;
-        int result = 0;
-        do {
-            if (index >= len) break;  // Prevent buffer overrun
-            b = encodedPolyline[index++] - 63;
-            result |= (b & 0x1f) << shift;
-            shift += 5;
-        } while (b >= 0x20);
-        int dlat = ((result & 1) ? ~(result >> 1) : (result >> 1));
-        lat += dlat;
-
-        shift = 0;
-        result = 0;
-        do {
-            if (index >= len) break;  // Prevent buffer overrun
-            b = encodedPolyline[index++] - 63;
-            result |= (b & 0x1f) << shift;
-            shift += 5;
-        } while (b >= 0x20);
-        int dlng = ((result & 1) ? ~(result >> 1) : (result >> 1));
-        lng += dlng;
-
-        services::Coordinate coord;
-        coord.lat = static_cast<double>(lat) / precision;
-        coord.lon = static_cast<double>(lng) / precision;
-        coordinates.push_back(coord);
+    while (p < end && count < out.size()) {
+        lat += decodeValue(p, end);
+        lng += decodeValue(p, end);
+        out[count].lat = static_cast<double>(lat) * scale;
+        out[count].lon = static_cast<double>(lng) * scale;
+        count++;
     }
-
-    return coordinates;
+    return count;
 }
 
 std::string PolylineDecoder::encode(const std::vector<services::Coordinate>& points,
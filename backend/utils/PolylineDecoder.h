@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <span>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "../services/Coordinate.h"
@@ -14,6 +17,15 @@ class PolylineDecoder {
     static std::vector<services::Coordinate> decode(const std::string& encodedPolyline,
                                                     double precision = 1e5);
 
+    // デコード後の座標数を返します (varint の終端バイトを数えるだけで値は復元しない)
+    // SSE2 が使える場合は 16 バイトずつ判定します
+    static size_t countPoints(std::string_view encodedPolyline);
+
+    // 呼び出し側のバッファに直接デコードします。out に収まる分だけ書き込み、書き込んだ座標数を
+    // 返します。countPoints() の結果でバッファを確保すれば、再確保なしで全体をデコードできます
+    static size_t decodeInto(std::string_view encodedPolyline, std::span<services::Coordinate> out,
+                             double precision = 1e5);
+
     // 座標のベクターをポリライン文字列にエンコードします
     static std::string encode(const std::vector<services::Coordinate>& points,
                               double precision = 1e5);
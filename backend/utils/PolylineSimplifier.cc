@@ -0,0 +1,111 @@
+#include "PolylineSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace utils {
+
+namespace {
+
+constexpr double kMetersPerDegreeLat = 110540.0;
+constexpr double kMetersPerDegreeLonAtEquator = 111320.0;
+constexpr double kEarthCircumferenceMeters = 40075016.686;
+constexpr int kTileSizePixels = 256;
+
+struct Point {
+    double x;
+    double y;
+};
+
+// 点 p と線分 ab の距離の 2 乗
+double segmentDistanceSquared(const Point& p, const Point& a, const Point& b) {
+    double dx = b.x - a.x;
+    double dy = b.y - a.y;
+    double lengthSquared = dx * dx + dy * dy;
+    double t = 0.0;
+    if (lengthSquared > 0.0) {
+        t = std::clamp(((p.x - a.x) * dx + (p.y - a.y) * dy) / lengthSquared, 0.0, 1.0);
+    }
+    double ex = p.x - (a.x + t * dx);
+    double ey = p.y - (a.y + t * dy);
+    return ex * ex + ey * ey;
+}
+
+}  // namespace
+
+std::vector<services::Coordinate> PolylineSimplifier::simplify(
+    std::span<const services::Coordinate> path, double toleranceMeters) {
+    if (path.size() <= 2 || toleranceMeters <= 0.0) {
+        return {path.begin(), path.end()};
+    }
+
+    // ルート周辺の正距円筒図法で平面座標 (m) に変換する
+    double lat0 = path.front().lat;
+    double lonScale = kMetersPerDegreeLonAtEquator * std::cos(lat0 * M_PI / 180.0);
+    std::vector<Point> points(path.size());
+    for (size_t i = 0; i < path.size(); ++i) {
+        points[i] = {(path[i].lon - path.front().lon) * lonScale,
+                     (path[i].lat - lat0) * kMetersPerDegreeLat};
+    }
+
+    // 再帰の代わりに区間のスタックで処理する (長いルートでもスタックを使い切らない)
+    std::vector<bool> keep(path.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+    double toleranceSquared = toleranceMeters * toleranceMeters;
+    std::vector<std::pair<size_t, size_t>> stack{{0, path.size() - 1}};
+    while (!stack.empty()) {
+        auto [first, last] = stack.back();
+        stack.pop_back();
+
+        double maxDistance = 0.0;
+        size_t farthest = first;
+        for (size_t i = first + 1; i < last; ++i) {
+            double distance = segmentDistanceSquared(points[i], points[first], points[last]);
+            if (distance > maxDistance) {
+                maxDistance = distance;
+                farthest = i;
+            }
+        }
+        if (maxDistance > toleranceSquared) {
+            keep[farthest] = true;
+            if (farthest - first > 1) stack.emplace_back(first, farthest);
+            if (last - farthest > 1) stack.emplace_back(farthest, last);
+        }
+    }
+
+    std::vector<services::Coordinate> simplified;
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (keep[i]) simplified.push_back(path[i]);
+    }
+    return simplified;
+}
+
+double PolylineSimplifier::metersPerPixel(int zoom, double latitude) {
+    return kEarthCircumferenceMeters * std::cos(latitude * M_PI / 180.0) /
+           (kTileSizePixels * std::ldexp(1.0, zoom));
+}
+
+double PolylineSimplifier::overviewTolerance(std::span<const services::Coordinate> path,
+                                             double viewportPixels) {
+    if (path.empty() || viewportPixels <= 0.0) return 0.0;
+
+    double minLat = path.front().lat;
+    double maxLat = minLat;
+    double minLon = path.front().lon;
+    double maxLon = minLon;
+    for (const auto& point : path) {
+        minLat = std::min(minLat, point.lat);
+        maxLat = std::max(maxLat, point.lat);
+        minLon = std::min(minLon, point.lon);
+        maxLon = std::max(maxLon, point.lon);
+    }
+    double midLat = (minLat + maxLat) / 2.0;
+    double height = (maxLat - minLat) * kMetersPerDegreeLat;
+    double width =
+        (maxLon - minLon) * kMetersPerDegreeLonAtEquator * std::cos(midLat * M_PI / 180.0);
+    return std::max(height, width) / viewportPixels;
+}
+
+}  // namespace utils
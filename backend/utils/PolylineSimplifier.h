@@ -0,0 +1,26 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include "../services/Coordinate.h"
+
+namespace utils {
+
+class PolylineSimplifier {
+   public:
+    // Douglas-Peucker 法で、元の線から toleranceMeters 以上離れない範囲で頂点を間引きます
+    // 始点と終点は常に残します
+    static std::vector<services::Coordinate> simplify(std::span<const services::Coordinate> path,
+                                                      double toleranceMeters);
+
+    // Web メルカトルのズーム zoom で 1 ピクセルに相当する地上距離 (m)
+    static double metersPerPixel(int zoom, double latitude);
+
+    // ルート全体を viewportPixels 程度の大きさで表示したときの 1 ピクセル (m)
+    // 初期表示用の粗いジオメトリの許容誤差に使います
+    static double overviewTolerance(std::span<const services::Coordinate> path,
+                                    double viewportPixels = 1024.0);
+};
+
+}  // namespace utils
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+namespace cycling::utils {
+
+/**
+ * @brief Thread-safe token bucket rate limiter
+ *
+ * Tokens are refilled continuously at `ratePerSecond` up to `burst`. Callers never block:
+ * tryAcquire() either takes a token or returns false, and timeUntilAvailable() tells a
+ * scheduler how long to wait before the next token appears.
+ */
+class TokenBucket {
+   public:
+    using Clock = std::chrono::steady_clock;
+
+    TokenBucket(double ratePerSecond, double burst)
+        : ratePerSecond_(std::max(ratePerSecond, 0.0)),
+          burst_(std::max(burst, 1.0)),
+          tokens_(burst_),
+          lastRefill_(Clock::now()) {}
+
+    /**
+     * @brief Take one token if available
+     *
+     * @return true if a token was consumed
+     */
+    bool tryAcquire() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refill(Clock::now());
+        if (tokens_ >= 1.0) {
+            tokens_ -= 1.0;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief Time until at least one token is available (zero if one is available now)
+     *
+     * @return Clock::duration
+     */
+    Clock::duration timeUntilAvailable() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refill(Clock::now());
+        if (tokens_ >= 1.0) {
+            return Clock::duration::zero();
+        }
+        if (ratePerSecond_ <= 0.0) {
+            return Clock::duration::max();
+        }
+        auto seconds = std::chrono::duration<double>((1.0 - tokens_) / ratePerSecond_);
+        return std::chrono::duration_cast<Clock::duration>(seconds) + Clock::duration(1);
+    }
+
+    /**
+     * @brief Change the refill rate (tokens already accumulated are kept)
+     *
+     * @param ratePerSecond
+     * @param burst
+     */
+    void setRate(double ratePerSecond, double burst) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        refill(Clock::now());
+        ratePerSecond_ = std::max(ratePerSecond, 0.0);
+        burst_ = std::max(burst, 1.0);
+        tokens_ = std::min(tokens_, burst_);
+    }
+
+   private:
+    void refill(Clock::time_point now) {
+        std::chrono::duration<double> elapsed = now - lastRefill_;
+        tokens_ = std::min(burst_, tokens_ + elapsed.count() * ratePerSecond_);
+        lastRefill_ = now;
+    }
+
+    double ratePerSecond_;
+    double burst_;
+    double tokens_;
+    Clock::time_point lastRefill_;
+    std::mutex mutex_;
+};
+
+}  // namespace cycling::utils
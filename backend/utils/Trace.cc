@@ -0,0 +1,209 @@
+#include "Trace.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+namespace utils {
+
+namespace {
+
+struct ThreadState {
+    Trace* trace = nullptr;
+    int span = Trace::kNoSpan;
+};
+thread_local ThreadState tls;
+
+uint32_t threadTag() {
+    thread_local uint32_t tag =
+        static_cast<uint32_t>(std::hash<std::thread::id>()(std::this_thread::get_id()));
+    return tag;
+}
+
+double millis(Trace::Clock::duration d) {
+    return std::chrono::duration<double, std::milli>(d).count();
+}
+
+double micros(Trace::Clock::duration d) {
+    return std::chrono::duration<double, std::micro>(d).count();
+}
+
+}  // namespace
+
+Trace::Trace(size_t maxSpans) : origin_(Clock::now()), maxSpans_(maxSpans) {
+    spans_.reserve(std::min<size_t>(maxSpans_, 256));
+}
+
+Trace* Trace::current() { return tls.trace; }
+
+int Trace::currentSpan() { return tls.span; }
+
+Trace::Scope::Scope(Trace* trace, int parent)
+    : previousTrace_(tls.trace), previousSpan_(tls.span) {
+    tls.trace = trace;
+    tls.span = parent;
+}
+
+Trace::Scope::~Scope() {
+    tls.trace = previousTrace_;
+    tls.span = previousSpan_;
+}
+
+int Trace::open(const char* name, int parent) {
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spans_.size() >= maxSpans_) {
+        dropped_++;
+        return kNoSpan;
+    }
+    spans_.push_back({name, {}, parent, now, now, false, threadTag()});
+    return static_cast<int>(spans_.size() - 1);
+}
+
+void Trace::close(int index, std::string detail, AllocationCount allocations) {
+    if (index == kNoSpan) return;
+    auto now = Clock::now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto& span = spans_[index];
+    span.end = now;
+    span.closed = true;
+    span.detail = std::move(detail);
+    span.allocations = allocations;
+}
+
+int Trace::add(const char* name, int parent, Clock::time_point start, Clock::time_point end,
+               std::string detail) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (spans_.size() >= maxSpans_) {
+        dropped_++;
+        return kNoSpan;
+    }
+    spans_.push_back({name, std::move(detail), parent, start, end, true, threadTag()});
+    return static_cast<int>(spans_.size() - 1);
+}
+
+std::vector<Trace::Span> Trace::spans() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return spans_;
+}
+
+size_t Trace::dropped() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return dropped_;
+}
+
+std::string Trace::serverTiming() const {
+    struct Total {
+        Clock::duration duration{};
+        size_t count = 0;
+    };
+    std::vector<std::pair<std::string, Total>> totals;  // 最初に現れた順
+    std::unordered_map<std::string, size_t> index;
+    for (const auto& span : spans()) {
+        if (!span.closed) continue;
+        auto [it, inserted] = index.try_emplace(span.name, totals.size());
+        if (inserted) totals.emplace_back(span.name, Total{});
+        auto& total = totals[it->second].second;
+        total.duration += span.end - span.start;
+        total.count++;
+    }
+
+    std::string header;
+    char buffer[64];
+    for (const auto& [name, total] : totals) {
+        header += name;
+        if (total.count > 1) {
+            std::snprintf(buffer, sizeof(buffer), ";desc=\"x%zu\"", total.count);
+            header += buffer;
+        }
+        std::snprintf(buffer, sizeof(buffer), ";dur=%.2f, ", millis(total.duration));
+        header += buffer;
+    }
+    std::snprintf(buffer, sizeof(buffer), "total;dur=%.2f", millis(Clock::now() - origin_));
+    return header + buffer;
+}
+
+Json::Value Trace::toJson() const {
+    auto all = spans();
+    std::vector<std::vector<int>> children(all.size());
+    std::vector<int> roots;
+    for (size_t i = 0; i < all.size(); ++i) {
+        int parent = all[i].parent;
+        if (parent >= 0 && static_cast<size_t>(parent) < all.size()) {
+            children[parent].push_back(static_cast<int>(i));
+        } else {
+            roots.push_back(static_cast<int>(i));
+        }
+    }
+
+    auto now = Clock::now();
+    std::function<Json::Value(int)> node = [&](int i) {
+        const auto& span = all[i];
+        Json::Value json;
+        json["name"] = span.name;
+        if (!span.detail.empty()) json["detail"] = span.detail;
+        json["start_ms"] = millis(span.start - origin_);
+        json["duration_ms"] = millis((span.closed ? span.end : now) - span.start);
+        if (!span.closed) json["unfinished"] = true;
+        if (AllocationCounter::enabled()) {
+            json["allocations"] = static_cast<Json::UInt64>(span.allocations.allocations);
+            json["allocated_bytes"] = static_cast<Json::UInt64>(span.allocations.bytes);
+        }
+        if (!children[i].empty()) {
+            Json::Value& list = json["children"] = Json::Value(Json::arrayValue);
+            for (int child : children[i]) list.append(node(child));
+        }
+        return json;
+    };
+
+    Json::Value json;
+    json["total_ms"] = millis(now - origin_);
+    json["dropped_spans"] = static_cast<Json::UInt64>(dropped());
+    json["spans"] = Json::Value(Json::arrayValue);
+    for (int root : roots) json["spans"].append(node(root));
+    return json;
+}
+
+Json::Value Trace::toChromeTrace() const {
+    auto now = Clock::now();
+    Json::Value events(Json::arrayValue);
+    for (const auto& span : spans()) {
+        Json::Value event;
+        event["name"] = span.name;
+        event["cat"] = "route";
+        event["ph"] = "X";
+        event["ts"] = micros(span.start - origin_);
+        event["dur"] = micros((span.closed ? span.end : now) - span.start);
+        event["pid"] = 1;
+        event["tid"] = span.thread;
+        if (!span.detail.empty()) event["args"]["detail"] = span.detail;
+        if (AllocationCounter::enabled()) {
+            event["args"]["allocations"] = static_cast<Json::UInt64>(span.allocations.allocations);
+            event["args"]["allocated_bytes"] = static_cast<Json::UInt64>(span.allocations.bytes);
+        }
+        events.append(event);
+    }
+    Json::Value json;
+    json["traceEvents"] = events;
+    json["displayTimeUnit"] = "ms";
+    return json;
+}
+
+TraceSpan::TraceSpan(const char* name) : trace_(tls.trace) {
+    if (!trace_) return;
+    previousSpan_ = tls.span;
+    index_ = trace_->open(name, previousSpan_);
+    allocationsAtOpen_ = AllocationCounter::thisThread();
+    if (index_ != Trace::kNoSpan) tls.span = index_;
+}
+
+TraceSpan::~TraceSpan() {
+    if (!trace_) return;
+    trace_->close(index_, std::move(detail_),
+                  AllocationCounter::thisThread() - allocationsAtOpen_);
+    tls.span = previousSpan_;
+}
+
+}  // namespace utils
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <json/json.h>
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "AllocationCounter.h"
+
+namespace utils {
+
+/**
+ * @brief 1 リクエスト分のトレース (区間の記録)
+ *
+ * 区間はリクエストごとの配列に追記するだけで、親子関係は添字で持つ。
+ * Trace::Scope でスレッドの「現在のトレース」に設定すると、そのスレッドで作った TraceSpan が
+ * 自動的に記録される (設定されていなければ TraceSpan は何もしない)。
+ * 別スレッドのコールバックからは add() で開始・終了時刻を指定して記録する。
+ * 確保数の計測 (AllocationCounter) が有効なビルドでは、TraceSpan は区間内のヒープ確保も記録する。
+ */
+class Trace : public std::enable_shared_from_this<Trace> {
+   public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr int kNoSpan = -1;
+
+    struct Span {
+        const char* name;  // 文字列リテラル (Server-Timing の項目名にもなる)
+        std::string detail;
+        int parent;
+        Clock::time_point start;
+        Clock::time_point end;
+        bool closed;
+        uint32_t thread;
+        AllocationCount allocations{};  // 区間を開いたスレッドでの確保 (子の区間を含む)
+    };
+
+    explicit Trace(size_t maxSpans = 4096);
+
+    // このスレッドの現在のトレースと、その中で現在開いている区間
+    static Trace* current();
+    static int currentSpan();
+
+    /**
+     * @brief スコープの間、trace をこのスレッドの現在のトレースにする (入れ子可)
+     */
+    class Scope {
+       public:
+        explicit Scope(Trace* trace, int parent = kNoSpan);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+       private:
+        Trace* previousTrace_;
+        int previousSpan_;
+    };
+
+    // 上限に達した場合は kNoSpan を返し、dropped() に数える
+    int open(const char* name, int parent);
+    void close(int index, std::string detail = {}, AllocationCount allocations = {});
+    int add(const char* name, int parent, Clock::time_point start, Clock::time_point end,
+            std::string detail = {});
+
+    [[nodiscard]] std::vector<Span> spans() const;
+    [[nodiscard]] size_t dropped() const;
+
+    /**
+     * @brief Server-Timing ヘッダーの値
+     *
+     * 区間を名前ごとに集計し (同じ名前の区間の合計時間と件数)、最後にトレース開始からの
+     * 経過時間を total として付ける。例: `osrm;desc="x3";dur=12.4, total;dur=30.1`
+     */
+    [[nodiscard]] std::string serverTiming() const;
+
+    // 区間の木 (開始・所要時間はミリ秒、開始はトレース開始からの相対時刻)
+    [[nodiscard]] Json::Value toJson() const;
+
+    // chrome://tracing や Perfetto で開ける Trace Event 形式
+    [[nodiscard]] Json::Value toChromeTrace() const;
+
+   private:
+    Clock::time_point origin_;
+    size_t maxSpans_;
+
+    mutable std::mutex mutex_;
+    std::vector<Span> spans_;
+    size_t dropped_ = 0;
+};
+
+/**
+ * @brief 現在のトレースに、スコープの間の区間を記録する
+ *
+ * 現在開いている区間の子になり、スコープの間はこの区間が現在の区間になる。
+ */
+class TraceSpan {
+   public:
+    explicit TraceSpan(const char* name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+    // 終了時に区間へ付ける補足 (キャッシュの階層など)
+    void setDetail(std::string detail) { detail_ = std::move(detail); }
+    [[nodiscard]] bool active() const { return trace_ != nullptr; }
+
+   private:
+    Trace* trace_;
+    int index_ = Trace::kNoSpan;
+    int previousSpan_ = Trace::kNoSpan;
+    std::string detail_;
+    AllocationCount allocationsAtOpen_;
+};
+
+}  // namespace utils